@@ -3,6 +3,8 @@
 
 #include <stdint.h>
 
+#include "bat_objective.h"
+
 #define dimension 2
 
 /* Default values (can be overridden at runtime via CLI options). */
@@ -22,25 +24,60 @@
 #define Ub         5
 #define Lb         -5
 
+/*
+ * Build variant (`make fast`, `make pgo` pass -DBAT_BUILD=<name>), appended
+ * to the BENCH line as " build=<name>" so that the variants form separate
+ * series; empty for the baseline build.
+ */
+#define BAT_STR_(x) #x
+#define BAT_STR(x)  BAT_STR_(x)
+#ifdef BAT_BUILD
+#define BAT_BUILD_BENCH " build=" BAT_STR(BAT_BUILD)
+#else
+#define BAT_BUILD_BENCH ""
+#endif
+
+/*
+ * One bat of the AoS layout. Only the state that survives an iteration is
+ * stored: the frequency is drawn and used inside update_bat().
+ */
 typedef struct {
     double x_i[dimension];
     double v_i[dimension];
-    double f_i;
     double A_i;
     double r_i;
     double f_value;
 
     /* Per-bat RNG state (makes OpenMP/MPI runs deterministic and thread-safe). */
     uint32_t rng_state;
+
+    /* Cached second Box-Muller variate (BAT_RNG_NO_SPARE when empty). */
+    double rng_spare;
 } Bat;
 
+/* Population aggregates (defined in bat_stats.h). */
+typedef struct BatStats BatStats;
+
 /* Core Bat Algorithm functions (implemented in src/bat_core.c).
  * These are shared by sequential / OpenMP / MPI implementations.
  */
 void initialize_bats(Bat bats[], int n_bats, Bat *best_bat);
-void update_bat(Bat bats[], int n_bats, const Bat *best_bat, int i, int t);
+void update_bat(Bat bats[], const Bat *best_bat, const BatStats *stats, const BatObjective *obj, int i, int t);
 
 /* Deterministic initializer used by all front-ends. */
-void initialize_bats_seeded(Bat bats[], int n_bats, Bat *best_bat, uint32_t seed);
+void initialize_bats_seeded(Bat bats[], int n_bats, Bat *best_bat, uint32_t seed, const BatObjective *obj);
+
+/*
+ * Initializes bats [begin, end) only (same values; safe on disjoint ranges).
+ * bats[i] gets RNG stream index_offset + i (its global index).
+ */
+void initialize_bats_range(Bat bats[], int begin, int end, long index_offset, uint32_t seed, const BatObjective *obj);
+
+/*
+ * Block partition of n bats over `parts` workers (MPI ranks): worker `part`
+ * owns the global indices [*begin, *begin + *count). The first n % parts
+ * workers get one extra bat, so n does not need to be a multiple of parts.
+ */
+void bat_partition(int n, int parts, int part, long *begin, int *count);
 
 #endif
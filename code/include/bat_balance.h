@@ -0,0 +1,108 @@
+#ifndef BAT_BALANCE_H
+#define BAT_BALANCE_H
+
+#include <mpi.h>
+
+/*
+ * bat_balance.h
+ *
+ * Dynamic load balancing of the MPI version (--rebalance-every K).
+ *
+ * Every rank owns a contiguous block of global indices; the blocks start
+ * as bat_partition(). Each rank times the update of its bats. After every
+ * K-th iteration the ranks allgather the update time of the last K
+ * iterations. If the slowest rank took more than BAT_BALANCE_TOL times the
+ * mean, the blocks are resized in proportion to the measured speed of each
+ * rank (bats per second of update), still in global index order, and the
+ * bats that change owner move with ONE MPI_Alltoallv of their checkpoint
+ * records (bat_ckpt.h: position, velocity, loudness, pulse rate, value and
+ * RNG state). A bat keeps its global index and its RNG stream, and the
+ * statistics do not depend on which rank adds a bat, so a rebalanced run
+ * computes the same trajectory bit for bit (--verify).
+ *
+ * BENCH fields (bat_balance_print_bench):
+ *   rebalance_every=K rebalances=<n> migrated_bats=<N> migrate_s=<t>
+ *   imbalance_first=<x> imbalance_last=<x> local_bats_min=<a> local_bats_max=<b>
+ * - rebalances     : partitions changed
+ * - migrated_bats  : bats that changed owner, over all the rebalances
+ * - migrate_s      : time spent planning and moving (slowest rank)
+ * - imbalance_*    : max / mean update time of the first and of the last
+ *                    measuring window (first: the static partition)
+ * - local_bats_*   : smallest and largest block of the final partition
+ *
+ * Only compiled into the MPI binary.
+ */
+
+/* Imbalance (max / mean update time) above which the blocks are resized. */
+#define BAT_BALANCE_TOL 1.1
+
+typedef struct {
+    MPI_Comm comm;
+    int rank;
+    int size;
+    int every;              /* K, 0: never */
+    double busy;            /* update time of this rank in the current window */
+    long *begin;            /* current block of every rank */
+    int *count;
+    long *next_begin;       /* planned blocks (bat_balance_plan) */
+    int *next_count;
+    int rebalances;
+    long migrated;
+    double migrate_s;       /* this rank */
+    double imbalance_first; /* 0: no window measured */
+    double imbalance_last;
+} BatBalance;
+
+/*
+ * Starts from the static partition of n_bats bats (bat_partition).
+ * Aborts if the arrays cannot be allocated.
+ *
+ * Parameters:
+ *   - b      : balancer
+ *   - comm   : communicator of the ranks holding the population
+ *   - every  : --rebalance-every K (0: never)
+ *   - n_bats : global number of bats
+ */
+void bat_balance_init(BatBalance *b, MPI_Comm comm, int every, int n_bats);
+
+void bat_balance_free(BatBalance *b);
+
+/* Block of this rank: global index of its first bat and number of bats. */
+void bat_balance_local(const BatBalance *b, long *begin, int *local_n);
+
+/* Adds update time of this rank to the current window. */
+static inline void bat_balance_add_busy(BatBalance *b, double seconds) {
+    b->busy += seconds;
+}
+
+/* 1 if the window ends after iteration t (same answer on every rank). */
+static inline int bat_balance_due(const BatBalance *b, int t) {
+    return b->every > 0 && (t + 1) % b->every == 0;
+}
+
+/*
+ * Collective: ends the window (allgather of the update times) and plans
+ * the new blocks. Returns 1 if the partition changes: the caller stores its
+ * bats and calls bat_balance_migrate(); 0 if it stays.
+ */
+int bat_balance_plan(BatBalance *b);
+
+/*
+ * Collective: moves the records to their new owners and makes the planned
+ * partition the current one.
+ *
+ * Parameters:
+ *   - b    : balancer (after bat_balance_plan() returned 1)
+ *   - send : records of the current block of this rank
+ *   - recv : output, records of its planned block (next_count[rank] records)
+ *   - dim  : problem dimension (record size BAT_CKPT_RECORD(dim))
+ */
+void bat_balance_migrate(BatBalance *b, const double *send, double *recv, int dim);
+
+/* Collective: combines the migration times (max over the ranks) for the report. */
+void bat_balance_finish(BatBalance *b);
+
+/* Appends the BENCH fields (see above); nothing without --rebalance-every. */
+void bat_balance_print_bench(const BatBalance *b);
+
+#endif
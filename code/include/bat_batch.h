@@ -0,0 +1,62 @@
+#ifndef BAT_BATCH_H
+#define BAT_BATCH_H
+
+#include "bat_objective.h"
+#include "bat_options.h"
+
+/*
+ * bat_batch.h
+ *
+ * Run specifications of the batch front-end (batch_bat): a list of small,
+ * independent optimizations.
+ *
+ * A spec file has one run per line, written with the command-line options
+ * of the other programs (bat_options.h), e.g.
+ *
+ *   # seed and objective per run, everything else from the command line
+ *   --seed 1 --objective rastrigin --dim 8
+ *   --seed 2 --objective ackley --dim 8 --target -1e-3
+ *   --n-bats 64 --iters 20000
+ *
+ * A line starts from the options given on the command line, with seed
+ * (command-line seed + run index), so a line without --seed still gets its
+ * own stream. Blank lines and text after '#' are ignored. --traj,
+ * --checkpoint, --restart and --verify are not available per run.
+ */
+
+typedef struct {
+    BatOptions opt;                 /* options of the run */
+    const BatObjective *objective;  /* resolved opt.objective */
+} BatRunSpec;
+
+typedef struct {
+    BatRunSpec *runs;
+    long n_runs;
+    char *text;                     /* contents of the spec file (the options point into it) */
+} BatBatch;
+
+/*
+ * Reads and validates a spec file.
+ *
+ * Parameters:
+ *   - b        : output batch
+ *   - path     : spec file
+ *   - defaults : command-line options (starting point of every line)
+ *   - report   : print errors on stderr (MPI: rank 0 only)
+ *
+ * Returns 0, or -1 if the file cannot be read or a line is invalid.
+ */
+int bat_batch_load(BatBatch *b, const char *path, const BatOptions *defaults, int report);
+
+/*
+ * n_runs runs of the command-line options, with seeds defaults->seed + k.
+ * Returns 0, or -1 if the options are invalid or memory is exhausted.
+ */
+int bat_batch_repeat(BatBatch *b, long n_runs, const BatOptions *defaults, int report);
+
+/* 1 if the options use a feature a batch run does not support (reported). */
+int bat_batch_unsupported(const BatOptions *o, int report);
+
+void bat_batch_free(BatBatch *b);
+
+#endif
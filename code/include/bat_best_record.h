@@ -0,0 +1,72 @@
+#ifndef BAT_BEST_RECORD_H
+#define BAT_BEST_RECORD_H
+
+#include <mpi.h>
+
+#include "bat_stats.h"
+
+/*
+ * bat_best_record.h
+ *
+ * Fused global-best exchange for the MPI front-ends (mpi_bat, hybrid_bat).
+ *
+ * One record carries everything the next iteration needs from the other
+ * ranks, as doubles:
+ *
+ *   [A_sum, r_sum, count, stop_votes, best_value, best_index, x_0 .. x_{dim-1}]
+ *
+ * It is reduced with ONE MPI_Allreduce on a contiguous derived datatype and
+ * a user-defined op that sums the statistics and keeps the best
+ * (value, index, x). Ties go to the smallest global index, like MPI_MAXLOC
+ * and bat_stats_merge(), so the op is commutative.
+ *
+ * The best index is a global bat index, exact as a double.
+ */
+
+enum {
+    BAT_REC_A_SUM = 0,
+    BAT_REC_R_SUM,
+    BAT_REC_COUNT,
+    BAT_REC_STOP,
+    BAT_REC_VALUE,
+    BAT_REC_INDEX,
+    BAT_REC_X
+};
+
+/* Doubles in one record of dimension dim. */
+#define BAT_BEST_RECORD_SIZE(dim) (BAT_REC_X + (dim))
+
+typedef struct {
+    MPI_Comm comm;
+    int dim;
+    double *rec;        /* BAT_BEST_RECORD_SIZE(dim) doubles */
+    MPI_Datatype type;  /* contiguous record */
+    MPI_Op op;          /* sum statistics + keep best */
+} BatBestRecord;
+
+/* Creates the datatype and the op (aborts on allocation failure). */
+void bat_best_record_init(BatBestRecord *br, MPI_Comm comm, int dim);
+
+/* Releases the datatype, the op and the buffer. */
+void bat_best_record_free(BatBestRecord *br);
+
+/* Packs the local statistics and the local best position into rec. */
+void bat_best_record_pack(const BatBestRecord *br, double *rec, const BatStats *stats, const double *local_x);
+
+/* Unpacks a reduced record: global statistics (finalized) and best position. */
+void bat_best_record_unpack(const BatBestRecord *br, const double *rec, BatStats *stats, double *best_x);
+
+/*
+ * Fused exchange: one MPI_Allreduce gives every rank the global statistics
+ * and the global best (value, index, position). Returns the best value.
+ *
+ * Parameters:
+ *   - br      : exchange buffers
+ *   - stats   : local statistics in, global statistics out (finalized;
+ *               best_index becomes the global best index)
+ *   - local_x : position of the local best (dim doubles)
+ *   - best_x  : output, position of the global best (dim doubles)
+ */
+double bat_best_exchange(BatBestRecord *br, BatStats *stats, const double *local_x, double *best_x);
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef BAT_BEST_SHM_H
+#define BAT_BEST_SHM_H
+
+#include <mpi.h>
+
+#include "bat_best_record.h"
+
+/*
+ * bat_best_shm.h
+ *
+ * Node-aware global-best exchange of mpi_bat (--best-exchange shm), built
+ * on the fused record (bat_best_record.h) and MPI-3 shared memory.
+ *
+ * The ranks of a node (MPI_Comm_split_type, MPI_COMM_TYPE_SHARED) share
+ * one window (MPI_Win_allocate_shared) holding a record slot per rank and
+ * one result slot:
+ *
+ *   1. every rank packs its local record into its own slot;
+ *   2. node barrier; the leader (node rank 0) combines the slots in node
+ *      rank order with the record op (MPI_Reduce_local) into the result;
+ *   3. the leaders reduce the node results with ONE MPI_Allreduce on the
+ *      communicator of the leaders (skipped on a single node);
+ *   4. node barrier; every rank unpacks the result slot.
+ *
+ * The inter-node collective has one participant per node instead of one
+ * per rank. The op is the one of the fused exchange (sums, best with ties
+ * to the smallest index), and A_sum is exact, so the trajectory is the
+ * same as with --best-exchange fused.
+ *
+ * If no node holds two ranks the window is not created and the exchange
+ * is the plain fused MPI_Allreduce.
+ *
+ * BENCH fields (bat_best_shm_print_bench):
+ *   shm_nodes=<N> shm_node_ranks=<R>
+ * - shm_nodes      : nodes, i.e. participants of the inter-node reduction
+ * - shm_node_ranks : most ranks on one node (1: fallback to fused)
+ */
+
+typedef struct {
+    MPI_Comm node;        /* ranks sharing memory with this one */
+    MPI_Comm leaders;     /* node rank 0 of every node; MPI_COMM_NULL elsewhere */
+    MPI_Win win;          /* node window, passive epoch (lock_all) */
+    double *slots;        /* node_size records + the result record */
+    int width;            /* doubles per record */
+    int node_rank;
+    int node_size;
+    int nodes;
+    int max_node_ranks;
+    int active;           /* 0: fallback to bat_best_exchange() */
+} BatBestShm;
+
+/*
+ * Collective on br->comm: splits it by node and allocates the windows.
+ * Aborts if the window cannot be allocated.
+ */
+void bat_best_shm_init(BatBestShm *s, const BatBestRecord *br);
+
+/* Collective: releases the window and the communicators. */
+void bat_best_shm_free(BatBestShm *s);
+
+/*
+ * Same contract as bat_best_exchange(): every rank gets the global
+ * statistics and the global best. Returns the best value.
+ *
+ * Parameters:
+ *   - s       : node window (bat_best_shm_init)
+ *   - br      : fused exchange buffers (datatype, op)
+ *   - stats   : local statistics in, global statistics out (finalized)
+ *   - local_x : position of the local best (dim doubles)
+ *   - best_x  : output, position of the global best (dim doubles)
+ */
+double bat_best_shm_exchange(BatBestShm *s, BatBestRecord *br, BatStats *stats, const double *local_x, double *best_x);
+
+/* Appends the BENCH fields (see above). */
+void bat_best_shm_print_bench(const BatBestShm *s);
+
+#endif
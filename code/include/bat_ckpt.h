@@ -0,0 +1,213 @@
+#ifndef BAT_CKPT_H
+#define BAT_CKPT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "bat.h"
+#include "bat_pop.h"
+#include "bat_stats.h"
+#include "bat_stop.h"
+
+/*
+ * bat_ckpt.h
+ *
+ * Checkpoint/restart of the whole optimizer state.
+ *
+ * --checkpoint FILE [--checkpoint-every K] saves the state after every K
+ * iterations (and once more at the end of the run); --restart FILE
+ * resumes a run from such a file. The file holds everything the next
+ * iteration reads: every bat (position, velocity, loudness, pulse rate,
+ * value and RNG state), the global best, the population statistics, the
+ * stall window of the stopping criteria and the iteration counter. A run
+ * restarted from a checkpoint therefore follows exactly the same
+ * trajectory as the uninterrupted run with the same number of threads and
+ * ranks (the loudness sums are rounded in worker order, so runs with
+ * other worker counts already differ in the last bits).
+ *
+ * File layout (native byte order):
+ *
+ *   header  : BatCkptHeader (136 bytes)
+ *   best_x  : dim doubles, position of the global best
+ *   records : n_bats records of BAT_CKPT_RECORD(dim) doubles, in global
+ *             index order:
+ *               x[dim], v[dim], A, r, f_value, rng_spare, rng_state
+ *             (rng_state is a uint32_t, stored exactly as a double)
+ *
+ * Records have a fixed size and do not depend on the layout or on the
+ * number of workers, so a file written by one front-end (AoS or SoA, any
+ * number of threads or ranks) can be restarted by any other, on another
+ * number of threads or ranks. The MPI
+ * front-ends read and write their own block of records with collective
+ * MPI-IO (bat_ckpt_mpi.h).
+ *
+ * --iters is still the total number of iterations: a run restarted after
+ * iteration T performs iterations T .. iters-1.
+ *
+ * A checkpoint is written to FILE.tmp and renamed over FILE once complete,
+ * so a job killed while writing keeps the previous checkpoint.
+ */
+
+#define BAT_CKPT_MAGIC   "BATCKPT1"
+#define BAT_CKPT_VERSION 1
+
+/* Default --checkpoint-every. */
+#define BAT_CKPT_EVERY 1000
+
+/* Doubles in the record of one bat. */
+#define BAT_CKPT_RECORD(dim) (2 * (dim) + 5)
+
+typedef struct {
+    char magic[8];          /* BAT_CKPT_MAGIC, not NUL-terminated */
+    uint32_t version;       /* BAT_CKPT_VERSION */
+    int32_t dim;
+    int64_t n_bats;
+    int64_t iteration;      /* iterations completed: the run resumes at t = iteration */
+    uint32_t seed;          /* seed of the original run (informative) */
+    int32_t reserved;
+
+    /* Population statistics after the last completed iteration */
+    double A_sum;
+    double r_sum;
+    double count;
+    double best_value;
+    int64_t best_index;     /* global index of the best bat */
+
+    /* Stall window of the stopping criteria (BatStopState) */
+    double stop_ref_value;
+    int64_t stop_ref_iter;
+
+    char objective[32];     /* objective name, NUL-terminated */
+} BatCkptHeader;
+
+typedef struct {
+    const char *path;       /* --checkpoint FILE, NULL: no checkpoints */
+    int every;              /* --checkpoint-every K */
+    const char *restart;    /* --restart FILE, NULL: fresh start */
+} BatCkptOptions;
+
+/* No checkpoint, no restart, BAT_CKPT_EVERY. */
+void bat_ckpt_defaults(BatCkptOptions *o);
+
+/*
+ * Consumes argv[*i] and its value if it is a checkpoint option, advancing
+ * *i past the value. Returns 1 if the option was consumed, 0 otherwise.
+ */
+int bat_ckpt_parse_option(BatCkptOptions *o, int argc, char **argv, int *i);
+
+/* 1 if a checkpoint is written after iteration t. */
+static inline int bat_ckpt_due(const BatCkptOptions *o, int t) {
+    return o->path != NULL && (t + 1) % o->every == 0;
+}
+
+/*
+ * Fills the header of the state after `iteration` completed iterations.
+ *
+ * Parameters:
+ *   - h         : header to fill
+ *   - n_bats    : global number of bats
+ *   - dim       : problem dimension
+ *   - iteration : iterations completed
+ *   - seed      : seed of the run
+ *   - stats     : global statistics and global best after the last iteration
+ *   - stop      : stall window of the stopping criteria
+ *   - objective : objective name
+ */
+void bat_ckpt_header_init(BatCkptHeader *h, long n_bats, int dim, int iteration, unsigned int seed,
+                          const BatStats *stats, const BatStopState *stop, const char *objective);
+
+/*
+ * Restores the statistics (finalized, global best included) and the stall
+ * window saved in a header.
+ */
+void bat_ckpt_header_restore(const BatCkptHeader *h, BatStats *stats, BatStopState *stop);
+
+/*
+ * Checks that a header can resume a run with these parameters (same
+ * population, dimension and objective, at most max_iters iterations done).
+ * Returns NULL if it can, otherwise a short description of the mismatch.
+ */
+const char *bat_ckpt_mismatch(const BatCkptHeader *h, long n_bats, int dim, const char *objective, int max_iters);
+
+/* Byte offset of the record of global bat i in a file of dimension dim. */
+size_t bat_ckpt_record_offset(int dim, long i);
+
+/*
+ * Copies bats [begin, end) to / from records (record k = bat begin + k).
+ * Disjoint ranges may be handled concurrently.
+ */
+void bat_ckpt_store_bats(double *records, const Bat bats[], int begin, int end);
+void bat_ckpt_store_pop(double *records, const BatPopulation *pop, int begin, int end);
+void bat_ckpt_load_bats(const double *records, Bat bats[], int begin, int end);
+void bat_ckpt_load_pop(const double *records, BatPopulation *pop, int begin, int end);
+
+/*
+ * Writes a complete checkpoint (header, best_x and the h->n_bats records)
+ * through path.tmp. Returns 0 on success, -1 on error (errno is set).
+ */
+int bat_ckpt_write(const char *path, const BatCkptHeader *h, const double *best_x, const double *records);
+
+/*
+ * Reads the header of a checkpoint (zeroed if the file is too short).
+ * Returns 0 on success, -1 if the file cannot be opened (errno is set).
+ */
+int bat_ckpt_read_header(const char *path, BatCkptHeader *h);
+
+/*
+ * Reads best_x (h->dim doubles) and all the records of a checkpoint whose
+ * header was read with bat_ckpt_read_header(). Returns 0 or -1 (errno).
+ */
+int bat_ckpt_read(const char *path, const BatCkptHeader *h, double *best_x, double *records);
+
+/*
+ * Serial restart: reads the checkpoint at path, checks it against the run
+ * (bat_ckpt_mismatch) and reads best_x and all its records. Prints the
+ * error and returns -1 if the run cannot resume from this file.
+ *
+ * Parameters:
+ *   - path      : checkpoint file (--restart)
+ *   - n_bats    : global number of bats of the run
+ *   - dim       : problem dimension of the run
+ *   - objective : objective name of the run
+ *   - max_iters : --iters of the run
+ *   - h         : output, header of the file
+ *   - best_x    : output, dim doubles
+ *   - records   : output, n_bats records
+ */
+int bat_ckpt_restore(const char *path, long n_bats, int dim, const char *objective, int max_iters,
+                     BatCkptHeader *h, double *best_x, double *records);
+
+/*
+ * Serial checkpoint of a whole AoS population after `iteration` completed
+ * iterations: fills the header and the records, then writes the file.
+ * Returns 0, or -1 if the file could not be written (reported; the
+ * previous checkpoint is kept).
+ *
+ * Parameters:
+ *   - o         : checkpoint options (o->path)
+ *   - records   : n_bats records (scratch)
+ *   - bats      : population
+ *   - n_bats    : number of bats
+ *   - iteration : iterations completed
+ *   - seed      : seed of the run
+ *   - stats     : statistics and best after the last iteration
+ *   - stop      : stall window of the stopping criteria
+ *   - objective : objective name
+ */
+int bat_ckpt_save_bats(const BatCkptOptions *o, double *records, const Bat bats[], int n_bats, int iteration,
+                       unsigned int seed, const BatStats *stats, const BatStopState *stop, const char *objective);
+
+/* Same as bat_ckpt_save_bats(), for the SoA store (best_x: position of the best). */
+int bat_ckpt_save_pop(const BatCkptOptions *o, double *records, const BatPopulation *pop, const double *best_x,
+                      int iteration, unsigned int seed, const BatStats *stats, const BatStopState *stop);
+
+/* "<path>.tmp" (malloc'ed, NULL if out of memory). */
+char *bat_ckpt_tmp_path(const char *path);
+
+/*
+ * BENCH fields: iteration the run resumed from (with --restart) and
+ * number of checkpoints written (with --checkpoint).
+ */
+void bat_ckpt_print_bench(const BatCkptOptions *o, int restart_iter, int written);
+
+#endif
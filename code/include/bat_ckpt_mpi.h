@@ -0,0 +1,83 @@
+#ifndef BAT_CKPT_MPI_H
+#define BAT_CKPT_MPI_H
+
+#include <mpi.h>
+
+#include "bat_ckpt.h"
+
+/*
+ * bat_ckpt_mpi.h
+ *
+ * Collective checkpoint I/O for the MPI front-ends (mpi_bat, hybrid_bat).
+ * Same file format as bat_ckpt.h.
+ *
+ * Every rank owns a contiguous block of global indices, so its records are
+ * one contiguous piece of the file: each rank writes (or reads) exactly
+ * its block with one collective MPI_File_write_at_all (read_at_all), and
+ * nothing is gathered on rank 0. Rank 0 also writes the header and best_x.
+ * The offset of a block only depends on its first global index, so a run
+ * can be restarted on any number of ranks.
+ *
+ * Only the thread that calls MPI (the master thread in the hybrid build)
+ * may call these functions. Errors abort the job. Only compiled into the
+ * MPI binaries.
+ */
+
+/*
+ * Collective: writes a checkpoint through path.tmp (renamed by rank 0).
+ *
+ * Parameters:
+ *   - comm    : communicator of the ranks holding the population
+ *   - path    : checkpoint file
+ *   - h       : header (same on all ranks)
+ *   - best_x  : position of the global best (h->dim doubles)
+ *   - records : records of the local bats
+ *   - begin   : global index of the first local bat
+ *   - local_n : number of local bats
+ */
+void bat_ckpt_mpi_write(MPI_Comm comm, const char *path, const BatCkptHeader *h, const double *best_x,
+                        const double *records, long begin, int local_n);
+
+/*
+ * Collective: checkpoint after `iteration` completed iterations, from the
+ * records of the local bats. The bcast exchange of mpi_bat leaves the
+ * local best in stats, so the global best index is reduced here (the
+ * smallest index holding best_value, as in bat_stats_merge).
+ *
+ * Parameters:
+ *   - comm      : communicator of the ranks holding the population
+ *   - o         : checkpoint options (o->path)
+ *   - records   : records of the local bats
+ *   - n_bats    : global number of bats
+ *   - dim       : problem dimension
+ *   - iteration : iterations completed
+ *   - seed      : seed of the run
+ *   - stats     : global sums, local or global best
+ *   - best_value : global best value
+ *   - stop      : stall window of the stopping criteria
+ *   - objective : objective name
+ *   - best_x    : position of the global best
+ *   - begin     : global index of the first local bat
+ *   - local_n   : number of local bats
+ */
+void bat_ckpt_mpi_save(MPI_Comm comm, const BatCkptOptions *o, const double *records, long n_bats, int dim,
+                       int iteration, unsigned int seed, const BatStats *stats, double best_value,
+                       const BatStopState *stop, const char *objective, const double *best_x,
+                       long begin, int local_n);
+
+/* Collective: every rank reads the header of a checkpoint (zeroed if the file is too short). */
+void bat_ckpt_mpi_read_header(MPI_Comm comm, const char *path, BatCkptHeader *h);
+
+/*
+ * Collective: reads the header of --restart and checks it against the run
+ * (bat_ckpt_mismatch). Returns 0, or -1 on every rank (reported by rank
+ * 0) if the run cannot resume from this file.
+ */
+int bat_ckpt_mpi_restore_header(MPI_Comm comm, const char *path, long n_bats, int dim, const char *objective,
+                                int max_iters, BatCkptHeader *h);
+
+/* Collective: reads best_x and the records of bats [begin, begin + local_n). */
+void bat_ckpt_mpi_read(MPI_Comm comm, const char *path, const BatCkptHeader *h, double *best_x,
+                       double *records, long begin, int local_n);
+
+#endif
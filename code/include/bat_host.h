@@ -0,0 +1,52 @@
+#ifndef BAT_HOST_H
+#define BAT_HOST_H
+
+#include <stdint.h>
+
+/*
+ * bat_host.h
+ *
+ * Placement of a run, recorded on its BENCH line so that timings can be
+ * traced back to the machine and the pinning they were measured with:
+ *
+ *   host=<name> cpus=<list> worker_cpus=<K> bind=<OMP_PROC_BIND> [places=<OMP_PLACES>] [hosts=<H>]
+ *
+ * - host        : host name (rank 0 for the MPI front-ends)
+ * - cpus        : union of the CPUs the workers (threads and ranks) were
+ *                 allowed to run on, as a range list (e.g. 0-3,8); on
+ *                 several nodes, the union of their CPU numbers
+ * - worker_cpus : most CPUs allowed to a single worker: 1 (2 with SMT and
+ *                 OMP_PLACES=cores) when every worker is pinned, the whole
+ *                 machine when nothing is bound
+ * - bind        : OMP_PROC_BIND of the run ("unset" if not set)
+ * - places      : OMP_PLACES, if set
+ * - hosts       : number of nodes (MPI runs on several nodes)
+ *
+ * Every worker adds the affinity mask of its own thread (Linux
+ * sched_getaffinity) after the OpenMP runtime or the MPI launcher has
+ * bound it. The MPI front-ends combine the ranks with bat_host_mpi_reduce().
+ */
+
+/* Largest CPU number recorded + 1. */
+#define BAT_HOST_MAX_CPUS 1024
+#define BAT_HOST_MASK_WORDS (BAT_HOST_MAX_CPUS / 64)
+
+typedef struct {
+    uint64_t mask[BAT_HOST_MASK_WORDS];  /* union of the workers' CPUs */
+    int worker_cpus;                     /* most CPUs of one worker */
+    int hosts;                           /* distinct hosts (1 without MPI) */
+} BatPlacement;
+
+/* No worker, one host. */
+void bat_placement_init(BatPlacement *p);
+
+/*
+ * Adds the affinity mask of the calling thread. OpenMP front-ends call it
+ * from every thread, inside a critical section.
+ */
+void bat_placement_add_self(BatPlacement *p);
+
+/* Appends the placement fields (see above) to the BENCH line. */
+void bat_placement_print_bench(const BatPlacement *p);
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef BAT_HOST_MPI_H
+#define BAT_HOST_MPI_H
+
+#include <mpi.h>
+
+#include "bat_host.h"
+
+/*
+ * bat_host_mpi.h
+ *
+ * Combination of the placements (bat_host.h) over the ranks of the MPI
+ * front-ends (mpi_bat, hybrid_bat, batch_bat). Only compiled into the MPI
+ * binaries.
+ */
+
+/*
+ * Collective: union of the CPU masks, largest worker_cpus and number of
+ * distinct hosts (shared-memory nodes) over all ranks. The result is valid
+ * on rank 0.
+ */
+void bat_host_mpi_reduce(BatPlacement *p, MPI_Comm comm);
+
+#endif
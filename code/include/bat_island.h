@@ -0,0 +1,132 @@
+#ifndef BAT_ISLAND_H
+#define BAT_ISLAND_H
+
+#include <stdint.h>
+#include <mpi.h>
+
+/*
+ * bat_island.h
+ *
+ * Island model for the MPI version (--island).
+ *
+ * Every rank evolves its own population (an "island") around its LOCAL
+ * best; there is no per-iteration global reduction. Every `every`
+ * iterations each island sends a copy of its top-k bats to its neighbors
+ * (non-blocking point-to-point) and, one iteration later, the immigrants
+ * replace the worst local bats they beat.
+ *
+ * Topologies (neighbors may change every migration for "random"):
+ *   - ring   : send to rank + 1, receive from rank - 1
+ *   - torus  : 2-D periodic grid (MPI_Dims_create), 4 neighbors
+ *   - random : a random cycle over all ranks, redrawn every migration from
+ *              the seed (the same on every rank)
+ *
+ * A migrant travels as BAT_MIGRANT_SIZE(dim) doubles:
+ *   [f_value, A, r, x_0 .. x_{dim-1}, v_0 .. v_{dim-1}]
+ * The receiving bat keeps its own RNG stream.
+ *
+ * Only compiled into the MPI binary.
+ */
+
+typedef enum {
+    BAT_TOPOLOGY_RING = 0,
+    BAT_TOPOLOGY_TORUS = 1,
+    BAT_TOPOLOGY_RANDOM = 2
+} BatTopology;
+
+/* Parse a topology name ("ring" / "torus" / "random"). Returns 0 on success. */
+int bat_topology_parse(const char *name, BatTopology *topology);
+
+/* Name of a topology, as printed in the BENCH line. */
+const char *bat_topology_name(BatTopology topology);
+
+/* Offsets inside a migrant record. */
+enum {
+    BAT_MIGRANT_F = 0,
+    BAT_MIGRANT_A,
+    BAT_MIGRANT_R,
+    BAT_MIGRANT_X
+};
+#define BAT_MIGRANT_SIZE(dim) (BAT_MIGRANT_X + 2 * (dim))
+
+/* Maximum neighbors of an island (torus). */
+#define BAT_ISLAND_MAX_LINKS 4
+
+/* (value, index) pair used to rank bats and migrants. */
+typedef struct {
+    double f;
+    int i;
+} BatIslandRank;
+
+typedef struct {
+    MPI_Comm comm;
+    int rank, size;
+    BatTopology topology;
+    int every;            /* iterations between migrations */
+    int k;                /* emigrants per neighbor */
+    int dim;
+    uint32_t seed;        /* drives the random topology */
+    int torus_dims[2];
+
+    int epoch;            /* migrations posted so far */
+    int n_links;          /* neighbors of the posted migration */
+    int send_to[BAT_ISLAND_MAX_LINKS];
+    int recv_from[BAT_ISLAND_MAX_LINKS];
+    int in_flight;        /* 1 between post and receive */
+    MPI_Request reqs[2 * BAT_ISLAND_MAX_LINKS];
+
+    double *send_buf;     /* k migrants */
+    double *recv_buf;     /* BAT_ISLAND_MAX_LINKS * k migrants */
+
+    /* Selection scratch: max(n, BAT_ISLAND_MAX_LINKS * k) entries */
+    BatIslandRank *order;
+    BatIslandRank *incoming;
+
+    /* Traffic of this rank */
+    long msgs_sent;
+    double bytes_sent;
+} BatIslands;
+
+/*
+ * Sets up the island exchange of this rank. Returns 0 on success.
+ *
+ * Parameters:
+ *   - isl      : island state
+ *   - comm     : communicator of the islands
+ *   - topology : neighbor structure
+ *   - every    : migration interval (iterations, >= 1)
+ *   - k        : migrants sent to each neighbor (1 <= k <= n)
+ *   - dim      : problem dimension
+ *   - n        : number of local bats
+ *   - seed     : global random seed
+ */
+int bat_islands_init(BatIslands *isl, MPI_Comm comm, BatTopology topology,
+                     int every, int k, int dim, int n, uint32_t seed);
+
+/* Completes any migration in flight and releases the buffers. */
+void bat_islands_free(BatIslands *isl);
+
+/* 1 if a migration is posted after iteration t. */
+static inline int bat_islands_due(const BatIslands *isl, int t) {
+    return (t + 1) % isl->every == 0;
+}
+
+/*
+ * Indices of the k best local bats (f descending, ties: smallest index).
+ * The caller packs bat idx[j] into send_buf + j * BAT_MIGRANT_SIZE(dim).
+ */
+void bat_islands_emigrants(BatIslands *isl, const double f[], int n, int idx[]);
+
+/* Posts the sends of send_buf and the receives of the current neighbors. */
+void bat_islands_post(BatIslands *isl);
+
+/*
+ * Waits for the migration in flight and plans the replacements: the best
+ * immigrants are paired with the worst local bats, and local bat dst[j] is
+ * replaced by the migrant recv_buf + src[j] * BAT_MIGRANT_SIZE(dim) only if
+ * the immigrant is better. dst / src need n_links * k entries
+ * (at most BAT_ISLAND_MAX_LINKS * k). Returns the number of replacements.
+ */
+int bat_islands_receive(BatIslands *isl, const double f[], int n, int dst[], int src[]);
+
+#endif
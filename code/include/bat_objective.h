@@ -0,0 +1,74 @@
+#ifndef BAT_OBJECTIVE_H
+#define BAT_OBJECTIVE_H
+
+/*
+ * bat_objective.h
+ *
+ * Registry of objective functions, selected at runtime with --objective.
+ *
+ * Every objective is exposed through one batched entry point:
+ *
+ *   void evaluate(const double *X, int n, int d, double *out);
+ *
+ * which scores n points of dimension d in one call. X is dimension-major:
+ * coordinate k of point i is X[k * n + i]. This is exactly the layout of a
+ * SoA tile, so a whole tile of candidates is scored with loops that run
+ * over the points (SIMD lanes). For a single point (n = 1) X is simply the
+ * point itself.
+ *
+ * The Bat Algorithm in this project MAXIMIZES. The built-in "sphere" keeps
+ * the historical objective 10 - sum(x^2) (maximum 10 at the origin). The
+ * classic minimization benchmarks are negated, so their maximum is 0:
+ *   - rastrigin  : -(10 d + sum(x^2 - 10 cos(2 pi x)))
+ *   - rosenbrock : -sum(100 (x_{k+1} - x_k^2)^2 + (1 - x_k)^2)
+ *   - ackley     : -(-20 exp(-0.2 sqrt(sum(x^2) / d)) - exp(sum(cos(2 pi x)) / d) + 20 + e)
+ *
+ * User objectives can be added with bat_objective_register() (function
+ * pointer) or loaded from a shared object with --objective so:PATH[:SYMBOL]
+ * (default symbol: bat_objective_evaluate, same signature as above).
+ *
+ * The batch boundary is also the natural place for caching or offloading
+ * expensive user objectives.
+ *
+ * The built-ins also have a single-precision entry point (evaluate_f, same
+ * layout and summation order in float) for the compact population store
+ * (--precision float, see bat_pop.h). User objectives only have the double
+ * one; --precision mixed stores floats and scores them in double.
+ */
+
+/* Batched evaluation: out[i] = f(point i), points stored dimension-major. */
+typedef void (*BatObjectiveEval)(const double *X, int n, int d, double *out);
+
+/* Same in single precision. */
+typedef void (*BatObjectiveEvalF)(const float *X, int n, int d, float *out);
+
+typedef struct {
+    const char *name;
+    BatObjectiveEval evaluate;
+    BatObjectiveEvalF evaluate_f;   /* NULL for user objectives */
+} BatObjective;
+
+/* Name of the objective used when --objective is not given. */
+#define BAT_OBJECTIVE_DEFAULT "sphere"
+
+/*
+ * Look up an objective by name (built-in, registered, or "so:PATH[:SYMBOL]",
+ * which is loaded on first use). Returns NULL if not found; for shared
+ * objects the loader error is printed to stderr.
+ */
+const BatObjective *bat_objective_find(const char *name);
+
+/* Register a user objective. Returns 0 on success, -1 if the table is full. */
+int bat_objective_register(const char *name, BatObjectiveEval evaluate);
+
+/* Print the available objective names (one line, on stderr). */
+void bat_objective_print_names(void);
+
+/* Convenience wrapper: evaluate a single point x[0..d-1]. */
+static inline double bat_objective_eval1(const BatObjective *obj, const double *x, int d) {
+    double out;
+    obj->evaluate(x, 1, d, &out);
+    return out;
+}
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef BAT_OPTIONS_H
+#define BAT_OPTIONS_H
+
+#include "bat.h"
+#include "bat_pop.h"
+#include "bat_stop.h"
+#include "bat_traj.h"
+#include "bat_ckpt.h"
+#include "bat_verify.h"
+
+/*
+ * bat_options.h
+ *
+ * Command-line options shared by all front-ends:
+ *
+ *   --n-bats N --iters T --seed S --quiet --no-snapshot
+ *   --layout aos|soa --dim D --objective NAME --precision double|mixed|float
+ *   + the stopping criteria (bat_stop.h), the trajectory (bat_traj.h),
+ *     the checkpoint options (bat_ckpt.h) and the digests (bat_verify.h)
+ *
+ * A front-end parses its own options (e.g. the MPI exchange modes) around
+ * bat_options_parse_option(), or calls bat_options_parse() when it has
+ * none. Unknown options are ignored, as before.
+ */
+
+typedef struct {
+    int n_bats;             /* --n-bats */
+    int max_iters;          /* --iters */
+    unsigned int seed;      /* --seed (default: current time) */
+    int quiet;              /* --quiet */
+    int do_snapshot;        /* 0 with --no-snapshot (CSV snapshots of the sequential version) */
+    BatLayout layout;       /* --layout; SoA by default when --dim is not the compiled dimension */
+    int layout_set;         /* --layout was given */
+    int dim;                /* --dim */
+    const char *objective;  /* --objective */
+    BatPrecision precision; /* --precision (SoA store; compact precisions select SoA) */
+    BatStopCriteria stop;
+    BatTrajOptions traj;
+    BatCkptOptions ckpt;
+    BatVerifyOptions verify;
+} BatOptions;
+
+/* N_BATS, MAX_ITERS, time-based seed, AoS, compiled dimension, default objective. */
+void bat_options_defaults(BatOptions *o);
+
+/*
+ * Consumes argv[*i] (and its value) if it is a shared option, advancing *i
+ * past the value. Returns 1 if the option was consumed, 0 if it is not a
+ * shared option, -1 if its value is invalid (reported on stderr).
+ */
+int bat_options_parse_option(BatOptions *o, int argc, char **argv, int *i);
+
+/*
+ * Applies the defaults that depend on other options (the AoS Bat struct
+ * has a compile-time dimension and is in double: other sizes and
+ * precisions use SoA). Call after parsing.
+ */
+void bat_options_finish(BatOptions *o);
+
+/*
+ * Defaults, every argument through bat_options_parse_option(), then
+ * bat_options_finish(). Returns 0, or -1 if a value is invalid.
+ */
+int bat_options_parse(BatOptions *o, int argc, char **argv);
+
+/*
+ * Checks the parsed values and resolves the objective (every MPI rank must
+ * call it: shared objects are loaded on first use).
+ *
+ * Parameters:
+ *   - o      : parsed options
+ *   - report : print the error on stderr (MPI: rank 0 only)
+ *   - obj    : output, the objective of the run
+ *
+ * Returns 0, or -1 if the run cannot start with these options.
+ */
+int bat_options_validate(const BatOptions *o, int report, const BatObjective **obj);
+
+#endif
@@ -0,0 +1,228 @@
+#ifndef BAT_POP_H
+#define BAT_POP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bat.h"
+
+/*
+ * bat_pop.h
+ *
+ * Structure-of-arrays (SoA) population store.
+ *
+ * The classic layout is an array of Bat structs (AoS): every bat carries
+ * its position, velocity and parameters side by side. update_bat() then
+ * works on one bat at a time and the compiler cannot vectorize across bats.
+ *
+ * BatPopulation keeps one aligned array per field instead. Positions and
+ * velocities are stored in tiles of BAT_POP_LANES bats; inside a tile the
+ * data is dimension-major:
+ *
+ *   x[(tile * dim + d) * BAT_POP_LANES + lane]
+ *
+ * so coordinate d of all the bats of a tile is one contiguous SIMD vector,
+ * and a tile is a contiguous (dim x BAT_POP_LANES) block that streams well
+ * even when dim is large.
+ *
+ * The last tile is padded; padding lanes hold harmless values and are never
+ * reported (statistics, best, snapshots).
+ *
+ * The block kernel (bat_pop_update) performs exactly the same random draws,
+ * per bat, as update_bat(), so both layouts produce the same trajectory for
+ * the same seed.
+ *
+ * The dimension is a runtime value (--dim). bat_pop_alloc() picks a kernel
+ * specialized for the common sizes (2, 4, 8, 16, 32), where the loops over
+ * the dimension are fully unrolled, and a generic streaming kernel otherwise.
+ *
+ * The precision is a runtime value too (--precision):
+ *
+ * - double : every field in double (the default, same trajectory as AoS)
+ * - mixed  : positions, velocities, loudness and pulse rate in float
+ *            (xf, vf, Af, rf); the moves and the objective are computed in
+ *            double from the stored floats
+ * - float  : same storage, the moves and the objective in float (the
+ *            objective's evaluate_f, see bat_objective.h)
+ *
+ * The compact store roughly halves the bytes streamed per bat and
+ * iteration for large dimensions (bat_pop_bytes_per_bat). The values,
+ * the RNG state and the cached normal stay in double / uint32, so every bat
+ * draws the same random numbers as in double; the trajectory differs by
+ * the float rounding only, and is the same for every front-end and number
+ * of workers. Code outside the kernels accesses the fields through
+ * bat_pop_x() / bat_pop_set_x() and friends.
+ */
+
+/* Bats per tile (8 doubles = one AVX-512 vector, two AVX2 vectors). */
+#define BAT_POP_LANES 8
+
+/* Alignment of every array (one cache line). */
+#define BAT_POP_ALIGN 64
+
+/* Population layout selected at runtime (--layout aos|soa). */
+typedef enum {
+    BAT_LAYOUT_AOS = 0,  /* array of Bat structs + update_bat() */
+    BAT_LAYOUT_SOA = 1   /* BatPopulation + bat_pop_update() */
+} BatLayout;
+
+/* Parse a layout name ("aos" / "soa"). Returns 0 on success, -1 if unknown. */
+int bat_layout_parse(const char *name, BatLayout *layout);
+
+/* Name of a layout, as printed in the BENCH line. */
+const char *bat_layout_name(BatLayout layout);
+
+/* Storage precision of the SoA store (--precision double|mixed|float). */
+typedef enum {
+    BAT_PRECISION_DOUBLE = 0,
+    BAT_PRECISION_MIXED,    /* float storage, double arithmetic */
+    BAT_PRECISION_FLOAT     /* float storage and arithmetic */
+} BatPrecision;
+
+/* Parse a precision name. Returns 0 on success, -1 if unknown. */
+int bat_precision_parse(const char *name, BatPrecision *precision);
+
+/* Name of a precision, as printed in the BENCH line. */
+const char *bat_precision_name(BatPrecision precision);
+
+/*
+ * Appends " precision=<name> bytes_per_bat=<B>" to the BENCH line
+ * (B: bat_pop_bytes_per_bat(), or sizeof(Bat) for the AoS layout).
+ */
+void bat_precision_print_bench(BatPrecision precision, size_t bytes_per_bat);
+
+typedef struct BatPopulation BatPopulation;
+
+/* Block update kernel, specialized per dimension (see bat_pop_update). */
+typedef void (*BatPopKernel)(BatPopulation *pop, int tile_begin, int tile_end,
+                             const double best_x[], const BatStats *stats,
+                             BatStats *next_stats, int t, double *scratch);
+
+struct BatPopulation {
+    int n;              /* number of bats stored */
+    int dim;            /* problem dimension */
+    int n_tiles;        /* ceil(n / BAT_POP_LANES) */
+    long index_offset;  /* global index of bat 0 (MPI partitions) */
+    BatPrecision precision;
+
+    /* BAT_PRECISION_DOUBLE only (NULL otherwise) */
+    double *x;          /* positions  (tiled, dimension-major) */
+    double *v;          /* velocities (tiled, dimension-major) */
+    double *A;          /* loudness, one per bat (padded to n_tiles * lanes) */
+    double *r;          /* pulse rate */
+
+    /* Same fields in float, BAT_PRECISION_MIXED / FLOAT only (NULL otherwise) */
+    float *xf;
+    float *vf;
+    float *Af;
+    float *rf;
+
+    double *f_value;    /* objective value of the current position */
+    uint32_t *rng;      /* per-bat RNG state */
+    double *rng_spare;  /* per-bat cached Box-Muller variate */
+
+    /* Objective used by the kernel (set by bat_pop_init_seeded). */
+    const BatObjective *objective;
+
+    /* Update kernel picked by bat_pop_alloc() for this dimension. */
+    BatPopKernel kernel;
+    const char *kernel_name;  /* "d2", "d4", ..., or "generic" */
+};
+
+/* Offset of coordinate d of bat i inside x / v. */
+static inline size_t bat_pop_offset(int dim, int i, int d) {
+    return ((size_t)(i / BAT_POP_LANES) * (size_t)dim + (size_t)d) * BAT_POP_LANES
+           + (size_t)(i % BAT_POP_LANES);
+}
+
+/*
+ * Position, velocity (offset k = bat_pop_offset()), loudness and pulse
+ * rate (bat i) in any precision; the setters round to float in the compact
+ * store. For the code around the kernels (I/O, migration, digests).
+ */
+#define BAT_POP_ACCESSORS(name, field)                                              \
+    static inline double bat_pop_##name(const BatPopulation *pop, size_t k) {      \
+        return pop->field ? pop->field[k] : (double)pop->field##f[k];              \
+    }                                                                               \
+    static inline void bat_pop_set_##name(BatPopulation *pop, size_t k, double value) { \
+        if (pop->field) {                                                           \
+            pop->field[k] = value;                                                  \
+        } else {                                                                    \
+            pop->field##f[k] = (float)value;                                        \
+        }                                                                           \
+    }
+
+BAT_POP_ACCESSORS(x, x)
+BAT_POP_ACCESSORS(v, v)
+BAT_POP_ACCESSORS(A, A)
+BAT_POP_ACCESSORS(r, r)
+
+#undef BAT_POP_ACCESSORS
+
+/*
+ * Allocate storage for n bats of dimension dim in the given precision and
+ * select the update kernel for that dimension. Returns 0 on success.
+ */
+int bat_pop_alloc(BatPopulation *pop, int n, int dim, BatPrecision precision);
+
+/* Release the storage of a population. */
+void bat_pop_free(BatPopulation *pop);
+
+/*
+ * Deterministic initializer, same values as initialize_bats_seeded():
+ * bat i of this store gets RNG stream (index_offset + i). scratch has
+ * bat_pop_scratch_size(dim) doubles, as for bat_pop_update(); only the
+ * mixed precision uses it (NULL is fine in double and float).
+ */
+void bat_pop_init_seeded(BatPopulation *pop, uint32_t seed, long index_offset, const BatObjective *obj,
+                         double *scratch);
+
+/*
+ * Parallel initialization in two steps. bat_pop_init_begin() records the
+ * index offset and objective (call once); bat_pop_init_tiles() initializes
+ * tiles [tile_begin, tile_end) and may run concurrently on disjoint ranges.
+ * Calling it with the same static partition as bat_pop_update() places the
+ * pages of each tile on the NUMA node of the thread that owns it.
+ */
+void bat_pop_init_begin(BatPopulation *pop, long index_offset, const BatObjective *obj);
+void bat_pop_init_tiles(BatPopulation *pop, uint32_t seed, int tile_begin, int tile_end, double *scratch);
+
+/*
+ * Sets only the padding lanes of the last tile (neutral state, never
+ * reported), without drawing or evaluating the real bats: for a store that
+ * is filled from checkpoint records (bat_ckpt_load_pop) right after.
+ */
+void bat_pop_init_padding(BatPopulation *pop);
+
+/* Copy the position of bat i into out[0..dim-1]. */
+void bat_pop_get_x(const BatPopulation *pop, int i, double out[]);
+
+/* Bytes of persistent storage per bat of the SoA store (all arrays, without the padding lanes). */
+size_t bat_pop_bytes_per_bat(int dim, BatPrecision precision);
+
+/* Scratch doubles needed by one concurrent caller of bat_pop_update(). */
+size_t bat_pop_scratch_size(int dim);
+
+/*
+ * Block update kernel: one iteration for the bats of tiles
+ * [tile_begin, tile_end). Moves, clamps and evaluates a whole tile at a
+ * time. Updated bats are added to next_stats (if not NULL).
+ *
+ * Parameters:
+ *   - pop        : population store
+ *   - tile_begin : first tile to update
+ *   - tile_end   : one past the last tile to update
+ *   - best_x     : position of the current global best (read-only)
+ *   - stats      : population aggregates of the previous iteration
+ *   - next_stats : accumulator for the updated population (may be NULL)
+ *   - t          : current iteration index
+ *   - scratch    : bat_pop_scratch_size(dim) doubles owned by the caller
+ */
+void bat_pop_update(BatPopulation *pop, int tile_begin, int tile_end,
+                    const double best_x[], const BatStats *stats,
+                    BatStats *next_stats, int t, double *scratch);
+
+/* Accumulate the statistics of tiles [tile_begin, tile_end). */
+void bat_pop_stats(const BatPopulation *pop, int tile_begin, int tile_end, BatStats *acc);
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef BAT_PROF_H
+#define BAT_PROF_H
+
+#include <time.h>
+
+/*
+ * bat_prof.h
+ *
+ * Per-phase timing of the iteration loops, compiled in with
+ * `make PROFILE=1` (-DBAT_PROFILE). Without it every call below is empty
+ * and the BENCH line is unchanged.
+ *
+ * Each worker (thread, or rank in mpi_bat) owns one BatProf and calls
+ * bat_prof_lap(p, phase) when a piece of work ends: the time since its
+ * previous lap is charged to that phase. The laps of a worker cover its
+ * whole run without gaps, so its phases add up to the init time plus the
+ * timed loop (time_s). A lap is one clock_gettime().
+ *
+ * Phases:
+ *   init   : allocation of the frame buffers, initialization or restart of
+ *            the population, initial best (before time_s starts)
+ *   update : position / velocity update and evaluation of the bats
+ *   reduce : best and statistics inside the process (slot merge, copy of
+ *            the best, stopping criteria)
+ *   comm   : MPI exchange of the best, statistics and migrants
+ *   wait   : OpenMP barriers, i.e. load imbalance between threads
+ *   io     : progress output, snapshots, trajectory frames, checkpoints
+ *
+ * With `make PROFILE=1 PAPI=1` (-DBAT_PROFILE_PAPI, needs libpapi) every
+ * worker also counts cycles, instructions and L2 cache misses between
+ * bat_prof_begin() and bat_prof_end(); events the CPU does not provide are
+ * left out.
+ *
+ * BENCH fields, over all workers (threads x ranks):
+ *   prof_workers=W
+ *   prof_<phase>_min= prof_<phase>_avg= prof_<phase>_max=   (seconds)
+ *   papi_cycles= papi_ins= papi_l2_tcm= ipc=               (sums, PAPI only)
+ */
+
+typedef enum {
+    BAT_PROF_INIT = 0,
+    BAT_PROF_UPDATE,
+    BAT_PROF_REDUCE,
+    BAT_PROF_COMM,
+    BAT_PROF_WAIT,
+    BAT_PROF_IO,
+    BAT_PROF_PHASES
+} BatProfPhase;
+
+/* Hardware counters (PAPI builds). */
+enum {
+    BAT_PROF_CYCLES = 0,
+    BAT_PROF_INS,
+    BAT_PROF_L2_MISSES,
+    BAT_PROF_COUNTERS
+};
+
+/* Timers of one worker; keep it in the worker's own memory (thread stack). */
+typedef struct {
+    double t[BAT_PROF_PHASES];              /* seconds per phase */
+    long long counters[BAT_PROF_COUNTERS];  /* -1: not counted */
+    double mark;                            /* time of the previous lap */
+    int events;                             /* PAPI event set, -1: none */
+    int slot[BAT_PROF_COUNTERS];            /* position of each counter in the set, -1: absent */
+} BatProf;
+
+/* Combined timers of several workers (min / sum / max per phase). */
+typedef struct {
+    long workers;
+    double min[BAT_PROF_PHASES];
+    double sum[BAT_PROF_PHASES];
+    double max[BAT_PROF_PHASES];
+    long long counters[BAT_PROF_COUNTERS];  /* sums, -1: not counted */
+} BatProfSummary;
+
+/* 1 if the timers are compiled in. */
+int bat_prof_enabled(void);
+
+/* Zeroes the timers, starts the counters and the first lap. */
+void bat_prof_begin(BatProf *p);
+
+/* Stops the counters (the last lap must already be taken). */
+void bat_prof_end(BatProf *p);
+
+/* Charges the time since the previous lap to `phase`. */
+static inline void bat_prof_lap(BatProf *p, BatProfPhase phase) {
+#ifdef BAT_PROFILE
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double t = (double)now.tv_sec + 1e-9 * (double)now.tv_nsec;
+    p->t[phase] += t - p->mark;
+    p->mark = t;
+#else
+    (void)p;
+    (void)phase;
+#endif
+}
+
+/*
+ * Adds the timers and counters of a finished BatProf to `into` (also
+ * finished): a worker that runs in several parallel regions times each one
+ * on its own and counts once in the summary.
+ */
+void bat_prof_merge(BatProf *into, const BatProf *p);
+
+void bat_prof_summary_init(BatProfSummary *s);
+
+/* Adds one worker. */
+void bat_prof_summary_add(BatProfSummary *s, const BatProf *p);
+
+/* Appends the BENCH fields; prints nothing when the timers are compiled out. */
+void bat_prof_print_bench(const BatProfSummary *s);
+
+#endif
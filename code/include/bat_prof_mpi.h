@@ -0,0 +1,23 @@
+#ifndef BAT_PROF_MPI_H
+#define BAT_PROF_MPI_H
+
+#include <mpi.h>
+
+#include "bat_prof.h"
+
+/*
+ * bat_prof_mpi.h
+ *
+ * Combination of the per-phase timers (bat_prof.h) over the ranks of the
+ * MPI front-ends (mpi_bat, hybrid_bat). Only compiled into the MPI
+ * binaries.
+ */
+
+/*
+ * Collective: combines the summaries of all ranks (min / sum / max per
+ * phase, sums of workers and counters). The result is valid on rank 0.
+ * Does nothing when the timers are compiled out.
+ */
+void bat_prof_mpi_reduce(BatProfSummary *s, MPI_Comm comm);
+
+#endif
@@ -2,6 +2,7 @@
 #define BAT_RNG_H
 
 #include <stdint.h>
+#include <math.h>
 
 /*
  * bat_rng.h
@@ -17,19 +18,100 @@
  *
  * We therefore avoid C's rand() and instead store a RNG state per Bat.
  *
+ * The generator step, the uniform draw and the block draws below are
+ * inline: they run several times per bat per iteration, from other
+ * translation units (bat_core.c, bat_pop.c, the front-ends). The *_lanes /
+ * *_fill functions draw many numbers per call:
+ * - bat_rng_uniform01_lanes(): one uniform per stream for a block of bats,
+ *   a loop over independent lanes that the compiler vectorizes
+ * - bat_rng_normal_fill(): n normals from one stream, using BOTH outputs of
+ *   each Box-Muller pair; an odd leftover is cached in a per-bat "spare"
+ *   slot and returned by the next call
+ *
  * Note: this is NOT cryptography. It's only meant for simulation/experiments.
  */
 
 /* Initialize a per-bat RNG state from a global seed + an index (e.g., bat id). */
 uint32_t bat_rng_init(uint32_t seed, uint32_t stream_id);
 
+/* Value of an empty Box-Muller spare slot. */
+#define BAT_RNG_NO_SPARE NAN
+
+/* xorshift32 step: advances the state and returns 32 random bits. */
+static inline uint32_t bat_rng_next(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
 /* Uniform random in (0,1) (never returns exactly 0 or 1). */
-double bat_rng_uniform01(uint32_t *state);
+static inline double bat_rng_uniform01(uint32_t *state) {
+    uint32_t r = bat_rng_next(state);
+    return ((double)r + 1.0) / ((double)UINT32_MAX + 2.0);
+}
+
+/*
+ * Box-Muller: two independent standard normals from two uniforms of one
+ * stream (the building block of bat_rng_normal_fill()).
+ */
+static inline void bat_rng_normal_pair(uint32_t *state, double *z0, double *z1) {
+    double u1 = bat_rng_uniform01(state);
+    double u2 = bat_rng_uniform01(state);
+    double r = sqrt(-2.0 * log(u1));
+    double theta = 2.0 * M_PI * u2;
+    *z0 = r * cos(theta);
+    *z1 = r * sin(theta);
+}
+
+/* One uniform in (0,1) per stream: out[l] is drawn from states[l]. */
+static inline void bat_rng_uniform01_lanes(uint32_t states[], int n, double out[]) {
+    for (int l = 0; l < n; l++) {
+        uint32_t x = states[l];
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        states[l] = x;
+        out[l] = ((double)x + 1.0) / ((double)UINT32_MAX + 2.0);
+    }
+}
 
 /* Uniform random in [a,b]. */
 double bat_rng_uniform(uint32_t *state, double a, double b);
 
-/* Gaussian random using Box-Muller. */
+/* Gaussian random using Box-Muller (second variate discarded). */
 double bat_rng_normal(uint32_t *state, double mean, double stddev);
 
+/*
+ * Fills out[0..n-1] with standard normal values drawn from one stream.
+ * Each pair of uniforms (u1, u2) gives two independent normals
+ * r*cos(theta) and r*sin(theta); both are used. When n is odd the unused
+ * sin() value is kept in *spare and consumed first by the next call,
+ * so no random numbers (and no log/sqrt) are wasted.
+ *
+ * Parameters:
+ *   - state : pointer to the RNG state to update
+ *   - spare : per-bat spare slot (BAT_RNG_NO_SPARE when empty)
+ *   - n     : number of values to produce
+ *   - out   : output array
+ */
+static inline void bat_rng_normal_fill(uint32_t *state, double *spare, int n, double out[]) {
+    int k = 0;
+
+    if (n > 0 && !isnan(*spare)) {
+        out[k++] = *spare;
+        *spare = BAT_RNG_NO_SPARE;
+    }
+
+    for (; k + 1 < n; k += 2) {
+        bat_rng_normal_pair(state, &out[k], &out[k + 1]);
+    }
+
+    if (k < n) {
+        bat_rng_normal_pair(state, &out[k], spare);
+    }
+}
+
 #endif
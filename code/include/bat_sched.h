@@ -0,0 +1,201 @@
+#ifndef BAT_SCHED_H
+#define BAT_SCHED_H
+
+/*
+ * bat_sched.h
+ *
+ * Scheduling of the update phase of the OpenMP front-end
+ * (--schedule static|dynamic|tasks [--chunk N]).
+ *
+ * The update phase is split into work items: bats with the AoS layout,
+ * tiles of BAT_POP_LANES bats with --layout soa.
+ *
+ * - static  : one contiguous share of the items per thread (the default,
+ *             same partition as the parallel first touch)
+ * - dynamic : `omp for schedule(dynamic, chunk)`, idle threads grab the
+ *             next chunk of items
+ * - tasks   : one thread creates one task per chunk of items, the tasks
+ *             are executed (and stolen) by every thread of the team
+ *
+ * Every bat draws from its own RNG stream and the statistics do not depend
+ * on the order of the additions (bat_stats.h), so every schedule computes
+ * the same trajectory bit for bit (--verify).
+ *
+ * --chunk 0 (the default) tunes the chunk at runtime: a hill climb over
+ * powers of two, starting from items / (16 * threads), that keeps the
+ * chunk with the fastest update phase (minimum over BAT_SCHED_TRIALS
+ * iterations per candidate). The search takes a few dozen iterations, then
+ * the chunk stays fixed.
+ *
+ * --threads auto picks the team size (and the starting chunk) at runtime,
+ * for the mixed workloads where OMP_NUM_THREADS cannot be tuned per job:
+ *
+ * - at startup the front-end times an empty iteration (barrier + single)
+ *   and an empty dynamic loop for the candidate teams: 1, 2, 4, ... up to
+ *   the usable threads (OMP_NUM_THREADS, at most the CPUs of the process)
+ * - the first BAT_SCHED_CALIB_ITERS iterations run with the largest team
+ *   (parallel first touch) and measure the cost of a work item from the
+ *   busy times of the threads
+ * - the plan minimizes the predicted iteration time
+ *       ceil(items / p) * item_cost + sync_cost(p)
+ *   a team of 1 runs serially (no barrier). The team only changes when
+ *   the prediction improves by BAT_SCHED_MIN_GAIN; the front-end then ends
+ *   its parallel region and forks the new team
+ * - dynamic / tasks without --chunk start the chunk search from the
+ *   smallest chunk whose work hides the dispatch cost BAT_SCHED_GRAIN times
+ * - --retune K measures the item cost again every K iterations (the local
+ *   searches get rarer as the pulse rates grow) and re-plans
+ *
+ * The team size does not change the trajectory (--verify).
+ */
+
+/* Iterations timed per candidate chunk of the tuner. */
+#define BAT_SCHED_TRIALS 3
+
+typedef enum {
+    BAT_SCHED_STATIC = 0,
+    BAT_SCHED_DYNAMIC,
+    BAT_SCHED_TASKS
+} BatSchedKind;
+
+typedef struct {
+    BatSchedKind kind;      /* --schedule */
+    int chunk;              /* --chunk N, 0: tuned at runtime */
+    int set;                /* --schedule or --chunk was given (BENCH fields) */
+    int threads;            /* --threads N, 0: OMP_NUM_THREADS */
+    int threads_auto;       /* --threads auto */
+    int retune_every;       /* --retune K (--threads auto), 0: plan once */
+} BatSchedOptions;
+
+/* Static schedule, tuned chunk, OMP_NUM_THREADS threads. */
+void bat_sched_defaults(BatSchedOptions *o);
+
+/*
+ * Consumes argv[*i] and its value if it is a scheduling option (including
+ * --threads and --retune), advancing
+ * *i past the value. Returns 1 if the option was consumed, 0 if it is not
+ * a scheduling option, -1 if its value is invalid (reported on stderr).
+ */
+int bat_sched_parse_option(BatSchedOptions *o, int argc, char **argv, int *i);
+
+/* Name of a schedule, as in --schedule. */
+const char *bat_sched_kind_name(BatSchedKind kind);
+
+/* Chunk search state (updated by one thread between two barriers). */
+typedef struct {
+    int chunk;              /* chunk of the next update phase */
+    int tuning;             /* 1 while the search runs */
+    int max_chunk;          /* items per thread: larger chunks idle threads */
+    int direction;          /* +1: doubling, -1: halving */
+    int best_chunk;
+    double best_time;       /* fastest update phase of best_chunk */
+    int trials;             /* iterations timed with the current chunk */
+    double trial_time;      /* fastest of them */
+    int tuned_iters;        /* update phases spent searching */
+} BatSchedTuner;
+
+/*
+ * Initializes the chunk of the first update phase.
+ *
+ * Parameters:
+ *   - tu      : tuner to initialize
+ *   - o       : parsed options (a --chunk > 0 is used as is)
+ *   - items   : work items of one update phase
+ *   - threads : threads of the team
+ */
+void bat_sched_tuner_init(BatSchedTuner *tu, const BatSchedOptions *o, int items, int threads);
+
+/* Records the wall time of one update phase and picks the next chunk. */
+void bat_sched_tuner_record(BatSchedTuner *tu, double seconds);
+
+/* Restarts the chunk search from `chunk` (bounded by the tuner's max_chunk). */
+void bat_sched_tuner_restart(BatSchedTuner *tu, int chunk);
+
+/* Iterations timed to measure the cost of a work item (--threads auto). */
+#define BAT_SCHED_CALIB_ITERS 3
+/* Relative gain of the predicted iteration time needed to change the team. */
+#define BAT_SCHED_MIN_GAIN 0.1
+/* Work of a chunk / its dispatch cost, for the starting chunk. */
+#define BAT_SCHED_GRAIN 20
+/* Candidate teams: powers of two up to the usable threads, plus that number. */
+#define BAT_SCHED_MAX_TEAMS 16
+
+/* Team planner of --threads auto (updated by the merging thread). */
+typedef struct {
+    int n_teams;
+    int team[BAT_SCHED_MAX_TEAMS];          /* candidate team sizes, increasing */
+    double sync_s[BAT_SCHED_MAX_TEAMS];     /* empty iteration of the team (measured) */
+    double dispatch_s[BAT_SCHED_MAX_TEAMS]; /* one dynamic chunk of the team (measured) */
+    double calib_s;                         /* time spent measuring them */
+    int threads;                            /* planned team */
+    int chunk;                              /* planned starting chunk (dynamic, tasks) */
+    double item_s;                          /* measured cost of one work item */
+    int trials;                             /* iterations measured in the current window */
+    double trial_s;                         /* cheapest item of the window */
+    int retune_every;
+    int next_retune;                        /* first iteration of the next window (--retune) */
+    int plans;                              /* item cost measurements done */
+} BatSchedPlanner;
+
+/*
+ * Sets the candidate teams; the front-end then fills sync_s / dispatch_s
+ * and calib_s. The first measuring window starts with the next recorded
+ * iteration, the next ones --retune iterations after each plan.
+ *
+ * Parameters:
+ *   - pl          : planner to initialize
+ *   - o           : parsed options (--retune)
+ *   - max_threads : usable threads (the largest candidate)
+ */
+void bat_sched_planner_init(BatSchedPlanner *pl, const BatSchedOptions *o, int max_threads);
+
+/*
+ * 1 if iteration t must be recorded (bat_sched_planner_record): the
+ * measuring window is open, or a --retune window opens at t. Between the
+ * windows the front-end can skip the recording, and its barrier; the busy
+ * time accumulated meanwhile is dropped when the next window opens.
+ */
+static inline int bat_sched_planner_measuring(const BatSchedPlanner *pl, int t) {
+    return pl->trials < BAT_SCHED_CALIB_ITERS || (pl->retune_every > 0 && t >= pl->next_retune);
+}
+
+/*
+ * Records the busy time of all the threads in the update phase of
+ * iteration t (the iteration that opens a --retune window only resets the
+ * accumulated time). Returns 1 when a measuring window ends: pl->threads and
+ * pl->chunk hold the new plan (pl->threads may equal the current team).
+ *
+ * Parameters:
+ *   - pl      : planner
+ *   - busy_s  : sum of the busy times of the threads in this update phase
+ *   - items   : work items of the update phase
+ *   - team    : current team size
+ *   - t       : iteration
+ */
+int bat_sched_planner_record(BatSchedPlanner *pl, double busy_s, int items, int team, int t);
+
+/*
+ * Appends " threads_mode=auto threads_max=<M> item_ns=<c> sync_ns=<s>
+ * [chunk_grain=<g>] plans=<n> calib_s=<t>" to the BENCH line (nothing
+ * without --threads auto): the measured cost of a work item and of an empty
+ * iteration of the final team, the starting chunk of dynamic / tasks, the
+ * number of measuring windows and the startup measurement time.
+ */
+void bat_sched_planner_print_bench(const BatSchedOptions *o, const BatSchedPlanner *pl, BatSchedKind kind);
+
+/*
+ * Appends " schedule=<kind> chunk=<c> [chunk_tuned_iters=<n>]
+ * busy_s=<t0,t1,...> idle_s=<t0,t1,...> imbalance=<max/mean busy>" to the
+ * BENCH line (nothing without --schedule / --chunk).
+ *
+ * Parameters:
+ *   - o       : parsed options
+ *   - tu      : tuner of the run (final chunk)
+ *   - busy    : per-thread time spent updating bats
+ *   - idle    : per-thread time spent waiting for the update phase to end
+ *   - threads : number of entries of busy / idle
+ */
+void bat_sched_print_bench(const BatSchedOptions *o, const BatSchedTuner *tu, const double busy[],
+                           const double idle[], int threads);
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef BAT_SOLVER_H
+#define BAT_SOLVER_H
+
+#include <stdint.h>
+
+#include "bat.h"
+#include "bat_objective.h"
+#include "bat_pop.h"
+#include "bat_stats.h"
+#include "bat_stop.h"
+
+/*
+ * bat_solver.h
+ *
+ * Embeddable solver (libbat): the single-threaded Bat Algorithm on the SoA
+ * store behind a handle that owns its workspace.
+ *
+ *   BatSolverParams p;
+ *   bat_solver_params_defaults(&p);
+ *   p.n_bats = 64; p.dim = 8; p.max_iters = 2000;
+ *
+ *   BatSolver s;
+ *   if (bat_solver_alloc(&s, &p) != 0) { ... }
+ *   for (uint32_t seed = 1; seed <= 100; seed++) {
+ *       BatSolverResult res;
+ *       bat_solver_solve(&s, bat_objective_find("rastrigin"), seed, &res);
+ *       ... res.best_value, res.best_x[0 .. dim-1] ...
+ *   }
+ *   bat_solver_free(&s);
+ *
+ * bat_solver_alloc() allocates (and touches) the whole workspace once: the
+ * population, the position of the best and the kernel scratch. A solve
+ * only reinitializes it in place, so repeated solves perform no allocation
+ * and run on warm pages. A solve follows exactly the same trajectory as
+ * `sequential --layout soa` with the same parameters and seed.
+ *
+ * Front-ends that need to act between iterations (snapshots, trajectory,
+ * checkpoints) drive the same state with bat_solver_start() and
+ * bat_solver_step(); the fields of BatSolver are the state of the run.
+ *
+ * A handle is not thread-safe; use one handle per thread.
+ */
+
+typedef struct {
+    int n_bats;             /* population size */
+    int dim;                /* problem dimension */
+    int max_iters;          /* iterations per solve */
+    BatPrecision precision; /* storage of the population (bat_pop.h); float needs evaluate_f */
+    BatStopCriteria stop;   /* early termination (bat_stop.h) */
+} BatSolverParams;
+
+typedef struct {
+    BatSolverParams params;
+
+    /* Workspace, allocated by bat_solver_alloc() and reused by every solve */
+    BatPopulation pop;
+    double *best_x;         /* position of the current best (dim doubles) */
+    double *scratch;        /* bat_pop_scratch_size(dim) doubles */
+
+    /* State of the current run */
+    const BatObjective *objective;
+    BatStats stats;         /* statistics and best after the last iteration */
+    BatStopState stop_state;
+    int t;                  /* iterations completed */
+    long solves;            /* runs started on this workspace */
+} BatSolver;
+
+typedef struct {
+    double best_value;
+    const double *best_x;   /* dim doubles, owned by the solver: valid until the next solve */
+    int iters;              /* iterations performed */
+    BatStopReason stop_reason;
+    double time_s;          /* wall-clock time of the iteration loop */
+} BatSolverResult;
+
+/* N_BATS bats of the compiled dimension in double, MAX_ITERS iterations, no stopping criterion. */
+void bat_solver_params_defaults(BatSolverParams *p);
+
+/*
+ * Allocates the workspace for these parameters.
+ * Returns 0 on success, -1 if the parameters are invalid (errno EINVAL)
+ * or memory is exhausted (errno ENOMEM).
+ */
+int bat_solver_alloc(BatSolver *s, const BatSolverParams *p);
+
+/* Releases the workspace. */
+void bat_solver_free(BatSolver *s);
+
+/*
+ * Switches an allocated solver to new parameters. The workspace is kept
+ * when n_bats, dim and precision do not change (only max_iters / stop differ) and
+ * reallocated otherwise. Returns 0, or -1 as bat_solver_alloc() (the
+ * solver is then unchanged).
+ */
+int bat_solver_set_params(BatSolver *s, const BatSolverParams *p);
+
+/*
+ * Starts a run: initializes the population for (seed, obj) in place,
+ * computes the initial statistics and best, resets the stall window and
+ * sets t = 0.
+ */
+void bat_solver_start(BatSolver *s, const BatObjective *obj, uint32_t seed);
+
+/* Performs iteration s->t (update, statistics, new best), then s->t++. */
+void bat_solver_step(BatSolver *s);
+
+/*
+ * Complete run: bat_solver_start(), then iterations until max_iters or a
+ * stopping criterion.
+ *
+ * Parameters:
+ *   - s    : allocated solver
+ *   - obj  : objective function
+ *   - seed : random seed of the run
+ *   - out  : result (best_x points into the workspace)
+ */
+void bat_solver_solve(BatSolver *s, const BatObjective *obj, uint32_t seed, BatSolverResult *out);
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef BAT_STATS_H
+#define BAT_STATS_H
+
+#include <math.h>
+
+#include "bat.h"
+
+/*
+ * bat_stats.h
+ *
+ * Population statistics (running aggregates over the bat population).
+ *
+ * The local-search step of the Bat Algorithm needs the average loudness
+ * of the population. Recomputing it inside update_bat() costs a full scan
+ * of the population for every bat, i.e. O(N^2) per iteration.
+ *
+ * Instead, the front-ends accumulate these aggregates once per iteration,
+ * while they already visit every bat to recompute the best, and pass the
+ * finalized result to update_bat() as a read-only input for the next
+ * iteration.
+ *
+ * The accumulator is a plain struct so it can be:
+ * - merged across OpenMP threads (per-thread slots, bat_stats_merge)
+ * - reduced across MPI ranks (the sums are contiguous doubles)
+ *
+ * The loudness sum is exact: every A_i is rounded to a multiple of
+ * 2^-BAT_STATS_A_FRAC_BITS before it is added, and sums of such values are
+ * exact doubles as long as they stay below 2^(53 - BAT_STATS_A_FRAC_BITS)
+ * (8M bats at full loudness). A_mean, which steers the local search, then
+ * does not depend on the order of the additions: 1 thread or 64, 1 rank or
+ * 16, AoS or SoA, every version computes the same trajectory bit for bit
+ * (checked with --verify, bat_verify.h). The rounding error (< 1e-9 per bat)
+ * is far below the resolution of the local-search step.
+ */
+
+/* Fractional bits of the loudness terms of A_sum. */
+#define BAT_STATS_A_FRAC_BITS 30
+
+/* Term of A_sum for loudness A_i: A_i rounded to a multiple of 2^-BAT_STATS_A_FRAC_BITS. */
+static inline double bat_stats_loudness_term(double A_i) {
+    const double scale = (double)(1L << BAT_STATS_A_FRAC_BITS);
+    return rint(A_i * scale) / scale;
+}
+
+struct BatStats {
+    /* Sums (reduced with +). Kept first and contiguous for MPI. */
+    double A_sum;       /* sum of loudness A_i (exact, see above) */
+    double r_sum;       /* sum of pulse rates r_i */
+    double count;       /* number of bats accumulated (double for MPI_SUM) */
+    double stop_votes;  /* ranks asking to stop (wall clock, see bat_stop.h) */
+
+    /* Best bat seen by this accumulator (reduced with max). */
+    double best_value;
+    long   best_index;  /* global bat index, -1 if empty */
+
+    /* Derived values (filled by bat_stats_finalize). */
+    double A_mean;
+    double r_mean;
+};
+
+/* Number of leading doubles that are reduced with MPI_SUM. */
+#define BAT_STATS_N_SUMS 4
+
+/* Reset an accumulator to the empty state. */
+void bat_stats_reset(BatStats *s);
+
+/*
+ * 1 if a bat (f_value, index) ranks before the best (best_value,
+ * best_index) of an accumulator: larger value, ties to the smallest index.
+ * NaN ranks after every number and -inf still beats the empty state, so a
+ * non-empty accumulator always holds one of its bats (an objective loaded
+ * with so:PATH may return NaN or -inf everywhere). A total order: the
+ * result does not depend on the order of the bats.
+ */
+static inline int bat_stats_better(double f_value, long index, double best_value, long best_index) {
+    if (f_value > best_value) {
+        return 1;
+    }
+    if (f_value == best_value) {
+        return best_index < 0 || index < best_index;
+    }
+    return best_index < 0 || (isnan(best_value) && (!isnan(f_value) || index < best_index));
+}
+
+/*
+ * Add one bat (values + global index) to the accumulator. Inline: the
+ * update kernels call it once per bat per iteration. Ties on the value go
+ * to the smallest index, as in bat_stats_merge(), so the bats can be added
+ * in any order (dynamic schedules).
+ */
+static inline void bat_stats_add_values(BatStats *s, double A_i, double r_i, double f_value, long index) {
+    s->A_sum += bat_stats_loudness_term(A_i);
+    s->r_sum += r_i;
+    s->count += 1.0;
+
+    if (bat_stats_better(f_value, index, s->best_value, s->best_index)) {
+        s->best_value = f_value;
+        s->best_index = index;
+    }
+}
+
+/* Same as bat_stats_add_values(), for a Bat struct. */
+static inline void bat_stats_add(BatStats *s, const Bat *bat, long index) {
+    bat_stats_add_values(s, bat->A_i, bat->r_i, bat->f_value, index);
+}
+
+/* Merge src into dst (used for thread and rank reductions). */
+void bat_stats_merge(BatStats *dst, const BatStats *src);
+
+/* Compute the derived means from the sums. */
+void bat_stats_finalize(BatStats *s);
+
+/* Full pass over bats[0..n_bats-1]; index offset = global index of bats[0]. */
+void bat_stats_compute(BatStats *s, const Bat bats[], int n_bats, long index_offset);
+
+#endif
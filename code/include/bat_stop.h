@@ -0,0 +1,101 @@
+#ifndef BAT_STOP_H
+#define BAT_STOP_H
+
+/*
+ * bat_stop.h
+ *
+ * Convergence-based early termination, shared by all front-ends.
+ *
+ * By default a run performs exactly --iters iterations. Any of these
+ * criteria stops it earlier:
+ *   - target : the global best reaches --target F (the algorithm
+ *              maximizes, so best >= F)
+ *   - stall  : the global best has not improved by more than --tol over
+ *              the last --window W iterations
+ *   - time   : the iteration loop has run for --time-limit S seconds
+ *
+ * The criteria are evaluated every --check-every K iterations (default 1),
+ * once the global best of that iteration is known, so a check costs a few
+ * comparisons (plus one clock read with --time-limit).
+ *
+ * Target and stall only depend on the global best value, which is the same
+ * on every thread and every rank. The wall clock is not: in the MPI
+ * front-ends each rank casts a vote (its time limit is reached) in
+ * BatStats.stop_votes, which is summed by the best-exchange reduction they
+ * already run every iteration. All ranks therefore take the same decision
+ * without an extra collective.
+ */
+
+typedef enum {
+    BAT_STOP_NONE = 0,    /* ran all --iters iterations */
+    BAT_STOP_TARGET,
+    BAT_STOP_STALL,
+    BAT_STOP_TIME
+} BatStopReason;
+
+typedef struct {
+    int use_target;
+    double target;        /* --target */
+    int window;           /* --window W, 0: no stall criterion */
+    double tol;           /* --tol */
+    double time_limit;    /* --time-limit, seconds, <= 0: none */
+    int check_every;      /* --check-every K */
+} BatStopCriteria;
+
+/* Progress of the stall criterion. */
+typedef struct {
+    double ref_value;     /* best value after the last improvement > tol */
+    int ref_iter;         /* iteration of that improvement (-1: initial population) */
+} BatStopState;
+
+/* No criterion, check every iteration. */
+void bat_stop_defaults(BatStopCriteria *c);
+
+/*
+ * Consumes argv[*i] (and its value) if it is a stopping option, advancing
+ * *i past the value. Returns 1 if the option was consumed, 0 otherwise.
+ */
+int bat_stop_parse_option(BatStopCriteria *c, int argc, char **argv, int *i);
+
+/* 1 if the values are usable (K >= 1, W >= 0, tol >= 0). */
+int bat_stop_valid(const BatStopCriteria *c);
+
+/* 1 if at least one criterion is enabled. */
+static inline int bat_stop_enabled(const BatStopCriteria *c) {
+    return c->use_target || c->window > 0 || c->time_limit > 0.0;
+}
+
+/* 1 if the criteria are evaluated after iteration t. */
+static inline int bat_stop_due(const BatStopCriteria *c, int t) {
+    return bat_stop_enabled(c) && (t + 1) % c->check_every == 0;
+}
+
+/* 1 if the wall-clock budget is exhausted after `elapsed` seconds. */
+int bat_stop_time_up(const BatStopCriteria *c, double elapsed);
+
+/* Starts the stall window at the initial population. */
+void bat_stop_init(BatStopState *s, double best_value);
+
+/*
+ * Evaluates the criteria after iteration t (call only when bat_stop_due).
+ *
+ * Parameters:
+ *   - c          : criteria
+ *   - s          : stall progress, updated
+ *   - t          : iteration just completed
+ *   - best_value : global best after iteration t
+ *   - time_up    : wall-clock budget exhausted (bat_stop_time_up, or the
+ *                  reduced rank votes)
+ */
+BatStopReason bat_stop_check(const BatStopCriteria *c, BatStopState *s, int t, double best_value, int time_up);
+
+/* Name of a reason, as printed in the BENCH line ("iters" for BAT_STOP_NONE). */
+const char *bat_stop_reason_name(BatStopReason reason);
+
+/*
+ * BENCH fields of a run with stopping criteria: the number of iterations
+ * performed and the reason. Prints nothing when no criterion is enabled.
+ */
+void bat_stop_print_bench(const BatStopCriteria *c, int iters_done, BatStopReason reason);
+
+#endif
@@ -0,0 +1,157 @@
+#ifndef BAT_STORE_H
+#define BAT_STORE_H
+
+#include <stddef.h>
+
+#include "bat_ckpt.h"
+
+/*
+ * bat_store.h
+ *
+ * Out-of-core population store of the sequential version
+ * (--store mmap:FILE [--store-block N]).
+ *
+ * The population lives in FILE, mapped with mmap(MAP_SHARED), instead of
+ * in memory. The file IS a checkpoint (bat_ckpt.h: header, best_x, one
+ * fixed-size record per bat), so a swarm larger than the RAM pages in and
+ * out through the page cache. Each iteration streams the records in
+ * blocks of N bats: the block is loaded into a small SoA population,
+ * updated with the usual kernel and stored back. Before a block is
+ * updated the next one is prefetched (madvise MADV_WILLNEED); the whole
+ * mapping is read sequentially (MADV_SEQUENTIAL). When the file is larger
+ * than half of the physical memory the blocks already written are also
+ * released (MADV_DONTNEED: the dirty pages go back to the file) so that
+ * the run does not push the rest of the system out.
+ *
+ * Sync points: after every --checkpoint-every K iterations and at the end
+ * of the run, the records are synced (msync), then best_x and a valid
+ * checkpoint header of that iteration are written and synced as well. The
+ * file is then a complete checkpoint: --restart resumes from it in any
+ * front-end, and `--store mmap:FILE --restart FILE` resumes in place, by
+ * mapping it again (no parse step, no copy of the records).
+ *
+ * Crash consistency: the records are updated in place, so there is only
+ * one copy of them. Before the first record changes after a sync point,
+ * the header is switched to BAT_STORE_MAGIC and synced; the valid header
+ * comes back at the next sync point. At any moment the file is therefore
+ * either the complete checkpoint of the last sync point or marked in use,
+ * and then rejected ("not a bat checkpoint") instead of resuming from
+ * records of two different iterations. SIGTERM and SIGINT (walltime,
+ * Ctrl-C) do not kill the run: it stops after the current iteration and
+ * ends with a sync point. Only a crash or SIGKILL between two sync points
+ * loses the file; a smaller K narrows that window (each sync point writes
+ * back the pages dirtied since the previous one).
+ *
+ * An existing FILE is never overwritten: a new run needs a new path, and a
+ * checkpoint or store left by an earlier run is resumed with --restart.
+ *
+ * Every bat keeps its global index (RNG stream) and the blocks are
+ * updated in index order, so the trajectory is the one of the in-memory
+ * SoA population (--verify).
+ *
+ * BENCH fields (bat_store_print_bench), only with --store:
+ *   store=mmap store_block=<N> store_bytes=<B> store_drop=<0|1>
+ * - store_bytes : size of the mapped file
+ * - store_drop  : the blocks were released after their update
+ */
+
+/* Header magic of a store in use (not a valid checkpoint). */
+#define BAT_STORE_MAGIC "BATSTOR1"
+
+/* Default --store-block (bats per block). */
+#define BAT_STORE_BLOCK 4096
+
+typedef struct {
+    const char *path;       /* --store mmap:FILE, NULL: population in memory */
+    int block;              /* --store-block N, rounded up to whole tiles */
+} BatStoreOptions;
+
+typedef struct {
+    int fd;
+    unsigned char *map;     /* whole file */
+    size_t bytes;
+    double *best_x;         /* dim doubles after the header */
+    double *records;        /* n_bats records */
+    long n_bats;
+    int dim;
+    int block;
+    int drop;               /* release the blocks after their update */
+    int in_use;             /* header marked in use since the last sync point */
+} BatStore;
+
+/* No store, BAT_STORE_BLOCK. */
+void bat_store_defaults(BatStoreOptions *o);
+
+/*
+ * Consumes argv[*i] and its value if it is a store option, advancing *i
+ * past the value. Returns 1 if the option was consumed, 0 if it is not a
+ * store option, -1 if its value is invalid (reported on stderr).
+ */
+int bat_store_parse_option(BatStoreOptions *o, int argc, char **argv, int *i);
+
+/*
+ * Creates o->path (which must not exist yet) with room for n_bats records,
+ * maps it and marks it in use. Prints the error and returns -1 if the file
+ * exists or cannot be created.
+ */
+int bat_store_create(BatStore *s, const BatStoreOptions *o, long n_bats, int dim);
+
+/*
+ * Maps an existing checkpoint o->path to resume in place: checks it
+ * against the run (bat_ckpt_mismatch). The file stays a valid checkpoint
+ * until bat_store_begin_update(). Prints the error and returns -1 if the
+ * run cannot resume from this file.
+ *
+ * Parameters:
+ *   - s         : store to open
+ *   - o         : store options (o->path)
+ *   - n_bats    : global number of bats of the run
+ *   - dim       : problem dimension of the run
+ *   - objective : objective name of the run
+ *   - max_iters : --iters of the run
+ *   - h         : output, header of the file
+ */
+int bat_store_resume(BatStore *s, const BatStoreOptions *o, long n_bats, int dim, const char *objective,
+                     int max_iters, BatCkptHeader *h);
+
+/*
+ * Call before the records change: marks the header in use and syncs it, if
+ * it is not marked since the last sync point. Returns 0, or -1 (errno).
+ */
+int bat_store_begin_update(BatStore *s);
+
+/*
+ * Records of bats [begin, begin + n) (one block), after asking the kernel
+ * to read ahead the block that follows (the first one after the last).
+ */
+double *bat_store_block(BatStore *s, long begin, int n);
+
+/* Done with block [begin, begin + n): released if s->drop. */
+void bat_store_release(BatStore *s, long begin, int n);
+
+/*
+ * Sync point: syncs the records, then writes and syncs best_x and the
+ * header h (a valid checkpoint header). Returns 0, or -1 on error (errno
+ * is set; the file stays marked in use).
+ */
+int bat_store_sync(BatStore *s, const BatCkptHeader *h, const double *best_x);
+
+/*
+ * Last sync point (bat_store_sync), then unmaps and closes the file.
+ * Returns 0, or -1 on error (errno is set).
+ */
+int bat_store_close(BatStore *s, const BatCkptHeader *h, const double *best_x);
+
+/*
+ * SIGTERM / SIGINT only set a flag, read with bat_store_interrupted(): the
+ * run stops at the end of the iteration with a sync point.
+ */
+void bat_store_catch_signals(void);
+
+/* 1 once SIGTERM or SIGINT was received (after bat_store_catch_signals()). */
+int bat_store_interrupted(void);
+
+/* Appends the BENCH fields (see above); nothing without --store. */
+void bat_store_print_bench(const BatStoreOptions *o, const BatStore *s);
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef BAT_TRAJ_H
+#define BAT_TRAJ_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <pthread.h>
+
+#include "bat.h"
+#include "bat_pop.h"
+
+/*
+ * bat_traj.h
+ *
+ * Trajectory output (--traj FILE): the positions of all bats every
+ * --traj-every N iterations, in a compact binary file.
+ *
+ * File layout (native byte order):
+ *
+ *   header : BatTrajHeader (32 bytes)
+ *   frame  : int64 iteration, then n_bats * dim values (float with
+ *            --traj-float, double otherwise), bat-major in global index
+ *            order: value (i, d) is at i * dim + d
+ *
+ * A frame is taken after iteration t when t % N == 0. All frames have the
+ * same size, so frame k starts at sizeof(BatTrajHeader) + k * frame size.
+ * tools/traj2csv.py converts a file to CSV.
+ *
+ * The writer keeps two frame buffers: the optimizer copies the positions
+ * into one while the other is written. Sequential and OpenMP runs write
+ * from a background thread (BatTrajWriter); MPI runs write collectively
+ * with non-blocking MPI-IO (bat_traj_mpi.h). The optimizer only waits if
+ * the file system is more than one frame behind.
+ */
+
+#define BAT_TRAJ_MAGIC   "BATTRAJ1"
+#define BAT_TRAJ_VERSION 1
+
+/* Default --traj-every. */
+#define BAT_TRAJ_EVERY 100
+
+typedef struct {
+    char magic[8];          /* BAT_TRAJ_MAGIC, not NUL-terminated */
+    uint32_t version;       /* BAT_TRAJ_VERSION */
+    uint32_t value_size;    /* 4: float, 8: double */
+    int64_t n_bats;
+    int32_t dim;
+    int32_t every;          /* iterations between frames */
+} BatTrajHeader;
+
+/* Bytes in front of the positions of a frame (the iteration number). */
+#define BAT_TRAJ_FRAME_HEAD 8
+
+typedef struct {
+    const char *path;       /* --traj FILE, NULL: no trajectory */
+    int every;              /* --traj-every N */
+    int value_size;         /* 8, or 4 with --traj-float */
+} BatTrajOptions;
+
+/* No trajectory, BAT_TRAJ_EVERY, double values. */
+void bat_traj_defaults(BatTrajOptions *o);
+
+/*
+ * Consumes argv[*i] (and its value) if it is a trajectory option, advancing
+ * *i past the value. Returns 1 if the option was consumed, 0 otherwise.
+ */
+int bat_traj_parse_option(BatTrajOptions *o, int argc, char **argv, int *i);
+
+/* 1 if a frame is taken after iteration t. */
+static inline int bat_traj_due(const BatTrajOptions *o, int t) {
+    return o->path != NULL && t % o->every == 0;
+}
+
+/* Fills the header of a file with n_bats bats of dimension dim. */
+void bat_traj_header_init(BatTrajHeader *h, const BatTrajOptions *o, long n_bats, int dim);
+
+/* Bytes of one bat (row) and of one complete frame. */
+size_t bat_traj_row_size(const BatTrajHeader *h);
+size_t bat_traj_frame_size(const BatTrajHeader *h);
+
+/*
+ * Copies the positions of bats [begin, end) into rows (row i of the
+ * buffer = bat i), converted to the value size of the file. Disjoint
+ * ranges may be stored concurrently.
+ */
+void bat_traj_store_bats(void *rows, const BatTrajHeader *h, const Bat bats[], int begin, int end);
+void bat_traj_store_pop(void *rows, const BatTrajHeader *h, const BatPopulation *pop, int begin, int end);
+
+/* Background writer of a whole population (sequential / OpenMP). */
+typedef struct {
+    FILE *fp;
+    BatTrajHeader header;
+    size_t frame_bytes;
+    unsigned char *buf[2];  /* frame buffers: [iteration | rows] */
+    int fill;               /* buffer the optimizer fills next */
+    int queued[2];          /* 1: handed to the thread, not written yet */
+    int closing;
+    int error;              /* a write failed */
+    long frames;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} BatTrajWriter;
+
+/*
+ * Creates the file, writes the header and starts the writer thread.
+ * Returns 0 on success, -1 on error (errno is set).
+ */
+int bat_traj_open(BatTrajWriter *w, const BatTrajOptions *o, long n_bats, int dim);
+
+/*
+ * Returns the rows of the next frame to fill (n_bats rows). Waits only
+ * while this buffer is still being written.
+ */
+void *bat_traj_begin(BatTrajWriter *w);
+
+/* Hands the filled frame of iteration t to the writer thread. */
+void bat_traj_commit(BatTrajWriter *w, int t);
+
+/* Writes the queued frames, stops the thread, closes the file. Returns 0, or -1 if a write failed. */
+int bat_traj_close(BatTrajWriter *w);
+
+/* BENCH fields of a run with a trajectory (nothing without --traj). */
+void bat_traj_print_bench(const BatTrajOptions *o, long frames);
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef BAT_TRAJ_MPI_H
+#define BAT_TRAJ_MPI_H
+
+#include <mpi.h>
+
+#include "bat_traj.h"
+
+/*
+ * bat_traj_mpi.h
+ *
+ * Collective trajectory writer for the MPI front-ends (mpi_bat,
+ * hybrid_bat). Same file format as bat_traj.h.
+ *
+ * Every rank owns a contiguous block of global indices, so its rows are
+ * one contiguous piece of each frame. A frame is written with ONE
+ * non-blocking collective MPI_File_iwrite_at_all(); rank 0 also writes the
+ * iteration number in front of its rows. The two frame buffers alternate,
+ * and a buffer is only waited for when it is reused two frames later.
+ *
+ * The part of a rank may exceed 2 GiB (large --dim / --n-bats): it is
+ * described by a derived datatype, not by an int count of bytes.
+ *
+ * Only the thread that calls MPI (the master thread in the hybrid build)
+ * may use the writer. Only compiled into the MPI binaries.
+ */
+
+/* Block size of the part datatype (the count of blocks stays an int). */
+#define BAT_TRAJ_MPI_CHUNK ((size_t)1 << 20)
+
+typedef struct {
+    MPI_Comm comm;
+    MPI_File fh;
+    int rank;
+    BatTrajHeader header;
+    size_t frame_bytes;     /* bytes of a whole frame (all ranks) */
+    MPI_Offset my_offset;   /* offset of this rank's part inside a frame */
+    size_t my_bytes;        /* bytes of this rank's part */
+    MPI_Datatype part;      /* one element = the my_bytes of the part */
+    unsigned char *buf[2];  /* rank 0: [iteration | rows], others: [rows] */
+    MPI_Request req[2];
+    int fill;               /* buffer filled next */
+    long frames;
+} BatTrajMpiWriter;
+
+/*
+ * Collective: opens the file and writes the header (rank 0).
+ * Aborts on error.
+ *
+ * Parameters:
+ *   - w       : writer
+ *   - comm    : communicator of the ranks holding the population
+ *   - o       : trajectory options (path, interval, value size)
+ *   - n_bats  : global number of bats
+ *   - dim     : problem dimension
+ *   - begin   : global index of the first local bat
+ *   - local_n : number of local bats
+ */
+void bat_traj_mpi_open(BatTrajMpiWriter *w, MPI_Comm comm, const BatTrajOptions *o,
+                       long n_bats, int dim, long begin, int local_n);
+
+/*
+ * Moves this rank's part of the frames to a new block of bats (mpi_bat
+ * --rebalance-every): completes the pending writes of this rank and
+ * resizes its frame buffers. Aborts on error.
+ */
+void bat_traj_mpi_set_block(BatTrajMpiWriter *w, long begin, int local_n);
+
+/* Rows of the next frame for the local bats (row i = local bat i). */
+void *bat_traj_mpi_begin(BatTrajMpiWriter *w);
+
+/* Collective: posts the write of the filled frame of iteration t. */
+void bat_traj_mpi_commit(BatTrajMpiWriter *w, int t);
+
+/* Collective: completes the pending writes and closes the file. */
+void bat_traj_mpi_close(BatTrajMpiWriter *w);
+
+#endif
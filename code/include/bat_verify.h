@@ -0,0 +1,123 @@
+#ifndef BAT_VERIFY_H
+#define BAT_VERIFY_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "bat.h"
+#include "bat_pop.h"
+#include "bat_stats.h"
+
+/*
+ * bat_verify.h
+ *
+ * Result-equivalence digests (--verify FILE [--verify-every K]).
+ *
+ * After every K-th iteration t (t % K == 0) the run appends one line to
+ * FILE describing the state it reached:
+ *
+ *   t=<t> best=<value> index=<i> A_sum=<sum> sum=<checksum> x=<x0,x1,...>
+ *
+ * - best, index, x : global best after the iteration (printed with %.17g,
+ *                    so they can be compared bit for bit)
+ * - A_sum          : loudness sum of the population
+ * - sum            : 64-bit checksum of the whole population: the sum
+ *                    (mod 2^64) of a hash of every bat (global index,
+ *                    position, velocity, loudness, pulse rate, value and
+ *                    RNG state). The sum does not depend on the order of
+ *                    the bats, so threads and ranks add their partial sums
+ *                    in any order and get the same value.
+ *
+ * The first line is a header with the run description:
+ *
+ *   # BATVERIFY 1 version=<name> n_bats=<N> dim=<D> seed=<S> objective=<name> precision=<name>
+ *
+ * tools/verify_diff.py compares the files of two or more runs (e.g.
+ * sequential, OpenMP and MPI with the same options) and reports the first
+ * iteration where they differ. Every field is exact: the loudness sum does
+ * not depend on the order of the additions (bat_stats.h), so the versions
+ * compute the same trajectory bit for bit for any number of threads and
+ * ranks. Only --async-best with K > 0 legitimately differs.
+ *
+ * Runs of different precisions (--precision, bat_pop.h) follow different
+ * trajectories: verify_diff.py then checks that the best values stay
+ * within a tolerance of the reference instead.
+ *
+ * The checksum costs one extra pass over the bats (and one reduction in
+ * MPI runs) on every digest iteration: timings of --verify runs are not
+ * meant to be compared.
+ */
+
+/* Default --verify-every. */
+#define BAT_VERIFY_EVERY 1
+
+typedef struct {
+    const char *path;       /* --verify FILE, NULL: no digests */
+    int every;              /* --verify-every K */
+} BatVerifyOptions;
+
+/* No digests, BAT_VERIFY_EVERY. */
+void bat_verify_defaults(BatVerifyOptions *o);
+
+/*
+ * Consumes argv[*i] and its value if it is a digest option, advancing *i
+ * past the value. Returns 1 if the option was consumed, 0 otherwise.
+ */
+int bat_verify_parse_option(BatVerifyOptions *o, int argc, char **argv, int *i);
+
+/* 1 if a digest is taken after iteration t. */
+static inline int bat_verify_due(const BatVerifyOptions *o, int t) {
+    return o->path != NULL && t % o->every == 0;
+}
+
+/*
+ * Checksum of bats [begin, end); bats[k] has global index index_offset + k.
+ * Partial sums of disjoint ranges add up (mod 2^64) to the full checksum.
+ */
+uint64_t bat_verify_hash_bats(const Bat bats[], int begin, int end, long index_offset);
+
+/* Same as bat_verify_hash_bats() for the SoA store (global index pop->index_offset + i). */
+uint64_t bat_verify_hash_pop(const BatPopulation *pop, int begin, int end);
+
+typedef struct {
+    FILE *fp;
+    int dim;
+    long digests;           /* lines written */
+} BatVerifyWriter;
+
+/*
+ * Creates the digest file and writes its header (one writer per run, on
+ * MPI rank 0). Returns 0 on success, -1 on error (errno is set).
+ *
+ * Parameters:
+ *   - w         : writer to initialize
+ *   - path      : --verify FILE
+ *   - version   : front-end name (as in the BENCH line)
+ *   - n_bats    : global number of bats
+ *   - dim       : problem dimension
+ *   - seed      : seed of the run
+ *   - objective : objective name
+ *   - precision : storage precision (bat_precision_name(); "double" for AoS)
+ */
+int bat_verify_open(BatVerifyWriter *w, const char *path, const char *version, long n_bats, int dim,
+                    unsigned int seed, const char *objective, const char *precision);
+
+/*
+ * Appends the digest of iteration t.
+ *
+ * Parameters:
+ *   - w        : open writer
+ *   - t        : iteration index
+ *   - stats    : global statistics and best after the iteration
+ *   - best_x   : position of the global best (w->dim values)
+ *   - checksum : global checksum of the population
+ */
+void bat_verify_write(BatVerifyWriter *w, int t, const BatStats *stats, const double best_x[], uint64_t checksum);
+
+/* Closes the file. Returns 0, or -1 if a write failed. */
+int bat_verify_close(BatVerifyWriter *w);
+
+/* Appends " verify_every=K digests=N" to the BENCH line (nothing without --verify). */
+void bat_verify_print_bench(const BatVerifyOptions *o, long digests);
+
+#endif
@@ -0,0 +1,197 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bat.h"
+#include "bat_ckpt.h"
+#include "bat_balance.h"
+
+/*
+ * bat_balance.c
+ *
+ * Purpose:
+ * Per-rank update timing, resizing of the index blocks and migration of
+ * the bats that change owner (see bat_balance.h).
+ */
+
+void bat_balance_init(BatBalance *b, MPI_Comm comm, int every, int n_bats) {
+    memset(b, 0, sizeof(*b));
+    b->comm = comm;
+    MPI_Comm_rank(comm, &b->rank);
+    MPI_Comm_size(comm, &b->size);
+    b->every = every;
+
+    b->begin = malloc((size_t)b->size * sizeof(long));
+    b->count = malloc((size_t)b->size * sizeof(int));
+    b->next_begin = malloc((size_t)b->size * sizeof(long));
+    b->next_count = malloc((size_t)b->size * sizeof(int));
+    if (!b->begin || !b->count || !b->next_begin || !b->next_count) {
+        perror("malloc partition");
+        MPI_Abort(comm, 1);
+    }
+    for (int q = 0; q < b->size; q++) {
+        bat_partition(n_bats, b->size, q, &b->begin[q], &b->count[q]);
+    }
+}
+
+void bat_balance_free(BatBalance *b) {
+    free(b->begin);
+    free(b->count);
+    free(b->next_begin);
+    free(b->next_count);
+}
+
+void bat_balance_local(const BatBalance *b, long *begin, int *local_n) {
+    *begin = b->begin[b->rank];
+    *local_n = b->count[b->rank];
+}
+
+/*
+ * Blocks proportional to the speeds (bats per second), at least one bat per
+ * rank, rounded by largest remainder so that they add up to n.
+ */
+static void plan_counts(const BatBalance *b, const double busy[], int n) {
+    double total_speed = 0.0;
+    for (int q = 0; q < b->size; q++) {
+        total_speed += b->count[q] / busy[q];
+    }
+
+    int assigned = 0;
+    double *rest = malloc((size_t)b->size * sizeof(double));
+    if (!rest) {
+        perror("malloc partition");
+        MPI_Abort(b->comm, 1);
+    }
+    for (int q = 0; q < b->size; q++) {
+        const double share = 1.0 + (n - b->size) * (b->count[q] / busy[q]) / total_speed;
+        b->next_count[q] = (int)share;
+        rest[q] = share - b->next_count[q];
+        assigned += b->next_count[q];
+    }
+    /* Same order on every rank: ties go to the lowest rank */
+    while (assigned < n) {
+        int best = 0;
+        for (int q = 1; q < b->size; q++) {
+            if (rest[q] > rest[best]) {
+                best = q;
+            }
+        }
+        b->next_count[best]++;
+        rest[best] = -1.0;
+        assigned++;
+    }
+    free(rest);
+
+    long begin = 0;
+    for (int q = 0; q < b->size; q++) {
+        b->next_begin[q] = begin;
+        begin += b->next_count[q];
+    }
+}
+
+int bat_balance_plan(BatBalance *b) {
+    const double start = MPI_Wtime();
+    double *busy = malloc((size_t)b->size * sizeof(double));
+    if (!busy) {
+        perror("malloc update times");
+        MPI_Abort(b->comm, 1);
+    }
+    MPI_Allgather(&b->busy, 1, MPI_DOUBLE, busy, 1, MPI_DOUBLE, b->comm);
+    b->busy = 0.0;
+
+    double sum = 0.0, max = 0.0, min = busy[0];
+    long n = 0;
+    for (int q = 0; q < b->size; q++) {
+        sum += busy[q];
+        max = busy[q] > max ? busy[q] : max;
+        min = busy[q] < min ? busy[q] : min;
+        n += b->count[q];
+    }
+    const double imbalance = sum > 0.0 ? max * b->size / sum : 1.0;
+    if (b->imbalance_first == 0.0) {
+        b->imbalance_first = imbalance;
+    }
+    b->imbalance_last = imbalance;
+
+    /* Every rank takes the same decision on the same gathered times */
+    int changed = 0;
+    if (imbalance > BAT_BALANCE_TOL && min > 0.0) {
+        plan_counts(b, busy, (int)n);
+        for (int q = 0; q < b->size; q++) {
+            changed |= (b->next_count[q] != b->count[q]);
+        }
+    }
+    free(busy);
+    b->migrate_s += MPI_Wtime() - start;
+    return changed;
+}
+
+/* Number of indices shared by [a, a + na) and [c, c + nc); *from: first one. */
+static int overlap(long a, int na, long c, int nc, long *from) {
+    const long lo = a > c ? a : c;
+    const long hi = (a + na < c + nc) ? a + na : c + nc;
+    *from = lo;
+    return hi > lo ? (int)(hi - lo) : 0;
+}
+
+void bat_balance_migrate(BatBalance *b, const double *send, double *recv, int dim) {
+    const double start = MPI_Wtime();
+    const int me = b->rank;
+    int *counts = malloc(4 * (size_t)b->size * sizeof(int));
+    if (!counts) {
+        perror("malloc migration counts");
+        MPI_Abort(b->comm, 1);
+    }
+    int *send_counts = counts, *send_displs = counts + b->size;
+    int *recv_counts = counts + 2 * b->size, *recv_displs = counts + 3 * b->size;
+
+    /* Bats of my current block that q owns next / of q's current block that I own next */
+    for (int q = 0; q < b->size; q++) {
+        long from;
+        send_counts[q] = overlap(b->begin[me], b->count[me], b->next_begin[q], b->next_count[q], &from);
+        send_displs[q] = (int)(from - b->begin[me]);
+        recv_counts[q] = overlap(b->begin[q], b->count[q], b->next_begin[me], b->next_count[me], &from);
+        recv_displs[q] = (int)(from - b->next_begin[me]);
+        if (send_counts[q] == 0) {
+            send_displs[q] = 0;
+        }
+        if (recv_counts[q] == 0) {
+            recv_displs[q] = 0;
+        }
+    }
+
+    MPI_Datatype record;
+    MPI_Type_contiguous(BAT_CKPT_RECORD(dim), MPI_DOUBLE, &record);
+    MPI_Type_commit(&record);
+    MPI_Alltoallv(send, send_counts, send_displs, record, recv, recv_counts, recv_displs, record, b->comm);
+    MPI_Type_free(&record);
+    free(counts);
+
+    /* Same count on every rank: bats whose owner changed */
+    for (int q = 0; q < b->size; q++) {
+        long from;
+        b->migrated += b->next_count[q] - overlap(b->begin[q], b->count[q], b->next_begin[q], b->next_count[q], &from);
+    }
+    memcpy(b->begin, b->next_begin, (size_t)b->size * sizeof(long));
+    memcpy(b->count, b->next_count, (size_t)b->size * sizeof(int));
+    b->rebalances++;
+    b->migrate_s += MPI_Wtime() - start;
+}
+
+void bat_balance_finish(BatBalance *b) {
+    MPI_Allreduce(MPI_IN_PLACE, &b->migrate_s, 1, MPI_DOUBLE, MPI_MAX, b->comm);
+}
+
+void bat_balance_print_bench(const BatBalance *b) {
+    if (b->every <= 0) {
+        return;
+    }
+    int min = b->count[0], max = b->count[0];
+    for (int q = 1; q < b->size; q++) {
+        min = b->count[q] < min ? b->count[q] : min;
+        max = b->count[q] > max ? b->count[q] : max;
+    }
+    printf(" rebalance_every=%d rebalances=%d migrated_bats=%ld migrate_s=%.6f imbalance_first=%.3f imbalance_last=%.3f"
+           " local_bats_min=%d local_bats_max=%d",
+           b->every, b->rebalances, b->migrated, b->migrate_s, b->imbalance_first, b->imbalance_last, min, max);
+}
@@ -0,0 +1,205 @@
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bat_batch.h"
+
+/*
+ * bat_batch.c
+ *
+ * Purpose:
+ * Reading and validation of the run specifications of the batch
+ * front-end (see bat_batch.h).
+ */
+
+/* Most options on one line of a spec file. */
+#define BAT_BATCH_MAX_ARGS 64
+
+int bat_batch_unsupported(const BatOptions *o, int report) {
+    if (o->traj.path || o->ckpt.path || o->ckpt.restart || o->verify.path) {
+        if (report) {
+            fprintf(stderr, "--traj / --checkpoint / --restart / --verify are not available in batch mode\n");
+        }
+        return 1;
+    }
+    return 0;
+}
+
+/* Reads the whole file into a NUL-terminated buffer. */
+static char *read_text(const char *path) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        return NULL;
+    }
+    char *text = NULL;
+    long len = -1;
+    if (fseek(fp, 0, SEEK_END) == 0) {
+        len = ftell(fp);
+    }
+    if (len >= 0 && fseek(fp, 0, SEEK_SET) == 0) {
+        text = malloc((size_t)len + 1);
+        if (text && fread(text, 1, (size_t)len, fp) != (size_t)len) {
+            free(text);
+            text = NULL;
+            errno = EIO;
+        }
+    }
+    fclose(fp);
+    if (text) {
+        text[len] = '\0';
+    }
+    return text;
+}
+
+/*
+ * Fills spec k from the command-line options and the tokens of one line.
+ * Returns 0, or -1 if the line is invalid (reported).
+ */
+static int parse_spec(BatRunSpec *spec, long k, const BatOptions *defaults, int argc, char **argv,
+                      const char *path, int line, int report) {
+    spec->opt = *defaults;
+    spec->opt.seed = defaults->seed + (unsigned int)k;
+
+    for (int i = 0; i < argc; i++) {
+        int rc = bat_options_parse_option(&spec->opt, argc, argv, &i);
+        if (rc == 0 && report) {
+            fprintf(stderr, "Unknown or incomplete option '%s'\n", argv[i]);
+        }
+        if (rc <= 0) {
+            if (report) {
+                fprintf(stderr, "  in %s, line %d\n", path, line);
+            }
+            return -1;
+        }
+    }
+
+    /* The batch solver always works on the SoA store */
+    spec->opt.layout = BAT_LAYOUT_SOA;
+    if (bat_batch_unsupported(&spec->opt, report) ||
+        bat_options_validate(&spec->opt, report, &spec->objective) != 0) {
+        if (report) {
+            fprintf(stderr, "  in %s, line %d\n", path, line);
+        }
+        return -1;
+    }
+    return 0;
+}
+
+int bat_batch_load(BatBatch *b, const char *path, const BatOptions *defaults, int report) {
+    memset(b, 0, sizeof(*b));
+    b->text = read_text(path);
+    if (!b->text) {
+        if (report) {
+            perror(path);
+        }
+        return -1;
+    }
+
+    long lines = 1;
+    for (const char *c = b->text; *c; c++) {
+        lines += (*c == '\n');
+    }
+    b->runs = malloc((size_t)lines * sizeof(BatRunSpec));
+    if (!b->runs) {
+        if (report) {
+            perror("malloc batch");
+        }
+        bat_batch_free(b);
+        return -1;
+    }
+
+    char *next = b->text;
+    for (int line = 1; next; line++) {
+        char *cur = next;
+        next = strchr(cur, '\n');
+        if (next) {
+            *next++ = '\0';
+        }
+        char *comment = strchr(cur, '#');
+        if (comment) {
+            *comment = '\0';
+        }
+
+        /* Split the line in place into argv-style tokens */
+        char *argv[BAT_BATCH_MAX_ARGS];
+        int argc = 0;
+        for (char *c = cur; *c;) {
+            while (*c && isspace((unsigned char)*c)) {
+                *c++ = '\0';
+            }
+            if (!*c) {
+                break;
+            }
+            if (argc == BAT_BATCH_MAX_ARGS) {
+                if (report) {
+                    fprintf(stderr, "More than %d options in %s, line %d\n", BAT_BATCH_MAX_ARGS, path, line);
+                }
+                bat_batch_free(b);
+                return -1;
+            }
+            argv[argc++] = c;
+            while (*c && !isspace((unsigned char)*c)) {
+                c++;
+            }
+        }
+        if (argc == 0) {
+            continue;
+        }
+
+        if (parse_spec(&b->runs[b->n_runs], b->n_runs, defaults, argc, argv, path, line, report) != 0) {
+            bat_batch_free(b);
+            return -1;
+        }
+        b->n_runs++;
+    }
+
+    if (b->n_runs == 0) {
+        if (report) {
+            fprintf(stderr, "No runs in %s\n", path);
+        }
+        bat_batch_free(b);
+        return -1;
+    }
+    return 0;
+}
+
+int bat_batch_repeat(BatBatch *b, long n_runs, const BatOptions *defaults, int report) {
+    memset(b, 0, sizeof(*b));
+    if (n_runs <= 0) {
+        if (report) {
+            fprintf(stderr, "Invalid number of runs: runs=%ld\n", n_runs);
+        }
+        return -1;
+    }
+
+    BatRunSpec spec;
+    spec.opt = *defaults;
+    spec.opt.layout = BAT_LAYOUT_SOA;
+    if (bat_batch_unsupported(&spec.opt, report) || bat_options_validate(&spec.opt, report, &spec.objective) != 0) {
+        return -1;
+    }
+
+    b->runs = malloc((size_t)n_runs * sizeof(BatRunSpec));
+    if (!b->runs) {
+        if (report) {
+            perror("malloc batch");
+        }
+        return -1;
+    }
+    for (long k = 0; k < n_runs; k++) {
+        b->runs[k] = spec;
+        b->runs[k].opt.seed = defaults->seed + (unsigned int)k;
+    }
+    b->n_runs = n_runs;
+    return 0;
+}
+
+void bat_batch_free(BatBatch *b) {
+    free(b->runs);
+    free(b->text);
+    b->runs = NULL;
+    b->text = NULL;
+    b->n_runs = 0;
+}
@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bat.h"
+#include "bat_best_record.h"
+
+/*
+ * bat_best_record.c
+ *
+ * Purpose:
+ * Derived datatype, user-defined reduction op and pack / unpack helpers of
+ * the fused global-best record (see bat_best_record.h).
+ */
+
+/* User reduction op: sums the statistics, keeps the best (value, index, x). */
+static void best_record_op(void *in, void *inout, int *len, MPI_Datatype *type) {
+    int type_size;
+    MPI_Type_size(*type, &type_size);
+    int width = type_size / (int)sizeof(double);
+
+    for (int k = 0; k < *len; k++) {
+        const double *a = (const double *)in + (size_t)k * width;
+        double *b = (double *)inout + (size_t)k * width;
+
+        b[BAT_REC_A_SUM] += a[BAT_REC_A_SUM];
+        b[BAT_REC_R_SUM] += a[BAT_REC_R_SUM];
+        b[BAT_REC_COUNT] += a[BAT_REC_COUNT];
+        b[BAT_REC_STOP] += a[BAT_REC_STOP];
+
+        if (a[BAT_REC_INDEX] >= 0.0 && bat_stats_better(a[BAT_REC_VALUE], (long)a[BAT_REC_INDEX],
+                                                         b[BAT_REC_VALUE], (long)b[BAT_REC_INDEX])) {
+            memcpy(b + BAT_REC_VALUE, a + BAT_REC_VALUE, (size_t)(width - BAT_REC_VALUE) * sizeof(double));
+        }
+    }
+}
+
+void bat_best_record_init(BatBestRecord *br, MPI_Comm comm, int dim) {
+    br->comm = comm;
+    br->dim = dim;
+    br->rec = malloc((size_t)BAT_BEST_RECORD_SIZE(dim) * sizeof(double));
+    if (!br->rec) {
+        perror("malloc best record");
+        MPI_Abort(comm, 1);
+    }
+    MPI_Type_contiguous(BAT_BEST_RECORD_SIZE(dim), MPI_DOUBLE, &br->type);
+    MPI_Type_commit(&br->type);
+    MPI_Op_create(best_record_op, 1, &br->op);
+}
+
+void bat_best_record_free(BatBestRecord *br) {
+    MPI_Op_free(&br->op);
+    MPI_Type_free(&br->type);
+    free(br->rec);
+    br->rec = NULL;
+}
+
+void bat_best_record_pack(const BatBestRecord *br, double *rec, const BatStats *stats, const double *local_x) {
+    rec[BAT_REC_A_SUM] = stats->A_sum;
+    rec[BAT_REC_R_SUM] = stats->r_sum;
+    rec[BAT_REC_COUNT] = stats->count;
+    rec[BAT_REC_STOP] = stats->stop_votes;
+    rec[BAT_REC_VALUE] = stats->best_value;
+    rec[BAT_REC_INDEX] = (double)stats->best_index;
+    memcpy(rec + BAT_REC_X, local_x, (size_t)br->dim * sizeof(double));
+}
+
+void bat_best_record_unpack(const BatBestRecord *br, const double *rec, BatStats *stats, double *best_x) {
+    stats->A_sum = rec[BAT_REC_A_SUM];
+    stats->r_sum = rec[BAT_REC_R_SUM];
+    stats->count = rec[BAT_REC_COUNT];
+    stats->stop_votes = rec[BAT_REC_STOP];
+    stats->best_value = rec[BAT_REC_VALUE];
+    stats->best_index = (long)rec[BAT_REC_INDEX];
+    bat_stats_finalize(stats);
+    memcpy(best_x, rec + BAT_REC_X, (size_t)br->dim * sizeof(double));
+}
+
+double bat_best_exchange(BatBestRecord *br, BatStats *stats, const double *local_x, double *best_x) {
+    bat_best_record_pack(br, br->rec, stats, local_x);
+    MPI_Allreduce(MPI_IN_PLACE, br->rec, 1, br->type, br->op, br->comm);
+    bat_best_record_unpack(br, br->rec, stats, best_x);
+    return stats->best_value;
+}
@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bat.h"
+#include "bat_best_shm.h"
+
+/*
+ * bat_best_shm.c
+ *
+ * Purpose:
+ * Node communicators, shared record window and two-level reduction of the
+ * fused global-best record (see bat_best_shm.h).
+ */
+
+void bat_best_shm_init(BatBestShm *s, const BatBestRecord *br) {
+    memset(s, 0, sizeof(*s));
+    s->width = BAT_BEST_RECORD_SIZE(br->dim);
+    s->win = MPI_WIN_NULL;
+    s->leaders = MPI_COMM_NULL;
+
+    int rank;
+    MPI_Comm_rank(br->comm, &rank);
+    MPI_Comm_split_type(br->comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &s->node);
+    MPI_Comm_rank(s->node, &s->node_rank);
+    MPI_Comm_size(s->node, &s->node_size);
+
+    int counts[2] = { s->node_rank == 0, s->node_size };
+    MPI_Allreduce(MPI_IN_PLACE, &counts[0], 1, MPI_INT, MPI_SUM, br->comm);
+    MPI_Allreduce(MPI_IN_PLACE, &counts[1], 1, MPI_INT, MPI_MAX, br->comm);
+    s->nodes = counts[0];
+    s->max_node_ranks = counts[1];
+    s->active = s->max_node_ranks > 1;
+
+    /* Every node takes part, single-rank nodes too: their leader is the rank */
+    MPI_Comm_split(br->comm, s->node_rank == 0 ? 0 : MPI_UNDEFINED, rank, &s->leaders);
+    if (!s->active) {
+        return;
+    }
+
+    /* The leader holds the whole node array; the others map it */
+    const MPI_Aint bytes = s->node_rank == 0 ? (MPI_Aint)(s->node_size + 1) * s->width * (MPI_Aint)sizeof(double) : 0;
+    double *base;
+    if (MPI_Win_allocate_shared(bytes, sizeof(double), MPI_INFO_NULL, s->node, &base, &s->win) != MPI_SUCCESS) {
+        fprintf(stderr, "MPI_Win_allocate_shared failed\n");
+        MPI_Abort(br->comm, 1);
+    }
+    MPI_Aint size;
+    int disp_unit;
+    MPI_Win_shared_query(s->win, 0, &size, &disp_unit, &s->slots);
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, s->win);
+}
+
+void bat_best_shm_free(BatBestShm *s) {
+    if (s->win != MPI_WIN_NULL) {
+        MPI_Win_unlock_all(s->win);
+        MPI_Win_free(&s->win);
+    }
+    if (s->leaders != MPI_COMM_NULL) {
+        MPI_Comm_free(&s->leaders);
+    }
+    MPI_Comm_free(&s->node);
+    s->slots = NULL;
+}
+
+/* Makes the stores of every rank of the node visible to the others. */
+static void node_sync(BatBestShm *s) {
+    MPI_Win_sync(s->win);
+    MPI_Barrier(s->node);
+    MPI_Win_sync(s->win);
+}
+
+double bat_best_shm_exchange(BatBestShm *s, BatBestRecord *br, BatStats *stats, const double *local_x, double *best_x) {
+    if (!s->active) {
+        return bat_best_exchange(br, stats, local_x, best_x);
+    }
+    double *result = s->slots + (size_t)s->node_size * s->width;
+
+    /*
+     * The leader writes the result only after the first barrier, which all
+     * ranks reach after reading the previous one: two barriers suffice.
+     */
+    bat_best_record_pack(br, s->slots + (size_t)s->node_rank * s->width, stats, local_x);
+    node_sync(s);
+
+    if (s->node_rank == 0) {
+        memcpy(result, s->slots, (size_t)s->width * sizeof(double));
+        for (int q = 1; q < s->node_size; q++) {
+            MPI_Reduce_local(s->slots + (size_t)q * s->width, result, 1, br->type, br->op);
+        }
+        if (s->nodes > 1) {
+            MPI_Allreduce(MPI_IN_PLACE, result, 1, br->type, br->op, s->leaders);
+        }
+    }
+    node_sync(s);
+
+    bat_best_record_unpack(br, result, stats, best_x);
+    return stats->best_value;
+}
+
+void bat_best_shm_print_bench(const BatBestShm *s) {
+    printf(" shm_nodes=%d shm_node_ranks=%d", s->nodes, s->max_node_ranks);
+}
@@ -0,0 +1,297 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bat_ckpt.h"
+
+/*
+ * bat_ckpt.c
+ *
+ * Purpose:
+ * Checkpoint format (see bat_ckpt.h): options, header, conversion of the
+ * bats to fixed-size records, and the serial file I/O used by the
+ * sequential and OpenMP front-ends.
+ */
+
+void bat_ckpt_defaults(BatCkptOptions *o) {
+    o->path = NULL;
+    o->every = BAT_CKPT_EVERY;
+    o->restart = NULL;
+}
+
+int bat_ckpt_parse_option(BatCkptOptions *o, int argc, char **argv, int *i) {
+    if (*i + 1 >= argc) {
+        return 0;
+    }
+    const char *opt = argv[*i];
+    const char *value = argv[*i + 1];
+
+    if (strcmp(opt, "--checkpoint") == 0) {
+        o->path = value;
+    } else if (strcmp(opt, "--checkpoint-every") == 0) {
+        o->every = atoi(value);
+    } else if (strcmp(opt, "--restart") == 0) {
+        o->restart = value;
+    } else {
+        return 0;
+    }
+    (*i)++;
+    return 1;
+}
+
+void bat_ckpt_header_init(BatCkptHeader *h, long n_bats, int dim, int iteration, unsigned int seed,
+                          const BatStats *stats, const BatStopState *stop, const char *objective) {
+    memset(h, 0, sizeof(*h));
+    memcpy(h->magic, BAT_CKPT_MAGIC, sizeof(h->magic));
+    h->version = BAT_CKPT_VERSION;
+    h->dim = dim;
+    h->n_bats = n_bats;
+    h->iteration = iteration;
+    h->seed = seed;
+    h->A_sum = stats->A_sum;
+    h->r_sum = stats->r_sum;
+    h->count = stats->count;
+    h->best_value = stats->best_value;
+    h->best_index = stats->best_index;
+    h->stop_ref_value = stop->ref_value;
+    h->stop_ref_iter = stop->ref_iter;
+    strncpy(h->objective, objective, sizeof(h->objective) - 1);
+}
+
+void bat_ckpt_header_restore(const BatCkptHeader *h, BatStats *stats, BatStopState *stop) {
+    bat_stats_reset(stats);
+    stats->A_sum = h->A_sum;
+    stats->r_sum = h->r_sum;
+    stats->count = h->count;
+    stats->best_value = h->best_value;
+    stats->best_index = (long)h->best_index;
+    bat_stats_finalize(stats);
+
+    stop->ref_value = h->stop_ref_value;
+    stop->ref_iter = (int)h->stop_ref_iter;
+}
+
+const char *bat_ckpt_mismatch(const BatCkptHeader *h, long n_bats, int dim, const char *objective, int max_iters) {
+    if (memcmp(h->magic, BAT_CKPT_MAGIC, sizeof(h->magic)) != 0) {
+        return "not a bat checkpoint";
+    }
+    if (h->version != BAT_CKPT_VERSION) {
+        return "unsupported checkpoint version";
+    }
+    if (h->n_bats != n_bats) {
+        return "different --n-bats";
+    }
+    if (h->dim != dim) {
+        return "different --dim";
+    }
+    if (strncmp(h->objective, objective, sizeof(h->objective)) != 0) {
+        return "different --objective";
+    }
+    if (h->iteration < 0 || h->iteration > max_iters) {
+        return "checkpoint is past --iters";
+    }
+    return NULL;
+}
+
+size_t bat_ckpt_record_offset(int dim, long i) {
+    return sizeof(BatCkptHeader) + (size_t)dim * sizeof(double)
+           + (size_t)i * BAT_CKPT_RECORD(dim) * sizeof(double);
+}
+
+void bat_ckpt_store_bats(double *records, const Bat bats[], int begin, int end) {
+    for (int i = begin; i < end; i++) {
+        double *rec = records + (size_t)(i - begin) * BAT_CKPT_RECORD(dimension);
+        for (int d = 0; d < dimension; d++) {
+            rec[d] = bats[i].x_i[d];
+            rec[dimension + d] = bats[i].v_i[d];
+        }
+        rec += 2 * dimension;
+        rec[0] = bats[i].A_i;
+        rec[1] = bats[i].r_i;
+        rec[2] = bats[i].f_value;
+        rec[3] = bats[i].rng_spare;
+        rec[4] = (double)bats[i].rng_state;
+    }
+}
+
+void bat_ckpt_load_bats(const double *records, Bat bats[], int begin, int end) {
+    for (int i = begin; i < end; i++) {
+        const double *rec = records + (size_t)(i - begin) * BAT_CKPT_RECORD(dimension);
+        for (int d = 0; d < dimension; d++) {
+            bats[i].x_i[d] = rec[d];
+            bats[i].v_i[d] = rec[dimension + d];
+        }
+        rec += 2 * dimension;
+        bats[i].A_i = rec[0];
+        bats[i].r_i = rec[1];
+        bats[i].f_value = rec[2];
+        bats[i].rng_spare = rec[3];
+        bats[i].rng_state = (uint32_t)rec[4];
+    }
+}
+
+void bat_ckpt_store_pop(double *records, const BatPopulation *pop, int begin, int end) {
+    const int dim = pop->dim;
+    for (int i = begin; i < end; i++) {
+        double *rec = records + (size_t)(i - begin) * BAT_CKPT_RECORD(dim);
+        for (int d = 0; d < dim; d++) {
+            size_t k = bat_pop_offset(dim, i, d);
+            rec[d] = bat_pop_x(pop, k);
+            rec[dim + d] = bat_pop_v(pop, k);
+        }
+        rec += 2 * dim;
+        rec[0] = bat_pop_A(pop, i);
+        rec[1] = bat_pop_r(pop, i);
+        rec[2] = pop->f_value[i];
+        rec[3] = pop->rng_spare[i];
+        rec[4] = (double)pop->rng[i];
+    }
+}
+
+void bat_ckpt_load_pop(const double *records, BatPopulation *pop, int begin, int end) {
+    const int dim = pop->dim;
+    for (int i = begin; i < end; i++) {
+        const double *rec = records + (size_t)(i - begin) * BAT_CKPT_RECORD(dim);
+        for (int d = 0; d < dim; d++) {
+            size_t k = bat_pop_offset(dim, i, d);
+            bat_pop_set_x(pop, k, rec[d]);
+            bat_pop_set_v(pop, k, rec[dim + d]);
+        }
+        rec += 2 * dim;
+        bat_pop_set_A(pop, i, rec[0]);
+        bat_pop_set_r(pop, i, rec[1]);
+        pop->f_value[i] = rec[2];
+        pop->rng_spare[i] = rec[3];
+        pop->rng[i] = (uint32_t)rec[4];
+    }
+}
+
+char *bat_ckpt_tmp_path(const char *path) {
+    size_t len = strlen(path);
+    char *tmp = malloc(len + 5);
+    if (tmp) {
+        memcpy(tmp, path, len);
+        memcpy(tmp + len, ".tmp", 5);
+    }
+    return tmp;
+}
+
+int bat_ckpt_write(const char *path, const BatCkptHeader *h, const double *best_x, const double *records) {
+    char *tmp = bat_ckpt_tmp_path(path);
+    if (!tmp) {
+        errno = ENOMEM;
+        return -1;
+    }
+    FILE *fp = fopen(tmp, "wb");
+    if (!fp) {
+        int err = errno;
+        free(tmp);
+        errno = err;
+        return -1;
+    }
+
+    size_t n_records = (size_t)h->n_bats * BAT_CKPT_RECORD(h->dim);
+    int failed = fwrite(h, sizeof(*h), 1, fp) != 1 ||
+                 fwrite(best_x, sizeof(double), (size_t)h->dim, fp) != (size_t)h->dim ||
+                 fwrite(records, sizeof(double), n_records, fp) != n_records;
+    int err = errno;
+    if (fclose(fp) != 0 && !failed) {
+        failed = 1;
+        err = errno;
+    }
+
+    /* Only a complete file replaces the previous checkpoint */
+    if (!failed && rename(tmp, path) != 0) {
+        failed = 1;
+        err = errno;
+    }
+    if (failed) {
+        remove(tmp);
+    }
+    free(tmp);
+    errno = err;
+    return failed ? -1 : 0;
+}
+
+int bat_ckpt_read_header(const char *path, BatCkptHeader *h) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        return -1;
+    }
+    /* A file shorter than a header is reported by bat_ckpt_mismatch() (bad magic) */
+    if (fread(h, sizeof(*h), 1, fp) != 1) {
+        memset(h, 0, sizeof(*h));
+    }
+    fclose(fp);
+    return 0;
+}
+
+int bat_ckpt_read(const char *path, const BatCkptHeader *h, double *best_x, double *records) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        return -1;
+    }
+    size_t n_records = (size_t)h->n_bats * BAT_CKPT_RECORD(h->dim);
+    int failed = fseek(fp, (long)sizeof(*h), SEEK_SET) != 0 ||
+                 fread(best_x, sizeof(double), (size_t)h->dim, fp) != (size_t)h->dim ||
+                 fread(records, sizeof(double), n_records, fp) != n_records;
+    fclose(fp);
+    if (failed) {
+        /* A short read is a truncated file */
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
+int bat_ckpt_restore(const char *path, long n_bats, int dim, const char *objective, int max_iters,
+                     BatCkptHeader *h, double *best_x, double *records) {
+    if (bat_ckpt_read_header(path, h) != 0) {
+        perror(path);
+        return -1;
+    }
+    const char *mismatch = bat_ckpt_mismatch(h, n_bats, dim, objective, max_iters);
+    if (mismatch) {
+        fprintf(stderr, "Cannot restart from %s: %s\n", path, mismatch);
+        return -1;
+    }
+    if (bat_ckpt_read(path, h, best_x, records) != 0) {
+        perror(path);
+        return -1;
+    }
+    return 0;
+}
+
+int bat_ckpt_save_bats(const BatCkptOptions *o, double *records, const Bat bats[], int n_bats, int iteration,
+                       unsigned int seed, const BatStats *stats, const BatStopState *stop, const char *objective) {
+    BatCkptHeader h;
+    bat_ckpt_header_init(&h, n_bats, dimension, iteration, seed, stats, stop, objective);
+    bat_ckpt_store_bats(records, bats, 0, n_bats);
+    if (bat_ckpt_write(o->path, &h, bats[stats->best_index].x_i, records) != 0) {
+        perror(o->path);
+        return -1;
+    }
+    return 0;
+}
+
+int bat_ckpt_save_pop(const BatCkptOptions *o, double *records, const BatPopulation *pop, const double *best_x,
+                      int iteration, unsigned int seed, const BatStats *stats, const BatStopState *stop) {
+    BatCkptHeader h;
+    bat_ckpt_header_init(&h, pop->n, pop->dim, iteration, seed, stats, stop, pop->objective->name);
+    bat_ckpt_store_pop(records, pop, 0, pop->n);
+    if (bat_ckpt_write(o->path, &h, best_x, records) != 0) {
+        perror(o->path);
+        return -1;
+    }
+    return 0;
+}
+
+void bat_ckpt_print_bench(const BatCkptOptions *o, int restart_iter, int written) {
+    if (o->restart) {
+        printf(" restart_iter=%d", restart_iter);
+    }
+    if (o->path) {
+        printf(" checkpoint_every=%d checkpoints=%d", o->every, written);
+    }
+}
@@ -0,0 +1,125 @@
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bat_ckpt_mpi.h"
+
+/*
+ * bat_ckpt_mpi.c
+ *
+ * Purpose:
+ * Collective MPI-IO reads and writes of the checkpoint format (see
+ * bat_ckpt_mpi.h and bat_ckpt.h).
+ */
+
+static void check_io(int rc, const char *what, MPI_Comm comm) {
+    if (rc != MPI_SUCCESS) {
+        char msg[MPI_MAX_ERROR_STRING];
+        int len = 0;
+        MPI_Error_string(rc, msg, &len);
+        fprintf(stderr, "%s: %s\n", what, msg);
+        MPI_Abort(comm, 1);
+    }
+}
+
+/* Doubles of the records of local_n bats, as an MPI count. */
+static int record_count(const BatCkptHeader *h, int local_n) {
+    return local_n * BAT_CKPT_RECORD(h->dim);
+}
+
+void bat_ckpt_mpi_write(MPI_Comm comm, const char *path, const BatCkptHeader *h, const double *best_x,
+                        const double *records, long begin, int local_n) {
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    char *tmp = bat_ckpt_tmp_path(path);
+    if (!tmp) {
+        perror("malloc checkpoint path");
+        MPI_Abort(comm, 1);
+    }
+
+    MPI_File fh;
+    check_io(MPI_File_open(comm, tmp, MPI_MODE_WRONLY | MPI_MODE_CREATE, MPI_INFO_NULL, &fh), tmp, comm);
+    check_io(MPI_File_set_size(fh, 0), tmp, comm);
+    if (rank == 0) {
+        check_io(MPI_File_write_at(fh, 0, h, (int)sizeof(*h), MPI_BYTE, MPI_STATUS_IGNORE), tmp, comm);
+        check_io(MPI_File_write_at(fh, (MPI_Offset)sizeof(*h), best_x, h->dim, MPI_DOUBLE, MPI_STATUS_IGNORE),
+                 tmp, comm);
+    }
+    check_io(MPI_File_write_at_all(fh, (MPI_Offset)bat_ckpt_record_offset(h->dim, begin), records,
+                                   record_count(h, local_n), MPI_DOUBLE, MPI_STATUS_IGNORE),
+             "MPI_File_write_at_all", comm);
+    check_io(MPI_File_close(&fh), "MPI_File_close", comm);
+
+    /* MPI_File_close is collective: every block is in the file */
+    if (rank == 0 && rename(tmp, path) != 0) {
+        perror(path);
+        MPI_Abort(comm, 1);
+    }
+    free(tmp);
+}
+
+void bat_ckpt_mpi_save(MPI_Comm comm, const BatCkptOptions *o, const double *records, long n_bats, int dim,
+                       int iteration, unsigned int seed, const BatStats *stats, double best_value,
+                       const BatStopState *stop, const char *objective, const double *best_x,
+                       long begin, int local_n) {
+    BatStats global = *stats;
+    const int same = stats->best_value == best_value || (isnan(stats->best_value) && isnan(best_value));
+    long index = same ? stats->best_index : LONG_MAX;
+    MPI_Allreduce(&index, &global.best_index, 1, MPI_LONG, MPI_MIN, comm);
+    global.best_value = best_value;
+
+    BatCkptHeader h;
+    bat_ckpt_header_init(&h, n_bats, dim, iteration, seed, &global, stop, objective);
+    bat_ckpt_mpi_write(comm, o->path, &h, best_x, records, begin, local_n);
+}
+
+void bat_ckpt_mpi_read_header(MPI_Comm comm, const char *path, BatCkptHeader *h) {
+    MPI_File fh;
+    MPI_Status status;
+    int got = 0;
+    check_io(MPI_File_open(comm, path, MPI_MODE_RDONLY, MPI_INFO_NULL, &fh), path, comm);
+    check_io(MPI_File_read_at_all(fh, 0, h, (int)sizeof(*h), MPI_BYTE, &status), path, comm);
+    MPI_Get_count(&status, MPI_BYTE, &got);
+    check_io(MPI_File_close(&fh), "MPI_File_close", comm);
+
+    /* Too short for a header: reported by bat_ckpt_mismatch() (bad magic) */
+    if (got != (int)sizeof(*h)) {
+        memset(h, 0, sizeof(*h));
+    }
+}
+
+int bat_ckpt_mpi_restore_header(MPI_Comm comm, const char *path, long n_bats, int dim, const char *objective,
+                                int max_iters, BatCkptHeader *h) {
+    bat_ckpt_mpi_read_header(comm, path, h);
+    const char *mismatch = bat_ckpt_mismatch(h, n_bats, dim, objective, max_iters);
+    if (mismatch) {
+        int rank;
+        MPI_Comm_rank(comm, &rank);
+        if (rank == 0) {
+            fprintf(stderr, "Cannot restart from %s: %s\n", path, mismatch);
+        }
+        return -1;
+    }
+    return 0;
+}
+
+void bat_ckpt_mpi_read(MPI_Comm comm, const char *path, const BatCkptHeader *h, double *best_x,
+                       double *records, long begin, int local_n) {
+    MPI_File fh;
+    MPI_Status status;
+    int got_x = 0, got = 0;
+    check_io(MPI_File_open(comm, path, MPI_MODE_RDONLY, MPI_INFO_NULL, &fh), path, comm);
+    check_io(MPI_File_read_at_all(fh, (MPI_Offset)sizeof(*h), best_x, h->dim, MPI_DOUBLE, &status), path, comm);
+    MPI_Get_count(&status, MPI_DOUBLE, &got_x);
+    check_io(MPI_File_read_at_all(fh, (MPI_Offset)bat_ckpt_record_offset(h->dim, begin), records,
+                                  record_count(h, local_n), MPI_DOUBLE, &status),
+             path, comm);
+    MPI_Get_count(&status, MPI_DOUBLE, &got);
+    check_io(MPI_File_close(&fh), "MPI_File_close", comm);
+    if (got_x != h->dim || got != record_count(h, local_n)) {
+        fprintf(stderr, "%s: truncated checkpoint\n", path);
+        MPI_Abort(comm, 1);
+    }
+}
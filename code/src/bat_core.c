@@ -3,6 +3,7 @@
 #include "bat.h"
 #include "bat_utils.h"
 #include "bat_rng.h"
+#include "bat_stats.h"
 
 /*
  * bat_core.c
@@ -28,33 +29,35 @@
  *   reason about for MPI.
  */
 
-/* Helper function for update_bat(): average loudness across the population */
-static double compute_A_mean(Bat bats[], int n_bats) {
-    double sum = 0.0;
-    for (int k = 0; k < n_bats; k++) sum += bats[k].A_i;
-    return sum / (double)n_bats;
-}
-
 /*
- * Initializes the bat population.
+ * Initializes bats [begin, end) of the population.
  * For each bat, an independent random generator is initialized, an initial
  * position and velocity are assigned, the Bat Algorithm parameters
  * (frequency, loudness, pulse rate) are set, and the objective function
- * is evaluated. The best initial bat is then selected.
+ * is evaluated.
+ *
+ * Bat i only depends on (seed, global index), so disjoint ranges can be
+ * initialized concurrently and give exactly the same values as one serial
+ * call. The OpenMP front-end uses this to first-touch every bat on the
+ * thread (and NUMA node) that will update it; the MPI front-ends use the
+ * offset to initialize a local slice of the global population.
  *
  * Parameters:
- *   - bats     : array containing the bat population
- *   - n_bats   : number of bats
- *   - best_bat : output parameter for the initial best bat
- *   - seed     : global random seed
+ *   - bats         : array containing the bat population (or a slice)
+ *   - begin        : first bat to initialize
+ *   - end          : one past the last bat to initialize
+ *   - index_offset : global index of bats[0]
+ *   - seed         : global random seed
+ *   - obj          : objective function (see bat_objective.h)
  */
 
-void initialize_bats_seeded(Bat bats[], int n_bats, Bat *best_bat, uint32_t seed) {
-   
-    for (int i = 0; i < n_bats; i++) {
+void initialize_bats_range(Bat bats[], int begin, int end, long index_offset, uint32_t seed, const BatObjective *obj) {
+
+    for (int i = begin; i < end; i++) {
 
-        /* Initialize RNG state for this bat */
-        bats[i].rng_state = bat_rng_init(seed, (uint32_t)i);
+        /* Initialize RNG state for this bat (global index = stream id) */
+        bats[i].rng_state = bat_rng_init(seed, (uint32_t)(index_offset + i));
+        bats[i].rng_spare = BAT_RNG_NO_SPARE;
         uint32_t *rng = &bats[i].rng_state;
 
         /* Initial position and velocity */
@@ -66,18 +69,34 @@ void initialize_bats_seeded(Bat bats[], int n_bats, Bat *best_bat, uint32_t seed
 
 
         /* Initialize Bat Algorithm parameters */
-        bats[i].f_i = F_MIN;    
         bats[i].A_i = A0;
         bats[i].r_i = R0;
 
         /* Evaluate objective function at initial position */
-        bats[i].f_value = objective_function(bats[i].x_i);
+        bats[i].f_value = bat_objective_eval1(obj, bats[i].x_i, dimension);
     }
+}
+
+/*
+ * Initializes the whole bat population (serially) and selects the best
+ * initial bat.
+ *
+ * Parameters:
+ *   - bats     : array containing the bat population
+ *   - n_bats   : number of bats
+ *   - best_bat : output parameter for the initial best bat
+ *   - seed     : global random seed
+ *   - obj      : objective function (see bat_objective.h)
+ */
+
+void initialize_bats_seeded(Bat bats[], int n_bats, Bat *best_bat, uint32_t seed, const BatObjective *obj) {
+   
+    initialize_bats_range(bats, 0, n_bats, 0, seed, obj);
 
     /* Select the best bat in the initial population */
     int best_index = 0;
     for (int i = 1; i < n_bats; i++) {
-        if (bats[i].f_value > bats[best_index].f_value) {
+        if (bat_stats_better(bats[i].f_value, i, bats[best_index].f_value, best_index)) {
             best_index = i;
         }
     }
@@ -87,7 +106,7 @@ void initialize_bats_seeded(Bat bats[], int n_bats, Bat *best_bat, uint32_t seed
 
 void initialize_bats(Bat bats[], int n_bats, Bat *best_bat) {
     /* Backward-compatible wrapper (used by older code paths). */
-    initialize_bats_seeded(bats, n_bats, best_bat, 1u);
+    initialize_bats_seeded(bats, n_bats, best_bat, 1u, bat_objective_find(BAT_OBJECTIVE_DEFAULT));
 }
 
 /*
@@ -96,25 +115,30 @@ void initialize_bats(Bat bats[], int n_bats, Bat *best_bat) {
  * candidate around the global best, and accepts the new position only if
  * it improves the bat and passes the loudness condition.
  *
+ * The average loudness used by the local search is taken from `stats`,
+ * which the caller computes once per iteration (previous generation).
+ * This keeps the cost of one update independent of the population size.
+ *
  * Parameters:
  *   - bats     : array containing the bat population
- *   - n_bats   : number of bats
  *   - best_bat : current global best (read-only)
+ *   - stats    : population aggregates of the previous iteration (read-only)
+ *   - obj      : objective function (see bat_objective.h)
  *   - i        : index of the bat to update
  *   - t        : current iteration index
  */
-void update_bat(Bat bats[], int n_bats, const Bat *best_bat, int i, int t) {
+void update_bat(Bat bats[], const Bat *best_bat, const BatStats *stats, const BatObjective *obj, int i, int t) {
 
     /* RNG state of bat i */
     uint32_t *rng = &bats[i].rng_state;
     
     /* Random frequency in [F_MIN, F_MAX]. */
     double beta = bat_rng_uniform01(rng);
-    bats[i].f_i = F_MIN + (F_MAX - F_MIN) * beta;
+    const double f_i = F_MIN + (F_MAX - F_MIN) * beta;
 
     /* Velocity update: move toward global best. */
     for (int d = 0; d < dimension; d++) {
-        bats[i].v_i[d] += (best_bat->x_i[d] - bats[i].x_i[d] ) * bats[i].f_i;
+        bats[i].v_i[d] += (best_bat->x_i[d] - bats[i].x_i[d] ) * f_i;
     }
 
     /* Position update + bounds clamp. */
@@ -131,18 +155,21 @@ void update_bat(Bat bats[], int n_bats, const Bat *best_bat, int i, int t) {
     }
 
     /* Evaluate the candidate obtained from the global move. */
-    double Fnew = objective_function(candidate_x);
+    double Fnew = bat_objective_eval1(obj, candidate_x, dimension);
 
     /* Optional local search (triggered by pulse rate). */
     double rand_pulse = bat_rng_uniform01(rng);
     if (rand_pulse > bats[i].r_i) {
 
         double local_x[dimension];
-        double A_mean = compute_A_mean(bats, n_bats);
+        double A_mean = stats->A_mean;
+
+        /* Standard normals for all dimensions (Box-Muller pairs, spare cached) */
+        bat_rng_normal_fill(rng, &bats[i].rng_spare, dimension, local_x);
 
         // local random walk around global best
         for (int d = 0; d < dimension; d++) {
-            double eps = bat_rng_normal(rng, 0.0, 1.0);
+            double eps = local_x[d];
             local_x[d] = best_bat->x_i[d] + 0.1 * eps * A_mean;
 
             /* Clamp the local candidate to bounds. */
@@ -150,7 +177,7 @@ void update_bat(Bat bats[], int n_bats, const Bat *best_bat, int i, int t) {
             if (local_x[d] > Ub) local_x[d] = Ub;
         }
         /* Evaluate the local (random-walk) candidate. */
-        double F_local = objective_function(local_x);
+        double F_local = bat_objective_eval1(obj, local_x, dimension);
 
         /* If the local candidate is better, keep it as the new candidate. */
         if (F_local > Fnew) {   /* we maximize */
@@ -177,3 +204,14 @@ void update_bat(Bat bats[], int n_bats, const Bat *best_bat, int i, int t) {
         /* Caller recomputes the global best outside this function. */
     }
 }
+
+/*
+ * Block partition used by the MPI front-ends.
+ * Every worker can compute any worker's range, with no communication.
+ */
+void bat_partition(int n, int parts, int part, long *begin, int *count) {
+    int base = n / parts;
+    int extra = n % parts;
+    *count = base + (part < extra ? 1 : 0);
+    *begin = (long)part * base + (part < extra ? part : extra);
+}
@@ -0,0 +1,102 @@
+#define _GNU_SOURCE
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bat_host.h"
+
+/*
+ * bat_host.c
+ *
+ * Purpose:
+ * Host name, CPU affinity and binding of a run for the BENCH line
+ * (see bat_host.h).
+ */
+
+void bat_placement_init(BatPlacement *p) {
+    memset(p->mask, 0, sizeof(p->mask));
+    p->worker_cpus = 0;
+    p->hosts = 1;
+}
+
+void bat_placement_add_self(BatPlacement *p) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+        return;
+    }
+    int n = 0;
+    for (int cpu = 0; cpu < CPU_SETSIZE && cpu < BAT_HOST_MAX_CPUS; cpu++) {
+        if (CPU_ISSET(cpu, &set)) {
+            p->mask[cpu / 64] |= (uint64_t)1 << (cpu % 64);
+            n++;
+        }
+    }
+    if (n > p->worker_cpus) {
+        p->worker_cpus = n;
+    }
+}
+
+static int has_cpu(const BatPlacement *p, int cpu) {
+    return (p->mask[cpu / 64] >> (cpu % 64)) & 1;
+}
+
+/* Prints " cpus=a-b,c,..." (" cpus=none" if no worker was recorded). */
+static void print_cpus(const BatPlacement *p) {
+    printf(" cpus=");
+    int first = 1;
+    for (int cpu = 0; cpu < BAT_HOST_MAX_CPUS; cpu++) {
+        if (!has_cpu(p, cpu)) {
+            continue;
+        }
+        int last = cpu;
+        while (last + 1 < BAT_HOST_MAX_CPUS && has_cpu(p, last + 1)) {
+            last++;
+        }
+        printf(last > cpu ? "%s%d-%d" : "%s%d", first ? "" : ",", cpu, last);
+        first = 0;
+        cpu = last;
+    }
+    if (first) {
+        printf("none");
+    }
+}
+
+/* Environment value without blanks (BENCH fields are split on spaces). */
+static void print_env(const char *field, const char *name, const char *unset) {
+    const char *value = getenv(name);
+    if (!value || !*value) {
+        if (unset) {
+            printf(" %s=%s", field, unset);
+        }
+        return;
+    }
+    printf(" %s=", field);
+    for (const char *c = value; *c; c++) {
+        putchar(*c == ' ' || *c == '\t' ? '_' : *c);
+    }
+}
+
+void bat_placement_print_bench(const BatPlacement *p) {
+    char host[256];
+    if (gethostname(host, sizeof(host)) != 0) {
+        strcpy(host, "unknown");
+    }
+    host[sizeof(host) - 1] = '\0';
+    for (char *c = host; *c; c++) {
+        if (*c == ' ') {
+            *c = '_';
+        }
+    }
+
+    printf(" host=%s", host);
+    print_cpus(p);
+    printf(" worker_cpus=%d", p->worker_cpus);
+    print_env("bind", "OMP_PROC_BIND", "unset");
+    print_env("places", "OMP_PLACES", NULL);
+    if (p->hosts > 1) {
+        printf(" hosts=%d", p->hosts);
+    }
+}
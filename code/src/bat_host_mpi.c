@@ -0,0 +1,31 @@
+#include "bat_host_mpi.h"
+
+/*
+ * bat_host_mpi.c
+ *
+ * Purpose:
+ * Reduction of the run placement over the ranks (see bat_host_mpi.h).
+ */
+
+void bat_host_mpi_reduce(BatPlacement *p, MPI_Comm comm) {
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+
+    /* One node communicator per shared-memory domain: its rank 0 counts the host */
+    MPI_Comm node;
+    int node_rank = 0;
+    MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &node);
+    MPI_Comm_rank(node, &node_rank);
+    MPI_Comm_free(&node);
+    int leader = (node_rank == 0);
+
+    if (rank == 0) {
+        MPI_Reduce(MPI_IN_PLACE, p->mask, BAT_HOST_MASK_WORDS, MPI_UINT64_T, MPI_BOR, 0, comm);
+        MPI_Reduce(MPI_IN_PLACE, &p->worker_cpus, 1, MPI_INT, MPI_MAX, 0, comm);
+        MPI_Reduce(&leader, &p->hosts, 1, MPI_INT, MPI_SUM, 0, comm);
+    } else {
+        MPI_Reduce(p->mask, NULL, BAT_HOST_MASK_WORDS, MPI_UINT64_T, MPI_BOR, 0, comm);
+        MPI_Reduce(&p->worker_cpus, NULL, 1, MPI_INT, MPI_MAX, 0, comm);
+        MPI_Reduce(&leader, NULL, 1, MPI_INT, MPI_SUM, 0, comm);
+    }
+}
@@ -0,0 +1,228 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bat_island.h"
+#include "bat_rng.h"
+
+/*
+ * bat_island.c
+ *
+ * Purpose:
+ * Migration between islands for the MPI island model: neighbor selection
+ * for each topology, ranking of emigrants / replacement candidates, and
+ * the non-blocking point-to-point exchange of migrant records.
+ *
+ * The front-end owns the populations: it packs the emigrants chosen here
+ * into send_buf and unpacks the immigrants into the bats chosen here, so
+ * this file does not depend on the population layout (AoS / SoA).
+ */
+
+int bat_topology_parse(const char *name, BatTopology *topology) {
+    if (strcmp(name, "ring") == 0) {
+        *topology = BAT_TOPOLOGY_RING;
+    } else if (strcmp(name, "torus") == 0) {
+        *topology = BAT_TOPOLOGY_TORUS;
+    } else if (strcmp(name, "random") == 0) {
+        *topology = BAT_TOPOLOGY_RANDOM;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+const char *bat_topology_name(BatTopology topology) {
+    switch (topology) {
+    case BAT_TOPOLOGY_TORUS:  return "torus";
+    case BAT_TOPOLOGY_RANDOM: return "random";
+    default:                  return "ring";
+    }
+}
+
+/* Best first; ties broken by the smallest index (deterministic). */
+static int rank_desc(const void *pa, const void *pb) {
+    const BatIslandRank *a = pa;
+    const BatIslandRank *b = pb;
+    if (a->f != b->f) {
+        return (a->f > b->f) ? -1 : 1;
+    }
+    return (a->i > b->i) - (a->i < b->i);
+}
+
+int bat_islands_init(BatIslands *isl, MPI_Comm comm, BatTopology topology,
+                     int every, int k, int dim, int n, uint32_t seed) {
+    memset(isl, 0, sizeof(*isl));
+    isl->comm = comm;
+    MPI_Comm_rank(comm, &isl->rank);
+    MPI_Comm_size(comm, &isl->size);
+    isl->topology = topology;
+    isl->every = every;
+    isl->k = k;
+    isl->dim = dim;
+    isl->seed = seed;
+
+    if (topology == BAT_TOPOLOGY_TORUS) {
+        MPI_Dims_create(isl->size, 2, isl->torus_dims);
+    }
+
+    size_t rec = BAT_MIGRANT_SIZE(dim);
+    size_t max_in = (size_t)BAT_ISLAND_MAX_LINKS * (size_t)k;
+    size_t ranked = ((size_t)n > max_in) ? (size_t)n : max_in;
+
+    isl->send_buf = malloc((size_t)k * rec * sizeof(double));
+    isl->recv_buf = malloc(max_in * rec * sizeof(double));
+    isl->order = malloc(ranked * sizeof(BatIslandRank));
+    isl->incoming = malloc(max_in * sizeof(BatIslandRank));
+    if (!isl->send_buf || !isl->recv_buf || !isl->order || !isl->incoming) {
+        bat_islands_free(isl);
+        return -1;
+    }
+    return 0;
+}
+
+void bat_islands_free(BatIslands *isl) {
+    if (isl->in_flight) {
+        MPI_Waitall(2 * isl->n_links, isl->reqs, MPI_STATUSES_IGNORE);
+        isl->in_flight = 0;
+    }
+    free(isl->send_buf);
+    free(isl->recv_buf);
+    free(isl->order);
+    free(isl->incoming);
+    isl->send_buf = isl->recv_buf = NULL;
+    isl->order = isl->incoming = NULL;
+}
+
+/*
+ * Neighbors of this rank for the next migration.
+ * Link j sends to send_to[j] and receives from recv_from[j] with tag j;
+ * the links are built so that the receive of link j on rank q matches the
+ * send of link j on recv_from[j].
+ */
+static void plan_links(BatIslands *isl) {
+    int rank = isl->rank;
+    int size = isl->size;
+
+    switch (isl->topology) {
+    case BAT_TOPOLOGY_TORUS: {
+        int rows = isl->torus_dims[0];
+        int cols = isl->torus_dims[1];
+        int row = rank / cols;
+        int col = rank % cols;
+        int east  = row * cols + (col + 1) % cols;
+        int west  = row * cols + (col + cols - 1) % cols;
+        int south = ((row + 1) % rows) * cols + col;
+        int north = ((row + rows - 1) % rows) * cols + col;
+
+        isl->n_links = 4;
+        isl->send_to[0] = east;  isl->recv_from[0] = west;
+        isl->send_to[1] = west;  isl->recv_from[1] = east;
+        isl->send_to[2] = south; isl->recv_from[2] = north;
+        isl->send_to[3] = north; isl->recv_from[3] = south;
+        break;
+    }
+    case BAT_TOPOLOGY_RANDOM: {
+        /* Same permutation on every rank: stream `epoch` of a derived seed */
+        int *perm = malloc((size_t)size * sizeof(int));
+        if (!perm) {
+            perror("malloc island permutation");
+            MPI_Abort(isl->comm, 1);
+        }
+        uint32_t rng = bat_rng_init(isl->seed ^ 0x51ED270Bu, (uint32_t)isl->epoch);
+        for (int j = 0; j < size; j++) {
+            perm[j] = j;
+        }
+        for (int j = size - 1; j > 0; j--) {
+            int m = (int)(bat_rng_next(&rng) % (uint32_t)(j + 1));
+            int tmp = perm[j];
+            perm[j] = perm[m];
+            perm[m] = tmp;
+        }
+
+        int pos = 0;
+        while (perm[pos] != rank) {
+            pos++;
+        }
+        isl->n_links = 1;
+        isl->send_to[0] = perm[(pos + 1) % size];
+        isl->recv_from[0] = perm[(pos + size - 1) % size];
+        free(perm);
+        break;
+    }
+    default:
+        isl->n_links = 1;
+        isl->send_to[0] = (rank + 1) % size;
+        isl->recv_from[0] = (rank + size - 1) % size;
+        break;
+    }
+}
+
+void bat_islands_emigrants(BatIslands *isl, const double f[], int n, int idx[]) {
+    for (int i = 0; i < n; i++) {
+        isl->order[i].f = f[i];
+        isl->order[i].i = i;
+    }
+    qsort(isl->order, (size_t)n, sizeof(BatIslandRank), rank_desc);
+    for (int j = 0; j < isl->k; j++) {
+        idx[j] = isl->order[j].i;
+    }
+}
+
+void bat_islands_post(BatIslands *isl) {
+    int rec = BAT_MIGRANT_SIZE(isl->dim);
+    int count = isl->k * rec;
+
+    plan_links(isl);
+
+    for (int j = 0; j < isl->n_links; j++) {
+        MPI_Irecv(isl->recv_buf + (size_t)j * count, count, MPI_DOUBLE,
+                  isl->recv_from[j], j, isl->comm, &isl->reqs[j]);
+    }
+    for (int j = 0; j < isl->n_links; j++) {
+        MPI_Isend(isl->send_buf, count, MPI_DOUBLE,
+                  isl->send_to[j], j, isl->comm, &isl->reqs[isl->n_links + j]);
+    }
+
+    isl->msgs_sent += isl->n_links;
+    isl->bytes_sent += (double)isl->n_links * count * sizeof(double);
+    isl->in_flight = 1;
+    isl->epoch++;
+}
+
+int bat_islands_receive(BatIslands *isl, const double f[], int n, int dst[], int src[]) {
+    if (!isl->in_flight) {
+        return 0;
+    }
+    MPI_Waitall(2 * isl->n_links, isl->reqs, MPI_STATUSES_IGNORE);
+    isl->in_flight = 0;
+
+    int rec = BAT_MIGRANT_SIZE(isl->dim);
+    int n_in = isl->n_links * isl->k;
+
+    /* Immigrants, best first */
+    for (int j = 0; j < n_in; j++) {
+        isl->incoming[j].f = isl->recv_buf[(size_t)j * rec + BAT_MIGRANT_F];
+        isl->incoming[j].i = j;
+    }
+    qsort(isl->incoming, (size_t)n_in, sizeof(BatIslandRank), rank_desc);
+
+    /* Local bats, best first: the worst ones are at the end */
+    for (int i = 0; i < n; i++) {
+        isl->order[i].f = f[i];
+        isl->order[i].i = i;
+    }
+    qsort(isl->order, (size_t)n, sizeof(BatIslandRank), rank_desc);
+
+    /* Best immigrant vs worst local bat, second best vs second worst, ... */
+    int m = 0;
+    for (int j = 0; j < n_in && j < n; j++) {
+        const BatIslandRank *local = &isl->order[n - 1 - j];
+        if (isl->incoming[j].f <= local->f) {
+            break;
+        }
+        dst[m] = local->i;
+        src[m] = isl->incoming[j].i;
+        m++;
+    }
+    return m;
+}
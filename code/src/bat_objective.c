@@ -0,0 +1,260 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <dlfcn.h>
+
+#include "bat_objective.h"
+
+/*
+ * bat_objective.c
+ *
+ * Purpose:
+ * Built-in objective functions and the registry used to select them.
+ *
+ * All built-ins are written "point-parallel": the outer loop runs over
+ * the dimensions and the inner loop over the n points, so the inner loop
+ * reads contiguous memory (dimension-major X) and vectorizes. The sums
+ * over the dimensions are accumulated in order k = 0 .. d-1, which makes a
+ * batched evaluation return exactly the same value as a single-point one.
+ *
+ * Registration (built-in table, user functions, shared objects) happens at
+ * startup, before any parallel region; lookups do not modify the table.
+ */
+
+/* Points processed per chunk by objectives that need extra accumulators. */
+#define CHUNK 64
+
+static void sphere_eval(const double *X, int n, int d, double *out) {
+    for (int i = 0; i < n; i++) {
+        out[i] = 0.0;
+    }
+    for (int k = 0; k < d; k++) {
+        const double *xk = X + (size_t)k * n;
+        for (int i = 0; i < n; i++) {
+            out[i] += xk[i] * xk[i];
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        out[i] = 10.0 - out[i];
+    }
+}
+
+static void rastrigin_eval(const double *X, int n, int d, double *out) {
+    for (int i = 0; i < n; i++) {
+        out[i] = 10.0 * d;
+    }
+    for (int k = 0; k < d; k++) {
+        const double *xk = X + (size_t)k * n;
+        for (int i = 0; i < n; i++) {
+            out[i] += xk[i] * xk[i] - 10.0 * cos(2.0 * M_PI * xk[i]);
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        out[i] = -out[i];
+    }
+}
+
+static void rosenbrock_eval(const double *X, int n, int d, double *out) {
+    for (int i = 0; i < n; i++) {
+        out[i] = 0.0;
+    }
+    for (int k = 0; k + 1 < d; k++) {
+        const double *xk = X + (size_t)k * n;
+        const double *xk1 = X + (size_t)(k + 1) * n;
+        for (int i = 0; i < n; i++) {
+            double a = xk1[i] - xk[i] * xk[i];
+            double b = 1.0 - xk[i];
+            out[i] += 100.0 * a * a + b * b;
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        out[i] = -out[i];
+    }
+}
+
+static void ackley_eval(const double *X, int n, int d, double *out) {
+    double sum_sq[CHUNK];
+    double sum_cos[CHUNK];
+
+    for (int i0 = 0; i0 < n; i0 += CHUNK) {
+        int m = (n - i0 < CHUNK) ? n - i0 : CHUNK;
+
+        for (int i = 0; i < m; i++) {
+            sum_sq[i] = 0.0;
+            sum_cos[i] = 0.0;
+        }
+        for (int k = 0; k < d; k++) {
+            const double *xk = X + (size_t)k * n + i0;
+            for (int i = 0; i < m; i++) {
+                sum_sq[i] += xk[i] * xk[i];
+                sum_cos[i] += cos(2.0 * M_PI * xk[i]);
+            }
+        }
+        for (int i = 0; i < m; i++) {
+            double f = -20.0 * exp(-0.2 * sqrt(sum_sq[i] / d))
+                       - exp(sum_cos[i] / d) + 20.0 + M_E;
+            out[i0 + i] = -f;
+        }
+    }
+}
+
+/* Single-precision versions of the built-ins (--precision float). */
+static void sphere_eval_f(const float *X, int n, int d, float *out) {
+    for (int i = 0; i < n; i++) {
+        out[i] = 0.0f;
+    }
+    for (int k = 0; k < d; k++) {
+        const float *xk = X + (size_t)k * n;
+        for (int i = 0; i < n; i++) {
+            out[i] += xk[i] * xk[i];
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        out[i] = 10.0f - out[i];
+    }
+}
+
+static void rastrigin_eval_f(const float *X, int n, int d, float *out) {
+    for (int i = 0; i < n; i++) {
+        out[i] = 10.0f * (float)d;
+    }
+    for (int k = 0; k < d; k++) {
+        const float *xk = X + (size_t)k * n;
+        for (int i = 0; i < n; i++) {
+            out[i] += xk[i] * xk[i] - 10.0f * cosf(2.0f * (float)M_PI * xk[i]);
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        out[i] = -out[i];
+    }
+}
+
+static void rosenbrock_eval_f(const float *X, int n, int d, float *out) {
+    for (int i = 0; i < n; i++) {
+        out[i] = 0.0f;
+    }
+    for (int k = 0; k + 1 < d; k++) {
+        const float *xk = X + (size_t)k * n;
+        const float *xk1 = X + (size_t)(k + 1) * n;
+        for (int i = 0; i < n; i++) {
+            float a = xk1[i] - xk[i] * xk[i];
+            float b = 1.0f - xk[i];
+            out[i] += 100.0f * a * a + b * b;
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        out[i] = -out[i];
+    }
+}
+
+static void ackley_eval_f(const float *X, int n, int d, float *out) {
+    float sum_sq[CHUNK];
+    float sum_cos[CHUNK];
+
+    for (int i0 = 0; i0 < n; i0 += CHUNK) {
+        int m = (n - i0 < CHUNK) ? n - i0 : CHUNK;
+
+        for (int i = 0; i < m; i++) {
+            sum_sq[i] = 0.0f;
+            sum_cos[i] = 0.0f;
+        }
+        for (int k = 0; k < d; k++) {
+            const float *xk = X + (size_t)k * n + i0;
+            for (int i = 0; i < m; i++) {
+                sum_sq[i] += xk[i] * xk[i];
+                sum_cos[i] += cosf(2.0f * (float)M_PI * xk[i]);
+            }
+        }
+        for (int i = 0; i < m; i++) {
+            float f = -20.0f * expf(-0.2f * sqrtf(sum_sq[i] / (float)d))
+                      - expf(sum_cos[i] / (float)d) + 20.0f + (float)M_E;
+            out[i0 + i] = -f;
+        }
+    }
+}
+
+/* Registry: built-ins first, then user / shared-object entries. */
+#define MAX_OBJECTIVES 16
+
+static BatObjective registry[MAX_OBJECTIVES] = {
+    { "sphere",     sphere_eval,     sphere_eval_f },
+    { "rastrigin",  rastrigin_eval,  rastrigin_eval_f },
+    { "rosenbrock", rosenbrock_eval, rosenbrock_eval_f },
+    { "ackley",     ackley_eval,     ackley_eval_f },
+};
+static int n_registered = 4;
+
+int bat_objective_register(const char *name, BatObjectiveEval evaluate) {
+    if (n_registered >= MAX_OBJECTIVES) {
+        return -1;
+    }
+    registry[n_registered].name = name;
+    registry[n_registered].evaluate = evaluate;
+    registry[n_registered].evaluate_f = NULL;
+    n_registered++;
+    return 0;
+}
+
+/*
+ * Loads "so:PATH[:SYMBOL]" and registers it under its full spec, so that a
+ * second lookup with the same name does not reopen the library.
+ */
+static const BatObjective *load_shared(const char *spec) {
+    const char *path_begin = spec + 3;
+    const char *colon = strchr(path_begin, ':');
+    const char *symbol = colon ? colon + 1 : "bat_objective_evaluate";
+
+    size_t path_len = colon ? (size_t)(colon - path_begin) : strlen(path_begin);
+    char *path = malloc(path_len + 1);
+    if (!path) {
+        return NULL;
+    }
+    memcpy(path, path_begin, path_len);
+    path[path_len] = '\0';
+
+    void *handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    free(path);
+    if (!handle) {
+        fprintf(stderr, "objective: %s\n", dlerror());
+        return NULL;
+    }
+
+    BatObjectiveEval evaluate;
+    /* POSIX: conversion from void * to function pointer via memcpy. */
+    void *sym = dlsym(handle, symbol);
+    if (!sym) {
+        fprintf(stderr, "objective: %s\n", dlerror());
+        dlclose(handle);
+        return NULL;
+    }
+    memcpy(&evaluate, &sym, sizeof(evaluate));
+
+    char *name = strdup(spec);
+    if (!name || bat_objective_register(name, evaluate) != 0) {
+        fprintf(stderr, "objective: cannot register '%s'\n", spec);
+        free(name);
+        dlclose(handle);
+        return NULL;
+    }
+    return &registry[n_registered - 1];
+}
+
+const BatObjective *bat_objective_find(const char *name) {
+    for (int k = 0; k < n_registered; k++) {
+        if (strcmp(registry[k].name, name) == 0) {
+            return &registry[k];
+        }
+    }
+    if (strncmp(name, "so:", 3) == 0) {
+        return load_shared(name);
+    }
+    return NULL;
+}
+
+void bat_objective_print_names(void) {
+    for (int k = 0; k < n_registered; k++) {
+        fprintf(stderr, "%s%s", (k == 0) ? "" : ", ", registry[k].name);
+    }
+    fprintf(stderr, ", so:PATH[:SYMBOL]\n");
+}
@@ -0,0 +1,164 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bat_options.h"
+
+/*
+ * bat_options.c
+ *
+ * Purpose:
+ * Parsing and validation of the command-line options common to the
+ * sequential, OpenMP, MPI and hybrid front-ends (see bat_options.h).
+ */
+
+void bat_options_defaults(BatOptions *o) {
+    o->n_bats = N_BATS;
+    o->max_iters = MAX_ITERS;
+    o->seed = (unsigned int)time(NULL);
+    o->quiet = 0;
+    o->do_snapshot = 1;
+    o->layout = BAT_LAYOUT_AOS;
+    o->layout_set = 0;
+    o->dim = dimension;
+    o->objective = BAT_OBJECTIVE_DEFAULT;
+    o->precision = BAT_PRECISION_DOUBLE;
+    bat_stop_defaults(&o->stop);
+    bat_traj_defaults(&o->traj);
+    bat_ckpt_defaults(&o->ckpt);
+    bat_verify_defaults(&o->verify);
+}
+
+int bat_options_parse_option(BatOptions *o, int argc, char **argv, int *i) {
+    const char *opt = argv[*i];
+    int has_value = *i + 1 < argc;
+
+    if (strcmp(opt, "--quiet") == 0) {
+        o->quiet = 1;
+    } else if (strcmp(opt, "--no-snapshot") == 0) {
+        o->do_snapshot = 0;
+    } else if (strcmp(opt, "--n-bats") == 0 && has_value) {
+        o->n_bats = atoi(argv[++*i]);
+    } else if (strcmp(opt, "--iters") == 0 && has_value) {
+        o->max_iters = atoi(argv[++*i]);
+    } else if (strcmp(opt, "--seed") == 0 && has_value) {
+        o->seed = (unsigned int)strtoul(argv[++*i], NULL, 10);
+    } else if (strcmp(opt, "--layout") == 0 && has_value) {
+        o->layout_set = 1;
+        if (bat_layout_parse(argv[++*i], &o->layout) != 0) {
+            fprintf(stderr, "Unknown layout '%s' (expected aos or soa)\n", argv[*i]);
+            return -1;
+        }
+    } else if (strcmp(opt, "--dim") == 0 && has_value) {
+        o->dim = atoi(argv[++*i]);
+    } else if (strcmp(opt, "--objective") == 0 && has_value) {
+        o->objective = argv[++*i];
+    } else if (strcmp(opt, "--precision") == 0 && has_value) {
+        if (bat_precision_parse(argv[++*i], &o->precision) != 0) {
+            fprintf(stderr, "Unknown precision '%s' (expected double, mixed or float)\n", argv[*i]);
+            return -1;
+        }
+    } else if (bat_stop_parse_option(&o->stop, argc, argv, i)) {
+        /* --target, --window, --tol, --time-limit, --check-every */
+    } else if (bat_traj_parse_option(&o->traj, argc, argv, i)) {
+        /* --traj, --traj-every, --traj-float */
+    } else if (bat_ckpt_parse_option(&o->ckpt, argc, argv, i)) {
+        /* --checkpoint, --checkpoint-every, --restart */
+    } else if (bat_verify_parse_option(&o->verify, argc, argv, i)) {
+        /* --verify, --verify-every */
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+void bat_options_finish(BatOptions *o) {
+    if (!o->layout_set && (o->dim != dimension || o->precision != BAT_PRECISION_DOUBLE)) {
+        o->layout = BAT_LAYOUT_SOA;
+    }
+}
+
+int bat_options_parse(BatOptions *o, int argc, char **argv) {
+    bat_options_defaults(o);
+    for (int i = 1; i < argc; i++) {
+        if (bat_options_parse_option(o, argc, argv, &i) < 0) {
+            return -1;
+        }
+    }
+    bat_options_finish(o);
+    return 0;
+}
+
+int bat_options_validate(const BatOptions *o, int report, const BatObjective **obj) {
+    *obj = NULL;
+
+    if (o->n_bats <= 0 || o->max_iters <= 0 || o->dim <= 0) {
+        if (report) {
+            fprintf(stderr, "Invalid parameters: n_bats=%d iters=%d dim=%d\n", o->n_bats, o->max_iters, o->dim);
+        }
+        return -1;
+    }
+
+    if (!bat_stop_valid(&o->stop)) {
+        if (report) {
+            fprintf(stderr, "Invalid stopping criteria: window=%d tol=%g check_every=%d\n",
+                    o->stop.window, o->stop.tol, o->stop.check_every);
+        }
+        return -1;
+    }
+
+    if (o->traj.every < 1) {
+        if (report) {
+            fprintf(stderr, "Invalid trajectory interval: traj_every=%d\n", o->traj.every);
+        }
+        return -1;
+    }
+
+    if (o->ckpt.every < 1) {
+        if (report) {
+            fprintf(stderr, "Invalid checkpoint interval: checkpoint_every=%d\n", o->ckpt.every);
+        }
+        return -1;
+    }
+
+    if (o->verify.every < 1) {
+        if (report) {
+            fprintf(stderr, "Invalid digest interval: verify_every=%d\n", o->verify.every);
+        }
+        return -1;
+    }
+
+    if (o->layout == BAT_LAYOUT_AOS && o->dim != dimension) {
+        if (report) {
+            fprintf(stderr, "The AoS layout is compiled for dim=%d; use --layout soa for dim=%d\n", dimension, o->dim);
+        }
+        return -1;
+    }
+
+    if (o->layout == BAT_LAYOUT_AOS && o->precision != BAT_PRECISION_DOUBLE) {
+        if (report) {
+            fprintf(stderr, "The AoS layout is double only; use --layout soa for --precision %s\n",
+                    bat_precision_name(o->precision));
+        }
+        return -1;
+    }
+
+    const BatObjective *found = bat_objective_find(o->objective);
+    if (!found) {
+        if (report) {
+            fprintf(stderr, "Unknown objective '%s'. Available: ", o->objective);
+            bat_objective_print_names();
+        }
+        return -1;
+    }
+    if (o->precision == BAT_PRECISION_FLOAT && !found->evaluate_f) {
+        if (report) {
+            fprintf(stderr, "Objective '%s' has no single-precision version; use --precision mixed\n",
+                    o->objective);
+        }
+        return -1;
+    }
+    *obj = found;
+    return 0;
+}
@@ -0,0 +1,624 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "bat.h"
+#include "bat_pop.h"
+#include "bat_rng.h"
+#include "bat_stats.h"
+
+/*
+ * bat_pop.c
+ *
+ * Purpose:
+ * Structure-of-arrays population store and its block update kernel.
+ *
+ * The algorithm is the same as update_bat() in bat_core.c; only the data
+ * layout and the loop order change:
+ * - the random draws that decide the control flow stay per bat
+ *   (each bat owns its RNG stream, so the order between bats is irrelevant)
+ * - the arithmetic that is identical for all bats (velocity, position,
+ *   clamp, objective) runs over the lanes of a tile, which the compiler
+ *   turns into SIMD instructions.
+ *
+ * The compact store (--precision mixed|float) has its own kernel body,
+ * update_tiles_compact(), with the same steps and draws on float fields.
+ */
+
+int bat_layout_parse(const char *name, BatLayout *layout) {
+    if (strcmp(name, "aos") == 0) {
+        *layout = BAT_LAYOUT_AOS;
+    } else if (strcmp(name, "soa") == 0) {
+        *layout = BAT_LAYOUT_SOA;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+const char *bat_layout_name(BatLayout layout) {
+    return (layout == BAT_LAYOUT_SOA) ? "soa" : "aos";
+}
+
+int bat_precision_parse(const char *name, BatPrecision *precision) {
+    if (strcmp(name, "double") == 0) {
+        *precision = BAT_PRECISION_DOUBLE;
+    } else if (strcmp(name, "mixed") == 0) {
+        *precision = BAT_PRECISION_MIXED;
+    } else if (strcmp(name, "float") == 0) {
+        *precision = BAT_PRECISION_FLOAT;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+const char *bat_precision_name(BatPrecision precision) {
+    switch (precision) {
+    case BAT_PRECISION_MIXED:
+        return "mixed";
+    case BAT_PRECISION_FLOAT:
+        return "float";
+    default:
+        return "double";
+    }
+}
+
+void bat_precision_print_bench(BatPrecision precision, size_t bytes_per_bat) {
+    printf(" precision=%s bytes_per_bat=%zu", bat_precision_name(precision), bytes_per_bat);
+}
+
+/* Allocate one aligned, zeroed array of the given size in bytes. */
+static void *alloc_aligned(size_t bytes) {
+    void *p = NULL;
+    if (bytes == 0) {
+        bytes = BAT_POP_ALIGN;
+    }
+    if (posix_memalign(&p, BAT_POP_ALIGN, bytes) != 0) {
+        return NULL;
+    }
+    memset(p, 0, bytes);
+    return p;
+}
+
+static void select_kernel(BatPopulation *pop);
+
+int bat_pop_alloc(BatPopulation *pop, int n, int dim, BatPrecision precision) {
+    memset(pop, 0, sizeof(*pop));
+    pop->n = n;
+    pop->dim = dim;
+    pop->n_tiles = (n + BAT_POP_LANES - 1) / BAT_POP_LANES;
+    pop->precision = precision;
+
+    size_t padded = (size_t)pop->n_tiles * BAT_POP_LANES;
+    size_t coords = padded * (size_t)dim;
+
+    int fields_ok;
+    if (precision == BAT_PRECISION_DOUBLE) {
+        pop->x = alloc_aligned(coords * sizeof(double));
+        pop->v = alloc_aligned(coords * sizeof(double));
+        pop->A = alloc_aligned(padded * sizeof(double));
+        pop->r = alloc_aligned(padded * sizeof(double));
+        fields_ok = pop->x && pop->v && pop->A && pop->r;
+    } else {
+        pop->xf = alloc_aligned(coords * sizeof(float));
+        pop->vf = alloc_aligned(coords * sizeof(float));
+        pop->Af = alloc_aligned(padded * sizeof(float));
+        pop->rf = alloc_aligned(padded * sizeof(float));
+        fields_ok = pop->xf && pop->vf && pop->Af && pop->rf;
+    }
+    pop->f_value = alloc_aligned(padded * sizeof(double));
+    pop->rng = alloc_aligned(padded * sizeof(uint32_t));
+    pop->rng_spare = alloc_aligned(padded * sizeof(double));
+
+    if (!fields_ok || !pop->f_value || !pop->rng || !pop->rng_spare) {
+        bat_pop_free(pop);
+        return -1;
+    }
+
+    select_kernel(pop);
+    return 0;
+}
+
+void bat_pop_free(BatPopulation *pop) {
+    free(pop->x);
+    free(pop->v);
+    free(pop->A);
+    free(pop->r);
+    free(pop->f_value);
+    free(pop->rng);
+    free(pop->rng_spare);
+    free(pop->xf);
+    free(pop->vf);
+    free(pop->Af);
+    free(pop->rf);
+    pop->x = pop->v = pop->A = pop->r = pop->f_value = pop->rng_spare = NULL;
+    pop->xf = pop->vf = pop->Af = pop->rf = NULL;
+    pop->rng = NULL;
+}
+
+size_t bat_pop_bytes_per_bat(int dim, BatPrecision precision) {
+    /* x, v, A, r in the store precision; f_value, rng_spare, rng */
+    size_t real = (precision == BAT_PRECISION_DOUBLE) ? sizeof(double) : sizeof(float);
+    return (2 * (size_t)dim + 2) * real + 2 * sizeof(double) + sizeof(uint32_t);
+}
+
+/*
+ * Scores the n points of a dimension-major float block: with the float
+ * entry point of the objective (BAT_PRECISION_FLOAT), otherwise widened to
+ * double in wide[] (n * dim doubles) and scored in double.
+ */
+static inline void evaluate_compact(const BatPopulation *pop, const float *X, int n, int dim,
+                                    double *wide, double *out) {
+    if (pop->precision == BAT_PRECISION_FLOAT) {
+        float out_f[BAT_POP_LANES];
+        pop->objective->evaluate_f(X, n, dim, out_f);
+        for (int i = 0; i < n; i++) {
+            out[i] = out_f[i];
+        }
+    } else {
+        for (size_t k = 0; k < (size_t)n * dim; k++) {
+            wide[k] = X[k];
+        }
+        pop->objective->evaluate(wide, n, dim, out);
+    }
+}
+
+/*
+ * Initializes the population exactly like initialize_bats_seeded():
+ * same RNG stream per global index, same draw order, same parameters.
+ * Padding lanes are set to a neutral state (position 0, no loudness).
+ *
+ * Parameters:
+ *   - pop          : allocated population
+ *   - seed         : global random seed
+ *   - index_offset : global index of bat 0 of this store
+ *   - obj          : objective function, also used by the update kernel
+ *   - scratch      : bat_pop_scratch_size(dim) doubles (NULL: double precision only)
+ */
+void bat_pop_init_seeded(BatPopulation *pop, uint32_t seed, long index_offset, const BatObjective *obj,
+                         double *scratch) {
+    bat_pop_init_begin(pop, index_offset, obj);
+    bat_pop_init_tiles(pop, seed, 0, pop->n_tiles, scratch);
+}
+
+void bat_pop_init_begin(BatPopulation *pop, long index_offset, const BatObjective *obj) {
+    pop->index_offset = index_offset;
+    pop->objective = obj;
+}
+
+/* Padding lane i >= pop->n: any valid xorshift state; never reported. */
+static void init_padding_lane(BatPopulation *pop, int i) {
+    const int dim = pop->dim;
+    pop->rng[i] = 0x6D2B79F5u;
+    pop->rng_spare[i] = BAT_RNG_NO_SPARE;
+    bat_pop_set_A(pop, i, 0.0);
+    bat_pop_set_r(pop, i, R0);
+    pop->f_value[i] = 0.0;
+    for (int d = 0; d < dim; d++) {
+        bat_pop_set_x(pop, bat_pop_offset(dim, i, d), 0.0);
+        bat_pop_set_v(pop, bat_pop_offset(dim, i, d), 0.0);
+    }
+}
+
+void bat_pop_init_padding(BatPopulation *pop) {
+    for (int i = pop->n; i < pop->n_tiles * BAT_POP_LANES; i++) {
+        init_padding_lane(pop, i);
+    }
+}
+
+/*
+ * Initializes tiles [tile_begin, tile_end), then evaluates them.
+ * Every value only depends on the seed and the global index, so disjoint
+ * tile ranges can be initialized concurrently (first touch by the owner).
+ */
+void bat_pop_init_tiles(BatPopulation *pop, uint32_t seed, int tile_begin, int tile_end, double *scratch) {
+    int dim = pop->dim;
+
+    for (int tile = tile_begin; tile < tile_end; tile++) {
+        for (int lane = 0; lane < BAT_POP_LANES; lane++) {
+            int i = tile * BAT_POP_LANES + lane;
+
+            if (i >= pop->n) {
+                init_padding_lane(pop, i);
+                continue;
+            }
+
+            /* Initialize RNG state for this bat (global index = stream id) */
+            pop->rng[i] = bat_rng_init(seed, (uint32_t)(pop->index_offset + i));
+            pop->rng_spare[i] = BAT_RNG_NO_SPARE;
+            uint32_t *rng = &pop->rng[i];
+
+            /* Initial position and velocity */
+            for (int d = 0; d < dim; d++) {
+                bat_pop_set_x(pop, bat_pop_offset(dim, i, d), bat_rng_uniform(rng, -5.0, 5.0));
+                bat_pop_set_v(pop, bat_pop_offset(dim, i, d), V0);
+            }
+
+            bat_pop_set_A(pop, i, A0);
+            bat_pop_set_r(pop, i, R0);
+        }
+
+        /* Evaluate objective function at the initial positions of the tile */
+        const size_t first = (size_t)tile * dim * BAT_POP_LANES;
+        double *out = pop->f_value + (size_t)tile * BAT_POP_LANES;
+        if (pop->precision == BAT_PRECISION_DOUBLE) {
+            pop->objective->evaluate(pop->x + first, BAT_POP_LANES, dim, out);
+        } else {
+            evaluate_compact(pop, pop->xf + first, BAT_POP_LANES, dim, scratch, out);
+        }
+    }
+}
+
+void bat_pop_get_x(const BatPopulation *pop, int i, double out[]) {
+    for (int d = 0; d < pop->dim; d++) {
+        out[d] = bat_pop_x(pop, bat_pop_offset(pop->dim, i, d));
+    }
+}
+
+size_t bat_pop_scratch_size(int dim) {
+    /*
+     * Normals of one bat + the local-search candidates of one tile
+     * + one tile widened to double (mixed precision).
+     */
+    return (size_t)dim * (2 * BAT_POP_LANES + 1);
+}
+
+/*
+ * Block update kernel body (see bat_pop_update() in bat_pop.h).
+ *
+ * Per tile:
+ *   1. draw the frequency of every bat (one uniform per lane)
+ *   2. velocity / position / clamp for all lanes, dimension by dimension
+ *   3. evaluate the moved positions of the whole tile in one call
+ *   4. draw the pulse of every lane; the bats that do a local search get
+ *      their normals (Box-Muller pairs) and all their local candidates are
+ *      evaluated in one batched call
+ *   5. draw the loudness test of every lane, accept / reject per bat
+ *
+ * Per bat, the draws happen in the same order as in update_bat()
+ * (frequency, pulse, normals, loudness), so both kernels give the same
+ * trajectory. Padding lanes draw too (their stream is never reported).
+ *
+ * `dim` is a separate parameter so that the specialized kernels below can
+ * pass a compile-time constant: the body is force-inlined into each of them
+ * and the loops over d are fully unrolled for small dimensions.
+ */
+static inline __attribute__((always_inline))
+void update_tiles(BatPopulation *pop, int tile_begin, int tile_end,
+                  const double best_x[], const BatStats *stats,
+                  BatStats *next_stats, int t, double *scratch, const int dim) {
+    const double A_mean = stats->A_mean;
+    const BatObjectiveEval evaluate = pop->objective->evaluate;
+    const double r_new = R0 * (1.0 - exp(-GAMMA * t));
+
+    /* Scratch: normals of one bat, then the local candidates of a tile. */
+    double *eps = scratch;
+    double *local = scratch + dim;
+
+    for (int tile = tile_begin; tile < tile_end; tile++) {
+        const int base = tile * BAT_POP_LANES;
+        int lanes = pop->n - base;
+        if (lanes > BAT_POP_LANES) lanes = BAT_POP_LANES;
+
+        double *X = pop->x + (size_t)tile * dim * BAT_POP_LANES;
+        double *V = pop->v + (size_t)tile * dim * BAT_POP_LANES;
+        uint32_t *rng = pop->rng + base;
+
+        /* 1. Random frequency in [F_MIN, F_MAX] (padding lanes do not move). */
+        double f[BAT_POP_LANES];
+        bat_rng_uniform01_lanes(rng, BAT_POP_LANES, f);
+        for (int l = 0; l < BAT_POP_LANES; l++) {
+            f[l] = (l < lanes) ? F_MIN + (F_MAX - F_MIN) * f[l] : 0.0;
+        }
+
+        /* 2. Velocity update toward the best, position update, clamp. */
+        for (int d = 0; d < dim; d++) {
+            double *xd = X + (size_t)d * BAT_POP_LANES;
+            double *vd = V + (size_t)d * BAT_POP_LANES;
+            const double bd = best_x[d];
+            for (int l = 0; l < BAT_POP_LANES; l++) {
+                vd[l] += (bd - xd[l]) * f[l];
+                double xn = xd[l] + vd[l];
+                xn = (xn < Lb) ? Lb : xn;
+                xn = (xn > Ub) ? Ub : xn;
+                xd[l] = xn;
+            }
+        }
+
+        /* 3. Evaluate the candidates obtained from the global move. */
+        double Fnew[BAT_POP_LANES];
+        evaluate(X, BAT_POP_LANES, dim, Fnew);
+
+        /* 4. Optional local search (triggered by pulse rate). */
+        double rand_pulse[BAT_POP_LANES];
+        bat_rng_uniform01_lanes(rng, BAT_POP_LANES, rand_pulse);
+
+        int local_lane[BAT_POP_LANES];  /* lanes doing a local search */
+        int m = 0;
+        for (int l = 0; l < lanes; l++) {
+            if (rand_pulse[l] > pop->r[base + l]) {
+                local_lane[m++] = l;
+            }
+        }
+
+        /* Column j of `local` (dimension-major, m points) belongs to local_lane[j]. */
+        int use_local[BAT_POP_LANES];
+        for (int l = 0; l < BAT_POP_LANES; l++) {
+            use_local[l] = -1;
+        }
+        if (m > 0) {
+            for (int j = 0; j < m; j++) {
+                const int l = local_lane[j];
+                bat_rng_normal_fill(&rng[l], &pop->rng_spare[base + l], dim, eps);
+
+                /* local random walk around global best */
+                for (int d = 0; d < dim; d++) {
+                    double xl = best_x[d] + 0.1 * eps[d] * A_mean;
+                    if (xl < Lb) xl = Lb;
+                    if (xl > Ub) xl = Ub;
+                    local[(size_t)d * m + j] = xl;
+                }
+            }
+
+            double F_local[BAT_POP_LANES];
+            evaluate(local, m, dim, F_local);
+
+            for (int j = 0; j < m; j++) {
+                const int l = local_lane[j];
+                if (F_local[j] > Fnew[l]) {   /* we maximize */
+                    Fnew[l] = F_local[j];
+                    use_local[l] = j;
+                }
+            }
+        }
+
+        /* 5. Accept only if improved AND passes loudness test. */
+        double rand_loud[BAT_POP_LANES];
+        bat_rng_uniform01_lanes(rng, BAT_POP_LANES, rand_loud);
+
+        for (int l = 0; l < lanes; l++) {
+            const int i = base + l;
+
+            if ((Fnew[l] > pop->f_value[i]) && (rand_loud[l] < pop->A[i])) {
+                if (use_local[l] >= 0) {
+                    const int j = use_local[l];
+                    for (int d = 0; d < dim; d++) {
+                        X[(size_t)d * BAT_POP_LANES + l] = local[(size_t)d * m + j];
+                    }
+                }
+                pop->f_value[i] = Fnew[l];
+                pop->A[i] *= ALPHA;
+                pop->r[i] = r_new;
+            }
+
+            if (next_stats) {
+                bat_stats_add_values(next_stats, pop->A[i], pop->r[i], pop->f_value[i],
+                                     pop->index_offset + i);
+            }
+        }
+    }
+}
+
+/*
+ * Kernel body of the compact store (--precision mixed|float): the steps and
+ * draws of update_tiles() on the float fields.
+ *
+ * - mixed : the velocity / position update of step 2 and the objective run
+ *           in double on the stored floats; the results are rounded when
+ *           they are stored
+ * - float : step 2 in float and the objective's evaluate_f
+ *
+ * The local-search candidates are computed in double (per bat, as in
+ * update_tiles()) and rounded to float before they are scored, so that the
+ * value of a bat is always the value of its stored position. `prec` is a
+ * compile-time constant in every specialization, like `dim`.
+ */
+static inline __attribute__((always_inline))
+void update_tiles_compact(BatPopulation *pop, int tile_begin, int tile_end,
+                          const double best_x[], const BatStats *stats,
+                          BatStats *next_stats, int t, double *scratch, const int dim,
+                          const BatPrecision prec) {
+    const double A_mean = stats->A_mean;
+    const float r_new = (float)(R0 * (1.0 - exp(-GAMMA * t)));
+
+    /* Scratch: normals of one bat, the local candidates of a tile, a widened tile. */
+    double *eps = scratch;
+    float *local = (float *)(scratch + dim);
+    double *wide = scratch + dim + (size_t)dim * BAT_POP_LANES;
+
+    for (int tile = tile_begin; tile < tile_end; tile++) {
+        const int base = tile * BAT_POP_LANES;
+        int lanes = pop->n - base;
+        if (lanes > BAT_POP_LANES) lanes = BAT_POP_LANES;
+
+        float *X = pop->xf + (size_t)tile * dim * BAT_POP_LANES;
+        float *V = pop->vf + (size_t)tile * dim * BAT_POP_LANES;
+        uint32_t *rng = pop->rng + base;
+
+        /* 1. Random frequency in [F_MIN, F_MAX] (padding lanes do not move). */
+        double f[BAT_POP_LANES];
+        bat_rng_uniform01_lanes(rng, BAT_POP_LANES, f);
+        for (int l = 0; l < BAT_POP_LANES; l++) {
+            f[l] = (l < lanes) ? F_MIN + (F_MAX - F_MIN) * f[l] : 0.0;
+        }
+
+        /* 2. Velocity update toward the best, position update, clamp. */
+        if (prec == BAT_PRECISION_FLOAT) {
+            float ff[BAT_POP_LANES];
+            for (int l = 0; l < BAT_POP_LANES; l++) {
+                ff[l] = (float)f[l];
+            }
+            for (int d = 0; d < dim; d++) {
+                float *xd = X + (size_t)d * BAT_POP_LANES;
+                float *vd = V + (size_t)d * BAT_POP_LANES;
+                const float bd = (float)best_x[d];
+                for (int l = 0; l < BAT_POP_LANES; l++) {
+                    vd[l] += (bd - xd[l]) * ff[l];
+                    float xn = xd[l] + vd[l];
+                    xn = (xn < (float)Lb) ? (float)Lb : xn;
+                    xn = (xn > (float)Ub) ? (float)Ub : xn;
+                    xd[l] = xn;
+                }
+            }
+        } else {
+            for (int d = 0; d < dim; d++) {
+                float *xd = X + (size_t)d * BAT_POP_LANES;
+                float *vd = V + (size_t)d * BAT_POP_LANES;
+                const double bd = best_x[d];
+                for (int l = 0; l < BAT_POP_LANES; l++) {
+                    double vn = (double)vd[l] + (bd - (double)xd[l]) * f[l];
+                    double xn = (double)xd[l] + vn;
+                    xn = (xn < Lb) ? Lb : xn;
+                    xn = (xn > Ub) ? Ub : xn;
+                    vd[l] = (float)vn;
+                    xd[l] = (float)xn;
+                }
+            }
+        }
+
+        /* 3. Evaluate the candidates obtained from the global move. */
+        double Fnew[BAT_POP_LANES];
+        evaluate_compact(pop, X, BAT_POP_LANES, dim, wide, Fnew);
+
+        /* 4. Optional local search (triggered by pulse rate). */
+        double rand_pulse[BAT_POP_LANES];
+        bat_rng_uniform01_lanes(rng, BAT_POP_LANES, rand_pulse);
+
+        int local_lane[BAT_POP_LANES];  /* lanes doing a local search */
+        int m = 0;
+        for (int l = 0; l < lanes; l++) {
+            if (rand_pulse[l] > pop->rf[base + l]) {
+                local_lane[m++] = l;
+            }
+        }
+
+        /* Column j of `local` (dimension-major, m points) belongs to local_lane[j]. */
+        int use_local[BAT_POP_LANES];
+        for (int l = 0; l < BAT_POP_LANES; l++) {
+            use_local[l] = -1;
+        }
+        if (m > 0) {
+            for (int j = 0; j < m; j++) {
+                const int l = local_lane[j];
+                bat_rng_normal_fill(&rng[l], &pop->rng_spare[base + l], dim, eps);
+
+                /* local random walk around global best */
+                for (int d = 0; d < dim; d++) {
+                    double xl = best_x[d] + 0.1 * eps[d] * A_mean;
+                    if (xl < Lb) xl = Lb;
+                    if (xl > Ub) xl = Ub;
+                    local[(size_t)d * m + j] = (float)xl;
+                }
+            }
+
+            double F_local[BAT_POP_LANES];
+            evaluate_compact(pop, local, m, dim, wide, F_local);
+
+            for (int j = 0; j < m; j++) {
+                const int l = local_lane[j];
+                if (F_local[j] > Fnew[l]) {   /* we maximize */
+                    Fnew[l] = F_local[j];
+                    use_local[l] = j;
+                }
+            }
+        }
+
+        /* 5. Accept only if improved AND passes loudness test. */
+        double rand_loud[BAT_POP_LANES];
+        bat_rng_uniform01_lanes(rng, BAT_POP_LANES, rand_loud);
+
+        for (int l = 0; l < lanes; l++) {
+            const int i = base + l;
+
+            if ((Fnew[l] > pop->f_value[i]) && (rand_loud[l] < pop->Af[i])) {
+                if (use_local[l] >= 0) {
+                    const int j = use_local[l];
+                    for (int d = 0; d < dim; d++) {
+                        X[(size_t)d * BAT_POP_LANES + l] = local[(size_t)d * m + j];
+                    }
+                }
+                pop->f_value[i] = Fnew[l];
+                pop->Af[i] = (float)(pop->Af[i] * ALPHA);
+                pop->rf[i] = r_new;
+            }
+
+            if (next_stats) {
+                bat_stats_add_values(next_stats, pop->Af[i], pop->rf[i], pop->f_value[i],
+                                     pop->index_offset + i);
+            }
+        }
+    }
+}
+
+/*
+ * Specialized kernels for common dimensions + the generic one.
+ * The dispatcher (select_kernel) runs once, when the population is allocated.
+ */
+#define BAT_POP_KERNEL_ARGS                                                    \
+    BatPopulation *pop, int tile_begin, int tile_end, const double best_x[],   \
+    const BatStats *stats, BatStats *next_stats, int t, double *scratch
+
+/* One kernel per precision (double, mixed, float) for dimension D. */
+#define BAT_POP_KERNELS(SUFFIX, D)                                                    \
+    static void update_tiles_##SUFFIX(BAT_POP_KERNEL_ARGS) {                          \
+        update_tiles(pop, tile_begin, tile_end, best_x, stats, next_stats, t,         \
+                     scratch, D);                                                     \
+    }                                                                                 \
+    static void update_tiles_mixed_##SUFFIX(BAT_POP_KERNEL_ARGS) {                    \
+        update_tiles_compact(pop, tile_begin, tile_end, best_x, stats, next_stats, t, \
+                             scratch, D, BAT_PRECISION_MIXED);                        \
+    }                                                                                 \
+    static void update_tiles_float_##SUFFIX(BAT_POP_KERNEL_ARGS) {                    \
+        update_tiles_compact(pop, tile_begin, tile_end, best_x, stats, next_stats, t, \
+                             scratch, D, BAT_PRECISION_FLOAT);                        \
+    }
+
+BAT_POP_KERNELS(d2, 2)
+BAT_POP_KERNELS(d4, 4)
+BAT_POP_KERNELS(d8, 8)
+BAT_POP_KERNELS(d16, 16)
+BAT_POP_KERNELS(d32, 32)
+BAT_POP_KERNELS(generic, pop->dim)
+
+#undef BAT_POP_KERNELS
+#undef BAT_POP_KERNEL_ARGS
+
+static void select_kernel(BatPopulation *pop) {
+    static const struct {
+        int dim;                    /* 0: generic */
+        const char *name;
+        BatPopKernel kernel[3];     /* indexed by BatPrecision */
+    } kernels[] = {
+        { 2,  "d2",      { update_tiles_d2,  update_tiles_mixed_d2,  update_tiles_float_d2 } },
+        { 4,  "d4",      { update_tiles_d4,  update_tiles_mixed_d4,  update_tiles_float_d4 } },
+        { 8,  "d8",      { update_tiles_d8,  update_tiles_mixed_d8,  update_tiles_float_d8 } },
+        { 16, "d16",     { update_tiles_d16, update_tiles_mixed_d16, update_tiles_float_d16 } },
+        { 32, "d32",     { update_tiles_d32, update_tiles_mixed_d32, update_tiles_float_d32 } },
+        { 0,  "generic", { update_tiles_generic, update_tiles_mixed_generic, update_tiles_float_generic } },
+    };
+    const int n_kernels = (int)(sizeof(kernels) / sizeof(kernels[0]));
+
+    int k = 0;
+    while (k < n_kernels - 1 && kernels[k].dim != pop->dim) {
+        k++;
+    }
+    pop->kernel = kernels[k].kernel[pop->precision];
+    pop->kernel_name = kernels[k].name;
+}
+
+void bat_pop_update(BatPopulation *pop, int tile_begin, int tile_end,
+                    const double best_x[], const BatStats *stats,
+                    BatStats *next_stats, int t, double *scratch) {
+    pop->kernel(pop, tile_begin, tile_end, best_x, stats, next_stats, t, scratch);
+}
+
+void bat_pop_stats(const BatPopulation *pop, int tile_begin, int tile_end, BatStats *acc) {
+    int end = tile_end * BAT_POP_LANES;
+    if (end > pop->n) end = pop->n;
+
+    for (int i = tile_begin * BAT_POP_LANES; i < end; i++) {
+        bat_stats_add_values(acc, bat_pop_A(pop, i), bat_pop_r(pop, i), pop->f_value[i], pop->index_offset + i);
+    }
+}
@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <string.h>
+
+#ifdef BAT_PROFILE_PAPI
+#include <pthread.h>
+#include <papi.h>
+#endif
+
+#include "bat_prof.h"
+
+/*
+ * bat_prof.c
+ *
+ * Purpose:
+ * Start / stop of the per-phase timers and hardware counters, and the
+ * BENCH fields of the breakdown (see bat_prof.h).
+ */
+
+static const char *const phase_names[BAT_PROF_PHASES] = {
+    "init", "update", "reduce", "comm", "wait", "io"
+};
+
+#ifdef BAT_PROFILE_PAPI
+static const int papi_events[BAT_PROF_COUNTERS] = { PAPI_TOT_CYC, PAPI_TOT_INS, PAPI_L2_TCM };
+
+static int papi_ready = 0;
+static pthread_once_t papi_once = PTHREAD_ONCE_INIT;
+
+/* Library and thread support, once per process. */
+static void papi_init(void) {
+    if (PAPI_library_init(PAPI_VER_CURRENT) != PAPI_VER_CURRENT ||
+        PAPI_thread_init((unsigned long (*)(void))pthread_self) != PAPI_OK) {
+        fprintf(stderr, "PAPI initialization failed: no hardware counters\n");
+        return;
+    }
+    papi_ready = 1;
+}
+
+/* Event set of the calling thread with the available events. */
+static void papi_start(BatProf *p) {
+    pthread_once(&papi_once, papi_init);
+    p->events = PAPI_NULL;
+    if (!papi_ready || PAPI_create_eventset(&p->events) != PAPI_OK) {
+        p->events = -1;
+        return;
+    }
+    int n = 0;
+    for (int k = 0; k < BAT_PROF_COUNTERS; k++) {
+        p->slot[k] = (PAPI_add_event(p->events, papi_events[k]) == PAPI_OK) ? n++ : -1;
+    }
+    if (n == 0 || PAPI_start(p->events) != PAPI_OK) {
+        PAPI_cleanup_eventset(p->events);
+        PAPI_destroy_eventset(&p->events);
+        p->events = -1;
+    }
+}
+#endif
+
+int bat_prof_enabled(void) {
+#ifdef BAT_PROFILE
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+void bat_prof_begin(BatProf *p) {
+    memset(p, 0, sizeof(*p));
+    p->events = -1;
+    for (int k = 0; k < BAT_PROF_COUNTERS; k++) {
+        p->counters[k] = -1;
+        p->slot[k] = -1;
+    }
+#ifdef BAT_PROFILE
+#ifdef BAT_PROFILE_PAPI
+    papi_start(p);
+#endif
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    p->mark = (double)now.tv_sec + 1e-9 * (double)now.tv_nsec;
+#endif
+}
+
+void bat_prof_end(BatProf *p) {
+#ifdef BAT_PROFILE_PAPI
+    if (p->events < 0) {
+        return;
+    }
+    long long values[BAT_PROF_COUNTERS] = { 0 };
+    if (PAPI_stop(p->events, values) != PAPI_OK) {
+        memset(values, 0, sizeof(values));
+    }
+    for (int k = 0; k < BAT_PROF_COUNTERS; k++) {
+        p->counters[k] = (p->slot[k] >= 0) ? values[p->slot[k]] : -1;
+    }
+    PAPI_cleanup_eventset(p->events);
+    PAPI_destroy_eventset(&p->events);
+    p->events = -1;
+#else
+    (void)p;
+#endif
+}
+
+void bat_prof_merge(BatProf *into, const BatProf *p) {
+    for (int k = 0; k < BAT_PROF_PHASES; k++) {
+        into->t[k] += p->t[k];
+    }
+    for (int k = 0; k < BAT_PROF_COUNTERS; k++) {
+        if (p->counters[k] >= 0) {
+            into->counters[k] = (into->counters[k] < 0 ? 0 : into->counters[k]) + p->counters[k];
+        }
+    }
+}
+
+void bat_prof_summary_init(BatProfSummary *s) {
+    s->workers = 0;
+    for (int k = 0; k < BAT_PROF_PHASES; k++) {
+        s->min[k] = 0.0;
+        s->sum[k] = 0.0;
+        s->max[k] = 0.0;
+    }
+    for (int k = 0; k < BAT_PROF_COUNTERS; k++) {
+        s->counters[k] = -1;
+    }
+}
+
+void bat_prof_summary_add(BatProfSummary *s, const BatProf *p) {
+    for (int k = 0; k < BAT_PROF_PHASES; k++) {
+        if (s->workers == 0 || p->t[k] < s->min[k]) {
+            s->min[k] = p->t[k];
+        }
+        if (s->workers == 0 || p->t[k] > s->max[k]) {
+            s->max[k] = p->t[k];
+        }
+        s->sum[k] += p->t[k];
+    }
+    for (int k = 0; k < BAT_PROF_COUNTERS; k++) {
+        if (p->counters[k] >= 0) {
+            s->counters[k] = (s->counters[k] < 0 ? 0 : s->counters[k]) + p->counters[k];
+        }
+    }
+    s->workers++;
+}
+
+void bat_prof_print_bench(const BatProfSummary *s) {
+    if (!bat_prof_enabled() || s->workers == 0) {
+        return;
+    }
+    printf(" prof_workers=%ld", s->workers);
+    for (int k = 0; k < BAT_PROF_PHASES; k++) {
+        printf(" prof_%s_min=%.6f prof_%s_avg=%.6f prof_%s_max=%.6f", phase_names[k], s->min[k],
+               phase_names[k], s->sum[k] / (double)s->workers, phase_names[k], s->max[k]);
+    }
+
+    const long long *c = s->counters;
+    if (c[BAT_PROF_CYCLES] >= 0) {
+        printf(" papi_cycles=%lld", c[BAT_PROF_CYCLES]);
+    }
+    if (c[BAT_PROF_INS] >= 0) {
+        printf(" papi_ins=%lld", c[BAT_PROF_INS]);
+    }
+    if (c[BAT_PROF_L2_MISSES] >= 0) {
+        printf(" papi_l2_tcm=%lld", c[BAT_PROF_L2_MISSES]);
+    }
+    if (c[BAT_PROF_CYCLES] > 0 && c[BAT_PROF_INS] >= 0) {
+        printf(" ipc=%.3f", (double)c[BAT_PROF_INS] / (double)c[BAT_PROF_CYCLES]);
+    }
+}
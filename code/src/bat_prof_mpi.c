@@ -0,0 +1,45 @@
+#include "bat_prof_mpi.h"
+
+/*
+ * bat_prof_mpi.c
+ *
+ * Purpose:
+ * Reduction of the per-phase timers over the ranks (see bat_prof_mpi.h).
+ */
+
+/* MPI_Reduce in place on rank 0. */
+static void reduce_to_root(void *buf, int count, MPI_Datatype type, MPI_Op op, int rank, MPI_Comm comm) {
+    if (rank == 0) {
+        MPI_Reduce(MPI_IN_PLACE, buf, count, type, op, 0, comm);
+    } else {
+        MPI_Reduce(buf, NULL, count, type, op, 0, comm);
+    }
+}
+
+void bat_prof_mpi_reduce(BatProfSummary *s, MPI_Comm comm) {
+    if (!bat_prof_enabled()) {
+        return;
+    }
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+
+    reduce_to_root(s->min, BAT_PROF_PHASES, MPI_DOUBLE, MPI_MIN, rank, comm);
+    reduce_to_root(s->sum, BAT_PROF_PHASES, MPI_DOUBLE, MPI_SUM, rank, comm);
+    reduce_to_root(s->max, BAT_PROF_PHASES, MPI_DOUBLE, MPI_MAX, rank, comm);
+    reduce_to_root(&s->workers, 1, MPI_LONG, MPI_SUM, rank, comm);
+
+    /* A counter is reported only if every rank has it (-1 somewhere => MIN < 0) */
+    long long have[BAT_PROF_COUNTERS];
+    for (int k = 0; k < BAT_PROF_COUNTERS; k++) {
+        have[k] = s->counters[k];
+    }
+    reduce_to_root(have, BAT_PROF_COUNTERS, MPI_LONG_LONG, MPI_MIN, rank, comm);
+    reduce_to_root(s->counters, BAT_PROF_COUNTERS, MPI_LONG_LONG, MPI_SUM, rank, comm);
+    if (rank == 0) {
+        for (int k = 0; k < BAT_PROF_COUNTERS; k++) {
+            if (have[k] < 0) {
+                s->counters[k] = -1;
+            }
+        }
+    }
+}
@@ -20,6 +20,9 @@
  * - This state is initialized once using a global seed and the bat index.
  * - All random draws update only the bat’s own state.
  *
+ * The xorshift step, the (0,1) uniform and the Box-Muller block draws are
+ * static inline in bat_rng.h.
+ *
  * Guarantees:
  * - Deterministic behavior when using the same seed.
  * - Independence between bats.
@@ -45,23 +48,6 @@ static uint32_t splitmix32(uint32_t x) {
     return x ^ (x >> 16);
 }
 
-/*
- * Advances the RNG state using a xorshift transition and returns a 32-bit
- * pseudo-random value. This function is used as the main random generator
- * during the algorithm, after the state has been initialized.
- *
- * Parameters:
- *   - state : pointer to the RNG state to update
- */
-static inline uint32_t xorshift32(uint32_t *state) {
-    uint32_t x = *state;
-    x ^= x << 13;
-    x ^= x >> 17;
-    x ^= x << 5;
-    *state = x;
-    return x;
-}
-
 /*
  * Initializes a per-bat RNG state using a global seed and a stream identifier.
  * Ensures a non-zero initial state.
@@ -78,18 +64,6 @@ uint32_t bat_rng_init(uint32_t seed, uint32_t stream_id) {
     return s;
 }
 
- /*
- * Generates a uniform random value strictly between 0 and 1.
- * Advances the RNG state using the xorshift generator.
- *
- * Parameters:
- *   - state : pointer to the RNG state to update
- */
-double bat_rng_uniform01(uint32_t *state) {
-    uint32_t r = xorshift32(state);
-    return ((double)r + 1.0) / ((double)UINT32_MAX + 2.0);
-}
-
 /*
  * Generates a uniform random value in the interval (a, b).
  * Uses a uniform draw in (0,1) and maps it to the given range.
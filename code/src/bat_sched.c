@@ -0,0 +1,308 @@
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bat_sched.h"
+
+/*
+ * bat_sched.c
+ *
+ * Purpose:
+ * Options, chunk tuner and BENCH fields of the OpenMP update schedules
+ * (see bat_sched.h).
+ */
+
+void bat_sched_defaults(BatSchedOptions *o) {
+    o->kind = BAT_SCHED_STATIC;
+    o->chunk = 0;
+    o->set = 0;
+    o->threads = 0;
+    o->threads_auto = 0;
+    o->retune_every = 0;
+}
+
+int bat_sched_parse_option(BatSchedOptions *o, int argc, char **argv, int *i) {
+    if (*i + 1 >= argc) {
+        return 0;
+    }
+    const char *opt = argv[*i];
+    const char *value = argv[*i + 1];
+
+    if (strcmp(opt, "--schedule") == 0) {
+        if (strcmp(value, "static") == 0) {
+            o->kind = BAT_SCHED_STATIC;
+        } else if (strcmp(value, "dynamic") == 0) {
+            o->kind = BAT_SCHED_DYNAMIC;
+        } else if (strcmp(value, "tasks") == 0) {
+            o->kind = BAT_SCHED_TASKS;
+        } else {
+            fprintf(stderr, "Unknown schedule '%s' (expected static, dynamic or tasks)\n", value);
+            return -1;
+        }
+    } else if (strcmp(opt, "--chunk") == 0) {
+        o->chunk = atoi(value);
+        if (o->chunk < 0) {
+            fprintf(stderr, "Invalid chunk: %d (expected N >= 1, or 0 to tune it)\n", o->chunk);
+            return -1;
+        }
+    } else if (strcmp(opt, "--threads") == 0) {
+        o->threads_auto = (strcmp(value, "auto") == 0);
+        o->threads = o->threads_auto ? 0 : atoi(value);
+        if (!o->threads_auto && o->threads < 1) {
+            fprintf(stderr, "Invalid threads: '%s' (expected N >= 1 or auto)\n", value);
+            return -1;
+        }
+        (*i)++;
+        return 1;
+    } else if (strcmp(opt, "--retune") == 0) {
+        o->retune_every = atoi(value);
+        if (o->retune_every < 0) {
+            fprintf(stderr, "Invalid retune period: %d (expected K >= 1, or 0 to plan once)\n", o->retune_every);
+            return -1;
+        }
+        (*i)++;
+        return 1;
+    } else {
+        return 0;
+    }
+    o->set = 1;
+    (*i)++;
+    return 1;
+}
+
+const char *bat_sched_kind_name(BatSchedKind kind) {
+    switch (kind) {
+    case BAT_SCHED_DYNAMIC:
+        return "dynamic";
+    case BAT_SCHED_TASKS:
+        return "tasks";
+    default:
+        return "static";
+    }
+}
+
+void bat_sched_tuner_init(BatSchedTuner *tu, const BatSchedOptions *o, int items, int threads) {
+    tu->max_chunk = threads > 0 ? (items + threads - 1) / threads : items;
+    if (tu->max_chunk < 1) {
+        tu->max_chunk = 1;
+    }
+
+    tu->tuning = (o->kind != BAT_SCHED_STATIC && o->chunk == 0);
+    if (o->chunk > 0) {
+        tu->chunk = o->chunk;
+    } else {
+        tu->chunk = items / (16 * (threads > 0 ? threads : 1));
+        if (tu->chunk < 1) {
+            tu->chunk = 1;
+        }
+        if (tu->chunk > tu->max_chunk) {
+            tu->chunk = tu->max_chunk;
+        }
+    }
+
+    tu->direction = +1;
+    tu->best_chunk = tu->chunk;
+    tu->best_time = DBL_MAX;
+    tu->trials = 0;
+    tu->trial_time = DBL_MAX;
+    tu->tuned_iters = 0;
+}
+
+/* Ends the search on the best chunk found. */
+static void tuner_finish(BatSchedTuner *tu) {
+    tu->tuning = 0;
+    tu->chunk = tu->best_chunk;
+}
+
+void bat_sched_tuner_record(BatSchedTuner *tu, double seconds) {
+    if (!tu->tuning) {
+        return;
+    }
+    tu->tuned_iters++;
+    if (seconds < tu->trial_time) {
+        tu->trial_time = seconds;
+    }
+    if (++tu->trials < BAT_SCHED_TRIALS) {
+        return;
+    }
+
+    /* Candidate measured: keep going in the same direction while it improves */
+    const int improved = tu->trial_time < tu->best_time;
+    const int first = (tu->tuned_iters == BAT_SCHED_TRIALS);
+    if (improved) {
+        tu->best_time = tu->trial_time;
+        tu->best_chunk = tu->chunk;
+    }
+    tu->trials = 0;
+    tu->trial_time = DBL_MAX;
+
+    if (!improved) {
+        if (tu->direction > 0 && tu->tuned_iters == 2 * BAT_SCHED_TRIALS) {
+            /* The first doubling was slower: search the smaller chunks */
+            tu->direction = -1;
+        } else {
+            tuner_finish(tu);
+            return;
+        }
+    }
+
+    int next = tu->direction > 0 ? tu->best_chunk * 2 : tu->best_chunk / 2;
+    if (first && next > tu->max_chunk) {
+        /* The starting chunk is already the largest one */
+        tu->direction = -1;
+        next = tu->best_chunk / 2;
+    }
+    if (next < 1 || next > tu->max_chunk) {
+        tuner_finish(tu);
+        return;
+    }
+    tu->chunk = next;
+}
+
+void bat_sched_tuner_restart(BatSchedTuner *tu, int chunk) {
+    if (chunk < 1) {
+        chunk = 1;
+    }
+    if (chunk > tu->max_chunk) {
+        chunk = tu->max_chunk;
+    }
+    tu->chunk = chunk;
+    tu->tuning = 1;
+    tu->direction = +1;
+    tu->best_chunk = chunk;
+    tu->best_time = DBL_MAX;
+    tu->trials = 0;
+    tu->trial_time = DBL_MAX;
+    tu->tuned_iters = 0;
+}
+
+void bat_sched_planner_init(BatSchedPlanner *pl, const BatSchedOptions *o, int max_threads) {
+    if (max_threads < 1) {
+        max_threads = 1;
+    }
+    pl->n_teams = 0;
+    for (int p = 1; p < max_threads && pl->n_teams < BAT_SCHED_MAX_TEAMS - 1; p *= 2) {
+        pl->team[pl->n_teams++] = p;
+    }
+    pl->team[pl->n_teams++] = max_threads;
+    for (int k = 0; k < pl->n_teams; k++) {
+        pl->sync_s[k] = 0.0;
+        pl->dispatch_s[k] = 0.0;
+    }
+    pl->calib_s = 0.0;
+    pl->threads = max_threads;
+    pl->chunk = 1;
+    pl->item_s = 0.0;
+    pl->trials = 0;
+    pl->trial_s = DBL_MAX;
+    pl->retune_every = o->retune_every;
+    pl->next_retune = 0;
+    pl->plans = 0;
+}
+
+/* Candidate of a team size (the largest one not above it). */
+static int planner_team_index(const BatSchedPlanner *pl, int team) {
+    int k = 0;
+    while (k + 1 < pl->n_teams && pl->team[k + 1] <= team) {
+        k++;
+    }
+    return k;
+}
+
+/* Predicted iteration time of candidate k. */
+static double planner_predict(const BatSchedPlanner *pl, int k, int items) {
+    const int p = pl->team[k];
+    return (double)((items + p - 1) / p) * pl->item_s + pl->sync_s[k];
+}
+
+/* Picks the team and the starting chunk from the measured item cost. */
+static void planner_plan(BatSchedPlanner *pl, int items, int team) {
+    const int current = planner_team_index(pl, team);
+    int best = current;
+    for (int k = 0; k < pl->n_teams; k++) {
+        if (planner_predict(pl, k, items) < planner_predict(pl, best, items)) {
+            best = k;
+        }
+    }
+    if (planner_predict(pl, best, items) > (1.0 - BAT_SCHED_MIN_GAIN) * planner_predict(pl, current, items)) {
+        best = current;
+    }
+    pl->threads = (best == current) ? team : pl->team[best];
+
+    const double work = BAT_SCHED_GRAIN * pl->dispatch_s[best];
+    pl->chunk = (pl->item_s > 0.0) ? (int)(work / pl->item_s) + 1 : 1;
+    if (pl->chunk > items) {
+        pl->chunk = items > 0 ? items : 1;
+    }
+}
+
+int bat_sched_planner_record(BatSchedPlanner *pl, double busy_s, int items, int team, int t) {
+    if (pl->retune_every > 0 && t >= pl->next_retune && pl->trials >= BAT_SCHED_CALIB_ITERS) {
+        /* Open a new measuring window; busy_s spans the iterations since the last one */
+        pl->trials = 0;
+        pl->trial_s = DBL_MAX;
+        return 0;
+    }
+    if (pl->trials >= BAT_SCHED_CALIB_ITERS || items <= 0) {
+        return 0;
+    }
+    const double item_s = busy_s / items;
+    if (item_s < pl->trial_s) {
+        pl->trial_s = item_s;
+    }
+    if (++pl->trials < BAT_SCHED_CALIB_ITERS) {
+        return 0;
+    }
+    pl->item_s = pl->trial_s;
+    pl->plans++;
+    pl->next_retune = t + 1 + pl->retune_every;
+    planner_plan(pl, items, team);
+    return 1;
+}
+
+void bat_sched_planner_print_bench(const BatSchedOptions *o, const BatSchedPlanner *pl, BatSchedKind kind) {
+    if (!o->threads_auto) {
+        return;
+    }
+    const int k = planner_team_index(pl, pl->threads);
+    printf(" threads_mode=auto threads_max=%d item_ns=%.1f sync_ns=%.1f", pl->team[pl->n_teams - 1],
+           1e9 * pl->item_s, 1e9 * pl->sync_s[k]);
+    if (kind != BAT_SCHED_STATIC) {
+        printf(" chunk_grain=%d", pl->chunk);
+    }
+    printf(" plans=%d calib_s=%.6f", pl->plans, pl->calib_s);
+}
+
+/* Prints " <name>=v0,v1,..." */
+static void print_list(const char *name, const double v[], int n) {
+    printf(" %s=", name);
+    for (int k = 0; k < n; k++) {
+        printf("%s%.6f", k == 0 ? "" : ",", v[k]);
+    }
+}
+
+void bat_sched_print_bench(const BatSchedOptions *o, const BatSchedTuner *tu, const double busy[],
+                           const double idle[], int threads) {
+    if (!o->set) {
+        return;
+    }
+    printf(" schedule=%s", bat_sched_kind_name(o->kind));
+    if (o->kind != BAT_SCHED_STATIC) {
+        printf(" chunk=%d", tu->chunk);
+        if (o->chunk == 0) {
+            printf(" chunk_tuned_iters=%d", tu->tuned_iters);
+        }
+    }
+    print_list("busy_s", busy, threads);
+    print_list("idle_s", idle, threads);
+
+    double sum = 0.0, max = 0.0;
+    for (int k = 0; k < threads; k++) {
+        sum += busy[k];
+        if (busy[k] > max) {
+            max = busy[k];
+        }
+    }
+    printf(" imbalance=%.3f", sum > 0.0 ? max * threads / sum : 1.0);
+}
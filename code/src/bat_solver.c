@@ -0,0 +1,137 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bat_solver.h"
+
+/*
+ * bat_solver.c
+ *
+ * Purpose:
+ * Solver handle of libbat (see bat_solver.h): a reusable workspace and the
+ * sequential SoA iteration, shared by the sequential front-end and by
+ * programs that embed the optimizer.
+ */
+
+/* Seconds elapsed since t0. */
+static double elapsed_since(const struct timespec *t0) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - t0->tv_sec) + 1e-9 * (double)(now.tv_nsec - t0->tv_nsec);
+}
+
+void bat_solver_params_defaults(BatSolverParams *p) {
+    p->n_bats = N_BATS;
+    p->dim = dimension;
+    p->max_iters = MAX_ITERS;
+    p->precision = BAT_PRECISION_DOUBLE;
+    bat_stop_defaults(&p->stop);
+}
+
+int bat_solver_alloc(BatSolver *s, const BatSolverParams *p) {
+    memset(s, 0, sizeof(*s));
+    if (p->n_bats <= 0 || p->dim <= 0 || p->max_iters <= 0 || !bat_stop_valid(&p->stop)) {
+        errno = EINVAL;
+        return -1;
+    }
+    s->params = *p;
+
+    /* bat_pop_alloc() zeroes the store, so its pages are resident before the first solve */
+    if (bat_pop_alloc(&s->pop, p->n_bats, p->dim, p->precision) != 0) {
+        errno = ENOMEM;
+        return -1;
+    }
+    s->best_x = calloc((size_t)p->dim, sizeof(double));
+    s->scratch = calloc(bat_pop_scratch_size(p->dim), sizeof(double));
+    if (!s->best_x || !s->scratch) {
+        bat_solver_free(s);
+        errno = ENOMEM;
+        return -1;
+    }
+    return 0;
+}
+
+void bat_solver_free(BatSolver *s) {
+    bat_pop_free(&s->pop);
+    free(s->best_x);
+    free(s->scratch);
+    s->best_x = NULL;
+    s->scratch = NULL;
+}
+
+int bat_solver_set_params(BatSolver *s, const BatSolverParams *p) {
+    if (p->n_bats <= 0 || p->dim <= 0 || p->max_iters <= 0 || !bat_stop_valid(&p->stop)) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (p->n_bats == s->params.n_bats && p->dim == s->params.dim && p->precision == s->params.precision) {
+        s->params = *p;
+        return 0;
+    }
+
+    BatSolver resized;
+    if (bat_solver_alloc(&resized, p) != 0) {
+        return -1;
+    }
+    resized.solves = s->solves;
+    bat_solver_free(s);
+    *s = resized;
+    return 0;
+}
+
+void bat_solver_start(BatSolver *s, const BatObjective *obj, uint32_t seed) {
+    s->objective = obj;
+    bat_pop_init_seeded(&s->pop, seed, 0, obj, s->scratch);
+
+    bat_stats_reset(&s->stats);
+    bat_pop_stats(&s->pop, 0, s->pop.n_tiles, &s->stats);
+    bat_stats_finalize(&s->stats);
+    bat_pop_get_x(&s->pop, (int)s->stats.best_index, s->best_x);
+
+    bat_stop_init(&s->stop_state, s->stats.best_value);
+    s->t = 0;
+    s->solves++;
+}
+
+void bat_solver_step(BatSolver *s) {
+    /* Update all tiles; the kernel accumulates the next statistics */
+    BatStats next_stats;
+    bat_stats_reset(&next_stats);
+    bat_pop_update(&s->pop, 0, s->pop.n_tiles, s->best_x, &s->stats, &next_stats, s->t, s->scratch);
+    bat_stats_finalize(&next_stats);
+    s->stats = next_stats;
+
+    /* New best (best_x is only read inside the update) */
+    bat_pop_get_x(&s->pop, (int)s->stats.best_index, s->best_x);
+    s->t++;
+}
+
+void bat_solver_solve(BatSolver *s, const BatObjective *obj, uint32_t seed, BatSolverResult *out) {
+    const BatStopCriteria *stop = &s->params.stop;
+    BatStopReason reason = BAT_STOP_NONE;
+
+    bat_solver_start(s, obj, seed);
+
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    while (s->t < s->params.max_iters) {
+        int t = s->t;
+        bat_solver_step(s);
+
+        if (bat_stop_due(stop, t)) {
+            reason = bat_stop_check(stop, &s->stop_state, t, s->stats.best_value,
+                                    bat_stop_time_up(stop, elapsed_since(&t0)));
+            if (reason != BAT_STOP_NONE) {
+                break;
+            }
+        }
+    }
+
+    out->time_s = elapsed_since(&t0);
+    out->best_value = s->stats.best_value;
+    out->best_x = s->best_x;
+    out->iters = s->t;
+    out->stop_reason = reason;
+}
@@ -0,0 +1,64 @@
+#include <float.h>
+#include "bat.h"
+#include "bat_stats.h"
+
+/*
+ * bat_stats.c
+ *
+ * Purpose:
+ * Maintain aggregates over the bat population (loudness mean, pulse-rate
+ * mean, best bat) so that update_bat() never has to scan the population.
+ *
+ * Usage pattern in the front-ends:
+ *   1. bat_stats_reset() before the update loop of iteration t
+ *   2. bat_stats_add() for each bat once it has been updated
+ *   3. merge the per-thread / per-rank partial results
+ *   4. bat_stats_finalize() -> input of iteration t+1
+ */
+
+void bat_stats_reset(BatStats *s) {
+    s->A_sum = 0.0;
+    s->r_sum = 0.0;
+    s->count = 0.0;
+    s->stop_votes = 0.0;
+    s->best_value = -DBL_MAX;
+    s->best_index = -1;
+    s->A_mean = 0.0;
+    s->r_mean = 0.0;
+}
+
+/*
+ * Merges two partial accumulators.
+ * Ties on best_value are broken by the smallest index (bat_stats_better),
+ * so the result does not depend on the merge order (thread scheduling,
+ * rank order).
+ */
+void bat_stats_merge(BatStats *dst, const BatStats *src) {
+    dst->A_sum += src->A_sum;
+    dst->r_sum += src->r_sum;
+    dst->count += src->count;
+    dst->stop_votes += src->stop_votes;
+
+    if (src->best_index >= 0 && bat_stats_better(src->best_value, src->best_index, dst->best_value, dst->best_index)) {
+        dst->best_value = src->best_value;
+        dst->best_index = src->best_index;
+    }
+}
+
+void bat_stats_finalize(BatStats *s) {
+    if (s->count > 0.0) {
+        s->A_mean = s->A_sum / s->count;
+        s->r_mean = s->r_sum / s->count;
+    } else {
+        s->A_mean = 0.0;
+        s->r_mean = 0.0;
+    }
+}
+
+void bat_stats_compute(BatStats *s, const Bat bats[], int n_bats, long index_offset) {
+    bat_stats_reset(s);
+    for (int i = 0; i < n_bats; i++) {
+        bat_stats_add(s, &bats[i], index_offset + i);
+    }
+    bat_stats_finalize(s);
+}
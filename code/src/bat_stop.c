@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bat_stop.h"
+
+/*
+ * bat_stop.c
+ *
+ * Purpose:
+ * Command-line options and evaluation of the early-termination criteria
+ * (see bat_stop.h). The front-ends decide when to call bat_stop_check()
+ * and how the time votes of their workers are combined.
+ */
+
+void bat_stop_defaults(BatStopCriteria *c) {
+    c->use_target = 0;
+    c->target = 0.0;
+    c->window = 0;
+    c->tol = 0.0;
+    c->time_limit = 0.0;
+    c->check_every = 1;
+}
+
+int bat_stop_parse_option(BatStopCriteria *c, int argc, char **argv, int *i) {
+    if (*i + 1 >= argc) {
+        return 0;
+    }
+    const char *opt = argv[*i];
+    const char *value = argv[*i + 1];
+
+    if (strcmp(opt, "--target") == 0) {
+        c->use_target = 1;
+        c->target = atof(value);
+    } else if (strcmp(opt, "--window") == 0) {
+        c->window = atoi(value);
+    } else if (strcmp(opt, "--tol") == 0) {
+        c->tol = atof(value);
+    } else if (strcmp(opt, "--time-limit") == 0) {
+        c->time_limit = atof(value);
+    } else if (strcmp(opt, "--check-every") == 0) {
+        c->check_every = atoi(value);
+    } else {
+        return 0;
+    }
+    (*i)++;
+    return 1;
+}
+
+int bat_stop_valid(const BatStopCriteria *c) {
+    return c->check_every >= 1 && c->window >= 0 && c->tol >= 0.0;
+}
+
+int bat_stop_time_up(const BatStopCriteria *c, double elapsed) {
+    return c->time_limit > 0.0 && elapsed >= c->time_limit;
+}
+
+void bat_stop_init(BatStopState *s, double best_value) {
+    s->ref_value = best_value;
+    s->ref_iter = -1;
+}
+
+BatStopReason bat_stop_check(const BatStopCriteria *c, BatStopState *s, int t, double best_value, int time_up) {
+    if (c->use_target && best_value >= c->target) {
+        return BAT_STOP_TARGET;
+    }
+
+    /* The window restarts at every improvement larger than tol */
+    if (c->window > 0) {
+        if (best_value > s->ref_value + c->tol) {
+            s->ref_value = best_value;
+            s->ref_iter = t;
+        } else if (t - s->ref_iter >= c->window) {
+            return BAT_STOP_STALL;
+        }
+    }
+
+    return time_up ? BAT_STOP_TIME : BAT_STOP_NONE;
+}
+
+const char *bat_stop_reason_name(BatStopReason reason) {
+    switch (reason) {
+    case BAT_STOP_TARGET: return "target";
+    case BAT_STOP_STALL:  return "stall";
+    case BAT_STOP_TIME:   return "time";
+    default:              return "iters";
+    }
+}
+
+void bat_stop_print_bench(const BatStopCriteria *c, int iters_done, BatStopReason reason) {
+    if (bat_stop_enabled(c)) {
+        printf(" stop_iter=%d stop=%s", iters_done, bat_stop_reason_name(reason));
+    }
+}
@@ -0,0 +1,258 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "bat_pop.h"
+#include "bat_store.h"
+
+/*
+ * bat_store.c
+ *
+ * Purpose:
+ * Options, mapping, block prefetch/release, sync points and signal
+ * handling of the memory-mapped population store (see bat_store.h).
+ */
+
+/* Set by the SIGTERM / SIGINT handler. */
+static volatile sig_atomic_t interrupted = 0;
+
+void bat_store_defaults(BatStoreOptions *o) {
+    o->path = NULL;
+    o->block = BAT_STORE_BLOCK;
+}
+
+int bat_store_parse_option(BatStoreOptions *o, int argc, char **argv, int *i) {
+    if (*i + 1 >= argc) {
+        return 0;
+    }
+    const char *opt = argv[*i];
+    const char *value = argv[*i + 1];
+
+    if (strcmp(opt, "--store") == 0) {
+        if (strcmp(value, "memory") == 0) {
+            o->path = NULL;
+        } else if (strncmp(value, "mmap:", 5) == 0 && value[5] != '\0') {
+            o->path = value + 5;
+        } else {
+            fprintf(stderr, "Unknown store '%s' (expected memory or mmap:FILE)\n", value);
+            return -1;
+        }
+    } else if (strcmp(opt, "--store-block") == 0) {
+        o->block = atoi(value);
+        if (o->block < 1) {
+            fprintf(stderr, "Invalid store block: store_block=%d\n", o->block);
+            return -1;
+        }
+        o->block = (o->block + BAT_POP_LANES - 1) / BAT_POP_LANES * BAT_POP_LANES;
+    } else {
+        return 0;
+    }
+    (*i)++;
+    return 1;
+}
+
+static size_t page_size(void) {
+    long page = sysconf(_SC_PAGESIZE);
+    return page > 0 ? (size_t)page : 4096;
+}
+
+/* madvise() on the whole pages inside bytes [from, to) of the mapping. */
+static void advise(const BatStore *s, size_t from, size_t to, int advice, int inner) {
+    const size_t page = page_size();
+    /* Released ranges must not touch the neighbouring blocks: inner pages only */
+    if (inner) {
+        from = (from + page - 1) / page * page;
+        to = to / page * page;
+    } else {
+        from = from / page * page;
+        to = (to + page - 1) / page * page;
+        to = to < s->bytes ? to : s->bytes;
+    }
+    if (to > from) {
+        madvise(s->map + from, to - from, advice);
+    }
+}
+
+/* Maps the open file s->fd of s->bytes bytes and points at its parts. */
+static int map_file(BatStore *s, const BatStoreOptions *o, long n_bats, int dim) {
+    s->map = mmap(NULL, s->bytes, PROT_READ | PROT_WRITE, MAP_SHARED, s->fd, 0);
+    if (s->map == MAP_FAILED) {
+        s->map = NULL;
+        return -1;
+    }
+    s->best_x = (double *)(s->map + sizeof(BatCkptHeader));
+    s->records = (double *)(s->map + bat_ckpt_record_offset(dim, 0));
+    s->n_bats = n_bats;
+    s->dim = dim;
+    s->block = o->block;
+    madvise(s->map, s->bytes, MADV_SEQUENTIAL);
+
+    /* Out of core: the file does not comfortably fit in the physical memory */
+    const long pages = sysconf(_SC_PHYS_PAGES);
+    s->drop = pages > 0 && s->bytes > (size_t)pages / 2 * page_size();
+
+    return 0;
+}
+
+/* Explains why create refuses an existing file (the magic tells what it holds). */
+static void report_existing(const char *path) {
+    char magic[8] = { 0 };
+    int fd = open(path, O_RDONLY);
+    if (fd >= 0) {
+        if (pread(fd, magic, sizeof(magic), 0) < 0) {
+            memset(magic, 0, sizeof(magic));
+        }
+        close(fd);
+    }
+    if (memcmp(magic, BAT_CKPT_MAGIC, sizeof(magic)) == 0) {
+        fprintf(stderr, "%s holds a checkpoint: resume it with --restart %s, or remove it\n", path, path);
+    } else if (memcmp(magic, BAT_STORE_MAGIC, sizeof(magic)) == 0) {
+        fprintf(stderr, "%s is the store of an interrupted run (not restartable): remove it\n", path);
+    } else {
+        fprintf(stderr, "%s exists: the store is not written over another file\n", path);
+    }
+}
+
+int bat_store_create(BatStore *s, const BatStoreOptions *o, long n_bats, int dim) {
+    memset(s, 0, sizeof(*s));
+    s->bytes = bat_ckpt_record_offset(dim, n_bats);
+    s->fd = open(o->path, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (s->fd < 0) {
+        if (errno == EEXIST) {
+            report_existing(o->path);
+        } else {
+            perror(o->path);
+        }
+        return -1;
+    }
+    if (ftruncate(s->fd, (off_t)s->bytes) != 0 || map_file(s, o, n_bats, dim) != 0) {
+        perror(o->path);
+        close(s->fd);
+        unlink(o->path);
+        return -1;
+    }
+    /* A new file is not a checkpoint yet: the first sync point makes it one */
+    memcpy(s->map, BAT_STORE_MAGIC, sizeof(((BatCkptHeader *)0)->magic));
+    s->in_use = 1;
+    return 0;
+}
+
+int bat_store_resume(BatStore *s, const BatStoreOptions *o, long n_bats, int dim, const char *objective,
+                     int max_iters, BatCkptHeader *h) {
+    memset(s, 0, sizeof(*s));
+    s->bytes = bat_ckpt_record_offset(dim, n_bats);
+    s->fd = open(o->path, O_RDWR);
+    if (s->fd < 0) {
+        perror(o->path);
+        return -1;
+    }
+
+    struct stat st;
+    memset(h, 0, sizeof(*h));
+    if (fstat(s->fd, &st) != 0 || pread(s->fd, h, sizeof(*h), 0) < 0) {
+        perror(o->path);
+        close(s->fd);
+        return -1;
+    }
+    const char *mismatch = bat_ckpt_mismatch(h, n_bats, dim, objective, max_iters);
+    if (!mismatch && (size_t)st.st_size != s->bytes) {
+        mismatch = "truncated file";
+    }
+    if (mismatch) {
+        fprintf(stderr, "Cannot restart from %s: %s\n", o->path, mismatch);
+        close(s->fd);
+        return -1;
+    }
+    if (map_file(s, o, n_bats, dim) != 0) {
+        perror(o->path);
+        close(s->fd);
+        return -1;
+    }
+    return 0;
+}
+
+double *bat_store_block(BatStore *s, long begin, int n) {
+    long next = begin + n < s->n_bats ? begin + n : 0;
+    long next_end = next + s->block < s->n_bats ? next + s->block : s->n_bats;
+    advise(s, bat_ckpt_record_offset(s->dim, next), bat_ckpt_record_offset(s->dim, next_end), MADV_WILLNEED, 0);
+    return s->records + (size_t)begin * BAT_CKPT_RECORD(s->dim);
+}
+
+int bat_store_begin_update(BatStore *s) {
+    if (s->in_use) {
+        return 0;
+    }
+    /* On disk before any record changes: the last checkpoint is being overwritten */
+    memcpy(s->map, BAT_STORE_MAGIC, sizeof(((BatCkptHeader *)0)->magic));
+    if (msync(s->map, sizeof(BatCkptHeader), MS_SYNC) != 0) {
+        return -1;
+    }
+    s->in_use = 1;
+    return 0;
+}
+
+void bat_store_release(BatStore *s, long begin, int n) {
+    if (s->drop) {
+        advise(s, bat_ckpt_record_offset(s->dim, begin), bat_ckpt_record_offset(s->dim, begin + n), MADV_DONTNEED, 1);
+    }
+}
+
+int bat_store_sync(BatStore *s, const BatCkptHeader *h, const double *best_x) {
+    /* The header goes last: the file is a checkpoint only once the records are on disk */
+    memcpy(s->best_x, best_x, (size_t)s->dim * sizeof(double));
+    if (msync(s->map, s->bytes, MS_SYNC) != 0) {
+        return -1;
+    }
+    memcpy(s->map, h, sizeof(*h));
+    if (msync(s->map, sizeof(*h), MS_SYNC) != 0) {
+        return -1;
+    }
+    s->in_use = 0;
+    return 0;
+}
+
+int bat_store_close(BatStore *s, const BatCkptHeader *h, const double *best_x) {
+    int rc = bat_store_sync(s, h, best_x);
+
+    int err = errno;
+    munmap(s->map, s->bytes);
+    if (close(s->fd) != 0 && rc == 0) {
+        err = errno;
+        rc = -1;
+    }
+    s->map = NULL;
+    errno = err;
+    return rc;
+}
+
+static void on_signal(int sig) {
+    (void)sig;
+    interrupted = 1;
+}
+
+void bat_store_catch_signals(void) {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
+}
+
+int bat_store_interrupted(void) {
+    return interrupted;
+}
+
+void bat_store_print_bench(const BatStoreOptions *o, const BatStore *s) {
+    if (!o->path) {
+        return;
+    }
+    printf(" store=mmap store_block=%d store_bytes=%zu store_drop=%d", s->block, s->bytes, s->drop);
+}
@@ -0,0 +1,217 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bat_traj.h"
+
+/*
+ * bat_traj.c
+ *
+ * Purpose:
+ * Binary trajectory format (see bat_traj.h): options, header, conversion
+ * of the positions into frame rows, and the double-buffered background
+ * writer used by the sequential and OpenMP front-ends.
+ */
+
+void bat_traj_defaults(BatTrajOptions *o) {
+    o->path = NULL;
+    o->every = BAT_TRAJ_EVERY;
+    o->value_size = (int)sizeof(double);
+}
+
+int bat_traj_parse_option(BatTrajOptions *o, int argc, char **argv, int *i) {
+    const char *opt = argv[*i];
+
+    if (strcmp(opt, "--traj-float") == 0) {
+        o->value_size = (int)sizeof(float);
+        return 1;
+    }
+    if (*i + 1 >= argc) {
+        return 0;
+    }
+    if (strcmp(opt, "--traj") == 0) {
+        o->path = argv[*i + 1];
+    } else if (strcmp(opt, "--traj-every") == 0) {
+        o->every = atoi(argv[*i + 1]);
+    } else {
+        return 0;
+    }
+    (*i)++;
+    return 1;
+}
+
+void bat_traj_header_init(BatTrajHeader *h, const BatTrajOptions *o, long n_bats, int dim) {
+    memset(h, 0, sizeof(*h));
+    memcpy(h->magic, BAT_TRAJ_MAGIC, sizeof(h->magic));
+    h->version = BAT_TRAJ_VERSION;
+    h->value_size = (uint32_t)o->value_size;
+    h->n_bats = n_bats;
+    h->dim = dim;
+    h->every = o->every;
+}
+
+size_t bat_traj_row_size(const BatTrajHeader *h) {
+    return (size_t)h->dim * h->value_size;
+}
+
+size_t bat_traj_frame_size(const BatTrajHeader *h) {
+    return BAT_TRAJ_FRAME_HEAD + (size_t)h->n_bats * bat_traj_row_size(h);
+}
+
+/* Row i <- x[0 .. dim-1]. */
+static void store_row(void *rows, const BatTrajHeader *h, int i, const double *x, size_t stride) {
+    const int dim = h->dim;
+    if (h->value_size == sizeof(float)) {
+        float *row = (float *)rows + (size_t)i * dim;
+        for (int d = 0; d < dim; d++) {
+            row[d] = (float)x[d * stride];
+        }
+    } else {
+        double *row = (double *)rows + (size_t)i * dim;
+        for (int d = 0; d < dim; d++) {
+            row[d] = x[d * stride];
+        }
+    }
+}
+
+/* Same as store_row() from float positions (compact SoA store). */
+static void store_row_f(void *rows, const BatTrajHeader *h, int i, const float *x, size_t stride) {
+    const int dim = h->dim;
+    if (h->value_size == sizeof(float)) {
+        float *row = (float *)rows + (size_t)i * dim;
+        for (int d = 0; d < dim; d++) {
+            row[d] = x[d * stride];
+        }
+    } else {
+        double *row = (double *)rows + (size_t)i * dim;
+        for (int d = 0; d < dim; d++) {
+            row[d] = x[d * stride];
+        }
+    }
+}
+
+void bat_traj_store_bats(void *rows, const BatTrajHeader *h, const Bat bats[], int begin, int end) {
+    for (int i = begin; i < end; i++) {
+        store_row(rows, h, i, bats[i].x_i, 1);
+    }
+}
+
+void bat_traj_store_pop(void *rows, const BatTrajHeader *h, const BatPopulation *pop, int begin, int end) {
+    /* Inside a tile, coordinate d of a bat is BAT_POP_LANES values after d - 1 */
+    for (int i = begin; i < end; i++) {
+        if (pop->x) {
+            store_row(rows, h, i, pop->x + bat_pop_offset(pop->dim, i, 0), BAT_POP_LANES);
+        } else {
+            store_row_f(rows, h, i, pop->xf + bat_pop_offset(pop->dim, i, 0), BAT_POP_LANES);
+        }
+    }
+}
+
+/* Writer thread: writes the queued buffers in order until closed. */
+static void *writer_main(void *arg) {
+    BatTrajWriter *w = arg;
+    int next = 0;
+
+    pthread_mutex_lock(&w->lock);
+    for (;;) {
+        while (!w->queued[next] && !w->closing) {
+            pthread_cond_wait(&w->cond, &w->lock);
+        }
+        if (!w->queued[next]) {
+            break;
+        }
+        pthread_mutex_unlock(&w->lock);
+
+        int failed = fwrite(w->buf[next], w->frame_bytes, 1, w->fp) != 1;
+
+        pthread_mutex_lock(&w->lock);
+        w->error |= failed;
+        w->queued[next] = 0;
+        pthread_cond_broadcast(&w->cond);
+        next ^= 1;
+    }
+    pthread_mutex_unlock(&w->lock);
+    return NULL;
+}
+
+int bat_traj_open(BatTrajWriter *w, const BatTrajOptions *o, long n_bats, int dim) {
+    memset(w, 0, sizeof(*w));
+    bat_traj_header_init(&w->header, o, n_bats, dim);
+    w->frame_bytes = bat_traj_frame_size(&w->header);
+
+    w->fp = fopen(o->path, "wb");
+    if (!w->fp) {
+        return -1;
+    }
+    w->buf[0] = malloc(w->frame_bytes);
+    w->buf[1] = malloc(w->frame_bytes);
+    if (!w->buf[0] || !w->buf[1] || fwrite(&w->header, sizeof(w->header), 1, w->fp) != 1) {
+        int err = w->buf[1] ? errno : ENOMEM;
+        free(w->buf[0]);
+        free(w->buf[1]);
+        fclose(w->fp);
+        errno = err;
+        return -1;
+    }
+
+    pthread_mutex_init(&w->lock, NULL);
+    pthread_cond_init(&w->cond, NULL);
+    int rc = pthread_create(&w->thread, NULL, writer_main, w);
+    if (rc != 0) {
+        pthread_mutex_destroy(&w->lock);
+        pthread_cond_destroy(&w->cond);
+        free(w->buf[0]);
+        free(w->buf[1]);
+        fclose(w->fp);
+        errno = rc;
+        return -1;
+    }
+    return 0;
+}
+
+void *bat_traj_begin(BatTrajWriter *w) {
+    pthread_mutex_lock(&w->lock);
+    while (w->queued[w->fill]) {
+        pthread_cond_wait(&w->cond, &w->lock);
+    }
+    pthread_mutex_unlock(&w->lock);
+    return w->buf[w->fill] + BAT_TRAJ_FRAME_HEAD;
+}
+
+void bat_traj_commit(BatTrajWriter *w, int t) {
+    int64_t iteration = t;
+    memcpy(w->buf[w->fill], &iteration, sizeof(iteration));
+
+    pthread_mutex_lock(&w->lock);
+    w->queued[w->fill] = 1;
+    pthread_cond_broadcast(&w->cond);
+    pthread_mutex_unlock(&w->lock);
+
+    w->fill ^= 1;
+    w->frames++;
+}
+
+int bat_traj_close(BatTrajWriter *w) {
+    pthread_mutex_lock(&w->lock);
+    w->closing = 1;
+    pthread_cond_broadcast(&w->cond);
+    pthread_mutex_unlock(&w->lock);
+    pthread_join(w->thread, NULL);
+
+    int failed = w->error;
+    if (fclose(w->fp) != 0) {
+        failed = 1;
+    }
+    pthread_mutex_destroy(&w->lock);
+    pthread_cond_destroy(&w->cond);
+    free(w->buf[0]);
+    free(w->buf[1]);
+    return failed ? -1 : 0;
+}
+
+void bat_traj_print_bench(const BatTrajOptions *o, long frames) {
+    if (o->path) {
+        printf(" traj_every=%d traj_frames=%ld traj_value=%s", o->every, frames,
+               o->value_size == (int)sizeof(float) ? "float" : "double");
+    }
+}
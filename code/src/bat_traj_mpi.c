@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bat_traj_mpi.h"
+
+/*
+ * bat_traj_mpi.c
+ *
+ * Purpose:
+ * Double-buffered, non-blocking collective MPI-IO writer of the binary
+ * trajectory format (see bat_traj_mpi.h and bat_traj.h).
+ */
+
+static void check_io(int rc, const char *what, MPI_Comm comm) {
+    if (rc != MPI_SUCCESS) {
+        char msg[MPI_MAX_ERROR_STRING];
+        int len = 0;
+        MPI_Error_string(rc, msg, &len);
+        fprintf(stderr, "%s: %s\n", what, msg);
+        MPI_Abort(comm, 1);
+    }
+}
+
+/*
+ * Offset, size and datatype of this rank's part of a frame, for the block
+ * [begin, begin + local_n). The part is written as ONE element of a
+ * derived type (whole BAT_TRAJ_MPI_CHUNK blocks, then the rest in bytes):
+ * an int count of bytes would wrap above 2 GiB per rank.
+ */
+static void set_part(BatTrajMpiWriter *w, long begin, int local_n) {
+    size_t row = bat_traj_row_size(&w->header);
+    size_t head = (w->rank == 0) ? BAT_TRAJ_FRAME_HEAD : 0;
+    w->my_offset = (MPI_Offset)(BAT_TRAJ_FRAME_HEAD - head) + (MPI_Offset)begin * (MPI_Offset)row;
+    w->my_bytes = head + (size_t)local_n * row;
+
+    if (w->part != MPI_DATATYPE_NULL) {
+        MPI_Type_free(&w->part);
+    }
+    MPI_Datatype chunk;
+    MPI_Type_contiguous((int)BAT_TRAJ_MPI_CHUNK, MPI_BYTE, &chunk);
+    int lens[2] = { (int)(w->my_bytes / BAT_TRAJ_MPI_CHUNK), (int)(w->my_bytes % BAT_TRAJ_MPI_CHUNK) };
+    MPI_Aint displs[2] = { 0, (MPI_Aint)(w->my_bytes - w->my_bytes % BAT_TRAJ_MPI_CHUNK) };
+    MPI_Datatype types[2] = { chunk, MPI_BYTE };
+    MPI_Type_create_struct(2, lens, displs, types, &w->part);
+    MPI_Type_commit(&w->part);
+    MPI_Type_free(&chunk);
+}
+
+void bat_traj_mpi_open(BatTrajMpiWriter *w, MPI_Comm comm, const BatTrajOptions *o,
+                       long n_bats, int dim, long begin, int local_n) {
+    memset(w, 0, sizeof(*w));
+    w->comm = comm;
+    w->part = MPI_DATATYPE_NULL;
+    MPI_Comm_rank(comm, &w->rank);
+    bat_traj_header_init(&w->header, o, n_bats, dim);
+    w->frame_bytes = bat_traj_frame_size(&w->header);
+
+    /* Rank 0 writes the iteration number in front of the rows */
+    set_part(w, begin, local_n);
+
+    w->buf[0] = malloc(w->my_bytes);
+    w->buf[1] = malloc(w->my_bytes);
+    if (!w->buf[0] || !w->buf[1]) {
+        perror("malloc trajectory buffers");
+        MPI_Abort(comm, 1);
+    }
+    w->req[0] = w->req[1] = MPI_REQUEST_NULL;
+
+    check_io(MPI_File_open(comm, o->path, MPI_MODE_WRONLY | MPI_MODE_CREATE, MPI_INFO_NULL, &w->fh),
+             o->path, comm);
+    check_io(MPI_File_set_size(w->fh, 0), o->path, comm);
+    if (w->rank == 0) {
+        check_io(MPI_File_write_at(w->fh, 0, &w->header, (int)sizeof(w->header), MPI_BYTE, MPI_STATUS_IGNORE),
+                 o->path, comm);
+    }
+}
+
+void bat_traj_mpi_set_block(BatTrajMpiWriter *w, long begin, int local_n) {
+    MPI_Waitall(2, w->req, MPI_STATUSES_IGNORE);
+    set_part(w, begin, local_n);
+    for (int k = 0; k < 2; k++) {
+        free(w->buf[k]);
+        w->buf[k] = malloc(w->my_bytes);
+        if (!w->buf[k]) {
+            perror("malloc trajectory buffers");
+            MPI_Abort(w->comm, 1);
+        }
+    }
+}
+
+void *bat_traj_mpi_begin(BatTrajMpiWriter *w) {
+    /* The write posted two frames ago used this buffer */
+    MPI_Wait(&w->req[w->fill], MPI_STATUS_IGNORE);
+    return w->buf[w->fill] + ((w->rank == 0) ? BAT_TRAJ_FRAME_HEAD : 0);
+}
+
+void bat_traj_mpi_commit(BatTrajMpiWriter *w, int t) {
+    if (w->rank == 0) {
+        int64_t iteration = t;
+        memcpy(w->buf[w->fill], &iteration, sizeof(iteration));
+    }
+    MPI_Offset frame = (MPI_Offset)sizeof(BatTrajHeader) + (MPI_Offset)w->frames * (MPI_Offset)w->frame_bytes;
+    check_io(MPI_File_iwrite_at_all(w->fh, frame + w->my_offset, w->buf[w->fill], 1, w->part,
+                                    &w->req[w->fill]),
+             "MPI_File_iwrite_at_all", w->comm);
+    w->fill ^= 1;
+    w->frames++;
+}
+
+void bat_traj_mpi_close(BatTrajMpiWriter *w) {
+    MPI_Waitall(2, w->req, MPI_STATUSES_IGNORE);
+    check_io(MPI_File_close(&w->fh), "MPI_File_close", w->comm);
+    free(w->buf[0]);
+    free(w->buf[1]);
+    MPI_Type_free(&w->part);
+}
@@ -0,0 +1,123 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "bat_verify.h"
+
+/*
+ * bat_verify.c
+ *
+ * Purpose:
+ * Population checksums and the digest file of --verify (see bat_verify.h).
+ */
+
+void bat_verify_defaults(BatVerifyOptions *o) {
+    o->path = NULL;
+    o->every = BAT_VERIFY_EVERY;
+}
+
+int bat_verify_parse_option(BatVerifyOptions *o, int argc, char **argv, int *i) {
+    if (*i + 1 >= argc) {
+        return 0;
+    }
+    const char *opt = argv[*i];
+    const char *value = argv[*i + 1];
+
+    if (strcmp(opt, "--verify") == 0) {
+        o->path = value;
+    } else if (strcmp(opt, "--verify-every") == 0) {
+        o->every = atoi(value);
+    } else {
+        return 0;
+    }
+    (*i)++;
+    return 1;
+}
+
+/* splitmix64 finalizer. */
+static inline uint64_t mix64(uint64_t h) {
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+/* Folds the bit pattern of v into h. */
+static inline uint64_t mix_double(uint64_t h, double v) {
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    return mix64(h ^ bits);
+}
+
+uint64_t bat_verify_hash_bats(const Bat bats[], int begin, int end, long index_offset) {
+    uint64_t sum = 0;
+    for (int i = begin; i < end; i++) {
+        const Bat *b = &bats[i];
+        uint64_t h = mix64((uint64_t)(index_offset + i));
+        for (int d = 0; d < dimension; d++) {
+            h = mix_double(h, b->x_i[d]);
+            h = mix_double(h, b->v_i[d]);
+        }
+        h = mix_double(h, b->A_i);
+        h = mix_double(h, b->r_i);
+        h = mix_double(h, b->f_value);
+        sum += mix64(h ^ b->rng_state);
+    }
+    return sum;
+}
+
+uint64_t bat_verify_hash_pop(const BatPopulation *pop, int begin, int end) {
+    uint64_t sum = 0;
+    for (int i = begin; i < end; i++) {
+        uint64_t h = mix64((uint64_t)(pop->index_offset + i));
+        for (int d = 0; d < pop->dim; d++) {
+            size_t k = bat_pop_offset(pop->dim, i, d);
+            h = mix_double(h, bat_pop_x(pop, k));
+            h = mix_double(h, bat_pop_v(pop, k));
+        }
+        h = mix_double(h, bat_pop_A(pop, i));
+        h = mix_double(h, bat_pop_r(pop, i));
+        h = mix_double(h, pop->f_value[i]);
+        sum += mix64(h ^ pop->rng[i]);
+    }
+    return sum;
+}
+
+int bat_verify_open(BatVerifyWriter *w, const char *path, const char *version, long n_bats, int dim,
+                    unsigned int seed, const char *objective, const char *precision) {
+    w->dim = dim;
+    w->digests = 0;
+    w->fp = fopen(path, "w");
+    if (!w->fp) {
+        return -1;
+    }
+    fprintf(w->fp, "# BATVERIFY 1 version=%s n_bats=%ld dim=%d seed=%u objective=%s precision=%s\n",
+            version, n_bats, dim, seed, objective, precision);
+    return 0;
+}
+
+void bat_verify_write(BatVerifyWriter *w, int t, const BatStats *stats, const double best_x[], uint64_t checksum) {
+    fprintf(w->fp, "t=%d best=%.17g index=%ld A_sum=%.17g sum=%016llx x=", t, stats->best_value,
+            stats->best_index, stats->A_sum, (unsigned long long)checksum);
+    for (int d = 0; d < w->dim; d++) {
+        fprintf(w->fp, "%s%.17g", (d == 0 ? "" : ","), best_x[d]);
+    }
+    fputc('\n', w->fp);
+    w->digests++;
+}
+
+int bat_verify_close(BatVerifyWriter *w) {
+    int failed = ferror(w->fp);
+    if (fclose(w->fp) != 0) {
+        failed = 1;
+    }
+    w->fp = NULL;
+    return failed ? -1 : 0;
+}
+
+void bat_verify_print_bench(const BatVerifyOptions *o, long digests) {
+    if (o->path) {
+        printf(" verify_every=%d digests=%ld", o->every, digests);
+    }
+}
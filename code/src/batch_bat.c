@@ -0,0 +1,272 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+#include <omp.h>
+
+#include "bat.h"
+#include "bat_options.h"
+#include "bat_host.h"
+#include "bat_host_mpi.h"
+#include "bat_solver.h"
+#include "bat_batch.h"
+
+/*
+ * Batch version of the Bat Algorithm: many small independent runs.
+ *
+ * Idea:
+ * - Production jobs are often thousands of small optimizations (N_BATS
+ *   bats, different seeds, parameters or objectives). Splitting the bats of
+ *   one such run over threads (openmp_bat) costs more in barriers than it
+ *   gains; running whole runs concurrently has no synchronization at all.
+ * - The runs come from a spec file (--batch FILE, one run per line, see
+ *   bat_batch.h) or are --runs N copies of the command line with seeds
+ *   seed, seed + 1, ...
+ * - Every OpenMP thread of every rank owns one libbat solver handle
+ *   (bat_solver.h), allocated by the thread itself and reused by all its
+ *   runs, so a run costs no allocation (only a change of --n-bats / --dim
+ *   reallocates).
+ * - Dynamic load balancing: the index of the next run lives on rank 0 in
+ *   an MPI window. An idle thread takes the next --chunk K runs of its rank
+ *   with one MPI_Fetch_and_op (passive target, no receiver involvement);
+ *   fast threads and ranks simply take more runs. The threads of a rank
+ *   share its chunk and send one request at a time (MPI_THREAD_SERIALIZED).
+ * - A run gives exactly the result of `sequential --layout soa` with the
+ *   same options and seed.
+ *
+ * Output:
+ * - one RUN line per run as soon as it finishes (completion order; run=
+ *   is the index in the spec list), unless --quiet
+ * - one BENCH line with the aggregate throughput (runs=, runs_per_s=) and
+ *   the load imbalance (busiest worker / mean busy time)
+ */
+
+/* Default --runs without --batch. */
+#define BATCH_RUNS 100
+
+typedef struct {
+    const char *spec_path;  /* --batch FILE, NULL: --runs copies of the command line */
+    long runs;              /* --runs N */
+    int chunk;              /* --chunk K: runs taken per request to rank 0 */
+} BatchOptions;
+
+/* Shared run counter on rank 0 and the chunk this rank is working through. */
+typedef struct {
+    MPI_Win win;
+    long *counter;          /* window memory (one long on rank 0) */
+    long n_runs;
+    int chunk;
+    long next;              /* runs [next, end) taken but not started */
+    long end;
+} RunQueue;
+
+static void parse_args(int argc, char **argv, BatOptions *opt, BatchOptions *bo) {
+    bat_options_defaults(opt);
+    bo->spec_path = NULL;
+    bo->runs = BATCH_RUNS;
+    bo->chunk = 1;
+
+    for (int i = 1; i < argc; i++) {
+        int shared = bat_options_parse_option(opt, argc, argv, &i);
+        if (shared < 0) {
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        } else if (shared) {
+            /* options of all front-ends (bat_options.h): defaults of every run */
+        } else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            bo->spec_path = argv[++i];
+        } else if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            bo->runs = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--chunk") == 0 && i + 1 < argc) {
+            bo->chunk = atoi(argv[++i]);
+        }
+    }
+
+    bat_options_finish(opt);
+}
+
+/* Creates the counter (collective). */
+static void queue_open(RunQueue *q, long n_runs, int chunk, int rank) {
+    MPI_Win_allocate(rank == 0 ? (MPI_Aint)sizeof(long) : 0, (int)sizeof(long), MPI_INFO_NULL, MPI_COMM_WORLD,
+                     &q->counter, &q->win);
+    if (rank == 0) {
+        MPI_Win_lock(MPI_LOCK_EXCLUSIVE, 0, 0, q->win);
+        *q->counter = 0;
+        MPI_Win_unlock(0, q->win);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    q->n_runs = n_runs;
+    q->chunk = chunk;
+    q->next = q->end = 0;
+}
+
+/*
+ * Index of the next run of this rank, or -1 when all runs are taken.
+ * Called by one thread at a time.
+ */
+static long queue_next(RunQueue *q) {
+    if (q->next == q->end) {
+        long add = q->chunk;
+        long first;
+        MPI_Win_lock(MPI_LOCK_SHARED, 0, 0, q->win);
+        MPI_Fetch_and_op(&add, &first, MPI_LONG, 0, 0, MPI_SUM, q->win);
+        MPI_Win_unlock(0, q->win);
+        if (first >= q->n_runs) {
+            return -1;
+        }
+        q->next = first;
+        q->end = (first + q->chunk < q->n_runs) ? first + q->chunk : q->n_runs;
+    }
+    return q->next++;
+}
+
+/* RUN line of a finished run. */
+static void print_run(long k, const BatRunSpec *spec, const BatSolverResult *res, int rank, int thread) {
+    const BatOptions *o = &spec->opt;
+    printf("RUN run=%ld seed=%u objective=%s n_bats=%d dim=%d iters=%d best=%.10g time_s=%.6f rank=%d thread=%d",
+           k, o->seed, spec->objective->name, o->n_bats, o->dim, res->iters, res->best_value, res->time_s, rank, thread);
+    if (bat_stop_enabled(&o->stop)) {
+        printf(" stop=%s", bat_stop_reason_name(res->stop_reason));
+    }
+    printf(" x=");
+    for (int d = 0; d < o->dim; d++) {
+        printf("%s%.10g", (d == 0 ? "" : ","), res->best_x[d]);
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+int main(int argc, char *argv[]) {
+
+    /* Threads call MPI (the run counter), one at a time */
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_SERIALIZED, &provided);
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    if (provided < MPI_THREAD_SERIALIZED) {
+        if (rank == 0) {
+            fprintf(stderr, "The MPI library does not support MPI_THREAD_SERIALIZED\n");
+        }
+        MPI_Finalize();
+        return 1;
+    }
+
+    BatOptions opt;
+    BatchOptions bo;
+    parse_args(argc, argv, &opt, &bo);
+
+    /* The command line gives the defaults of every run; the solver works on SoA */
+    const BatObjective *obj;
+    opt.layout = BAT_LAYOUT_SOA;
+    if (bat_options_validate(&opt, rank == 0, &obj) != 0 || bat_batch_unsupported(&opt, rank == 0)) {
+        MPI_Finalize();
+        return 1;
+    }
+
+    if (bo.chunk < 1) {
+        if (rank == 0) {
+            fprintf(stderr, "Invalid chunk: chunk=%d\n", bo.chunk);
+        }
+        MPI_Finalize();
+        return 1;
+    }
+
+    /* Every rank reads the same list (same decision everywhere) */
+    BatBatch batch;
+    int rc = bo.spec_path ? bat_batch_load(&batch, bo.spec_path, &opt, rank == 0)
+                          : bat_batch_repeat(&batch, bo.runs, &opt, rank == 0);
+    if (rc != 0) {
+        MPI_Finalize();
+        return 1;
+    }
+
+    RunQueue queue;
+    queue_open(&queue, batch.n_runs, bo.chunk, rank);
+
+    const int threads = omp_get_max_threads();
+    long runs_done = 0;
+    double busy_sum = 0.0;
+    double busy_max = 0.0;
+    BatPlacement placement;
+    bat_placement_init(&placement);
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t0 = MPI_Wtime();
+
+    #pragma omp parallel reduction(+:runs_done, busy_sum) reduction(max:busy_max)
+    {
+        const int thread = omp_get_thread_num();
+        BatSolver solver;
+        int have_solver = 0;
+        double busy = 0.0;
+        #pragma omp critical(placement)
+        bat_placement_add_self(&placement);
+
+        for (;;) {
+            long k;
+            #pragma omp critical(batch_queue)
+            k = queue_next(&queue);
+            if (k < 0) {
+                break;
+            }
+
+            /* Same n_bats / dim / precision as the previous run: the workspace is reused as is */
+            const BatRunSpec *spec = &batch.runs[k];
+            BatSolverParams params = { spec->opt.n_bats, spec->opt.dim, spec->opt.max_iters, spec->opt.precision,
+                                       spec->opt.stop };
+            if ((have_solver ? bat_solver_set_params(&solver, &params) : bat_solver_alloc(&solver, &params)) != 0) {
+                #pragma omp critical(batch_queue)
+                {
+                    perror("alloc solver");
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+            }
+            have_solver = 1;
+
+            BatSolverResult res;
+            bat_solver_solve(&solver, spec->objective, (uint32_t)spec->opt.seed, &res);
+            busy += res.time_s;
+            runs_done++;
+
+            if (!opt.quiet) {
+                #pragma omp critical(batch_out)
+                print_run(k, spec, &res, rank, thread);
+            }
+        }
+
+        if (have_solver) {
+            bat_solver_free(&solver);
+        }
+        busy_sum += busy;
+        busy_max = busy;
+    }
+
+    double elapsed = MPI_Wtime() - t0;
+
+    /* Aggregate over ranks: the batch ends with the last rank */
+    long total_runs;
+    double max_elapsed, total_busy, max_busy;
+    MPI_Reduce(&runs_done, &total_runs, 1, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&elapsed, &max_elapsed, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&busy_sum, &total_busy, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&busy_max, &max_busy, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    bat_host_mpi_reduce(&placement, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        double mean_busy = total_busy / ((double)size * threads);
+        printf("BENCH version=batch n_bats=%d iters=%d procs=%d threads=%d time_s=%.6f dim=%d objective=%s runs=%ld runs_per_s=%.3f imbalance=%.3f" BAT_BUILD_BENCH,
+               opt.n_bats, opt.max_iters, size, threads, max_elapsed, opt.dim, obj->name, total_runs,
+               max_elapsed > 0.0 ? (double)total_runs / max_elapsed : 0.0,
+               mean_busy > 0.0 ? max_busy / mean_busy : 1.0);
+        bat_precision_print_bench(opt.precision, bat_pop_bytes_per_bat(opt.dim, opt.precision));
+        bat_placement_print_bench(&placement);
+        printf("\n");
+    }
+
+    MPI_Win_free(&queue.win);
+    bat_batch_free(&batch);
+    MPI_Finalize();
+    return 0;
+}
@@ -0,0 +1,599 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <omp.h>
+
+/* Called from the device kernels: same RNG, layout and loudness rounding as the CPU versions. */
+#pragma omp declare target
+#include "bat_rng.h"
+#include "bat_pop.h"
+#include "bat_stats.h"
+#pragma omp end declare target
+
+#include "bat.h"
+#include "bat_stop.h"
+#include "bat_traj.h"
+#include "bat_ckpt.h"
+#include "bat_verify.h"
+#include "bat_options.h"
+#include "bat_prof.h"
+#include "bat_host.h"
+
+/*
+ * GPU version of the Bat Algorithm (OpenMP target offload).
+ *
+ * Idea:
+ * - The SoA population (bat_pop.h) is built on the host, copied to the
+ *   device once, and stays there for the whole run: positions, velocities,
+ *   loudness, pulse rates, objective values and the per-bat RNG streams.
+ * - One device thread per bat performs exactly the draws of one lane of the
+ *   CPU block kernel (frequency, pulse, normals, loudness) on its own
+ *   xorshift stream, so the device computes the same trajectory as the
+ *   sequential version for the same seed.
+ * - The statistics of the next iteration are device reductions: the
+ *   loudness sum (exact terms, bat_stats.h), the pulse-rate sum and the best
+ *   value in the update kernel, then the smallest index holding the best
+ *   value (same tie-break as bat_stats_merge). A third kernel gathers the
+ *   best position; only the scalars and best_x (dim doubles) come back to
+ *   the host per iteration.
+ * - The host keeps the control flow: stopping criteria, progress output.
+ *   The whole population is only downloaded when a trajectory frame
+ *   (--traj), a digest (--verify) or a checkpoint (--checkpoint) is due.
+ * - No device function pointers: the built-in objectives are re-implemented
+ *   as incremental accumulators (one coordinate at a time, summed in the
+ *   same order as bat_objective.c). User and shared-object objectives are
+ *   rejected.
+ * - Without an offload compiler (or without a device at run time) the
+ *   target regions run on the host; the BENCH line reports which one ran.
+ */
+
+/* Built-in objectives available on the device. */
+typedef enum {
+    DEV_SPHERE = 0,
+    DEV_RASTRIGIN,
+    DEV_ROSENBROCK,
+    DEV_ACKLEY
+} DevObjective;
+
+/* Map a registered objective to its device implementation. Returns 0 on success, -1 if none. */
+static int dev_objective_find(const char *name, DevObjective *kind) {
+    static const char *names[] = { "sphere", "rastrigin", "rosenbrock", "ackley" };
+    for (int k = 0; k < (int)(sizeof(names) / sizeof(names[0])); k++) {
+        if (strcmp(names[k], name) == 0) {
+            *kind = (DevObjective)k;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+#pragma omp declare target
+
+/* Objective of one point, accumulated coordinate by coordinate (d = 0 .. dim-1). */
+typedef struct {
+    double s0;    /* main sum */
+    double s1;    /* second sum (ackley: cosines) */
+    double prev;  /* previous coordinate (rosenbrock) */
+    int k;        /* coordinates added so far */
+} ObjAcc;
+
+static inline void obj_begin(ObjAcc *a, DevObjective kind, int dim) {
+    a->s0 = (kind == DEV_RASTRIGIN) ? 10.0 * dim : 0.0;
+    a->s1 = 0.0;
+    a->prev = 0.0;
+    a->k = 0;
+}
+
+static inline void obj_add(ObjAcc *a, DevObjective kind, double x) {
+    switch (kind) {
+    case DEV_SPHERE:
+        a->s0 += x * x;
+        break;
+    case DEV_RASTRIGIN:
+        a->s0 += x * x - 10.0 * cos(2.0 * M_PI * x);
+        break;
+    case DEV_ROSENBROCK:
+        if (a->k > 0) {
+            double u = x - a->prev * a->prev;
+            double w = 1.0 - a->prev;
+            a->s0 += 100.0 * u * u + w * w;
+        }
+        a->prev = x;
+        break;
+    case DEV_ACKLEY:
+        a->s0 += x * x;
+        a->s1 += cos(2.0 * M_PI * x);
+        break;
+    }
+    a->k++;
+}
+
+static inline double obj_end(const ObjAcc *a, DevObjective kind, int dim) {
+    switch (kind) {
+    case DEV_SPHERE:
+        return 10.0 - a->s0;
+    case DEV_ACKLEY: {
+        double f = -20.0 * exp(-0.2 * sqrt(a->s0 / dim))
+                   - exp(a->s1 / dim) + 20.0 + M_E;
+        return -f;
+    }
+    default:
+        return -a->s0;
+    }
+}
+
+/*
+ * Standard normals of one bat, one at a time, in the order of
+ * bat_rng_normal_fill(): the cached spare first, then Box-Muller pairs.
+ * normal_end() keeps an unused second value of a pair as the new spare.
+ */
+typedef struct {
+    uint32_t state;
+    double spare;
+    double pending;
+    int has_pending;
+} NormalStream;
+
+static inline void normal_begin(NormalStream *ns, uint32_t state, double spare) {
+    ns->state = state;
+    ns->spare = spare;
+    ns->has_pending = 0;
+}
+
+static inline double normal_next(NormalStream *ns) {
+    if (!isnan(ns->spare)) {
+        double z = ns->spare;
+        ns->spare = BAT_RNG_NO_SPARE;
+        return z;
+    }
+    if (ns->has_pending) {
+        ns->has_pending = 0;
+        return ns->pending;
+    }
+    double z;
+    bat_rng_normal_pair(&ns->state, &z, &ns->pending);
+    ns->has_pending = 1;
+    return z;
+}
+
+static inline void normal_end(NormalStream *ns) {
+    if (ns->has_pending) {
+        ns->spare = ns->pending;
+        ns->has_pending = 0;
+    }
+}
+
+/* Coordinate d of the local-search candidate around the best (one normal drawn). */
+static inline double local_coord(NormalStream *ns, const double best_x[], int d, double A_mean) {
+    double xl = best_x[d] + 0.1 * normal_next(ns) * A_mean;
+    if (xl < Lb) xl = Lb;
+    if (xl > Ub) xl = Ub;
+    return xl;
+}
+
+#pragma omp end declare target
+
+/* Device copy of a population: the host pointers of its arrays and their lengths. */
+typedef struct {
+    double *x, *v, *A, *r, *f_value, *rng_spare;
+    uint32_t *rng;
+    double *best_x;
+    size_t coords;   /* entries of x / v */
+    size_t padded;   /* entries of the per-bat arrays */
+    int dim;
+} DevPop;
+
+static void dev_bind(DevPop *dp, const BatPopulation *pop, double *best_x) {
+    dp->x = pop->x;
+    dp->v = pop->v;
+    dp->A = pop->A;
+    dp->r = pop->r;
+    dp->f_value = pop->f_value;
+    dp->rng = pop->rng;
+    dp->rng_spare = pop->rng_spare;
+    dp->best_x = best_x;
+    dp->padded = (size_t)pop->n_tiles * BAT_POP_LANES;
+    dp->coords = dp->padded * (size_t)pop->dim;
+    dp->dim = pop->dim;
+}
+
+/* Bytes of a whole population + best_x (one transfer of dev_upload / dev_download). */
+static size_t dev_bytes(const DevPop *dp) {
+    return dp->coords * 2 * sizeof(double) + dp->padded * (4 * sizeof(double) + sizeof(uint32_t))
+           + (size_t)dp->dim * sizeof(double);
+}
+
+/* Allocate the device arrays and copy the population to the device. */
+static void dev_upload(const DevPop *dp) {
+    #pragma omp target enter data map(to: dp->x[0:dp->coords], dp->v[0:dp->coords], dp->A[0:dp->padded], \
+                                          dp->r[0:dp->padded], dp->f_value[0:dp->padded], dp->rng[0:dp->padded], \
+                                          dp->rng_spare[0:dp->padded], dp->best_x[0:dp->dim])
+}
+
+/* Copy the device population back into the host arrays (trajectory, digest, checkpoint). */
+static void dev_download(const DevPop *dp) {
+    #pragma omp target update from(dp->x[0:dp->coords], dp->v[0:dp->coords], dp->A[0:dp->padded], \
+                                   dp->r[0:dp->padded], dp->f_value[0:dp->padded], dp->rng[0:dp->padded], \
+                                   dp->rng_spare[0:dp->padded])
+}
+
+/* Release the device arrays (the host copy is left as it is). */
+static void dev_release(const DevPop *dp) {
+    #pragma omp target exit data map(release: dp->x[0:dp->coords], dp->v[0:dp->coords], dp->A[0:dp->padded], \
+                                              dp->r[0:dp->padded], dp->f_value[0:dp->padded], dp->rng[0:dp->padded], \
+                                              dp->rng_spare[0:dp->padded], dp->best_x[0:dp->dim])
+}
+
+/*
+ * One iteration on the device, then the reductions: on return `stats` holds
+ * the finalized statistics of the updated population and best_x (host and
+ * device) the position of its best bat.
+ *
+ * Parameters:
+ *   - dp     : device population (mapped by dev_upload)
+ *   - n      : number of bats
+ *   - kind   : device objective
+ *   - stats  : input, statistics of the previous iteration; output, new ones
+ *   - t      : current iteration index
+ *   - prof   : phase timers (update kernel / reductions)
+ */
+static void dev_step(const DevPop *dp, int n, DevObjective kind, BatStats *stats, int t, BatProf *prof) {
+    double *x = dp->x, *v = dp->v, *A = dp->A, *r = dp->r, *f = dp->f_value, *spare = dp->rng_spare;
+    uint32_t *rng = dp->rng;
+    double *best_x = dp->best_x;
+    const int dim = dp->dim;
+    const double A_mean = stats->A_mean;
+    const double r_new = R0 * (1.0 - exp(-GAMMA * t));
+
+    double A_sum = 0.0;
+    double r_sum = 0.0;
+    double best_value = -DBL_MAX;
+
+    /* Move, evaluate, local search and acceptance: one lane of update_tiles() per bat. */
+    #pragma omp target teams distribute parallel for map(tofrom: A_sum, r_sum, best_value) \
+                reduction(+: A_sum, r_sum) reduction(max: best_value)
+    for (int i = 0; i < n; i++) {
+        uint32_t s = rng[i];
+        double sp = spare[i];
+
+        /* 1. Random frequency in [F_MIN, F_MAX] */
+        const double fr = F_MIN + (F_MAX - F_MIN) * bat_rng_uniform01(&s);
+
+        /* 2-3. Velocity, position, clamp and objective of the moved bat */
+        ObjAcc acc;
+        obj_begin(&acc, kind, dim);
+        for (int d = 0; d < dim; d++) {
+            const size_t o = bat_pop_offset(dim, i, d);
+            const double vd = v[o] + (best_x[d] - x[o]) * fr;
+            double xn = x[o] + vd;
+            xn = (xn < Lb) ? Lb : xn;
+            xn = (xn > Ub) ? Ub : xn;
+            v[o] = vd;
+            x[o] = xn;
+            obj_add(&acc, kind, xn);
+        }
+        double f_new = obj_end(&acc, kind, dim);
+
+        /* 4. Optional local search: the candidate is regenerated if accepted */
+        const double rand_pulse = bat_rng_uniform01(&s);
+        int use_local = 0;
+        uint32_t s_local = s;
+        double sp_local = sp;
+        if (rand_pulse > r[i]) {
+            NormalStream ns;
+            normal_begin(&ns, s, sp);
+            obj_begin(&acc, kind, dim);
+            for (int d = 0; d < dim; d++) {
+                obj_add(&acc, kind, local_coord(&ns, best_x, d, A_mean));
+            }
+            normal_end(&ns);
+            s = ns.state;
+            sp = ns.spare;
+
+            const double f_local = obj_end(&acc, kind, dim);
+            if (f_local > f_new) {   /* we maximize */
+                f_new = f_local;
+                use_local = 1;
+            }
+        }
+
+        /* 5. Accept only if improved AND passes loudness test */
+        const double rand_loud = bat_rng_uniform01(&s);
+        if ((f_new > f[i]) && (rand_loud < A[i])) {
+            if (use_local) {
+                NormalStream ns;
+                normal_begin(&ns, s_local, sp_local);
+                for (int d = 0; d < dim; d++) {
+                    x[bat_pop_offset(dim, i, d)] = local_coord(&ns, best_x, d, A_mean);
+                }
+            }
+            f[i] = f_new;
+            A[i] *= ALPHA;
+            r[i] = r_new;
+        }
+        rng[i] = s;
+        spare[i] = sp;
+
+        A_sum += bat_stats_loudness_term(A[i]);
+        r_sum += r[i];
+        best_value = (f[i] > best_value) ? f[i] : best_value;
+    }
+    bat_prof_lap(prof, BAT_PROF_UPDATE);
+
+    /* Smallest index holding the best value (tie-break of bat_stats_merge) */
+    long best_index = n;
+    #pragma omp target teams distribute parallel for map(tofrom: best_index) reduction(min: best_index)
+    for (int i = 0; i < n; i++) {
+        if (f[i] == best_value && i < best_index) {
+            best_index = i;
+        }
+    }
+
+    /* No value above -DBL_MAX (NaN or -inf everywhere): bat 0, as bat_stats_better() */
+    if (best_index == n) {
+        best_index = 0;
+        #pragma omp target map(from: best_value)
+        best_value = f[0];
+    }
+
+    /* Gather the best position on the device, bring only it back */
+    #pragma omp target
+    for (int d = 0; d < dim; d++) {
+        best_x[d] = x[bat_pop_offset(dim, (int)best_index, d)];
+    }
+    #pragma omp target update from(best_x[0:dim])
+
+    bat_stats_reset(stats);
+    stats->A_sum = A_sum;
+    stats->r_sum = r_sum;
+    stats->count = n;
+    stats->best_value = best_value;
+    stats->best_index = best_index;
+    bat_stats_finalize(stats);
+    bat_prof_lap(prof, BAT_PROF_REDUCE);
+}
+
+/* 1 if target regions run on an accelerator, 0 if they fall back to the host. */
+static int dev_on_accelerator(void) {
+    int on_device = 0;
+    #pragma omp target map(from: on_device)
+    on_device = !omp_is_initial_device();
+    return on_device;
+}
+
+int main(int argc, char **argv) {
+
+    BatOptions opt;
+    const BatObjective *obj;
+    if (bat_options_parse(&opt, argc, argv) != 0) {
+        return 1;
+    }
+    /* The device works on the SoA store only */
+    opt.layout = BAT_LAYOUT_SOA;
+    if (bat_options_validate(&opt, 1, &obj) != 0) {
+        return 1;
+    }
+    if (opt.precision != BAT_PRECISION_DOUBLE) {
+        fprintf(stderr, "gpu_bat computes in double only (--precision %s)\n", bat_precision_name(opt.precision));
+        return 1;
+    }
+
+    DevObjective kind;
+    if (dev_objective_find(obj->name, &kind) != 0) {
+        fprintf(stderr, "objective '%s' is not available on the device (built-ins only)\n", obj->name);
+        return 1;
+    }
+
+    const int n_bats = opt.n_bats;
+    const int max_iters = opt.max_iters;
+    const unsigned int seed = opt.seed;
+    const int dim = opt.dim;
+    const BatStopCriteria *stop = &opt.stop;
+    const BatTrajOptions *traj = &opt.traj;
+    const BatCkptOptions *ckpt = &opt.ckpt;
+    const BatVerifyOptions *verify = &opt.verify;
+
+    BatPopulation pop;
+    if (bat_pop_alloc(&pop, n_bats, dim, BAT_PRECISION_DOUBLE) != 0) {
+        perror("alloc population");
+        return 1;
+    }
+
+    double *best_x = malloc((size_t)dim * sizeof(double));
+    double *ckpt_records = NULL;
+    if (ckpt->path || ckpt->restart) {
+        ckpt_records = malloc((size_t)n_bats * BAT_CKPT_RECORD(dim) * sizeof(double));
+    }
+    if (!best_x || ((ckpt->path || ckpt->restart) && !ckpt_records)) {
+        perror("malloc best/records");
+        free(best_x);
+        free(ckpt_records);
+        bat_pop_free(&pop);
+        return 1;
+    }
+
+    BatProf prof;
+    bat_prof_begin(&prof);
+
+    /* Initial (or restored) population on the host, then statistics and best */
+    BatStats stats;
+    BatStopState stop_state;
+    int t_start = 0;
+    bat_pop_init_seeded(&pop, (uint32_t)seed, 0, obj, NULL);
+    if (ckpt->restart) {
+        BatCkptHeader h;
+        if (bat_ckpt_restore(ckpt->restart, n_bats, dim, obj->name, max_iters, &h, best_x, ckpt_records) != 0) {
+            free(best_x);
+            free(ckpt_records);
+            bat_pop_free(&pop);
+            return 1;
+        }
+        bat_ckpt_load_pop(ckpt_records, &pop, 0, n_bats);
+        bat_ckpt_header_restore(&h, &stats, &stop_state);
+        t_start = (int)h.iteration;
+    } else {
+        bat_stats_reset(&stats);
+        bat_pop_stats(&pop, 0, pop.n_tiles, &stats);
+        bat_stats_finalize(&stats);
+        bat_pop_get_x(&pop, (int)stats.best_index, best_x);
+        bat_stop_init(&stop_state, stats.best_value);
+    }
+
+    BatVerifyWriter vw;
+    if (verify->path && bat_verify_open(&vw, verify->path, "gpu", n_bats, dim, seed, obj->name, "double") != 0) {
+        perror(verify->path);
+        free(best_x);
+        free(ckpt_records);
+        bat_pop_free(&pop);
+        return 1;
+    }
+
+    BatTrajWriter tw;
+    if (traj->path && bat_traj_open(&tw, traj, n_bats, dim) != 0) {
+        perror(traj->path);
+        if (verify->path) {
+            bat_verify_close(&vw);
+        }
+        free(best_x);
+        free(ckpt_records);
+        bat_pop_free(&pop);
+        return 1;
+    }
+
+    /* The population moves to the device once and stays there */
+    const int on_accel = dev_on_accelerator();
+    DevPop dp;
+    dev_bind(&dp, &pop, best_x);
+    dev_upload(&dp);
+    size_t h2d_bytes = dev_bytes(&dp);
+    size_t d2h_bytes = 0;
+    const size_t step_bytes = (size_t)dim * sizeof(double) + 3 * sizeof(double) + sizeof(long);
+
+    BatStopReason stop_reason = BAT_STOP_NONE;
+    int iters_done = max_iters;
+    int ckpt_written = 0;
+    int ckpt_last = -1;
+    int rc = 0;
+
+    bat_prof_lap(&prof, BAT_PROF_INIT);
+    double t0 = omp_get_wtime();
+
+    for (int t = t_start; t < max_iters; t++) {
+
+        /* Iteration t on the device; the new statistics and best come back */
+        dev_step(&dp, n_bats, kind, &stats, t, &prof);
+        d2h_bytes += step_bytes;
+
+        /* Whole-population outputs: one download serves all of them */
+        const int verify_due = bat_verify_due(verify, t);
+        if (bat_traj_due(traj, t) || verify_due) {
+            dev_download(&dp);
+            d2h_bytes += dev_bytes(&dp) - (size_t)dim * sizeof(double);
+        }
+
+        if (bat_traj_due(traj, t)) {
+            bat_traj_store_pop(bat_traj_begin(&tw), &tw.header, &pop, 0, n_bats);
+            bat_traj_commit(&tw, t);
+        }
+
+        if (verify_due) {
+            bat_verify_write(&vw, t, &stats, best_x, bat_verify_hash_pop(&pop, 0, n_bats));
+        }
+
+        if (!opt.quiet && t % 100 == 0) {
+            printf("[Iter %d] Best f_value = %f\n", t, stats.best_value);
+        }
+        bat_prof_lap(&prof, BAT_PROF_IO);
+
+        if (bat_stop_due(stop, t)) {
+            stop_reason = bat_stop_check(stop, &stop_state, t, stats.best_value,
+                                         bat_stop_time_up(stop, omp_get_wtime() - t0));
+            if (stop_reason != BAT_STOP_NONE) {
+                iters_done = t + 1;
+                break;
+            }
+        }
+        bat_prof_lap(&prof, BAT_PROF_REDUCE);
+
+        if (bat_ckpt_due(ckpt, t)) {
+            if (!bat_traj_due(traj, t) && !verify_due) {
+                dev_download(&dp);
+                d2h_bytes += dev_bytes(&dp) - (size_t)dim * sizeof(double);
+            }
+            if (bat_ckpt_save_pop(ckpt, ckpt_records, &pop, best_x, t + 1, seed, &stats, &stop_state) == 0) {
+                ckpt_written++;
+            } else {
+                rc = 1;
+            }
+            ckpt_last = t + 1;
+        }
+        bat_prof_lap(&prof, BAT_PROF_IO);
+    }
+
+    /* Charges the stop check of the last iteration (if the loop broke) */
+    bat_prof_lap(&prof, BAT_PROF_REDUCE);
+
+    double elapsed = omp_get_wtime() - t0;
+
+    /* Final state, so that the run can be extended with a larger --iters */
+    if (ckpt->path && ckpt_last != iters_done) {
+        dev_download(&dp);
+        d2h_bytes += dev_bytes(&dp) - (size_t)dim * sizeof(double);
+        if (bat_ckpt_save_pop(ckpt, ckpt_records, &pop, best_x, iters_done, seed, &stats, &stop_state) == 0) {
+            ckpt_written++;
+        } else {
+            rc = 1;
+        }
+    }
+    dev_release(&dp);
+    bat_prof_lap(&prof, BAT_PROF_IO);
+    bat_prof_end(&prof);
+
+    if (traj->path && bat_traj_close(&tw) != 0) {
+        fprintf(stderr, "Writing the trajectory %s failed\n", traj->path);
+        rc = 1;
+    }
+
+    if (verify->path && bat_verify_close(&vw) != 0) {
+        fprintf(stderr, "Writing the digests %s failed\n", verify->path);
+        rc = 1;
+    }
+
+    if (!opt.quiet) {
+        if (stop_reason != BAT_STOP_NONE) {
+            printf("\nStopped after %d iterations (%s)", iters_done, bat_stop_reason_name(stop_reason));
+        }
+        printf("\nFinal best f_value = %f\n", stats.best_value);
+        printf("Final position = (");
+        for (int d = 0; d < dim; d++) {
+            printf("%s%f", (d == 0 ? "" : ", "), best_x[d]);
+        }
+        printf(")\n");
+    }
+
+    BatProfSummary prof_sum;
+    bat_prof_summary_init(&prof_sum);
+    bat_prof_summary_add(&prof_sum, &prof);
+
+    printf("BENCH version=gpu n_bats=%d iters=%d procs=1 threads=1 time_s=%.6f layout=soa dim=%d kernel=target objective=%s"
+           " device=%s h2d_bytes=%zu d2h_bytes=%zu" BAT_BUILD_BENCH,
+           n_bats, max_iters, elapsed, dim, obj->name, on_accel ? "accel" : "host", h2d_bytes, d2h_bytes);
+    bat_precision_print_bench(BAT_PRECISION_DOUBLE, bat_pop_bytes_per_bat(dim, BAT_PRECISION_DOUBLE));
+    bat_stop_print_bench(stop, iters_done, stop_reason);
+    bat_traj_print_bench(traj, traj->path ? tw.frames : 0);
+    bat_ckpt_print_bench(ckpt, t_start, ckpt_written);
+    bat_verify_print_bench(verify, verify->path ? vw.digests : 0);
+    bat_prof_print_bench(&prof_sum);
+    BatPlacement placement;
+    bat_placement_init(&placement);
+    bat_placement_add_self(&placement);
+    bat_placement_print_bench(&placement);
+    printf("\n");
+
+    free(best_x);
+    free(ckpt_records);
+    bat_pop_free(&pop);
+    return rc;
+}
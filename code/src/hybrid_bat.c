@@ -0,0 +1,652 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include <mpi.h>
+#include <omp.h>
+
+#include "bat.h"
+#include "bat_utils.h"
+#include "bat_stats.h"
+#include "bat_pop.h"
+#include "bat_best_record.h"
+#include "bat_stop.h"
+#include "bat_traj.h"
+#include "bat_traj_mpi.h"
+#include "bat_ckpt.h"
+#include "bat_ckpt_mpi.h"
+#include "bat_verify.h"
+#include "bat_options.h"
+#include "bat_prof.h"
+#include "bat_prof_mpi.h"
+#include "bat_host.h"
+#include "bat_host_mpi.h"
+
+/*
+ * Hybrid MPI + OpenMP version of the Bat Algorithm.
+ *
+ * Idea:
+ * - Run one MPI rank per node (or per socket) and OpenMP threads inside
+ *   each rank, instead of one rank per core.
+ * - Each rank owns a contiguous slice of the global population
+ *   (bat_partition, sizes may differ by one) and initializes it itself
+ *   (every bat only depends on (seed, global index)), in parallel, with the
+ *   same static partition as the update loop (first touch on the owner's
+ *   NUMA node).
+ * - Each rank runs ONE persistent parallel region, as in openmp_bat.c.
+ *   Every iteration:
+ *     1. threads update their static share of the local bats and
+ *        accumulate partial statistics in padded per-thread slots
+ *     2. level 1 reduction: the master thread merges the slots (thread
+ *        best -> rank best, as a (value, index) pair)
+ *     3. level 2 reduction: the master thread runs the fused exchange
+ *        (bat_best_record.h), ONE MPI_Allreduce over the ranks
+ * - Only the master thread calls MPI (MPI_THREAD_FUNNELED), so each
+ *   collective has `procs` participants instead of `procs * threads`.
+ *
+ * Same seed => same trajectory as mpi_bat / sequential, for any number of
+ * ranks and threads.
+ *
+ * The stopping criteria (bat_stop.h) are evaluated by the master thread on
+ * the reduced record (the wall-clock votes of the ranks are summed by the
+ * same Allreduce) and published to the other threads by the barrier that
+ * follows the exchange.
+ *
+ * --traj FILE: the master thread copies the rank's positions into a frame
+ * buffer and posts the collective MPI-IO write (bat_traj_mpi.h), which
+ * completes in the background.
+ *
+ * --checkpoint / --restart (bat_ckpt.h): the master thread reads the
+ * rank's block of the file before the parallel region (the threads load
+ * it with the first-touch partition) and writes the checkpoints with
+ * collective MPI-IO (bat_ckpt_mpi.h), after the stop check.
+ *
+ * --verify FILE (bat_verify.h): every thread adds the checksum of the bats
+ * it just updated to its slot; the master thread sums the slots, reduces
+ * the rank checksums to rank 0 (MPI_Reduce) and rank 0 writes the digest
+ * with the global best of the fused exchange.
+ *
+ * `make PROFILE=1`: every thread of every rank times its phases
+ * (bat_prof.h); the master's comm phase is the Allreduce, the other
+ * threads wait for it at the barrier that follows.
+ */
+
+/* Partial statistics of one thread, alone on its cache line(s). */
+typedef struct {
+    BatStats s;
+    uint64_t verify_sum;    /* checksum of this thread's bats (--verify) */
+} __attribute__((aligned(64))) ThreadSlot;
+
+/* Allocate one ThreadSlot per thread (cache-line aligned). */
+static ThreadSlot *alloc_slots(int threads) {
+    void *p = NULL;
+    if (posix_memalign(&p, 64, (size_t)threads * sizeof(ThreadSlot)) != 0) {
+        return NULL;
+    }
+    return p;
+}
+
+/* Level 1: merges the per-thread slots in thread order (rank-local sums and best). */
+static void merge_slots(const ThreadSlot slots[], int threads, BatStats *out) {
+    bat_stats_reset(out);
+    for (int k = 0; k < threads; k++) {
+        bat_stats_merge(out, &slots[k].s);
+    }
+}
+
+/*
+ * --verify (master thread, collective): sums the per-thread checksums, reduces
+ * them over the ranks and writes the digest of iteration t on rank 0.
+ *
+ * Parameters:
+ *   - vw      : digest writer (open on rank 0)
+ *   - t       : iteration index
+ *   - slots   : per-thread checksums
+ *   - threads : number of threads of the parallel region
+ *   - stats   : global statistics and best after the exchange
+ *   - best_x  : position of the global best
+ *   - rank    : rank of this process
+ */
+static void verify_digest(BatVerifyWriter *vw, int t, const ThreadSlot slots[], int threads, const BatStats *stats,
+                          const double *best_x, int rank) {
+    uint64_t local_sum = 0;
+    for (int k = 0; k < threads; k++) {
+        local_sum += slots[k].verify_sum;
+    }
+    uint64_t sum = 0;
+    MPI_Reduce(&local_sum, &sum, 1, MPI_UINT64_T, MPI_SUM, 0, MPI_COMM_WORLD);
+    if (rank == 0) {
+        bat_verify_write(vw, t, stats, best_x, sum);
+    }
+}
+
+/* Rank 0 creates the digest file of --verify (other ranks get an empty writer). Aborts on error. */
+static void verify_open(BatVerifyWriter *vw, const BatVerifyOptions *verify, int rank, int n_bats, int dim,
+                        unsigned int seed, const char *objective, BatPrecision precision) {
+    memset(vw, 0, sizeof(*vw));
+    if (verify->path && rank == 0 &&
+        bat_verify_open(vw, verify->path, "hybrid", n_bats, dim, seed, objective, bat_precision_name(precision)) != 0) {
+        perror(verify->path);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+}
+
+/* Rank 0 closes the digest file. Returns 1 if a write failed, 0 otherwise. */
+static int verify_close(BatVerifyWriter *vw, const BatVerifyOptions *verify, int rank) {
+    if (verify->path && rank == 0 && bat_verify_close(vw) != 0) {
+        fprintf(stderr, "Writing the digests %s failed\n", verify->path);
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * Evaluates the stopping criteria after iteration t (master thread, after
+ * the exchange). A reason other than BAT_STOP_NONE ends the loop of every
+ * thread once the following barrier is passed.
+ */
+static void check_stop(const BatStopCriteria *stop, BatStopState *state, int t, const BatStats *stats,
+                       BatStopReason *reason, int *iters_done) {
+    if (!bat_stop_due(stop, t)) {
+        return;
+    }
+    *reason = bat_stop_check(stop, state, t, stats->best_value, stats->stop_votes > 0.0);
+    if (*reason != BAT_STOP_NONE) {
+        *iters_done = t + 1;
+    }
+}
+
+/* Local checkpoint records (local_n of them), NULL if neither --checkpoint nor --restart. Aborts if out of memory. */
+static double *alloc_ckpt_records(const BatCkptOptions *ckpt, int local_n, int dim) {
+    if (!ckpt->path && !ckpt->restart) {
+        return NULL;
+    }
+    double *records = malloc((size_t)local_n * BAT_CKPT_RECORD(dim) * sizeof(double));
+    if (!records) {
+        perror("malloc checkpoint records");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    return records;
+}
+
+/* Collective: stops the timer started at t0; the slowest rank's time (result on rank 0). */
+static double elapsed_since(double t0) {
+    MPI_Barrier(MPI_COMM_WORLD);
+    double local_elapsed = MPI_Wtime() - t0;
+    double elapsed = 0.0;
+    MPI_Reduce(&local_elapsed, &elapsed, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    return elapsed;
+}
+
+/*
+ * Final report and BENCH line (rank 0); kernel is NULL for the AoS layout,
+ * precision is the one of the SoA store.
+ * Completes the trajectory (tw); elapsed comes from elapsed_since().
+ * prof holds the timers of the rank's threads and placement their CPU
+ * masks; both are reduced over the ranks here (collective).
+ */
+static void report(int rank, int size, int threads, int n_bats, int max_iters, int quiet, int dim,
+                   const char *kernel, BatPrecision precision, const BatObjective *obj, double best_value, const double *best_x,
+                   double elapsed, const BatStopCriteria *stop, int iters_done, BatStopReason stop_reason,
+                   const BatTrajOptions *traj, BatTrajMpiWriter *tw,
+                   const BatCkptOptions *ckpt, int restart_iter, int ckpt_written,
+                   const BatVerifyOptions *verify, long digests, BatProfSummary *prof, BatPlacement *placement) {
+    if (traj->path) {
+        bat_traj_mpi_close(tw);
+    }
+    bat_prof_mpi_reduce(prof, MPI_COMM_WORLD);
+    bat_host_mpi_reduce(placement, MPI_COMM_WORLD);
+
+    if (rank != 0) {
+        return;
+    }
+    if (!quiet) {
+        if (stop_reason != BAT_STOP_NONE) {
+            printf("\nStopped after %d iterations (%s)", iters_done, bat_stop_reason_name(stop_reason));
+        }
+        printf("\nFinal best f_value = %f\n", best_value);
+        printf("Final position = (");
+        for (int d = 0; d < dim; d++) {
+            printf("%s%f", d == 0 ? "" : ", ", best_x[d]);
+        }
+        printf(")\n");
+    }
+    printf("BENCH version=hybrid n_bats=%d iters=%d procs=%d threads=%d time_s=%.6f layout=%s dim=%d" BAT_BUILD_BENCH,
+           n_bats, max_iters, size, threads, elapsed, kernel ? "soa" : "aos", dim);
+    if (kernel) {
+        printf(" kernel=%s", kernel);
+    }
+    printf(" objective=%s exchange=fused", obj->name);
+    bat_precision_print_bench(precision, kernel ? bat_pop_bytes_per_bat(dim, precision) : sizeof(Bat));
+    bat_stop_print_bench(stop, iters_done, stop_reason);
+    bat_traj_print_bench(traj, traj->path ? tw->frames : 0);
+    bat_ckpt_print_bench(ckpt, restart_iter, ckpt_written);
+    bat_verify_print_bench(verify, digests);
+    bat_prof_print_bench(prof);
+    bat_placement_print_bench(placement);
+    printf("\n");
+}
+
+/*
+ * Main loop on the SoA population store: the rank's tiles are split
+ * statically between its threads.
+ */
+static int run_soa(int rank, int size, int n_bats, int max_iters, unsigned int seed, int quiet, int dim,
+                   BatPrecision precision, const BatObjective *obj, const BatStopCriteria *stop, const BatTrajOptions *traj,
+                   const BatCkptOptions *ckpt, const BatCkptHeader *restart, const BatVerifyOptions *verify) {
+    long begin;
+    int local_n;
+    bat_partition(n_bats, size, rank, &begin, &local_n);
+
+    BatPopulation pop;
+    if (bat_pop_alloc(&pop, local_n, dim, precision) != 0) {
+        perror("alloc population");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    const int threads = omp_get_max_threads();
+    double *best_x = malloc((size_t)dim * sizeof(double));
+    double *local_x = malloc((size_t)dim * sizeof(double));
+    ThreadSlot *slots = alloc_slots(threads);
+    if (!best_x || !local_x || !slots) {
+        perror("malloc best/slots");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    BatBestRecord br;
+    bat_best_record_init(&br, MPI_COMM_WORLD, dim);
+
+    /* Bats [begin, begin + local_n) of the global population */
+    bat_pop_init_begin(&pop, begin, obj);
+
+    /* Restart: read this rank's block now (MPI), load it in the parallel region */
+    double *ckpt_records = alloc_ckpt_records(ckpt, local_n, dim);
+    int t_start = 0;
+    if (ckpt->restart) {
+        bat_ckpt_mpi_read(MPI_COMM_WORLD, ckpt->restart, restart, best_x, ckpt_records, begin, local_n);
+        t_start = (int)restart->iteration;
+    }
+    int ckpt_written = 0;
+    int ckpt_last = -1;
+
+    BatTrajMpiWriter tw;
+    if (traj->path) {
+        bat_traj_mpi_open(&tw, MPI_COMM_WORLD, traj, n_bats, dim, begin, local_n);
+    }
+
+    BatVerifyWriter vw;
+    verify_open(&vw, verify, rank, n_bats, dim, seed, obj->name, precision);
+
+    BatStats stats;
+    double best_value = 0.0;
+    double t0 = 0.0;
+    BatStopState stop_state;
+    BatStopReason stop_reason = BAT_STOP_NONE;
+    int iters_done = max_iters;
+    BatProfSummary prof_sum;
+    bat_prof_summary_init(&prof_sum);
+    BatPlacement placement;
+    bat_placement_init(&placement);
+
+    #pragma omp parallel
+    {
+        const int tid = omp_get_thread_num();
+        BatProf prof;
+        bat_prof_begin(&prof);
+        #pragma omp critical(placement)
+        bat_placement_add_self(&placement);
+        double *scratch = malloc(bat_pop_scratch_size(dim) * sizeof(double));
+        if (!scratch) {
+            perror("malloc scratch");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+
+        /* Parallel first touch, same static partition as the update loop */
+        #pragma omp for schedule(static)
+        for (int tile = 0; tile < pop.n_tiles; tile++) {
+            bat_pop_init_tiles(&pop, (uint32_t)seed, tile, tile + 1, scratch);
+            if (ckpt->restart) {
+                int end = (tile + 1) * BAT_POP_LANES < local_n ? (tile + 1) * BAT_POP_LANES : local_n;
+                bat_ckpt_load_pop(ckpt_records + (size_t)tile * BAT_POP_LANES * BAT_CKPT_RECORD(dim), &pop,
+                                  tile * BAT_POP_LANES, end);
+            }
+        }
+
+        /* Global statistics and best of the initial (or restored) population */
+        #pragma omp master
+        {
+            if (ckpt->restart) {
+                bat_ckpt_header_restore(restart, &stats, &stop_state);
+                best_value = stats.best_value;
+            } else {
+                bat_stats_reset(&stats);
+                bat_pop_stats(&pop, 0, pop.n_tiles, &stats);
+                bat_pop_get_x(&pop, (int)(stats.best_index - pop.index_offset), local_x);
+                best_value = bat_best_exchange(&br, &stats, local_x, best_x);
+                bat_stop_init(&stop_state, best_value);
+            }
+
+            MPI_Barrier(MPI_COMM_WORLD);
+            t0 = MPI_Wtime();
+        }
+        #pragma omp barrier
+        bat_prof_lap(&prof, BAT_PROF_INIT);
+
+        for (int t = t_start; t < max_iters && stop_reason == BAT_STOP_NONE; t++) {
+
+            /* Phase 1: update this thread's tiles (best_x / stats are read-only) */
+            const int verify_due = bat_verify_due(verify, t);
+            bat_stats_reset(&slots[tid].s);
+            slots[tid].verify_sum = 0;
+            #pragma omp for schedule(static) nowait
+            for (int tile = 0; tile < pop.n_tiles; tile++) {
+                bat_pop_update(&pop, tile, tile + 1, best_x, &stats, &slots[tid].s, t, scratch);
+                if (verify_due) {
+                    int end = (tile + 1) * BAT_POP_LANES < local_n ? (tile + 1) * BAT_POP_LANES : local_n;
+                    slots[tid].verify_sum += bat_verify_hash_pop(&pop, tile * BAT_POP_LANES, end);
+                }
+            }
+            bat_prof_lap(&prof, BAT_PROF_UPDATE);
+            #pragma omp barrier
+            bat_prof_lap(&prof, BAT_PROF_WAIT);
+
+            /* Phase 2: threads -> rank (slots), then ranks -> global (MPI) */
+            #pragma omp master
+            {
+                merge_slots(slots, omp_get_num_threads(), &stats);
+                if (bat_stop_due(stop, t)) {
+                    stats.stop_votes = bat_stop_time_up(stop, MPI_Wtime() - t0);
+                }
+                bat_pop_get_x(&pop, (int)(stats.best_index - pop.index_offset), local_x);
+                bat_prof_lap(&prof, BAT_PROF_REDUCE);
+                best_value = bat_best_exchange(&br, &stats, local_x, best_x);
+                bat_prof_lap(&prof, BAT_PROF_COMM);
+
+                if (!quiet && rank == 0 && t % 1000 == 0) {
+                    printf("[Iter %d] Global best = %f\n", t, best_value);
+                }
+                if (bat_traj_due(traj, t)) {
+                    bat_traj_store_pop(bat_traj_mpi_begin(&tw), &tw.header, &pop, 0, local_n);
+                    bat_traj_mpi_commit(&tw, t);
+                }
+                if (verify_due) {
+                    verify_digest(&vw, t, slots, omp_get_num_threads(), &stats, best_x, rank);
+                }
+                bat_prof_lap(&prof, BAT_PROF_IO);
+                check_stop(stop, &stop_state, t, &stats, &stop_reason, &iters_done);
+                bat_prof_lap(&prof, BAT_PROF_REDUCE);
+
+                if (stop_reason == BAT_STOP_NONE && bat_ckpt_due(ckpt, t)) {
+                    bat_ckpt_store_pop(ckpt_records, &pop, 0, local_n);
+                    bat_ckpt_mpi_save(MPI_COMM_WORLD, ckpt, ckpt_records, n_bats, dim, t + 1, seed, &stats,
+                                      best_value, &stop_state, obj->name, best_x, begin, local_n);
+                    ckpt_written++;
+                    ckpt_last = t + 1;
+                }
+                bat_prof_lap(&prof, BAT_PROF_IO);
+            }
+            #pragma omp barrier
+            bat_prof_lap(&prof, BAT_PROF_WAIT);
+        }
+
+        bat_prof_end(&prof);
+        #pragma omp critical(prof_sum)
+        bat_prof_summary_add(&prof_sum, &prof);
+        free(scratch);
+    }
+
+    double elapsed = elapsed_since(t0);
+    int rc = verify_close(&vw, verify, rank);
+
+    if (ckpt->path && ckpt_last != iters_done) {
+        bat_ckpt_store_pop(ckpt_records, &pop, 0, local_n);
+        bat_ckpt_mpi_save(MPI_COMM_WORLD, ckpt, ckpt_records, n_bats, dim, iters_done, seed, &stats,
+                          best_value, &stop_state, obj->name, best_x, begin, local_n);
+        ckpt_written++;
+    }
+
+    report(rank, size, threads, n_bats, max_iters, quiet, dim, pop.kernel_name, precision, obj, best_value, best_x, elapsed,
+           stop, iters_done, stop_reason, traj, &tw, ckpt, t_start, ckpt_written,
+           verify, verify->path ? vw.digests : 0, &prof_sum, &placement);
+
+    bat_best_record_free(&br);
+    free(ckpt_records);
+    free(best_x);
+    free(local_x);
+    free(slots);
+    bat_pop_free(&pop);
+    return rc;
+}
+
+/* Main loop on the AoS layout: the rank's bats are split statically between its threads. */
+static int run_aos(int rank, int size, int n_bats, int max_iters, unsigned int seed, int quiet, const BatObjective *obj,
+                   const BatStopCriteria *stop, const BatTrajOptions *traj,
+                   const BatCkptOptions *ckpt, const BatCkptHeader *restart, const BatVerifyOptions *verify) {
+    long offset;
+    int local_n;
+    bat_partition(n_bats, size, rank, &offset, &local_n);
+    const int threads = omp_get_max_threads();
+
+    Bat *bats = malloc((size_t)local_n * sizeof(Bat));
+    ThreadSlot *slots = alloc_slots(threads);
+    if (!bats || !slots) {
+        perror("malloc bats");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    BatBestRecord br;
+    bat_best_record_init(&br, MPI_COMM_WORLD, dimension);
+
+    BatTrajMpiWriter tw;
+    if (traj->path) {
+        bat_traj_mpi_open(&tw, MPI_COMM_WORLD, traj, n_bats, dimension, offset, local_n);
+    }
+
+    BatVerifyWriter vw;
+    verify_open(&vw, verify, rank, n_bats, dimension, seed, obj->name, BAT_PRECISION_DOUBLE);
+
+    /* Only x_i and f_value of the best are read by update_bat(). */
+    Bat global_best;
+    memset(&global_best, 0, sizeof(global_best));
+
+    /* Restart: read this rank's block now (MPI), load it in the parallel region */
+    double *ckpt_records = alloc_ckpt_records(ckpt, local_n, dimension);
+    int t_start = 0;
+    if (ckpt->restart) {
+        bat_ckpt_mpi_read(MPI_COMM_WORLD, ckpt->restart, restart, global_best.x_i, ckpt_records, offset, local_n);
+        t_start = (int)restart->iteration;
+    }
+    int ckpt_written = 0;
+    int ckpt_last = -1;
+
+    BatStats stats;
+    double t0 = 0.0;
+    BatStopState stop_state;
+    BatStopReason stop_reason = BAT_STOP_NONE;
+    int iters_done = max_iters;
+    BatProfSummary prof_sum;
+    bat_prof_summary_init(&prof_sum);
+    BatPlacement placement;
+    bat_placement_init(&placement);
+
+    #pragma omp parallel
+    {
+        const int tid = omp_get_thread_num();
+        BatProf prof;
+        bat_prof_begin(&prof);
+        #pragma omp critical(placement)
+        bat_placement_add_self(&placement);
+
+        /* Parallel first touch, same static partition as the update loop */
+        #pragma omp for schedule(static)
+        for (int i = 0; i < local_n; i++) {
+            if (ckpt->restart) {
+                bat_ckpt_load_bats(ckpt_records + (size_t)i * BAT_CKPT_RECORD(dimension), bats, i, i + 1);
+            } else {
+                initialize_bats_range(bats, i, i + 1, offset, (uint32_t)seed, obj);
+            }
+        }
+
+        /* Global statistics and best of the initial (or restored) population */
+        #pragma omp master
+        {
+            if (ckpt->restart) {
+                bat_ckpt_header_restore(restart, &stats, &stop_state);
+                global_best.f_value = stats.best_value;
+            } else {
+                bat_stats_compute(&stats, bats, local_n, offset);
+                global_best.f_value = bat_best_exchange(&br, &stats, bats[stats.best_index - offset].x_i,
+                                                        global_best.x_i);
+                bat_stop_init(&stop_state, global_best.f_value);
+            }
+            MPI_Barrier(MPI_COMM_WORLD);
+            t0 = MPI_Wtime();
+        }
+        #pragma omp barrier
+        bat_prof_lap(&prof, BAT_PROF_INIT);
+
+        for (int t = t_start; t < max_iters && stop_reason == BAT_STOP_NONE; t++) {
+
+            /* Phase 1: update this thread's bats (global_best / stats are read-only) */
+            BatStats *mine = &slots[tid].s;
+            const int verify_due = bat_verify_due(verify, t);
+            bat_stats_reset(mine);
+            slots[tid].verify_sum = 0;
+
+            #pragma omp for schedule(static) nowait
+            for (int i = 0; i < local_n; i++) {
+                update_bat(bats, &global_best, &stats, obj, i, t);
+                bat_stats_add(mine, &bats[i], offset + i);
+                if (verify_due) {
+                    slots[tid].verify_sum += bat_verify_hash_bats(bats, i, i + 1, offset);
+                }
+            }
+            bat_prof_lap(&prof, BAT_PROF_UPDATE);
+            #pragma omp barrier
+            bat_prof_lap(&prof, BAT_PROF_WAIT);
+
+            /* Phase 2: threads -> rank (slots), then ranks -> global (MPI) */
+            #pragma omp master
+            {
+                merge_slots(slots, omp_get_num_threads(), &stats);
+                if (bat_stop_due(stop, t)) {
+                    stats.stop_votes = bat_stop_time_up(stop, MPI_Wtime() - t0);
+                }
+                bat_prof_lap(&prof, BAT_PROF_REDUCE);
+                global_best.f_value = bat_best_exchange(&br, &stats, bats[stats.best_index - offset].x_i,
+                                                        global_best.x_i);
+                bat_prof_lap(&prof, BAT_PROF_COMM);
+
+                if (!quiet && rank == 0 && t % 1000 == 0) {
+                    printf("[Iter %d] Global best = %f\n", t, global_best.f_value);
+                }
+                if (bat_traj_due(traj, t)) {
+                    bat_traj_store_bats(bat_traj_mpi_begin(&tw), &tw.header, bats, 0, local_n);
+                    bat_traj_mpi_commit(&tw, t);
+                }
+                if (verify_due) {
+                    verify_digest(&vw, t, slots, omp_get_num_threads(), &stats, global_best.x_i, rank);
+                }
+                bat_prof_lap(&prof, BAT_PROF_IO);
+                check_stop(stop, &stop_state, t, &stats, &stop_reason, &iters_done);
+                bat_prof_lap(&prof, BAT_PROF_REDUCE);
+
+                /* Periodic checkpoint (a stopping run writes its final one below) */
+                if (stop_reason == BAT_STOP_NONE && bat_ckpt_due(ckpt, t)) {
+                    bat_ckpt_store_bats(ckpt_records, bats, 0, local_n);
+                    bat_ckpt_mpi_save(MPI_COMM_WORLD, ckpt, ckpt_records, n_bats, dimension, t + 1, seed, &stats,
+                                      global_best.f_value, &stop_state, obj->name, global_best.x_i, offset, local_n);
+                    ckpt_written++;
+                    ckpt_last = t + 1;
+                }
+                bat_prof_lap(&prof, BAT_PROF_IO);
+            }
+            #pragma omp barrier
+            bat_prof_lap(&prof, BAT_PROF_WAIT);
+        }
+
+        bat_prof_end(&prof);
+        #pragma omp critical(prof_sum)
+        bat_prof_summary_add(&prof_sum, &prof);
+    }
+
+    double elapsed = elapsed_since(t0);
+    int rc = verify_close(&vw, verify, rank);
+
+    /* Final state, so that the run can be extended with a larger --iters */
+    if (ckpt->path && ckpt_last != iters_done) {
+        bat_ckpt_store_bats(ckpt_records, bats, 0, local_n);
+        bat_ckpt_mpi_save(MPI_COMM_WORLD, ckpt, ckpt_records, n_bats, dimension, iters_done, seed, &stats,
+                          global_best.f_value, &stop_state, obj->name, global_best.x_i, offset, local_n);
+        ckpt_written++;
+    }
+
+    report(rank, size, threads, n_bats, max_iters, quiet, dimension, NULL, BAT_PRECISION_DOUBLE, obj,
+           global_best.f_value, global_best.x_i, elapsed, stop, iters_done, stop_reason, traj, &tw,
+           ckpt, t_start, ckpt_written, verify, verify->path ? vw.digests : 0, &prof_sum, &placement);
+
+    bat_best_record_free(&br);
+    free(ckpt_records);
+    free(bats);
+    free(slots);
+    return rc;
+}
+
+int main(int argc, char *argv[]) {
+
+    /* Only the master thread of each rank calls MPI */
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    if (provided < MPI_THREAD_FUNNELED) {
+        if (rank == 0) {
+            fprintf(stderr, "The MPI library does not support MPI_THREAD_FUNNELED\n");
+        }
+        MPI_Finalize();
+        return 1;
+    }
+
+    /* Every rank parses the same arguments and resolves (loads) the objective */
+    BatOptions opt;
+    const BatObjective *obj;
+    if (bat_options_parse(&opt, argc, argv) != 0) {
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    if (bat_options_validate(&opt, rank == 0, &obj) != 0) {
+        MPI_Finalize();
+        return 1;
+    }
+
+    const int n_bats = opt.n_bats;
+    const int max_iters = opt.max_iters;
+    const int dim = opt.dim;
+
+    /* Partitions may be uneven, but every rank needs at least one bat */
+    if (n_bats < size) {
+        if (rank == 0) {
+            fprintf(stderr, "Need at least one bat per process (n_bats=%d, procs=%d)\n", n_bats, size);
+        }
+        MPI_Finalize();
+        return 1;
+    }
+
+    /* Every rank reads the header of --restart and takes the same decision */
+    BatCkptHeader restart;
+    if (opt.ckpt.restart &&
+        bat_ckpt_mpi_restore_header(MPI_COMM_WORLD, opt.ckpt.restart, n_bats, dim, obj->name, max_iters, &restart) != 0) {
+        MPI_Finalize();
+        return 1;
+    }
+
+    int rc = (opt.layout == BAT_LAYOUT_SOA)
+                 ? run_soa(rank, size, n_bats, max_iters, opt.seed, opt.quiet, dim, opt.precision, obj, &opt.stop, &opt.traj,
+                           &opt.ckpt, &restart, &opt.verify)
+                 : run_aos(rank, size, n_bats, max_iters, opt.seed, opt.quiet, obj, &opt.stop, &opt.traj, &opt.ckpt, &restart,
+                           &opt.verify);
+
+    MPI_Finalize();
+    return rc;
+}
@@ -0,0 +1,514 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bat.h"
+#include "bat_utils.h"
+#include "bat_rng.h"
+#include "bat_stats.h"
+#include "bat_pop.h"
+
+/*
+ * Kernel microbenchmarks (`make bench`).
+ *
+ * Idea:
+ * - Time the building blocks of an iteration in isolation, one thread, no
+ *   MPI: the bat update (AoS update_bat() and SoA bat_pop_update(), also
+ *   on the compact mixed / float store), the
+ *   objective (legacy objective_function() and the batched registry call on
+ *   SoA tiles), the RNG draws, the best / statistics reduction and the
+ *   population initializer.
+ * - Every kernel is swept over population sizes growing by --factor, from
+ *   working sets that fit in L1 to several times the last-level cache, so
+ *   layout and SIMD changes can be compared per memory level.
+ * - A measurement repeats full passes over the population, doubling the
+ *   number of passes until it takes at least --min-time seconds. Kernels
+ *   that change the population (updates) start every measurement from the
+ *   same initialized state, and all their passes use the same iteration
+ *   index (--iter): the pulse rate, hence the share of local searches,
+ *   depends on it, and the work per pass must not change with the number
+ *   of passes.
+ *
+ * Output: one line per (kernel, size)
+ *   MICRO kernel=<name> layout=<aos|soa|-> n_bats=<N> dim=<D> ws_bytes=<B>
+ *         level=<L1|L2|L3|DRAM> passes=<P> ns_per_update=<ns>
+ *         bytes_per_update=<B> gb_per_s=<GB/s>
+ * - ns_per_update  : time per bat processed (one update, evaluation, draw,
+ *                    ... of one bat)
+ * - bytes_per_update: per-bat state the kernel reads plus writes (whole
+ *                    structs for AoS, only the touched arrays for SoA)
+ * - ws_bytes       : memory footprint of the swept arrays; level= compares
+ *                    it with the data cache sizes reported by sysconf()
+ * tools/bench_analyze.py reads these lines (microbench.csv + plots).
+ */
+
+#define MICRO_MIN_BATS  16
+#define MICRO_MAX_BATS  (1 << 22)
+#define MICRO_FACTOR    4
+#define MICRO_MIN_TIME  0.1
+#define MICRO_ITER      100
+
+typedef struct {
+    int n;                      /* bats per pass */
+    int dim;                    /* --dim of the SoA and batched kernels */
+    uint32_t seed;
+    int iter;                   /* iteration index of every update pass */
+    const BatObjective *obj;
+
+    /* State of the kernel being measured (allocated by its setup) */
+    Bat *bats;
+    Bat best_bat;
+    BatPopulation pop;
+    BatStats stats;
+    double *best_x;
+    double *scratch;
+    double *X;                  /* points (objective kernels) */
+    double *out;                /* one output per bat (or dim normals per bat) */
+    uint32_t *states;           /* RNG streams */
+    double *spares;
+} Micro;
+
+typedef struct {
+    const char *name;
+    const char *layout;         /* "aos", "soa" or "-" */
+    int (*setup)(Micro *m);     /* allocates and initializes, 0 on success */
+    void (*pass)(Micro *m, int t);  /* t: iteration index (update kernels) */
+    int (*prepare)(Micro *m);   /* re-initializes before a measurement, may be NULL */
+    size_t (*footprint)(int dim);
+    size_t (*traffic)(int dim);
+} MicroKernel;
+
+/* Sink for the results of read-only kernels (keeps them from being optimized out). */
+static volatile double micro_sink;
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + 1e-9 * (double)ts.tv_nsec;
+}
+
+static void micro_free(Micro *m) {
+    free(m->bats);
+    bat_pop_free(&m->pop);
+    free(m->best_x);
+    free(m->scratch);
+    free(m->X);
+    free(m->out);
+    free(m->states);
+    free(m->spares);
+    m->bats = NULL;
+    m->best_x = m->scratch = m->X = m->out = m->spares = NULL;
+    m->states = NULL;
+    memset(&m->pop, 0, sizeof(m->pop));
+}
+
+/* Bytes of one SoA bat: x and v, A, r, f_value, RNG state and spare. */
+static size_t soa_bat_bytes(int dim) {
+    return bat_pop_bytes_per_bat(dim, BAT_PRECISION_DOUBLE);
+}
+
+/* ---- bat update ---- */
+
+static int aos_prepare(Micro *m) {
+    initialize_bats_seeded(m->bats, m->n, &m->best_bat, m->seed, m->obj);
+    bat_stats_compute(&m->stats, m->bats, m->n, 0);
+    return 0;
+}
+
+static int aos_setup(Micro *m) {
+    m->bats = malloc((size_t)m->n * sizeof(Bat));
+    return m->bats ? aos_prepare(m) : -1;
+}
+
+static void update_bat_pass(Micro *m, int t) {
+    for (int i = 0; i < m->n; i++) {
+        update_bat(m->bats, &m->best_bat, &m->stats, m->obj, i, t);
+    }
+}
+
+static size_t aos_footprint(int dim) {
+    (void)dim;
+    return sizeof(Bat);
+}
+
+static size_t aos_traffic(int dim) {
+    (void)dim;
+    return 2 * sizeof(Bat);
+}
+
+static int soa_prepare(Micro *m) {
+    bat_pop_init_seeded(&m->pop, m->seed, 0, m->obj, m->scratch);
+    bat_stats_reset(&m->stats);
+    bat_pop_stats(&m->pop, 0, m->pop.n_tiles, &m->stats);
+    bat_stats_finalize(&m->stats);
+    bat_pop_get_x(&m->pop, (int)m->stats.best_index, m->best_x);
+    return 0;
+}
+
+static int soa_setup_precision(Micro *m, BatPrecision precision) {
+    if (bat_pop_alloc(&m->pop, m->n, m->dim, precision) != 0) {
+        return -1;
+    }
+    m->best_x = calloc((size_t)m->dim, sizeof(double));
+    m->scratch = calloc(bat_pop_scratch_size(m->dim), sizeof(double));
+    return (m->best_x && m->scratch) ? soa_prepare(m) : -1;
+}
+
+static int soa_setup(Micro *m) {
+    return soa_setup_precision(m, BAT_PRECISION_DOUBLE);
+}
+
+static int soa_mixed_setup(Micro *m) {
+    return soa_setup_precision(m, BAT_PRECISION_MIXED);
+}
+
+static int soa_float_setup(Micro *m) {
+    if (!m->obj->evaluate_f) {
+        fprintf(stderr, "objective '%s' has no single-precision version\n", m->obj->name);
+        return -1;
+    }
+    return soa_setup_precision(m, BAT_PRECISION_FLOAT);
+}
+
+static void bat_pop_update_pass(Micro *m, int t) {
+    bat_pop_update(&m->pop, 0, m->pop.n_tiles, m->best_x, &m->stats, NULL, t, m->scratch);
+}
+
+static size_t soa_footprint(int dim) {
+    return soa_bat_bytes(dim);
+}
+
+static size_t soa_traffic(int dim) {
+    return 2 * soa_bat_bytes(dim);
+}
+
+/* Mixed and float share the compact store. */
+static size_t compact_footprint(int dim) {
+    return bat_pop_bytes_per_bat(dim, BAT_PRECISION_FLOAT);
+}
+
+static size_t compact_traffic(int dim) {
+    return 2 * compact_footprint(dim);
+}
+
+/* ---- objective ---- */
+
+/* Points in SoA tile order (dimension-major inside each tile of BAT_POP_LANES). */
+static int points_setup(Micro *m, int dim) {
+    size_t n_pad = ((size_t)m->n + BAT_POP_LANES - 1) / BAT_POP_LANES * BAT_POP_LANES;
+    m->X = malloc(n_pad * (size_t)dim * sizeof(double));
+    m->out = malloc(n_pad * sizeof(double));
+    if (!m->X || !m->out) {
+        return -1;
+    }
+    uint32_t state = bat_rng_init(m->seed, 0);
+    for (size_t k = 0; k < n_pad * (size_t)dim; k++) {
+        m->X[k] = bat_rng_uniform(&state, Lb, Ub);
+    }
+    return 0;
+}
+
+static int objective_function_setup(Micro *m) {
+    return points_setup(m, dimension);
+}
+
+/* Legacy single-point objective (fixed dimension), points stored contiguously. */
+static void objective_function_pass(Micro *m, int t) {
+    (void)t;
+    for (int i = 0; i < m->n; i++) {
+        m->out[i] = objective_function(&m->X[(size_t)i * dimension]);
+    }
+}
+
+static size_t objective_function_footprint(int dim) {
+    (void)dim;
+    return (dimension + 1) * sizeof(double);
+}
+
+static int objective_eval_setup(Micro *m) {
+    return points_setup(m, m->dim);
+}
+
+/* Batched registry call, one tile at a time as in the SoA kernel. */
+static void objective_eval_pass(Micro *m, int t) {
+    (void)t;
+    const int n_tiles = (m->n + BAT_POP_LANES - 1) / BAT_POP_LANES;
+    const size_t tile = (size_t)m->dim * BAT_POP_LANES;
+    for (int k = 0; k < n_tiles; k++) {
+        m->obj->evaluate(&m->X[k * tile], BAT_POP_LANES, m->dim, &m->out[(size_t)k * BAT_POP_LANES]);
+    }
+}
+
+static size_t objective_eval_footprint(int dim) {
+    return ((size_t)dim + 1) * sizeof(double);
+}
+
+/* ---- RNG ---- */
+
+static int rng_setup(Micro *m) {
+    size_t n_pad = ((size_t)m->n + BAT_POP_LANES - 1) / BAT_POP_LANES * BAT_POP_LANES;
+    m->states = malloc(n_pad * sizeof(uint32_t));
+    m->spares = malloc(n_pad * sizeof(double));
+    m->out = malloc(n_pad * (size_t)m->dim * sizeof(double));
+    if (!m->states || !m->spares || !m->out) {
+        return -1;
+    }
+    for (size_t i = 0; i < n_pad; i++) {
+        m->states[i] = bat_rng_init(m->seed, (uint32_t)i);
+        m->spares[i] = BAT_RNG_NO_SPARE;
+    }
+    return 0;
+}
+
+/* One draw per stream, one stream at a time (AoS update). */
+static void rng_uniform01_pass(Micro *m, int t) {
+    (void)t;
+    double sum = 0.0;
+    for (int i = 0; i < m->n; i++) {
+        sum += bat_rng_uniform01(&m->states[i]);
+    }
+    micro_sink = sum;
+}
+
+static size_t rng_uniform01_footprint(int dim) {
+    (void)dim;
+    return sizeof(uint32_t);
+}
+
+static size_t rng_uniform01_traffic(int dim) {
+    (void)dim;
+    return 2 * sizeof(uint32_t);
+}
+
+/* One draw per stream, a tile of streams per call (SoA kernel). */
+static void rng_uniform01_lanes_pass(Micro *m, int t) {
+    (void)t;
+    const int n_tiles = (m->n + BAT_POP_LANES - 1) / BAT_POP_LANES;
+    for (int k = 0; k < n_tiles; k++) {
+        bat_rng_uniform01_lanes(&m->states[(size_t)k * BAT_POP_LANES], BAT_POP_LANES,
+                                &m->out[(size_t)k * BAT_POP_LANES]);
+    }
+}
+
+static size_t rng_lanes_footprint(int dim) {
+    (void)dim;
+    return sizeof(uint32_t) + sizeof(double);
+}
+
+static size_t rng_lanes_traffic(int dim) {
+    (void)dim;
+    return 2 * sizeof(uint32_t) + sizeof(double);
+}
+
+/* dim normals per stream (the velocity noise of one bat). */
+static void rng_normal_fill_pass(Micro *m, int t) {
+    (void)t;
+    for (int i = 0; i < m->n; i++) {
+        bat_rng_normal_fill(&m->states[i], &m->spares[i], m->dim, &m->out[(size_t)i * m->dim]);
+    }
+}
+
+static size_t rng_normal_footprint(int dim) {
+    return sizeof(uint32_t) + sizeof(double) + (size_t)dim * sizeof(double);
+}
+
+static size_t rng_normal_traffic(int dim) {
+    return 2 * (sizeof(uint32_t) + sizeof(double)) + (size_t)dim * sizeof(double);
+}
+
+/* ---- best / statistics reduction ---- */
+
+static void bat_stats_compute_pass(Micro *m, int t) {
+    (void)t;
+    bat_stats_compute(&m->stats, m->bats, m->n, 0);
+    micro_sink = m->stats.best_value;
+}
+
+static void bat_pop_stats_pass(Micro *m, int t) {
+    (void)t;
+    BatStats acc;
+    bat_stats_reset(&acc);
+    bat_pop_stats(&m->pop, 0, m->pop.n_tiles, &acc);
+    bat_stats_finalize(&acc);
+    micro_sink = acc.best_value;
+}
+
+/* A_i, r_i and f_value of every bat. */
+static size_t soa_stats_traffic(int dim) {
+    (void)dim;
+    return 3 * sizeof(double);
+}
+
+/* ---- population init ---- */
+
+static void initialize_bats_seeded_pass(Micro *m, int t) {
+    (void)t;
+    initialize_bats_seeded(m->bats, m->n, &m->best_bat, m->seed, m->obj);
+}
+
+static void bat_pop_init_seeded_pass(Micro *m, int t) {
+    (void)t;
+    bat_pop_init_seeded(&m->pop, m->seed, 0, m->obj, m->scratch);
+}
+
+static const MicroKernel kernels[] = {
+    { "update_bat",             "aos", aos_setup, update_bat_pass,             aos_prepare, aos_footprint, aos_traffic },
+    { "bat_pop_update",         "soa", soa_setup, bat_pop_update_pass,         soa_prepare, soa_footprint, soa_traffic },
+    { "bat_pop_update_mixed",   "soa", soa_mixed_setup, bat_pop_update_pass,   soa_prepare, compact_footprint, compact_traffic },
+    { "bat_pop_update_float",   "soa", soa_float_setup, bat_pop_update_pass,   soa_prepare, compact_footprint, compact_traffic },
+    { "objective_function",     "aos", objective_function_setup, objective_function_pass, NULL,
+      objective_function_footprint, objective_function_footprint },
+    { "objective_eval",         "soa", objective_eval_setup, objective_eval_pass, NULL,
+      objective_eval_footprint, objective_eval_footprint },
+    { "rng_uniform01",          "-",   rng_setup, rng_uniform01_pass,          NULL, rng_uniform01_footprint, rng_uniform01_traffic },
+    { "rng_uniform01_lanes",    "-",   rng_setup, rng_uniform01_lanes_pass,    NULL, rng_lanes_footprint, rng_lanes_traffic },
+    { "rng_normal_fill",        "-",   rng_setup, rng_normal_fill_pass,        NULL, rng_normal_footprint, rng_normal_traffic },
+    { "bat_stats_compute",      "aos", aos_setup, bat_stats_compute_pass,      NULL, aos_footprint, aos_footprint },
+    { "bat_pop_stats",          "soa", soa_setup, bat_pop_stats_pass,          NULL, soa_footprint, soa_stats_traffic },
+    { "initialize_bats_seeded", "aos", aos_setup, initialize_bats_seeded_pass, NULL, aos_footprint, aos_footprint },
+    { "bat_pop_init_seeded",    "soa", soa_setup, bat_pop_init_seeded_pass,    NULL, soa_footprint, soa_footprint },
+};
+#define N_KERNELS ((int)(sizeof(kernels) / sizeof(kernels[0])))
+
+/* Data cache sizes in bytes (0 if unknown). */
+static long cache_size(int level) {
+    long bytes = 0;
+#if defined(_SC_LEVEL1_DCACHE_SIZE) && defined(_SC_LEVEL2_CACHE_SIZE) && defined(_SC_LEVEL3_CACHE_SIZE)
+    bytes = sysconf(level == 1 ? _SC_LEVEL1_DCACHE_SIZE : level == 2 ? _SC_LEVEL2_CACHE_SIZE : _SC_LEVEL3_CACHE_SIZE);
+#else
+    (void)level;
+#endif
+    return bytes > 0 ? bytes : 0;
+}
+
+/* Smallest cache level that holds ws bytes. */
+static const char *memory_level(size_t ws) {
+    static const char *const names[] = { "L1", "L2", "L3" };
+    for (int level = 1; level <= 3; level++) {
+        long size = cache_size(level);
+        if (size > 0 && ws <= (size_t)size) {
+            return names[level - 1];
+        }
+    }
+    return (cache_size(1) > 0) ? "DRAM" : "?";
+}
+
+/*
+ * Measures one kernel at one size and prints its MICRO line.
+ * Returns 0 on success, -1 if the state could not be allocated.
+ */
+static int measure(const MicroKernel *k, Micro *m, double min_time) {
+    int dim = (strcmp(k->layout, "aos") == 0) ? dimension : m->dim;
+    if (k->setup(m) != 0) {
+        micro_free(m);
+        return -1;
+    }
+
+    /* Warm-up pass (page faults, caches) */
+    k->pass(m, m->iter);
+
+    int passes = 1;
+    double elapsed;
+    for (;;) {
+        if (k->prepare) {
+            k->prepare(m);
+        }
+        double t0 = now_s();
+        for (int p = 0; p < passes; p++) {
+            k->pass(m, m->iter);
+        }
+        elapsed = now_s() - t0;
+        if (elapsed >= min_time || passes >= (1 << 30)) {
+            break;
+        }
+        passes *= 2;
+    }
+
+    double updates = (double)passes * (double)m->n;
+    double ns = 1e9 * elapsed / updates;
+    size_t ws = (size_t)m->n * k->footprint(dim);
+    size_t bytes = k->traffic(dim);
+    printf("MICRO kernel=%s layout=%s n_bats=%d dim=%d ws_bytes=%zu level=%s passes=%d ns_per_update=%.3f bytes_per_update=%zu gb_per_s=%.3f\n",
+           k->name, k->layout, m->n, dim, ws, memory_level(ws), passes, ns, bytes,
+           ns > 0.0 ? (double)bytes / ns : 0.0);
+    fflush(stdout);
+
+    micro_free(m);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int min_bats = MICRO_MIN_BATS;
+    int max_bats = MICRO_MAX_BATS;
+    int factor = MICRO_FACTOR;
+    double min_time = MICRO_MIN_TIME;
+    const char *only = NULL;
+    const char *objective = BAT_OBJECTIVE_DEFAULT;
+
+    Micro m;
+    memset(&m, 0, sizeof(m));
+    m.dim = dimension;
+    m.seed = 1u;
+    m.iter = MICRO_ITER;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--min-bats") == 0 && i + 1 < argc) {
+            min_bats = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max-bats") == 0 && i + 1 < argc) {
+            max_bats = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--factor") == 0 && i + 1 < argc) {
+            factor = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+            min_time = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--kernel") == 0 && i + 1 < argc) {
+            only = argv[++i];
+        } else if (strcmp(argv[i], "--dim") == 0 && i + 1 < argc) {
+            m.dim = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--objective") == 0 && i + 1 < argc) {
+            objective = argv[++i];
+        } else if (strcmp(argv[i], "--iter") == 0 && i + 1 < argc) {
+            m.iter = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            m.seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if (min_bats < 1 || max_bats < min_bats || factor < 2 || min_time < 0.0 || m.dim < 1 || m.iter < 0) {
+        fprintf(stderr, "Invalid sweep: min_bats=%d max_bats=%d factor=%d min_time=%g dim=%d iter=%d\n",
+                min_bats, max_bats, factor, min_time, m.dim, m.iter);
+        return 1;
+    }
+
+    m.obj = bat_objective_find(objective);
+    if (!m.obj) {
+        fprintf(stderr, "Unknown objective: %s\n", objective);
+        bat_objective_print_names();
+        return 1;
+    }
+
+    int found = 0;
+    for (int k = 0; k < N_KERNELS; k++) {
+        if (only && strcmp(only, kernels[k].name) != 0) {
+            continue;
+        }
+        found = 1;
+        for (long n = min_bats; n <= max_bats; n *= factor) {
+            m.n = (int)n;
+            if (measure(&kernels[k], &m, min_time) != 0) {
+                fprintf(stderr, "%s: cannot allocate %d bats, sweep stopped\n", kernels[k].name, m.n);
+                break;
+            }
+        }
+    }
+
+    if (!found) {
+        fprintf(stderr, "Unknown kernel: %s\n", only);
+        return 1;
+    }
+    return 0;
+}
@@ -6,12 +6,32 @@
 
 #include "bat.h"
 #include "bat_utils.h"
+#include "bat_stats.h"
+#include "bat_pop.h"
+#include "bat_island.h"
+#include "bat_best_record.h"
+#include "bat_best_shm.h"
+#include "bat_stop.h"
+#include "bat_traj.h"
+#include "bat_traj_mpi.h"
+#include "bat_verify.h"
+#include "bat_ckpt.h"
+#include "bat_ckpt_mpi.h"
+#include "bat_options.h"
+#include "bat_prof.h"
+#include "bat_prof_mpi.h"
+#include "bat_host.h"
+#include "bat_host_mpi.h"
+#include "bat_balance.h"
 
 /*
  * MPI version of the Bat Algorithm.
  *
  * Idea:
  * - We split the bats between MPI processes (each rank has a local part).
+ *   Each rank owns a contiguous block of global indices (bat_partition,
+ *   sizes may differ by one) and initializes it itself on the heap: the
+ *   RNG stream of bat i only depends on (seed, i).
  * - Every iteration, each rank updates its local bats using the current global best.
  * - Then each rank finds its local best.
  * - We use MPI_Allreduce with MPI_MAXLOC to find which rank has the best f_value.
@@ -19,25 +39,1198 @@
  *
  * This is the "AllReduce method": the global best score (value + owner rank)
  * is computed collectively with Allreduce.
+ *
+ * The population statistics (mean loudness used by the local search) are
+ * global: each rank accumulates its local sums and a single Allreduce
+ * combines them, so every rank sees the same A_mean.
+ *
+ * With --layout soa each rank stores its bats in a BatPopulation
+ * (structure of arrays) instead, and the best position is broadcast as
+ * `dimension` doubles.
+ *
+ * --best-exchange selects how the global best is shared every iteration:
+ * - bcast : the steps above (MAXLOC Allreduce + Bcast of the winner, plus
+ *           the Allreduce of the statistics: three collectives)
+ * - fused : (default) ONE Allreduce of a small record (statistics sums,
+ *           best value, best index, best position) with a user-defined
+ *           reduction op. Only the winning (f_value, x) travels, not the
+ *           whole Bat.
+ * - shm   : the fused record, reduced in two levels (bat_best_shm.h): the
+ *           ranks of a node combine their records in an MPI-3 shared
+ *           window and only one leader per node joins the Allreduce. Falls
+ *           back to fused when no node holds two ranks.
+ *
+ * --async-best [--staleness K] makes the fused exchange non-blocking: the
+ * reduction of iteration t is posted with MPI_Iallreduce and overlaps with
+ * the next iterations. Each iteration uses the newest completed result, and
+ * a rank only blocks when the result it uses would lag more than K
+ * iterations behind the synchronous one. K = 0 is the synchronous
+ * algorithm; with K > 0 results depend on message timing.
+ *
+ * --island replaces the global best by an island model (bat_island.h):
+ * every rank follows its own local best and only exchanges its top-k bats
+ * with its neighbors every M iterations (--migrate-every M --migrate-k k
+ * --topology ring|torus|random). The global best is reduced once, at the
+ * end, for the report.
+ *
+ * The stopping criteria (bat_stop.h) ride on the best exchange: each rank
+ * votes in BatStats.stop_votes when its wall-clock budget is spent, the
+ * vote is summed with the statistics, and every rank evaluates the same
+ * criteria on the same reduced record. In async mode the decision taken
+ * on the record posted after iteration p applies after iteration p + 1 + K,
+ * the first iteration at which every rank is guaranteed to have received
+ * that record. The island model has no global exchange and no criteria.
+ *
+ * --traj FILE [--traj-every N] writes the positions every N iterations with
+ * one non-blocking collective MPI-IO write per frame (bat_traj_mpi.h):
+ * every rank writes its own block, nothing is gathered on rank 0.
+ *
+ * --checkpoint FILE [--checkpoint-every K] / --restart FILE save and
+ * reload the whole state (bat_ckpt.h) in one shared file: each rank
+ * writes and reads the block of its own bats with collective MPI-IO
+ * (bat_ckpt_mpi.h). Blocks are located by global index, so a run can be
+ * restarted on another number of ranks. Checkpoints need the synchronous
+ * exchange: with --async-best reductions are in flight at any iteration,
+ * and islands have no global best to save.
+ *
+ * --verify FILE [--verify-every K] writes a digest of the state after every
+ * K-th iteration (bat_verify.h) on rank 0. The population checksum is the
+ * sum of the per-rank checksums, and the best / A_sum come from one extra
+ * fused exchange of the local statistics: this gives the same digest in
+ * every exchange mode (bcast does not reduce the best index, and async mode
+ * has not reduced iteration t yet) without changing the run itself. Not
+ * available with --island.
+ *
+ * --rebalance-every K (bat_balance.h) resizes the blocks of the ranks in
+ * proportion to their measured update speed every K iterations, when the
+ * slowest rank lags behind; the bats that change owner move with their
+ * RNG state, so the trajectory does not change. Needs the synchronous
+ * exchange (an in-flight reduction holds the local best by position) and
+ * no --island (the islands are the blocks).
+ *
+ * `make PROFILE=1` times the phases of every rank (bat_prof.h): the comm
+ * phase is the best exchange (or migration), including the wait for the
+ * slowest rank; min / avg / max over the ranks are in the BENCH line.
+ */
+
+/* How the global best is exchanged (--best-exchange). */
+typedef enum {
+    BEST_EXCHANGE_FUSED = 0,
+    BEST_EXCHANGE_BCAST = 1,
+    BEST_EXCHANGE_SHM = 2
+} BestExchange;
+
+static const char *best_exchange_name(BestExchange mode) {
+    switch (mode) {
+    case BEST_EXCHANGE_BCAST:
+        return "bcast";
+    case BEST_EXCHANGE_SHM:
+        return "shm";
+    default:
+        return "fused";
+    }
+}
+
+/* Communication options of a run (same on every rank). */
+typedef struct {
+    BestExchange exchange;
+    int staleness;          /* -1: synchronous, K >= 0: --async-best */
+    int island;             /* 1: island model, no per-iteration global best */
+    BatTopology topology;
+    int migrate_every;      /* M */
+    int migrate_k;          /* k */
+    int rebalance_every;    /* --rebalance-every K, 0: static blocks */
+} ExchangeOptions;
+
+/*
+ * Bounded-staleness exchange (--async-best): a ring of K + 1 records, each
+ * reduced by its own MPI_Iallreduce.
+ *
+ * The record posted after iteration p is, in the synchronous algorithm,
+ * the input of iteration p + 1. Used at iteration u its lag is u - 1 - p.
+ * Before iteration u every record with lag >= K is waited for, younger
+ * ones are only tested, so the lag never exceeds K.
+ */
+typedef struct {
+    int staleness;       /* K */
+    int depth;           /* ring size, K + 1 */
+    int head;            /* oldest in-flight slot */
+    int pending;         /* in-flight reductions */
+    double *recs;        /* depth records */
+    MPI_Request *reqs;
+    int *posted_at;      /* iteration that posted each slot */
+    int used_at;         /* iteration that posted the result in use */
+    double lag_sum;      /* sum of lags of the results used (staleness stats) */
+    long lag_samples;
+
+    /* Stopping criteria, evaluated on every record in posting order */
+    const BatStopCriteria *stop;
+    BatStopState stop_state;
+    BatStopReason stop_reason;
+    int stop_at;         /* first iteration not to run, -1: none */
+} AsyncBest;
+
+static void async_best_init(AsyncBest *ab, const BatBestRecord *br, int staleness,
+                            const BatStopCriteria *stop, double best_value) {
+    ab->staleness = staleness;
+    ab->depth = staleness + 1;
+    ab->head = 0;
+    ab->pending = 0;
+    ab->recs = malloc((size_t)ab->depth * (size_t)BAT_BEST_RECORD_SIZE(br->dim) * sizeof(double));
+    ab->reqs = malloc((size_t)ab->depth * sizeof(MPI_Request));
+    ab->posted_at = malloc((size_t)ab->depth * sizeof(int));
+    if (!ab->recs || !ab->reqs || !ab->posted_at) {
+        perror("malloc async best");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    ab->used_at = -1;  /* the initial (blocking) exchange */
+    ab->lag_sum = 0.0;
+    ab->lag_samples = 0;
+    ab->stop = stop;
+    bat_stop_init(&ab->stop_state, best_value);
+    ab->stop_reason = BAT_STOP_NONE;
+    ab->stop_at = -1;
+}
+
+static void async_best_free(AsyncBest *ab) {
+    free(ab->recs);
+    free(ab->reqs);
+    free(ab->posted_at);
+}
+
+/* Posts the reduction of the local state after iteration t. */
+static void async_best_post(AsyncBest *ab, BatBestRecord *br, const BatStats *local, const double *local_x, int t) {
+    int slot = (ab->head + ab->pending) % ab->depth;
+    double *rec = ab->recs + (size_t)slot * (size_t)BAT_BEST_RECORD_SIZE(br->dim);
+
+    bat_best_record_pack(br, rec, local, local_x);
+    ab->posted_at[slot] = t;
+    MPI_Iallreduce(MPI_IN_PLACE, rec, 1, br->type, br->op, br->comm, &ab->reqs[slot]);
+    ab->pending++;
+}
+
+/*
+ * Stopping criteria on the record posted after iteration p. Every rank
+ * sees the same records in the same order, so the decision and stop_at
+ * are the same everywhere.
+ */
+static void async_best_check_stop(AsyncBest *ab, const double *rec, int p) {
+    if (ab->stop_at >= 0 || !bat_stop_due(ab->stop, p)) {
+        return;
+    }
+    ab->stop_reason = bat_stop_check(ab->stop, &ab->stop_state, p, rec[BAT_REC_VALUE], rec[BAT_REC_STOP] > 0.0);
+    if (ab->stop_reason != BAT_STOP_NONE) {
+        ab->stop_at = p + 1 + ab->staleness;
+    }
+}
+
+/*
+ * Collects the completed reductions before iteration u (u = -1: wait for
+ * all of them) and applies the newest one to stats / best_x.
+ * Returns 1 if a new result was applied.
+ */
+static int async_best_collect(AsyncBest *ab, BatBestRecord *br, int u, BatStats *stats, double *best_x) {
+    int newest = -1;
+
+    while (ab->pending > 0) {
+        int slot = ab->head;
+        int lag = u - 1 - ab->posted_at[slot];
+
+        if (u < 0 || lag >= ab->staleness) {
+            MPI_Wait(&ab->reqs[slot], MPI_STATUS_IGNORE);
+        } else {
+            int done = 0;
+            MPI_Test(&ab->reqs[slot], &done, MPI_STATUS_IGNORE);
+            if (!done) {
+                break;
+            }
+        }
+        newest = slot;
+        if (u >= 0) {
+            async_best_check_stop(ab, ab->recs + (size_t)slot * (size_t)BAT_BEST_RECORD_SIZE(br->dim), ab->posted_at[slot]);
+        }
+        ab->head = (ab->head + 1) % ab->depth;
+        ab->pending--;
+    }
+
+    if (newest >= 0) {
+        bat_best_record_unpack(br, ab->recs + (size_t)newest * (size_t)BAT_BEST_RECORD_SIZE(br->dim), stats, best_x);
+        ab->used_at = ab->posted_at[newest];
+    }
+    if (u > 0) {
+        ab->lag_sum += (double)(u - 1 - ab->used_at);
+        ab->lag_samples++;
+    }
+    return newest >= 0;
+}
+
+/* Mean lag (in iterations) of the global best used by the iterations. */
+static double async_best_effective_staleness(const AsyncBest *ab) {
+    return (ab->lag_samples > 0) ? ab->lag_sum / (double)ab->lag_samples : 0.0;
+}
+
+/*
+ * Reduces the sums of a local BatStats accumulator across all ranks
+ * (one MPI_Allreduce) and computes the global means.
  */
+static void allreduce_stats(BatStats *stats) {
+    double sums[BAT_STATS_N_SUMS] = { stats->A_sum, stats->r_sum, stats->count, stats->stop_votes };
+    MPI_Allreduce(MPI_IN_PLACE, sums, BAT_STATS_N_SUMS, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    stats->A_sum = sums[0];
+    stats->r_sum = sums[1];
+    stats->count = sums[2];
+    stats->stop_votes = sums[3];
+    bat_stats_finalize(stats);
+}
 
-static void parse_args(int argc, char **argv, int *n_bats, int *max_iters, unsigned int *seed, int *quiet) {
-    *n_bats = N_BATS;
-    *max_iters = MAX_ITERS;
-    *seed = (unsigned int)time(NULL);
-    *quiet = 0;
+static void parse_args(int argc, char **argv, BatOptions *opt, ExchangeOptions *xo) {
+    bat_options_defaults(opt);
+    xo->exchange = BEST_EXCHANGE_FUSED;
+    xo->staleness = -1;
+    xo->island = 0;
+    xo->topology = BAT_TOPOLOGY_RING;
+    xo->migrate_every = 50;
+    xo->migrate_k = 2;
+    xo->rebalance_every = 0;
+    int async_best = 0;
+    int async_staleness = 1;
 
     for (int i = 1; i < argc; i++) {
-        if (strcmp(argv[i], "--n-bats") == 0 && i + 1 < argc) {
-            *n_bats = atoi(argv[++i]);
-        } else if (strcmp(argv[i], "--iters") == 0 && i + 1 < argc) {
-            *max_iters = atoi(argv[++i]);
-        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
-            *seed = (unsigned int)strtoul(argv[++i], NULL, 10);
-        } else if (strcmp(argv[i], "--quiet") == 0) {
-            *quiet = 1;
+        int shared = bat_options_parse_option(opt, argc, argv, &i);
+        if (shared < 0) {
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        } else if (shared) {
+            /* options of all front-ends (bat_options.h) */
+        } else if (strcmp(argv[i], "--best-exchange") == 0 && i + 1 < argc) {
+            const char *mode = argv[++i];
+            if (strcmp(mode, "fused") == 0) {
+                xo->exchange = BEST_EXCHANGE_FUSED;
+            } else if (strcmp(mode, "bcast") == 0) {
+                xo->exchange = BEST_EXCHANGE_BCAST;
+            } else if (strcmp(mode, "shm") == 0) {
+                xo->exchange = BEST_EXCHANGE_SHM;
+            } else {
+                fprintf(stderr, "Unknown best exchange '%s' (expected fused, bcast or shm)\n", mode);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+        } else if (strcmp(argv[i], "--async-best") == 0) {
+            async_best = 1;
+        } else if (strcmp(argv[i], "--staleness") == 0 && i + 1 < argc) {
+            async_best = 1;
+            async_staleness = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--island") == 0) {
+            xo->island = 1;
+        } else if (strcmp(argv[i], "--migrate-every") == 0 && i + 1 < argc) {
+            xo->island = 1;
+            xo->migrate_every = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--migrate-k") == 0 && i + 1 < argc) {
+            xo->island = 1;
+            xo->migrate_k = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--topology") == 0 && i + 1 < argc) {
+            xo->island = 1;
+            if (bat_topology_parse(argv[++i], &xo->topology) != 0) {
+                fprintf(stderr, "Unknown topology '%s' (expected ring, torus or random)\n", argv[i]);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+        } else if (strcmp(argv[i], "--rebalance-every") == 0 && i + 1 < argc) {
+            xo->rebalance_every = atoi(argv[++i]);
+            if (xo->rebalance_every < 0) {
+                fprintf(stderr, "Invalid rebalance period: %d (expected K >= 1, or 0 for static blocks)\n",
+                        xo->rebalance_every);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+        }
+    }
+
+    bat_options_finish(opt);
+
+    /* The asynchronous exchange is built on the fused record. */
+    if (async_best) {
+        if (xo->exchange != BEST_EXCHANGE_FUSED || async_staleness < 0 || xo->island) {
+            fprintf(stderr, "--async-best needs --best-exchange fused, --staleness K >= 0 and no --island\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        xo->staleness = async_staleness;
+    }
+
+    if (xo->rebalance_every > 0 && (xo->staleness >= 0 || xo->island)) {
+        fprintf(stderr, "--rebalance-every needs the synchronous exchange (no --async-best) and no --island\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+}
+
+/*
+ * Global best for the SoA layout: MPI_MAXLOC on (value, rank), then the
+ * owner broadcasts its best position. Returns the global best value.
+ *
+ * Parameters:
+ *   - pop    : local population
+ *   - stats  : local statistics (best_index = global index of the local best)
+ *   - best_x : output, position of the global best (dim doubles, all ranks)
+ *   - rank   : rank of this process
+ */
+static double exchange_best_soa(const BatPopulation *pop, const BatStats *stats, double *best_x, int rank) {
+    struct {
+        double value;
+        int rank;
+    } local_data, global_data;
+
+    local_data.value = stats->best_value;
+    local_data.rank  = rank;
+    MPI_Allreduce(&local_data, &global_data, 1, MPI_DOUBLE_INT, MPI_MAXLOC, MPI_COMM_WORLD);
+
+    if (rank == global_data.rank) {
+        bat_pop_get_x(pop, (int)(stats->best_index - pop->index_offset), best_x);
+    }
+    MPI_Bcast(best_x, pop->dim, MPI_DOUBLE, global_data.rank, MPI_COMM_WORLD);
+    return global_data.value;
+}
+
+/*
+ * Global best and global statistics for the SoA layout, with the selected
+ * exchange mode. local_x is a dim-double buffer for the local best; shm is
+ * only used in shm mode.
+ */
+static double exchange_best_pop(const BatPopulation *pop, BatStats *stats, double *best_x, double *local_x,
+                                BatBestRecord *br, BatBestShm *shm, BestExchange exchange, int rank) {
+    if (exchange == BEST_EXCHANGE_BCAST) {
+        double value = exchange_best_soa(pop, stats, best_x, rank);
+        allreduce_stats(stats);
+        return value;
+    }
+    bat_pop_get_x(pop, (int)(stats->best_index - pop->index_offset), local_x);
+    if (exchange == BEST_EXCHANGE_SHM) {
+        return bat_best_shm_exchange(shm, br, stats, local_x, best_x);
+    }
+    return bat_best_exchange(br, stats, local_x, best_x);
+}
+
+/* Mean of a per-rank value (result on rank 0). */
+static double mean_over_ranks(double value, int size) {
+    double sum = 0.0;
+    MPI_Reduce(&value, &sum, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    return sum / size;
+}
+
+/* Trajectory frames of the local bats after iteration t (collective, all ranks). */
+static void traj_frame_pop(BatTrajMpiWriter *tw, const BatTrajOptions *traj, const BatPopulation *pop, int t) {
+    if (bat_traj_due(traj, t)) {
+        bat_traj_store_pop(bat_traj_mpi_begin(tw), &tw->header, pop, 0, pop->n);
+        bat_traj_mpi_commit(tw, t);
+    }
+}
+
+static void traj_frame_bats(BatTrajMpiWriter *tw, const BatTrajOptions *traj, const Bat bats[], int local_n, int t) {
+    if (bat_traj_due(traj, t)) {
+        bat_traj_store_bats(bat_traj_mpi_begin(tw), &tw->header, bats, 0, local_n);
+        bat_traj_mpi_commit(tw, t);
+    }
+}
+
+/* Rank 0, not --quiet: why the loop ended before max_iters. */
+static void print_stopped(BatStopReason reason, int iters_done) {
+    if (reason != BAT_STOP_NONE) {
+        printf("\nStopped after %d iterations (%s)", iters_done, bat_stop_reason_name(reason));
+    }
+}
+
+/* BENCH fields of the async mode: requested bound and measured mean lag. */
+static void print_staleness(int staleness, double eff_staleness) {
+    if (staleness >= 0) {
+        printf(" staleness=%d eff_staleness=%.3f", staleness, eff_staleness);
+    }
+}
+
+/*
+ * Collective: stops the timers of this rank, combines them over the ranks
+ * and returns the summary (valid on rank 0).
+ */
+static BatProfSummary prof_finish(BatProf *prof) {
+    bat_prof_end(prof);
+    BatProfSummary sum;
+    bat_prof_summary_init(&sum);
+    bat_prof_summary_add(&sum, prof);
+    bat_prof_mpi_reduce(&sum, MPI_COMM_WORLD);
+    return sum;
+}
+
+/* Collective: placement of the ranks (bat_host.h), valid on rank 0. */
+static BatPlacement placement_finish(void) {
+    BatPlacement p;
+    bat_placement_init(&p);
+    bat_placement_add_self(&p);
+    bat_host_mpi_reduce(&p, MPI_COMM_WORLD);
+    return p;
+}
+
+/*
+ * --verify, collective: digest of iteration t, written by rank 0.
+ *
+ * Parameters:
+ *   - vw        : digest writer (open on rank 0)
+ *   - br        : fused exchange buffers
+ *   - t         : iteration index
+ *   - local     : statistics of this rank after iteration t (not reduced)
+ *   - local_x   : position of the local best
+ *   - best_x    : scratch, dim doubles
+ *   - local_sum : checksum of this rank's bats
+ *   - rank      : rank of this process
+ */
+static void verify_digest(BatVerifyWriter *vw, BatBestRecord *br, int t, const BatStats *local, const double *local_x,
+                          double *best_x, uint64_t local_sum, int rank) {
+    BatStats global = *local;
+    bat_best_exchange(br, &global, local_x, best_x);
+    uint64_t sum = 0;
+    MPI_Reduce(&local_sum, &sum, 1, MPI_UINT64_T, MPI_SUM, 0, MPI_COMM_WORLD);
+    if (rank == 0) {
+        bat_verify_write(vw, t, &global, best_x, sum);
+    }
+}
+
+/* Rank 0 creates the digest file of --verify (other ranks get an empty writer). Aborts on error. */
+static void verify_open(BatVerifyWriter *vw, const BatVerifyOptions *verify, int rank, int n_bats, int dim,
+                        unsigned int seed, const char *objective, BatPrecision precision) {
+    memset(vw, 0, sizeof(*vw));
+    if (verify->path && rank == 0 &&
+        bat_verify_open(vw, verify->path, "mpi", n_bats, dim, seed, objective, bat_precision_name(precision)) != 0) {
+        perror(verify->path);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+}
+
+/* Rank 0 closes the digest file. Returns 1 if a write failed, 0 otherwise. */
+static int verify_close(BatVerifyWriter *vw, const BatVerifyOptions *verify, int rank) {
+    if (verify->path && rank == 0 && bat_verify_close(vw) != 0) {
+        fprintf(stderr, "Writing the digests %s failed\n", verify->path);
+        return 1;
+    }
+    return 0;
+}
+
+/* Local checkpoint records (local_n of them), NULL if neither --checkpoint nor --restart. Aborts if out of memory. */
+static double *alloc_ckpt_records(const BatCkptOptions *ckpt, int local_n, int dim) {
+    if (!ckpt->path && !ckpt->restart) {
+        return NULL;
+    }
+    double *records = malloc((size_t)local_n * BAT_CKPT_RECORD(dim) * sizeof(double));
+    if (!records) {
+        perror("malloc checkpoint records");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    return records;
+}
+
+/* Records of the bats of a block, for the migration of --rebalance-every. */
+static double *alloc_records(int n, int dim) {
+    double *records = malloc((size_t)n * BAT_CKPT_RECORD(dim) * sizeof(double));
+    if (!records) {
+        perror("malloc migration records");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    return records;
+}
+
+/*
+ * --rebalance-every, SoA: moves the bats to their planned blocks
+ * (bat_balance_plan() returned 1). The new store only gets its padding
+ * lanes initialized (no objective evaluation) before the received records
+ * fill it; the checkpoint buffer and the trajectory writer follow the new
+ * block.
+ */
+static void rebalance_pop(BatBalance *bal, BatPopulation *pop, const BatCkptOptions *ckpt, double **ckpt_records,
+                          BatTrajMpiWriter *tw, const BatTrajOptions *traj) {
+    const int dim = pop->dim;
+    double *send = alloc_records(pop->n, dim);
+    double *recv = alloc_records(bal->next_count[bal->rank], dim);
+    bat_ckpt_store_pop(send, pop, 0, pop->n);
+    bat_balance_migrate(bal, send, recv, dim);
+
+    long begin;
+    int local_n;
+    bat_balance_local(bal, &begin, &local_n);
+    const BatObjective *obj = pop->objective;
+    const BatPrecision precision = pop->precision;
+    bat_pop_free(pop);
+    if (bat_pop_alloc(pop, local_n, dim, precision) != 0) {
+        perror("alloc population");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    bat_pop_init_begin(pop, begin, obj);
+    bat_pop_init_padding(pop);
+    bat_ckpt_load_pop(recv, pop, 0, local_n);
+    free(send);
+    free(recv);
+
+    free(*ckpt_records);
+    *ckpt_records = alloc_ckpt_records(ckpt, local_n, dim);
+    if (traj->path) {
+        bat_traj_mpi_set_block(tw, begin, local_n);
+    }
+}
+
+/* --rebalance-every, AoS: same as rebalance_pop() for an array of bats. */
+static void rebalance_bats(BatBalance *bal, Bat **bats, const BatCkptOptions *ckpt, double **ckpt_records,
+                           BatTrajMpiWriter *tw, const BatTrajOptions *traj) {
+    double *send = alloc_records(bal->count[bal->rank], dimension);
+    double *recv = alloc_records(bal->next_count[bal->rank], dimension);
+    bat_ckpt_store_bats(send, *bats, 0, bal->count[bal->rank]);
+    bat_balance_migrate(bal, send, recv, dimension);
+
+    long begin;
+    int local_n;
+    bat_balance_local(bal, &begin, &local_n);
+    free(*bats);
+    *bats = malloc((size_t)local_n * sizeof(Bat));
+    if (!*bats) {
+        perror("malloc bats");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    bat_ckpt_load_bats(recv, *bats, 0, local_n);
+    free(send);
+    free(recv);
+
+    free(*ckpt_records);
+    *ckpt_records = alloc_ckpt_records(ckpt, local_n, dimension);
+    if (traj->path) {
+        bat_traj_mpi_set_block(tw, begin, local_n);
+    }
+}
+
+/*
+ * Main loop on the SoA population store.
+ * Each rank allocates and initializes only its own slice of the global
+ * population (bat_partition), so memory and start-up cost are per rank.
+ */
+static int run_soa(int rank, int size, int n_bats, int max_iters, unsigned int seed, int quiet, int dim,
+                   BatPrecision precision, const BatObjective *obj, const ExchangeOptions *xo, const BatStopCriteria *stop, const BatTrajOptions *traj,
+                   const BatCkptOptions *ckpt, const BatCkptHeader *restart, const BatVerifyOptions *verify) {
+    const BestExchange exchange = xo->exchange;
+    const int staleness = xo->staleness;
+    long begin;
+    int local_n;
+    BatBalance bal;
+    bat_balance_init(&bal, MPI_COMM_WORLD, xo->rebalance_every, n_bats);
+    bat_balance_local(&bal, &begin, &local_n);
+
+    BatPopulation pop;
+    if (bat_pop_alloc(&pop, local_n, dim, precision) != 0) {
+        perror("alloc population");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    double *best_x = malloc((size_t)dim * sizeof(double));
+    double *local_x = malloc((size_t)dim * sizeof(double));
+    double *verify_x = malloc((size_t)dim * sizeof(double));
+    double *scratch = malloc(bat_pop_scratch_size(dim) * sizeof(double));
+    if (!best_x || !local_x || !verify_x || !scratch) {
+        perror("malloc best/scratch");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    BatBestRecord br;
+    bat_best_record_init(&br, MPI_COMM_WORLD, dim);
+    BatBestShm shm;
+    if (exchange == BEST_EXCHANGE_SHM) {
+        bat_best_shm_init(&shm, &br);
+    }
+
+    BatProf prof;
+    bat_prof_begin(&prof);
+
+    /* Bats [begin, begin + local_n) of the global population */
+    bat_pop_init_seeded(&pop, (uint32_t)seed, begin, obj, scratch);
+
+    BatStats stats;
+    bat_stats_reset(&stats);
+    bat_pop_stats(&pop, 0, pop.n_tiles, &stats);
+    double best_value = exchange_best_pop(&pop, &stats, best_x, local_x, &br, &shm, exchange, rank);
+
+    AsyncBest ab;
+    if (staleness >= 0) {
+        async_best_init(&ab, &br, staleness, stop, best_value);
+    }
+
+    BatStopState stop_state;
+    bat_stop_init(&stop_state, best_value);
+    BatStopReason stop_reason = BAT_STOP_NONE;
+    int iters_done = max_iters;
+
+    /* Restart: this rank's block of the file replaces its initial bats */
+    double *ckpt_records = alloc_ckpt_records(ckpt, local_n, dim);
+    int t_start = 0;
+    if (ckpt->restart) {
+        bat_ckpt_mpi_read(MPI_COMM_WORLD, ckpt->restart, restart, best_x, ckpt_records, begin, local_n);
+        bat_ckpt_load_pop(ckpt_records, &pop, 0, local_n);
+        bat_ckpt_header_restore(restart, &stats, &stop_state);
+        best_value = stats.best_value;
+        t_start = (int)restart->iteration;
+    }
+    int ckpt_written = 0;
+    int ckpt_last = -1;
+
+    BatTrajMpiWriter tw;
+    if (traj->path) {
+        bat_traj_mpi_open(&tw, MPI_COMM_WORLD, traj, n_bats, dim, begin, local_n);
+    }
+
+    BatVerifyWriter vw;
+    verify_open(&vw, verify, rank, n_bats, dim, seed, obj->name, precision);
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    bat_prof_lap(&prof, BAT_PROF_INIT);
+    double t0 = MPI_Wtime();
+
+    for (int t = t_start; t < max_iters; t++) {
+
+        /* Async mode: pick up the newest completed reduction (lag <= K) */
+        if (staleness >= 0 && async_best_collect(&ab, &br, t, &stats, best_x)) {
+            best_value = stats.best_value;
+        }
+
+        /* Async mode: a stop decided on an older record takes effect here */
+        if (staleness >= 0 && ab.stop_at >= 0 && t >= ab.stop_at) {
+            break;
+        }
+        bat_prof_lap(&prof, BAT_PROF_COMM);
+
+        /* Update the local tiles; the kernel accumulates the local statistics */
+        BatStats next_stats;
+        bat_stats_reset(&next_stats);
+        const double update_t0 = MPI_Wtime();
+        bat_pop_update(&pop, 0, pop.n_tiles, best_x, &stats, &next_stats, t, scratch);
+        bat_balance_add_busy(&bal, MPI_Wtime() - update_t0);
+        bat_prof_lap(&prof, BAT_PROF_UPDATE);
+
+        /* Digest before the exchange, while next_stats are still local */
+        if (bat_verify_due(verify, t)) {
+            bat_pop_get_x(&pop, (int)(next_stats.best_index - pop.index_offset), local_x);
+            verify_digest(&vw, &br, t, &next_stats, local_x, verify_x, bat_verify_hash_pop(&pop, 0, local_n), rank);
+            bat_prof_lap(&prof, BAT_PROF_IO);
+        }
+
+        /* This rank's wall-clock vote travels with the statistics */
+        if (bat_stop_due(stop, t)) {
+            next_stats.stop_votes = bat_stop_time_up(stop, MPI_Wtime() - t0);
+        }
+
+        if (staleness >= 0) {
+            /* Post the reduction of this iteration and keep computing */
+            bat_pop_get_x(&pop, (int)(next_stats.best_index - pop.index_offset), local_x);
+            async_best_post(&ab, &br, &next_stats, local_x, t);
+        } else {
+            /* Global best and global statistics for the next iteration */
+            best_value = exchange_best_pop(&pop, &next_stats, best_x, local_x, &br, &shm, exchange, rank);
+            stats = next_stats;
+        }
+        bat_prof_lap(&prof, BAT_PROF_COMM);
+
+        if (!quiet && rank == 0 && t % 1000 == 0) {
+            printf("[Iter %d] Global best = %f\n", t, best_value);
+        }
+
+        traj_frame_pop(&tw, traj, &pop, t);
+        bat_prof_lap(&prof, BAT_PROF_IO);
+
+        /* Same reduced record on every rank => same decision */
+        if (staleness < 0 && bat_stop_due(stop, t)) {
+            stop_reason = bat_stop_check(stop, &stop_state, t, best_value, stats.stop_votes > 0.0);
+            if (stop_reason != BAT_STOP_NONE) {
+                iters_done = t + 1;
+                break;
+            }
+        }
+        bat_prof_lap(&prof, BAT_PROF_REDUCE);
+
+        if (bat_ckpt_due(ckpt, t)) {
+            bat_ckpt_store_pop(ckpt_records, &pop, 0, local_n);
+            bat_ckpt_mpi_save(MPI_COMM_WORLD, ckpt, ckpt_records, n_bats, dim, t + 1, seed, &stats,
+                              best_value, &stop_state, obj->name, best_x, begin, local_n);
+            ckpt_written++;
+            ckpt_last = t + 1;
+        }
+        bat_prof_lap(&prof, BAT_PROF_IO);
+
+        /* Resize the blocks after the slowest rank (same decision on every rank) */
+        if (bat_balance_due(&bal, t) && bat_balance_plan(&bal)) {
+            rebalance_pop(&bal, &pop, ckpt, &ckpt_records, &tw, traj);
+            bat_balance_local(&bal, &begin, &local_n);
+        }
+        bat_prof_lap(&prof, BAT_PROF_COMM);
+    }
+    bat_prof_lap(&prof, BAT_PROF_REDUCE);
+
+    /* Async mode: the final result is the last posted reduction */
+    double eff_staleness = 0.0;
+    if (staleness >= 0) {
+        async_best_collect(&ab, &br, -1, &stats, best_x);
+        best_value = stats.best_value;
+        eff_staleness = async_best_effective_staleness(&ab);
+        if (ab.stop_at >= 0 && ab.stop_at < max_iters) {
+            stop_reason = ab.stop_reason;
+            iters_done = ab.stop_at;
+        }
+        async_best_free(&ab);
+    }
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double local_elapsed = MPI_Wtime() - t0;
+    bat_prof_lap(&prof, BAT_PROF_COMM);
+    double elapsed = 0.0;
+    MPI_Reduce(&local_elapsed, &elapsed, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    eff_staleness = mean_over_ranks(eff_staleness, size);
+    if (xo->rebalance_every > 0) {
+        bat_balance_finish(&bal);
+    }
+    BatProfSummary prof_sum = prof_finish(&prof);
+    BatPlacement placement = placement_finish();
+
+    if (traj->path) {
+        bat_traj_mpi_close(&tw);
+    }
+    int rc = verify_close(&vw, verify, rank);
+
+    if (ckpt->path && ckpt_last != iters_done) {
+        bat_ckpt_store_pop(ckpt_records, &pop, 0, local_n);
+        bat_ckpt_mpi_save(MPI_COMM_WORLD, ckpt, ckpt_records, n_bats, dim, iters_done, seed, &stats,
+                          best_value, &stop_state, obj->name, best_x, begin, local_n);
+        ckpt_written++;
+    }
+
+    if (rank == 0) {
+        if (!quiet) {
+            print_stopped(stop_reason, iters_done);
+            printf("\nFinal best f_value = %f\n", best_value);
+            printf("Final position = (");
+            for (int d = 0; d < dim; d++) {
+                printf("%s%f", d == 0 ? "" : ", ", best_x[d]);
+            }
+            printf(")\n");
+        }
+        printf("BENCH version=mpi n_bats=%d iters=%d procs=%d threads=1 time_s=%.6f layout=soa dim=%d kernel=%s objective=%s exchange=%s" BAT_BUILD_BENCH,
+               n_bats, max_iters, size, elapsed, dim, pop.kernel_name, obj->name, best_exchange_name(exchange));
+        if (exchange == BEST_EXCHANGE_SHM) {
+            bat_best_shm_print_bench(&shm);
+        }
+        bat_precision_print_bench(precision, bat_pop_bytes_per_bat(dim, precision));
+        print_staleness(staleness, eff_staleness);
+        bat_balance_print_bench(&bal);
+        bat_stop_print_bench(stop, iters_done, stop_reason);
+        bat_traj_print_bench(traj, traj->path ? tw.frames : 0);
+        bat_ckpt_print_bench(ckpt, t_start, ckpt_written);
+        bat_verify_print_bench(verify, verify->path ? vw.digests : 0);
+        bat_prof_print_bench(&prof_sum);
+        bat_placement_print_bench(&placement);
+        printf("\n");
+    }
+
+    if (exchange == BEST_EXCHANGE_SHM) {
+        bat_best_shm_free(&shm);
+    }
+    bat_best_record_free(&br);
+    bat_balance_free(&bal);
+    free(ckpt_records);
+    free(best_x);
+    free(local_x);
+    free(verify_x);
+    free(scratch);
+    bat_pop_free(&pop);
+    return rc;
+}
+
+/*
+ * Global best for the AoS layout, "bcast" mode.
+ *
+ * Goal:
+ * After each iteration, every rank has its own local_best.
+ * We need to determine which rank owns the best solution overall
+ * and make this solution available to all ranks.
+ */
+static void exchange_best_aos_bcast(const Bat *local_best, Bat *global_best, int rank) {
+    /*
+     * Step 1:
+     * Reduce only the objective value (f_value) together with the rank.
+     * We cannot directly reduce a Bat structure, so we use MPI_MAXLOC
+     * on a (value, rank) pair.
+     */
+    struct {
+        double value;
+        int rank;
+    } local_data, global_data;
+
+    /* Prepare local contribution: best score on this rank */
+    local_data.value = local_best->f_value;
+    local_data.rank  = rank;
+
+    /* Find the maximum objective value and the rank that owns it */
+    MPI_Allreduce(
+        &local_data,
+        &global_data,
+        1,
+        MPI_DOUBLE_INT,
+        MPI_MAXLOC,
+        MPI_COMM_WORLD
+    );
+
+    /*
+     * Step 2:
+     * Now all ranks know which rank owns the global best solution.
+     * That rank copies its local_best into global_best.
+     */
+    if (rank == global_data.rank) {
+        *global_best = *local_best;
+    }
+    /*
+     * Step 3:
+     * Broadcast the full global_best structure from the owning rank
+     * so that all ranks use the same global best in the next iteration.
+     */
+    MPI_Bcast(
+        global_best,
+        sizeof(Bat),
+        MPI_BYTE,
+        global_data.rank,
+        MPI_COMM_WORLD
+    );
+}
+
+/*
+ * Global best and global statistics for the AoS layout.
+ * In fused mode only x_i and f_value of global_best are updated: these
+ * are the only fields update_bat() reads from the best bat.
+ *
+ * Parameters:
+ *   - local_best  : best bat of this rank
+ *   - global_best : output, global best bat (all ranks)
+ *   - stats       : local statistics in, global statistics out
+ *   - br          : fused exchange buffers
+ *   - shm         : node window (shm mode only)
+ *   - exchange    : exchange mode
+ *   - rank        : rank of this process
+ */
+static void exchange_best_aos(const Bat *local_best, Bat *global_best, BatStats *stats,
+                              BatBestRecord *br, BatBestShm *shm, BestExchange exchange, int rank) {
+    if (exchange == BEST_EXCHANGE_BCAST) {
+        allreduce_stats(stats);
+        exchange_best_aos_bcast(local_best, global_best, rank);
+        return;
+    }
+    if (exchange == BEST_EXCHANGE_SHM) {
+        global_best->f_value = bat_best_shm_exchange(shm, br, stats, local_best->x_i, global_best->x_i);
+        return;
+    }
+    global_best->f_value = bat_best_exchange(br, stats, local_best->x_i, global_best->x_i);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Island model (--island)                                                 */
+/* ---------------------------------------------------------------------- */
+
+static void migrant_pack_aos(const Bat *bat, double *rec) {
+    rec[BAT_MIGRANT_F] = bat->f_value;
+    rec[BAT_MIGRANT_A] = bat->A_i;
+    rec[BAT_MIGRANT_R] = bat->r_i;
+    for (int d = 0; d < dimension; d++) {
+        rec[BAT_MIGRANT_X + d] = bat->x_i[d];
+        rec[BAT_MIGRANT_X + dimension + d] = bat->v_i[d];
+    }
+}
+
+/* The immigrant takes the place of *bat, which keeps its own RNG stream. */
+static void migrant_unpack_aos(Bat *bat, const double *rec) {
+    bat->f_value = rec[BAT_MIGRANT_F];
+    bat->A_i = rec[BAT_MIGRANT_A];
+    bat->r_i = rec[BAT_MIGRANT_R];
+    for (int d = 0; d < dimension; d++) {
+        bat->x_i[d] = rec[BAT_MIGRANT_X + d];
+        bat->v_i[d] = rec[BAT_MIGRANT_X + dimension + d];
+    }
+}
+
+static void migrant_pack_soa(const BatPopulation *pop, int i, double *rec) {
+    int dim = pop->dim;
+    rec[BAT_MIGRANT_F] = pop->f_value[i];
+    rec[BAT_MIGRANT_A] = bat_pop_A(pop, i);
+    rec[BAT_MIGRANT_R] = bat_pop_r(pop, i);
+    for (int d = 0; d < dim; d++) {
+        rec[BAT_MIGRANT_X + d] = bat_pop_x(pop, bat_pop_offset(dim, i, d));
+        rec[BAT_MIGRANT_X + dim + d] = bat_pop_v(pop, bat_pop_offset(dim, i, d));
+    }
+}
+
+static void migrant_unpack_soa(BatPopulation *pop, int i, const double *rec) {
+    int dim = pop->dim;
+    pop->f_value[i] = rec[BAT_MIGRANT_F];
+    bat_pop_set_A(pop, i, rec[BAT_MIGRANT_A]);
+    bat_pop_set_r(pop, i, rec[BAT_MIGRANT_R]);
+    for (int d = 0; d < dim; d++) {
+        bat_pop_set_x(pop, bat_pop_offset(dim, i, d), rec[BAT_MIGRANT_X + d]);
+        bat_pop_set_v(pop, bat_pop_offset(dim, i, d), rec[BAT_MIGRANT_X + dim + d]);
+    }
+}
+
+/*
+ * End of an island run: reduces the global best once (fused record), stops
+ * the timer and prints the report with the migration traffic.
+ *
+ * Parameters:
+ *   - stats   : local statistics of the final population
+ *   - local_x : position of the local best (dim doubles)
+ *   - kernel  : SoA kernel name, or NULL for the AoS layout
+ *   - precision : precision of the SoA store
+ *   - t0      : start time of the iteration loop
+ *   - traj    : trajectory options, tw: its writer (closed here)
+ *   - prof    : timers of this rank (stopped here)
+ */
+static void island_report(int rank, int size, int n_bats, int max_iters, int quiet, int dim,
+                          const char *kernel, BatPrecision precision, const BatObjective *obj, const ExchangeOptions *xo,
+                          BatIslands *isl, BatStats *stats, const double *local_x, double t0,
+                          const BatTrajOptions *traj, BatTrajMpiWriter *tw, BatProf *prof) {
+    double *best_x = malloc((size_t)dim * sizeof(double));
+    if (!best_x) {
+        perror("malloc best");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    BatBestRecord br;
+    bat_best_record_init(&br, MPI_COMM_WORLD, dim);
+    double best_value = bat_best_exchange(&br, stats, local_x, best_x);
+    bat_best_record_free(&br);
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double local_elapsed = MPI_Wtime() - t0;
+    bat_prof_lap(prof, BAT_PROF_COMM);
+    double elapsed = 0.0;
+    MPI_Reduce(&local_elapsed, &elapsed, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    BatProfSummary prof_sum = prof_finish(prof);
+    BatPlacement placement = placement_finish();
+
+    double traffic[2] = { (double)isl->msgs_sent, isl->bytes_sent };
+    double total[2] = { 0.0, 0.0 };
+    MPI_Reduce(traffic, total, 2, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    if (traj->path) {
+        bat_traj_mpi_close(tw);
+    }
+
+    if (rank == 0) {
+        if (!quiet) {
+            printf("\nFinal best f_value = %f\n", best_value);
+            printf("Final position = (");
+            for (int d = 0; d < dim; d++) {
+                printf("%s%f", d == 0 ? "" : ", ", best_x[d]);
+            }
+            printf(")\n");
+        }
+        printf("BENCH version=mpi n_bats=%d iters=%d procs=%d threads=1 time_s=%.6f layout=%s dim=%d" BAT_BUILD_BENCH,
+               n_bats, max_iters, size, elapsed, kernel ? "soa" : "aos", dim);
+        if (kernel) {
+            printf(" kernel=%s", kernel);
+        }
+        printf(" objective=%s exchange=island topology=%s migrate_every=%d migrate_k=%d migr_msgs=%.0f migr_bytes=%.0f",
+               obj->name, bat_topology_name(xo->topology), xo->migrate_every, xo->migrate_k,
+               total[0], total[1]);
+        bat_precision_print_bench(precision, kernel ? bat_pop_bytes_per_bat(dim, precision) : sizeof(Bat));
+        bat_traj_print_bench(traj, traj->path ? tw->frames : 0);
+        bat_prof_print_bench(&prof_sum);
+        bat_placement_print_bench(&placement);
+        printf("\n");
+    }
+    free(best_x);
+}
+
+/*
+ * Island model on the SoA store. Each rank initializes its own bats and
+ * moves them around its local best; migrants are exchanged every M
+ * iterations and integrated one iteration later.
+ */
+static int run_islands_soa(int rank, int size, int n_bats, int max_iters, unsigned int seed, int quiet, int dim,
+                           BatPrecision precision, const BatObjective *obj, const ExchangeOptions *xo, const BatTrajOptions *traj) {
+    long begin;
+    int local_n;
+    bat_partition(n_bats, size, rank, &begin, &local_n);
+
+    BatPopulation pop;
+    if (bat_pop_alloc(&pop, local_n, dim, precision) != 0) {
+        perror("alloc population");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    BatIslands isl;
+    size_t max_in = (size_t)BAT_ISLAND_MAX_LINKS * (size_t)xo->migrate_k;
+    double *best_x = malloc((size_t)dim * sizeof(double));
+    double *scratch = malloc(bat_pop_scratch_size(dim) * sizeof(double));
+    int *plan = malloc(2 * max_in * sizeof(int));
+    if (!best_x || !scratch || !plan ||
+        bat_islands_init(&isl, MPI_COMM_WORLD, xo->topology, xo->migrate_every, xo->migrate_k,
+                         dim, local_n, (uint32_t)seed) != 0) {
+        perror("malloc islands");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    int *dst = plan;
+    int *src = plan + max_in;
+    int *emigrants = plan;  /* reused: k <= max_in entries */
+    const int rec = BAT_MIGRANT_SIZE(dim);
+
+    BatProf prof;
+    bat_prof_begin(&prof);
+
+    /* Bats [begin, begin + local_n) of the global population */
+    bat_pop_init_seeded(&pop, (uint32_t)seed, begin, obj, scratch);
+
+    BatStats stats;
+    bat_stats_reset(&stats);
+    bat_pop_stats(&pop, 0, pop.n_tiles, &stats);
+    bat_stats_finalize(&stats);
+    bat_pop_get_x(&pop, (int)(stats.best_index - pop.index_offset), best_x);
+
+    BatTrajMpiWriter tw;
+    if (traj->path) {
+        bat_traj_mpi_open(&tw, MPI_COMM_WORLD, traj, n_bats, dim, begin, local_n);
+    }
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    bat_prof_lap(&prof, BAT_PROF_INIT);
+    double t0 = MPI_Wtime();
+
+    for (int t = 0; t < max_iters; t++) {
+
+        /* Local step: the island best plays the role of the global best */
+        BatStats next_stats;
+        bat_stats_reset(&next_stats);
+        bat_pop_update(&pop, 0, pop.n_tiles, best_x, &stats, &next_stats, t, scratch);
+        stats = next_stats;
+        bat_prof_lap(&prof, BAT_PROF_UPDATE);
+
+        /* Integrate the immigrants posted after the previous iteration */
+        if (isl.in_flight) {
+            int m = bat_islands_receive(&isl, pop.f_value, local_n, dst, src);
+            for (int j = 0; j < m; j++) {
+                migrant_unpack_soa(&pop, dst[j], isl.recv_buf + (size_t)src[j] * rec);
+            }
+            if (m > 0) {
+                bat_stats_reset(&stats);
+                bat_pop_stats(&pop, 0, pop.n_tiles, &stats);
+            }
+        }
+        bat_prof_lap(&prof, BAT_PROF_COMM);
+        bat_stats_finalize(&stats);
+        bat_pop_get_x(&pop, (int)(stats.best_index - pop.index_offset), best_x);
+        bat_prof_lap(&prof, BAT_PROF_REDUCE);
+
+        /* Every M iterations: send the top-k bats to the neighbors */
+        if (bat_islands_due(&isl, t)) {
+            bat_islands_emigrants(&isl, pop.f_value, local_n, emigrants);
+            for (int j = 0; j < xo->migrate_k; j++) {
+                migrant_pack_soa(&pop, emigrants[j], isl.send_buf + (size_t)j * rec);
+            }
+            bat_islands_post(&isl);
+        }
+        bat_prof_lap(&prof, BAT_PROF_COMM);
+
+        traj_frame_pop(&tw, traj, &pop, t);
+
+        if (!quiet && rank == 0 && t % 1000 == 0) {
+            printf("[Iter %d] Island 0 best = %f\n", t, stats.best_value);
+        }
+        bat_prof_lap(&prof, BAT_PROF_IO);
+    }
+
+    bat_islands_free(&isl);
+    island_report(rank, size, n_bats, max_iters, quiet, dim, pop.kernel_name, precision, obj, xo,
+                  &isl, &stats, best_x, t0, traj, &tw, &prof);
+
+    free(best_x);
+    free(scratch);
+    free(plan);
+    bat_pop_free(&pop);
+    return 0;
+}
+
+/*
+ * Island model on the AoS layout (local_bats = global bats [offset, offset + local_n),
+ * initialized by main(), whose timers are prof).
+ */
+static int run_islands_aos(int rank, int size, int n_bats, int max_iters, unsigned int seed, int quiet,
+                           const BatObjective *obj, const ExchangeOptions *xo, const BatTrajOptions *traj,
+                           Bat local_bats[], int local_n, long offset, BatProf *prof) {
+    BatIslands isl;
+    size_t max_in = (size_t)BAT_ISLAND_MAX_LINKS * (size_t)xo->migrate_k;
+    double *f = malloc((size_t)local_n * sizeof(double));
+    int *plan = malloc(2 * max_in * sizeof(int));
+    if (!f || !plan ||
+        bat_islands_init(&isl, MPI_COMM_WORLD, xo->topology, xo->migrate_every, xo->migrate_k,
+                         dimension, local_n, (uint32_t)seed) != 0) {
+        perror("malloc islands");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    int *dst = plan;
+    int *src = plan + max_in;
+    int *emigrants = plan;
+    const int rec = BAT_MIGRANT_SIZE(dimension);
+
+    BatStats stats;
+    bat_stats_compute(&stats, local_bats, local_n, offset);
+    Bat island_best = local_bats[stats.best_index - offset];
+
+    BatTrajMpiWriter tw;
+    if (traj->path) {
+        bat_traj_mpi_open(&tw, MPI_COMM_WORLD, traj, n_bats, dimension, offset, local_n);
+    }
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    bat_prof_lap(prof, BAT_PROF_INIT);
+    double t0 = MPI_Wtime();
+
+    for (int t = 0; t < max_iters; t++) {
+
+        /* Local step: the island best plays the role of the global best */
+        for (int i = 0; i < local_n; i++) {
+            update_bat(local_bats, &island_best, &stats, obj, i, t);
+        }
+        bat_prof_lap(prof, BAT_PROF_UPDATE);
+
+        /* Integrate the immigrants posted after the previous iteration */
+        if (isl.in_flight) {
+            for (int i = 0; i < local_n; i++) {
+                f[i] = local_bats[i].f_value;
+            }
+            int m = bat_islands_receive(&isl, f, local_n, dst, src);
+            for (int j = 0; j < m; j++) {
+                migrant_unpack_aos(&local_bats[dst[j]], isl.recv_buf + (size_t)src[j] * rec);
+            }
+        }
+        bat_prof_lap(prof, BAT_PROF_COMM);
+        bat_stats_compute(&stats, local_bats, local_n, offset);
+        island_best = local_bats[stats.best_index - offset];
+        bat_prof_lap(prof, BAT_PROF_REDUCE);
+
+        /* Every M iterations: send the top-k bats to the neighbors */
+        if (bat_islands_due(&isl, t)) {
+            for (int i = 0; i < local_n; i++) {
+                f[i] = local_bats[i].f_value;
+            }
+            bat_islands_emigrants(&isl, f, local_n, emigrants);
+            for (int j = 0; j < xo->migrate_k; j++) {
+                migrant_pack_aos(&local_bats[emigrants[j]], isl.send_buf + (size_t)j * rec);
+            }
+            bat_islands_post(&isl);
         }
+        bat_prof_lap(prof, BAT_PROF_COMM);
+
+        traj_frame_bats(&tw, traj, local_bats, local_n, t);
+
+        if (!quiet && rank == 0 && t % 1000 == 0) {
+            printf("[Iter %d] Island 0 best = %f\n", t, island_best.f_value);
+        }
+        bat_prof_lap(prof, BAT_PROF_IO);
     }
+
+    bat_islands_free(&isl);
+    island_report(rank, size, n_bats, max_iters, quiet, dimension, NULL, BAT_PRECISION_DOUBLE, obj, xo,
+                  &isl, &stats, island_best.x_i, t0, traj, &tw, prof);
+
+    free(f);
+    free(plan);
+    return 0;
 }
 
 int main(int argc, char *argv[]) {
@@ -49,136 +1242,279 @@ int main(int argc, char *argv[]) {
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
 
-    int n_bats, max_iters;
-    int quiet;
-    unsigned int seed;
-   /* Parse command-line arguments (same on all processes) */
-    parse_args(argc, argv, &n_bats, &max_iters, &seed, &quiet);
-   
-    /* Check input parameters */
-    if (n_bats <= 0 || max_iters <= 0) {
+    /* Parse command-line arguments (same on all processes) */
+    BatOptions opt;
+    ExchangeOptions xo;
+    parse_args(argc, argv, &opt, &xo);
+
+    /* Check input parameters; every rank resolves (and, for shared objects, loads) the objective */
+    const BatObjective *obj;
+    if (bat_options_validate(&opt, rank == 0, &obj) != 0) {
+        MPI_Finalize();
+        return 1;
+    }
+
+    const int n_bats = opt.n_bats;
+    const int max_iters = opt.max_iters;
+    const unsigned int seed = opt.seed;
+    const int quiet = opt.quiet;
+    const int dim = opt.dim;
+    const BatStopCriteria *stop = &opt.stop;
+    const BatTrajOptions *traj = &opt.traj;
+    const BatCkptOptions *ckpt = &opt.ckpt;
+    const BatVerifyOptions *verify = &opt.verify;
+
+    /* A checkpoint is a synchronous snapshot of the global state */
+    if ((ckpt->path || ckpt->restart) && (xo.island || xo.staleness >= 0)) {
+        if (rank == 0) {
+            fprintf(stderr, "--checkpoint / --restart are not available with --async-best or --island\n");
+        }
+        MPI_Finalize();
+        return 1;
+    }
+
+    /* The criteria are evaluated on the global best, which islands never exchange */
+    if (xo.island && bat_stop_enabled(stop)) {
+        if (rank == 0) {
+            fprintf(stderr, "--target / --window / --time-limit are not available with --island\n");
+        }
+        MPI_Finalize();
+        return 1;
+    }
+
+    /* A digest records the global best of each iteration */
+    if (verify->path && xo.island) {
         if (rank == 0) {
-            fprintf(stderr, "Invalid parameters: n_bats=%d iters=%d\n", n_bats, max_iters);
+            fprintf(stderr, "--verify is not available with --island\n");
         }
         MPI_Finalize();
         return 1;
     }
 
-   /* Require an equal number of bats per process */
-    if (n_bats % size != 0) {
+    /* Partitions may be uneven, but every rank needs at least one bat */
+    if (n_bats < size) {
         if (rank == 0) {
-            printf("N_BATS must be divisible by number of processes\n");
-            printf("Hint: choose --n-bats divisible by procs (n_bats=%d, procs=%d)\n", n_bats, size);
+            fprintf(stderr, "Need at least one bat per process (n_bats=%d, procs=%d)\n", n_bats, size);
         }
         MPI_Finalize();
-        return 0;
+        return 1;
+    }
+
+    /* The smallest partition has n_bats / size bats */
+    if (xo.island && (xo.migrate_every < 1 || xo.migrate_k < 1 || xo.migrate_k > n_bats / size)) {
+        if (rank == 0) {
+            fprintf(stderr, "Invalid island parameters: migrate_every=%d migrate_k=%d (need 1 <= k <= %d bats per rank)\n",
+                    xo.migrate_every, xo.migrate_k, n_bats / size);
+        }
+        MPI_Finalize();
+        return 1;
+    }
+
+    /* Every rank reads the header of --restart and takes the same decision */
+    BatCkptHeader restart;
+    if (ckpt->restart &&
+        bat_ckpt_mpi_restore_header(MPI_COMM_WORLD, ckpt->restart, n_bats, dim, obj->name, max_iters, &restart) != 0) {
+        MPI_Finalize();
+        return 1;
+    }
+
+    if (opt.layout == BAT_LAYOUT_SOA) {
+        int rc = xo.island ? run_islands_soa(rank, size, n_bats, max_iters, seed, quiet, dim, opt.precision, obj, &xo,
+                                             traj)
+                           : run_soa(rank, size, n_bats, max_iters, seed, quiet, dim, opt.precision, obj, &xo, stop,
+                                     traj, ckpt, &restart, verify);
+        MPI_Finalize();
+        return rc;
     }
    
-    /* Number of bats handled by each process */
-    int local_n = n_bats / size;
+    /* Global index range [offset, offset + local_n) handled by this process */
+    long offset;
+    int local_n;
+    BatBalance bal;
+    bat_balance_init(&bal, MPI_COMM_WORLD, xo.rebalance_every, n_bats);
+    bat_balance_local(&bal, &offset, &local_n);
 
-    /* Local and global bat storage */
-    Bat *all_bats = NULL;     /* full population (on rank 0) */
-    Bat local_bats[local_n];  /* bats handled by this process */
+    /*
+     * Each rank allocates (on the heap) and initializes only its own bats:
+     * bat i only depends on (seed, i), so no rank ever holds the whole
+     * population and nothing has to be scattered.
+     */
+    BatProf prof;
+    bat_prof_begin(&prof);
+    Bat *local_bats = malloc((size_t)local_n * sizeof(Bat));
+    if (!local_bats) {
+        perror("malloc bats");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    initialize_bats_range(local_bats, 0, local_n, offset, (uint32_t)seed, obj);
    
     /* Best bat on this process and best bat globally */
     Bat local_best, global_best;
 
-    /* Rank 0 allocates and initializes the full bat population */
-    if (rank == 0) {
-        /* Rank 0 creates and initializes the full population */
-        all_bats = malloc((size_t)n_bats * sizeof(Bat));
-        initialize_bats_seeded(all_bats, n_bats, &global_best, (uint32_t)seed);
+    if (xo.island) {
+        int rc = run_islands_aos(rank, size, n_bats, max_iters, seed, quiet, obj, &xo, traj, local_bats, local_n, offset, &prof);
+        bat_balance_free(&bal);
+        free(local_bats);
+        MPI_Finalize();
+        return rc;
     }
 
-    /* Distribute the population evenly: each rank receives local_n bats */
-    MPI_Scatter(
-        all_bats,
-        local_n * sizeof(Bat),
-        MPI_BYTE,
-        local_bats,
-        local_n * sizeof(Bat),
-        MPI_BYTE,
-        0,
-        MPI_COMM_WORLD
-    );
+    /*
+     * Global statistics and global best of the initial population (input of
+     * iteration 0). This runs on every rank, so global_best is valid
+     * everywhere before the loop, not only on rank 0.
+     */
+    BatBestRecord br;
+    bat_best_record_init(&br, MPI_COMM_WORLD, dimension);
+    BatBestShm shm;
+    if (xo.exchange == BEST_EXCHANGE_SHM) {
+        bat_best_shm_init(&shm, &br);
+    }
+    memset(&global_best, 0, sizeof(global_best));
+
+    BatStats stats;
+    bat_stats_compute(&stats, local_bats, local_n, offset);
+    local_best = local_bats[stats.best_index - offset];
+    exchange_best_aos(&local_best, &global_best, &stats, &br, &shm, xo.exchange, rank);
+
+    AsyncBest ab;
+    if (xo.staleness >= 0) {
+        async_best_init(&ab, &br, xo.staleness, stop, global_best.f_value);
+    }
+
+    /* Early termination (no criterion: exactly max_iters iterations) */
+    BatStopState stop_state;
+    bat_stop_init(&stop_state, global_best.f_value);
+    BatStopReason stop_reason = BAT_STOP_NONE;
+    int iters_done = max_iters;
+
+    /* Restart: this rank's block of the file replaces its initial bats */
+    double *ckpt_records = alloc_ckpt_records(ckpt, local_n, dimension);
+    int t_start = 0;
+    if (ckpt->restart) {
+        bat_ckpt_mpi_read(MPI_COMM_WORLD, ckpt->restart, &restart, global_best.x_i, ckpt_records, offset, local_n);
+        bat_ckpt_load_bats(ckpt_records, local_bats, 0, local_n);
+        bat_ckpt_header_restore(&restart, &stats, &stop_state);
+        global_best.f_value = stats.best_value;
+        t_start = (int)restart.iteration;
+    }
+    int ckpt_written = 0;
+    int ckpt_last = -1;
+
+    /* Binary trajectory: each rank writes its own block of every frame */
+    BatTrajMpiWriter tw;
+    if (traj->path) {
+        bat_traj_mpi_open(&tw, MPI_COMM_WORLD, traj, n_bats, dimension, offset, local_n);
+    }
+
+    /* Digests of the global best and the population (rank 0 writes) */
+    BatVerifyWriter vw;
+    verify_open(&vw, verify, rank, n_bats, dimension, seed, obj->name, BAT_PRECISION_DOUBLE);
 
     /* Synchronize all ranks before starting the timed parallel section */
     MPI_Barrier(MPI_COMM_WORLD);
+    bat_prof_lap(&prof, BAT_PROF_INIT);
     double t0 = MPI_Wtime();
 
     /* Main loop  */
-    for (int t = 0; t < max_iters; t++) {
+    for (int t = t_start; t < max_iters; t++) {
+
+        /* Async mode: pick up the newest completed reduction (lag <= K) */
+        if (xo.staleness >= 0 && async_best_collect(&ab, &br, t, &stats, global_best.x_i)) {
+            global_best.f_value = stats.best_value;
+        }
+
+        /* Async mode: a stop decided on an older record takes effect here */
+        if (xo.staleness >= 0 && ab.stop_at >= 0 && t >= ab.stop_at) {
+            break;
+        }
+        bat_prof_lap(&prof, BAT_PROF_COMM);
 
         /* Update the bats owned by this rank */
+        const double update_t0 = MPI_Wtime();
         for (int i = 0; i < local_n; i++) {
-            update_bat(local_bats, local_n, &global_best, i, t);
-        }
-
-        /* Determine the best bat on this rank */
-        local_best = local_bats[0];
-        for (int i = 1; i < local_n; i++) {
-            if (local_bats[i].f_value > local_best.f_value) {
-                local_best = local_bats[i];
-            }
-        }
-
-       
-        /* Global best computation  
-         *
-         * Goal:
-         * After each iteration, every rank has its own local_best.
-         * We need to determine which rank owns the best solution overall
-         * and make this solution available to all ranks.
-         *
-         * Step 1:
-         * Reduce only the objective value (f_value) together with the rank.
-         * We cannot directly reduce a Bat structure, so we use MPI_MAXLOC
-         * on a (value, rank) pair.
-         */
-        struct {
-            double value;
-            int rank;
-        } local_data, global_data;
-       
-        /* Prepare local contribution: best score on this rank */
-        local_data.value = local_best.f_value;
-        local_data.rank  = rank;
-       
-        /* Find the maximum objective value and the rank that owns it */
-        MPI_Allreduce(
-            &local_data,
-            &global_data,
-            1,
-            MPI_DOUBLE_INT,
-            MPI_MAXLOC,
-            MPI_COMM_WORLD
-        );
-
-        /*
-         * Step 2:
-         * Now all ranks know which rank owns the global best solution.
-         * That rank copies its local_best into global_best.
-         */
-        if (rank == global_data.rank) {
-            global_best = local_best;
-        }
-        /*
-         * Step 3:
-         * Broadcast the full global_best structure from the owning rank
-         * so that all ranks use the same global best in the next iteration.
-         */
-        MPI_Bcast(
-            &global_best,
-            sizeof(Bat),
-            MPI_BYTE,
-            global_data.rank,
-            MPI_COMM_WORLD
-        );
+            update_bat(local_bats, &global_best, &stats, obj, i, t);
+        }
+        bat_balance_add_busy(&bal, MPI_Wtime() - update_t0);
+        bat_prof_lap(&prof, BAT_PROF_UPDATE);
+
+        /* Determine the best bat on this rank and the local statistics */
+        BatStats local_stats;
+        bat_stats_compute(&local_stats, local_bats, local_n, offset);
+        local_best = local_bats[local_stats.best_index - offset];
+        bat_prof_lap(&prof, BAT_PROF_REDUCE);
+
+        /* Digest before the exchange, while local_stats are still local */
+        if (bat_verify_due(verify, t)) {
+            double verify_x[dimension];
+            verify_digest(&vw, &br, t, &local_stats, local_best.x_i, verify_x,
+                          bat_verify_hash_bats(local_bats, 0, local_n, offset), rank);
+            bat_prof_lap(&prof, BAT_PROF_IO);
+        }
+
+        /* This rank's wall-clock vote travels with the statistics */
+        if (bat_stop_due(stop, t)) {
+            local_stats.stop_votes = bat_stop_time_up(stop, MPI_Wtime() - t0);
+        }
+
+        if (xo.staleness >= 0) {
+            /* Post the reduction of this iteration and keep computing */
+            async_best_post(&ab, &br, &local_stats, local_best.x_i, t);
+        } else {
+            /* Global best and global statistics for the next iteration */
+            stats = local_stats;
+            exchange_best_aos(&local_best, &global_best, &stats, &br, &shm, xo.exchange, rank);
+        }
+        bat_prof_lap(&prof, BAT_PROF_COMM);
+
         /* Periodic progress output (only on rank 0) */
         if (!quiet && rank == 0 && t % 1000 == 0) {
             printf("[Iter %d] Global best = %f\n", t, global_best.f_value);
         }
+
+        traj_frame_bats(&tw, traj, local_bats, local_n, t);
+        bat_prof_lap(&prof, BAT_PROF_IO);
+
+        /* Same reduced record on every rank => same decision */
+        if (xo.staleness < 0 && bat_stop_due(stop, t)) {
+            stop_reason = bat_stop_check(stop, &stop_state, t, global_best.f_value, stats.stop_votes > 0.0);
+            if (stop_reason != BAT_STOP_NONE) {
+                iters_done = t + 1;
+                break;
+            }
+        }
+        bat_prof_lap(&prof, BAT_PROF_REDUCE);
+
+        /* Checkpoint after the stop check, so the saved stall window includes t */
+        if (bat_ckpt_due(ckpt, t)) {
+            bat_ckpt_store_bats(ckpt_records, local_bats, 0, local_n);
+            bat_ckpt_mpi_save(MPI_COMM_WORLD, ckpt, ckpt_records, n_bats, dimension, t + 1, seed, &stats,
+                              global_best.f_value, &stop_state, obj->name, global_best.x_i, offset, local_n);
+            ckpt_written++;
+            ckpt_last = t + 1;
+        }
+        bat_prof_lap(&prof, BAT_PROF_IO);
+
+        /* Resize the blocks after the slowest rank (same decision on every rank) */
+        if (bat_balance_due(&bal, t) && bat_balance_plan(&bal)) {
+            rebalance_bats(&bal, &local_bats, ckpt, &ckpt_records, &tw, traj);
+            bat_balance_local(&bal, &offset, &local_n);
+        }
+        bat_prof_lap(&prof, BAT_PROF_COMM);
+    }
+    bat_prof_lap(&prof, BAT_PROF_REDUCE);
+
+    /* Async mode: the final result is the last posted reduction */
+    double eff_staleness = 0.0;
+    if (xo.staleness >= 0) {
+        async_best_collect(&ab, &br, -1, &stats, global_best.x_i);
+        global_best.f_value = stats.best_value;
+        eff_staleness = async_best_effective_staleness(&ab);
+        if (ab.stop_at >= 0 && ab.stop_at < max_iters) {
+            stop_reason = ab.stop_reason;
+            iters_done = ab.stop_at;
+        }
+        async_best_free(&ab);
     }
 
     /* Synchronize all ranks before stopping the timer */
@@ -187,14 +1523,36 @@ int main(int argc, char *argv[]) {
    
    /* Measure local execution time */
     double local_elapsed = t1 - t0;
+    bat_prof_lap(&prof, BAT_PROF_COMM);
    
     /* Compute the global execution time (maximum over all ranks) */
     double elapsed = 0.0;
     MPI_Reduce(&local_elapsed, &elapsed, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    eff_staleness = mean_over_ranks(eff_staleness, size);
+    if (xo.rebalance_every > 0) {
+        bat_balance_finish(&bal);
+    }
+    BatProfSummary prof_sum = prof_finish(&prof);
+    BatPlacement placement = placement_finish();
+
+    /* Complete the trajectory writes (outside the timed loop) */
+    if (traj->path) {
+        bat_traj_mpi_close(&tw);
+    }
+    int rc = verify_close(&vw, verify, rank);
+
+    /* Final state, so that the run can be extended with a larger --iters */
+    if (ckpt->path && ckpt_last != iters_done) {
+        bat_ckpt_store_bats(ckpt_records, local_bats, 0, local_n);
+        bat_ckpt_mpi_save(MPI_COMM_WORLD, ckpt, ckpt_records, n_bats, dimension, iters_done, seed, &stats,
+                          global_best.f_value, &stop_state, obj->name, global_best.x_i, offset, local_n);
+        ckpt_written++;
+    }
    
     /* Final output and benchmark report (rank 0 only) */
     if (rank == 0) {
         if (!quiet) {
+            print_stopped(stop_reason, iters_done);
             printf("\nFinal best f_value = %f\n", global_best.f_value);
             printf("Final position = (");
             for (int d = 0; d < dimension; d++) {
@@ -203,12 +1561,30 @@ int main(int argc, char *argv[]) {
             printf(")\n");
         }
          /* Machine-readable benchmark line */
-         printf("BENCH version=mpi n_bats=%d iters=%d procs=%d threads=1 time_s=%.6f\n",
-             n_bats, max_iters, size, elapsed);
-        /* Free global population allocated on rank 0 */
-        free(all_bats);
+         printf("BENCH version=mpi n_bats=%d iters=%d procs=%d threads=1 time_s=%.6f layout=aos dim=%d objective=%s exchange=%s" BAT_BUILD_BENCH,
+             n_bats, max_iters, size, elapsed, dimension, obj->name, best_exchange_name(xo.exchange));
+         if (xo.exchange == BEST_EXCHANGE_SHM) {
+             bat_best_shm_print_bench(&shm);
+         }
+         bat_precision_print_bench(BAT_PRECISION_DOUBLE, sizeof(Bat));
+         print_staleness(xo.staleness, eff_staleness);
+         bat_balance_print_bench(&bal);
+         bat_stop_print_bench(stop, iters_done, stop_reason);
+         bat_traj_print_bench(traj, traj->path ? tw.frames : 0);
+         bat_ckpt_print_bench(ckpt, t_start, ckpt_written);
+         bat_verify_print_bench(verify, verify->path ? vw.digests : 0);
+         bat_prof_print_bench(&prof_sum);
+         bat_placement_print_bench(&placement);
+         printf("\n");
     }
 
+    if (xo.exchange == BEST_EXCHANGE_SHM) {
+        bat_best_shm_free(&shm);
+    }
+    bat_best_record_free(&br);
+    bat_balance_free(&bal);
+    free(ckpt_records);
+    free(local_bats);
     MPI_Finalize();
-    return 0;
+    return rc;
 }
@@ -1,3 +1,4 @@
+#include <float.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
@@ -6,48 +7,769 @@
 
 #include "bat.h"
 #include "bat_utils.h"
+#include "bat_stats.h"
+#include "bat_pop.h"
+#include "bat_stop.h"
+#include "bat_traj.h"
+#include "bat_ckpt.h"
+#include "bat_verify.h"
+#include "bat_options.h"
+#include "bat_prof.h"
+#include "bat_sched.h"
+#include "bat_host.h"
 
 /*
  * OpenMP version of the Bat Algorithm.
  *
  * Idea:
  * - We keep a shared array bats[] in memory.
- * - Each iteration, we update all bats in parallel (omp for).
- * - Each thread tracks its best bat (thread_best).
- * - At the end, we merge the thread bests to get the iteration best (iter_best).
+ * - ONE parallel region spans the whole iteration loop (no fork/join per
+ *   iteration). Each iteration has two phases:
+ *     1. update: every thread updates its static share of the bats and
+ *        accumulates its partial statistics (loudness sums + best value and
+ *        index) into its own cache-line-padded slot
+ *     2. reduce (after a barrier): every thread merges the slots, which
+ *        gives the statistics and the best bat for the next iteration
+ * - Generations: a slot holds two generations, t & 1. Iteration t writes
+ *   generation t & 1 while late threads still merge t - 1 from the other
+ *   one, so only the barrier of phase 1 is needed. The thread that finds
+ *   a new best for its slot copies that bat (its position with SoA) into
+ *   the generation while no other thread writes it: the inputs of an
+ *   iteration are frozen copies, bats[] is only written by the updates.
+ *   The best is reduced as a (value, index) pair: no critical section.
+ * - Output, stopping criteria, checkpoints, chunk tuning and team planning
+ *   run on one thread (the bookkeeping thread, a single block) in the
+ *   iterations that need them; the barrier at its end publishes their
+ *   decisions.
+ * - With --layout soa, threads share a BatPopulation (structure of arrays)
+ *   and each one runs the block kernel on its static range of tiles.
+ * - The population is initialized inside the same region with the same
+ *   static partition, so pages are first-touched by their owning thread
+ *   (NUMA locality) and the values match the serial initializer.
+ * - The stopping criteria (bat_stop.h) are evaluated by the bookkeeping
+ *   thread; its decision is published by the barrier of the single block, so all
+ *   threads leave the loop after the same iteration.
+ * - --traj FILE: the bookkeeping thread copies the positions into a frame
+ *   buffer while the others are parked at the barrier; a background
+ *   thread writes the frames (bat_traj.h).
+ * - --checkpoint / --restart (bat_ckpt.h): a restart reloads the saved
+ *   bats with the same static partition as the initializer; checkpoints
+ *   are written by the bookkeeping thread, after the stop check.
+ * - --verify (bat_verify.h): every thread adds the checksum of the bats it
+ *   just updated to its slot; the bookkeeping thread sums the slots and
+ *   writes the digest.
+ * - `make PROFILE=1`: every thread times its phases (bat_prof.h); the
+ *   barrier waits show the load imbalance, the single block the serial
+ *   bookkeeping.
+ * - --schedule dynamic|tasks [--chunk N] (bat_sched.h): the update phase
+ *   hands out chunks of bats (tiles with SoA) to the idle threads, or runs
+ *   them as tasks; the partial statistics of a chunk go to the slot of the
+ *   thread that ran it. The chunk is tuned by the bookkeeping thread unless
+ *   --chunk is given. Every thread times its share of the phase: the busy
+ *   and idle (barrier) times are reported per thread on the BENCH line.
+ *   With tasks, the tasks mostly run inside the barrier: PROFILE=1 charges
+ *   them to the wait phase, the busy times do not.
+ * - --threads auto (bat_sched.h): the team sizes are timed at startup, the
+ *   first iterations measure the cost of a work item, then the
+ *   bookkeeping thread plans the team. A new team size ends the parallel
+ *   region after its block and the loop continues in a region of the new
+ *   size (an "epoch"); only the first epoch initializes the population.
  */
 
-static void parse_args(int argc, char **argv, int *n_bats, int *max_iters, unsigned int *seed, int *quiet) {
-    *n_bats = N_BATS;
-    *max_iters = MAX_ITERS;
-    *seed = (unsigned int)time(NULL);
-    *quiet = 0;
+/*
+ * What one thread contributes to the generation of iteration t. The slots
+ * keep two of them, indexed by t & 1: iteration t fills gen[t & 1] while
+ * the threads that are still merging iteration t - 1 read gen[(t - 1) & 1].
+ */
+typedef struct {
+    BatStats s;             /* partial statistics of the thread's bats */
+    uint64_t verify_sum;    /* their checksum (--verify) */
+    int t;                  /* iteration held; any other value: empty */
+    Bat best;               /* AoS: copy of the best bat of s */
+    double *best_x;         /* SoA: its position (dim doubles) */
+} GenPart;
+
+/* Partial results of one thread, alone on its cache line(s). */
+typedef struct {
+    GenPart gen[2];         /* generations t & 1 (see GenPart) */
+    double *scratch;        /* local-search candidates of this thread (SoA) */
+    double phase_t0;        /* start of the current update phase */
+    double phase_time;      /* its length, barrier included */
+    double phase_sum;       /* sum of the phase_time of the run */
+    double busy;            /* time spent updating bats in the run */
+    double busy_mark;       /* busy at the previous merge (--threads auto) */
+    BatProf prof;           /* phases of this thread over all the epochs */
+    int epochs;             /* parallel regions this thread took part in */
+} __attribute__((aligned(64))) ThreadSlot;
+
+/*
+ * Allocate one zeroed ThreadSlot per thread (cache-line aligned) with empty
+ * generations, followed in the same block by the best positions of the
+ * SoA generations (dim doubles each; dim = 0 for AoS).
+ */
+static ThreadSlot *alloc_slots(int threads, int dim) {
+    const size_t bytes = (size_t)threads * sizeof(ThreadSlot);
+    void *p = NULL;
+    if (posix_memalign(&p, 64, bytes + 2 * (size_t)threads * dim * sizeof(double)) != 0) {
+        return NULL;
+    }
+    memset(p, 0, bytes);
+    ThreadSlot *slots = p;
+    double *best_x = (double *)((char *)p + bytes);
+    for (int k = 0; k < threads; k++) {
+        for (int g = 0; g < 2; g++) {
+            slots[k].gen[g].t = -1;
+            slots[k].gen[g].best_x = best_x + (size_t)(2 * k + g) * dim;
+        }
+    }
+    return slots;
+}
+
+/* Inputs of the update phase of iteration t (the same on every thread, read-only). */
+typedef struct {
+    BatPopulation *pop;     /* --layout soa; NULL: AoS bats */
+    Bat *bats;
+    const Bat *best_bat;    /* AoS: best of the previous iteration (frozen copy) */
+    const double *best_x;   /* SoA: its position (frozen copy) */
+    const BatStats *stats;
+    const BatObjective *obj;
+    int n_bats;
+    int items;              /* work items: tiles (SoA) or bats (AoS) */
+    int t;
+    int verify_due;
+} UpdatePhase;
+
+/*
+ * Generation of iteration t in a slot, emptied on first use. The owner
+ * empties it itself: with --schedule tasks it may run the tasks of
+ * iteration t while the others still merge iteration t - 1.
+ */
+static GenPart *gen_part(ThreadSlot *slot, int t) {
+    GenPart *part = &slot->gen[t & 1];
+    if (part->t != t) {
+        bat_stats_reset(&part->s);
+        part->verify_sum = 0;
+        part->t = t;
+    }
+    return part;
+}
+
+/*
+ * Updates the work items [begin, end) and adds them to the slot. A new
+ * best of the slot is one of these bats: it is copied now, while no other
+ * thread writes it.
+ */
+static void update_items(const UpdatePhase *u, int begin, int end, ThreadSlot *slot) {
+    GenPart *part = gen_part(slot, u->t);
+    const long best_before = part->s.best_index;
+    if (u->pop) {
+        bat_pop_update(u->pop, begin, end, u->best_x, u->stats, &part->s, u->t, slot->scratch);
+        if (part->s.best_index != best_before) {
+            bat_pop_get_x(u->pop, (int)part->s.best_index, part->best_x);
+        }
+        if (u->verify_due) {
+            int last = end * BAT_POP_LANES < u->n_bats ? end * BAT_POP_LANES : u->n_bats;
+            part->verify_sum += bat_verify_hash_pop(u->pop, begin * BAT_POP_LANES, last);
+        }
+        return;
+    }
+    for (int i = begin; i < end; i++) {
+        update_bat(u->bats, u->best_bat, u->stats, u->obj, i, u->t);
+        bat_stats_add(&part->s, &u->bats[i], i);
+    }
+    if (part->s.best_index != best_before) {
+        part->best = u->bats[part->s.best_index];
+    }
+    if (u->verify_due) {
+        part->verify_sum += bat_verify_hash_bats(u->bats, begin, end, 0);
+    }
+}
+
+/*
+ * Phase 1 of an iteration, run by every thread of the team: updates all
+ * the work items with the selected schedule and returns without a barrier
+ * (the caller's barrier also completes the tasks).
+ *
+ * Parameters:
+ *   - u     : inputs of the phase
+ *   - kind  : --schedule
+ *   - chunk : work items per chunk (dynamic, tasks)
+ *   - slots : per-thread slots (generation u->t filled)
+ */
+static void update_phase(const UpdatePhase *u, BatSchedKind kind, int chunk, ThreadSlot slots[]) {
+    ThreadSlot *mine = &slots[omp_get_thread_num()];
+    mine->phase_t0 = omp_get_wtime();
+
+    switch (kind) {
+    case BAT_SCHED_STATIC:
+        #pragma omp for schedule(static) nowait
+        for (int k = 0; k < u->items; k++) {
+            update_items(u, k, k + 1, mine);
+        }
+        mine->busy += omp_get_wtime() - mine->phase_t0;
+        break;
+
+    case BAT_SCHED_DYNAMIC:
+        #pragma omp for schedule(dynamic, chunk) nowait
+        for (int k = 0; k < u->items; k++) {
+            update_items(u, k, k + 1, mine);
+        }
+        mine->busy += omp_get_wtime() - mine->phase_t0;
+        break;
+
+    case BAT_SCHED_TASKS:
+        /* Tied tasks: a slot is only written by the thread running them */
+        #pragma omp single nowait
+        for (int begin = 0; begin < u->items; begin += chunk) {
+            #pragma omp task firstprivate(begin)
+            {
+                ThreadSlot *slot = &slots[omp_get_thread_num()];
+                const double start = omp_get_wtime();
+                update_items(u, begin, begin + chunk < u->items ? begin + chunk : u->items, slot);
+                slot->busy += omp_get_wtime() - start;
+            }
+        }
+        break;
+    }
+}
+
+/* After the barrier of phase 1: the length of the phase for this thread. */
+static void end_update_phase(ThreadSlot *slot) {
+    slot->phase_time = omp_get_wtime() - slot->phase_t0;
+    slot->phase_sum += slot->phase_time;
+}
+
+/* Appends the schedule fields (bat_sched.h) with the busy / idle times of the slots. */
+static void print_sched_bench(const BatSchedOptions *sched, const BatSchedTuner *tuner, const ThreadSlot slots[],
+                              int threads) {
+    double *times = malloc(2 * (size_t)threads * sizeof(double));
+    if (!times) {
+        return;
+    }
+    for (int k = 0; k < threads; k++) {
+        times[k] = slots[k].busy;
+        times[threads + k] = slots[k].phase_sum - slots[k].busy;
+    }
+    bat_sched_print_bench(sched, tuner, times, times + threads, threads);
+    free(times);
+}
+
+/*
+ * Merges the generations of iteration t in thread order and computes the
+ * means. Every thread calls it after the barrier of the update phase and
+ * gets the same result, so no thread has to publish it. Returns the
+ * generation holding the best bat (valid until iteration t + 2, which
+ * starts after the next barrier).
+ */
+static const GenPart *merge_gen(const ThreadSlot slots[], int threads, int t, BatStats *out) {
+    const GenPart *best = NULL;
+    bat_stats_reset(out);
+    for (int k = 0; k < threads; k++) {
+        const GenPart *part = &slots[k].gen[t & 1];
+        if (part->t != t) {
+            continue;   /* this thread got no work item */
+        }
+        bat_stats_merge(out, &part->s);
+        if (part->s.best_index >= 0 && part->s.best_index == out->best_index) {
+            best = part;
+        }
+    }
+    bat_stats_finalize(out);
+    return best;
+}
+
+/*
+ * 1 if iteration t needs the bookkeeping thread and the barrier that ends its
+ * block: output, stopping criteria, checkpoint, chunk tuning or team
+ * planning while the planner measures. The other iterations go on without
+ * a second barrier. Called before the update phase, when tuner->tuning and
+ * the planner window (changed inside that block) are the same for every
+ * thread.
+ */
+static int needs_single(const BatTrajOptions *traj, const BatVerifyOptions *verify, const BatStopCriteria *stop,
+                        const BatCkptOptions *ckpt, int quiet, const BatSchedOptions *sched, const BatSchedTuner *tuner,
+                        const BatSchedPlanner *planner, int t) {
+    return bat_traj_due(traj, t) || bat_verify_due(verify, t) || bat_stop_due(stop, t) || bat_ckpt_due(ckpt, t) ||
+           tuner->tuning || (sched->threads_auto && bat_sched_planner_measuring(planner, t)) ||
+           (!quiet && t % 100 == 0);
+}
+
+/* Busy time of the team since the previous call (all the slots). */
+static double take_busy(ThreadSlot slots[], int threads) {
+    double sum = 0.0;
+    for (int k = 0; k < threads; k++) {
+        sum += slots[k].busy - slots[k].busy_mark;
+        slots[k].busy_mark = slots[k].busy;
+    }
+    return sum;
+}
+
+/* Keeps the timers of one epoch in the thread's slot (end of a parallel region). */
+static void keep_prof(ThreadSlot *slot, BatProf *prof) {
+    bat_prof_end(prof);
+    if (slot->epochs++ == 0) {
+        slot->prof = *prof;
+    } else {
+        bat_prof_merge(&slot->prof, prof);
+    }
+}
+
+/* Adds every thread that ran to the summary. */
+static void summarize_prof(const ThreadSlot slots[], int threads, BatProfSummary *sum) {
+    for (int k = 0; k < threads; k++) {
+        if (slots[k].epochs > 0) {
+            bat_prof_summary_add(sum, &slots[k].prof);
+        }
+    }
+}
+
+/* Rounds of the startup timing of a team (--threads auto), best of the repeats. */
+#define TEAM_ROUNDS 64
+#define TEAM_REPEATS 3
+
+/*
+ * Startup measurements of --threads auto: for every candidate team, the
+ * time of an empty iteration (the barrier of the update phase and the
+ * single block of the bookkeeping, which runs every iteration in this
+ * mode) and of one chunk of an empty dynamic loop.
+ */
+static void measure_teams(BatSchedPlanner *pl) {
+    const double start = omp_get_wtime();
+    for (int k = 0; k < pl->n_teams; k++) {
+        double sync = DBL_MAX, dispatch = DBL_MAX;
+        #pragma omp parallel num_threads(pl->team[k])
+        {
+            const int chunks = 16 * omp_get_num_threads();
+            for (int rep = 0; rep < TEAM_REPEATS; rep++) {
+                #pragma omp barrier
+                const double t0 = omp_get_wtime();
+                for (int r = 0; r < TEAM_ROUNDS; r++) {
+                    #pragma omp barrier
+                    #pragma omp single
+                    { }
+                }
+                const double t1 = omp_get_wtime();
+                #pragma omp for schedule(dynamic, 1)
+                for (int c = 0; c < chunks; c++) {
+                    /* empty: only the runtime's dispatch is timed */
+                }
+                const double t2 = omp_get_wtime();
+                #pragma omp master
+                {
+                    const double round = (t1 - t0) / TEAM_ROUNDS;
+                    const double loop = (t2 - t1 > round) ? t2 - t1 - round : 0.0;
+                    if (round < sync) {
+                        sync = round;
+                    }
+                    if (loop * omp_get_num_threads() / chunks < dispatch) {
+                        dispatch = loop * omp_get_num_threads() / chunks;
+                    }
+                }
+            }
+        }
+        pl->sync_s[k] = sync;
+        pl->dispatch_s[k] = dispatch;
+    }
+    pl->calib_s = omp_get_wtime() - start;
+}
+
+/*
+ * Usable threads and the team of the first epoch: --threads N, else
+ * OMP_NUM_THREADS; with --threads auto at most the CPUs of the process, and
+ * the planner's candidate teams are timed.
+ */
+static int plan_first_team(const BatSchedOptions *sched, BatSchedPlanner *planner) {
+    int threads = sched->threads > 0 ? sched->threads : omp_get_max_threads();
+    if (sched->threads_auto && threads > omp_get_num_procs()) {
+        threads = omp_get_num_procs();
+    }
+    bat_sched_planner_init(planner, sched, threads);
+    if (sched->threads_auto) {
+        measure_teams(planner);
+    }
+    return threads;
+}
+
+/*
+ * Called by the bookkeeping thread after the update phase of iteration t:
+ * feeds the planner and applies a new plan. Returns the team of the next
+ * epoch if the team must change, 0 otherwise.
+ */
+static int replan(const BatSchedOptions *sched, BatSchedPlanner *planner, BatSchedTuner *tuner, ThreadSlot slots[],
+                  int team, int items, int t) {
+    if (!sched->threads_auto) {
+        return 0;
+    }
+    if (!bat_sched_planner_record(planner, take_busy(slots, team), items, team, t)) {
+        return 0;
+    }
+    if (planner->threads != team) {
+        return planner->threads;
+    }
+    if (sched->kind != BAT_SCHED_STATIC && sched->chunk == 0) {
+        bat_sched_tuner_restart(tuner, planner->chunk);
+    }
+    return 0;
+}
+
+/* Chunk tuner of an epoch with `team` threads (started from the plan, if any). */
+static void start_tuner(BatSchedTuner *tuner, const BatSchedOptions *sched, const BatSchedPlanner *planner, int items,
+                        int team) {
+    bat_sched_tuner_init(tuner, sched, items, team);
+    if (planner->plans > 0 && sched->kind != BAT_SCHED_STATIC && sched->chunk == 0) {
+        bat_sched_tuner_restart(tuner, planner->chunk);
+    }
+}
+
+/* Checksum of the population after iteration t: sum of the per-thread partial checksums. */
+static uint64_t merge_verify_sums(const ThreadSlot slots[], int threads, int t) {
+    uint64_t sum = 0;
+    for (int k = 0; k < threads; k++) {
+        if (slots[k].gen[t & 1].t == t) {
+            sum += slots[k].gen[t & 1].verify_sum;
+        }
+    }
+    return sum;
+}
+
+/*
+ * Main loop on the SoA population store.
+ * The work items are the tiles (split statically by default); every thread
+ * owns a private scratch buffer for the local-search candidates.
+ */
+static int run_soa(int n_bats, int max_iters, unsigned int seed, int quiet, int dim, BatPrecision precision,
+                   const BatObjective *obj, const BatStopCriteria *stop, const BatTrajOptions *traj, const BatCkptOptions *ckpt,
+                   const BatVerifyOptions *verify, const BatSchedOptions *sched) {
+    BatPopulation pop;
+    if (bat_pop_alloc(&pop, n_bats, dim, precision) != 0) {
+        perror("alloc population");
+        return 1;
+    }
+
+    BatSchedPlanner planner;
+    const int threads = plan_first_team(sched, &planner);
+    double *best_x = malloc((size_t)dim * sizeof(double));
+    ThreadSlot *slots = alloc_slots(threads, dim);
+    double *ckpt_records = NULL;
+    if (ckpt->path || ckpt->restart) {
+        ckpt_records = malloc((size_t)n_bats * BAT_CKPT_RECORD(dim) * sizeof(double));
+    }
+    if (!best_x || !slots || ((ckpt->path || ckpt->restart) && !ckpt_records)) {
+        perror("malloc best/slots");
+        free(best_x);
+        free(slots);
+        free(ckpt_records);
+        bat_pop_free(&pop);
+        return 1;
+    }
+
+    /* Restart: read the whole file now, load it inside the parallel region */
+    BatCkptHeader ckpt_h;
+    int t_start = 0;
+    if (ckpt->restart) {
+        if (bat_ckpt_restore(ckpt->restart, n_bats, dim, obj->name, max_iters, &ckpt_h, best_x, ckpt_records) != 0) {
+            free(best_x);
+            free(slots);
+            free(ckpt_records);
+            bat_pop_free(&pop);
+            return 1;
+        }
+        t_start = (int)ckpt_h.iteration;
+    }
 
+    BatVerifyWriter vw;
+    if (verify->path && bat_verify_open(&vw, verify->path, "openmp", n_bats, dim, seed, obj->name,
+                                       bat_precision_name(precision)) != 0) {
+        perror(verify->path);
+        free(best_x);
+        free(slots);
+        free(ckpt_records);
+        bat_pop_free(&pop);
+        return 1;
+    }
+
+    BatTrajWriter tw;
+    if (traj->path && bat_traj_open(&tw, traj, n_bats, dim) != 0) {
+        perror(traj->path);
+        if (verify->path) {
+            bat_verify_close(&vw);
+        }
+        free(best_x);
+        free(slots);
+        free(ckpt_records);
+        bat_pop_free(&pop);
+        return 1;
+    }
+
+    bat_pop_init_begin(&pop, 0, obj);
+
+    BatStats stats;
+    int alloc_failed = 0;
+    double t0 = 0.0;
+    BatStopState stop_state;
+    BatStopReason stop_reason = BAT_STOP_NONE;
+    int iters_done = max_iters;
+    int ckpt_written = 0;
+    int ckpt_last = -1;
+    int rc = 0;
+    BatProfSummary prof_sum;
+    bat_prof_summary_init(&prof_sum);
+    BatSchedTuner tuner;
+    BatPlacement placement;
+    bat_placement_init(&placement);
+
+    /* Epochs: one parallel region per team size (a single one without --threads auto) */
+    int team = threads;
+    int t_next = t_start;
+    int epoch = 0;
+    int next_team;
+    do {
+        next_team = 0;
+        start_tuner(&tuner, sched, &planner, pop.n_tiles, team);
+
+        #pragma omp parallel num_threads(team)
+        {
+            const int tid = omp_get_thread_num();
+            BatProf prof;
+            bat_prof_begin(&prof);
+            #pragma omp critical(placement)
+            bat_placement_add_self(&placement);
+            double *scratch = malloc(bat_pop_scratch_size(dim) * sizeof(double));
+            slots[tid].scratch = scratch;
+            if (!scratch) {
+                #pragma omp atomic write
+                alloc_failed = 1;
+            }
+
+            if (epoch == 0) {
+                /*
+                 * Parallel first touch: same static partition of the tiles as the
+                 * update loop below, so each tile lives on its owner's NUMA node.
+                 */
+                #pragma omp for schedule(static)
+                for (int tile = 0; tile < pop.n_tiles; tile++) {
+                    if (!scratch) {
+                        continue;   /* the run is abandoned (alloc_failed) */
+                    }
+                    bat_pop_init_tiles(&pop, (uint32_t)seed, tile, tile + 1, scratch);
+                    if (ckpt->restart) {
+                        int end = (tile + 1) * BAT_POP_LANES < n_bats ? (tile + 1) * BAT_POP_LANES : n_bats;
+                        bat_ckpt_load_pop(ckpt_records + (size_t)tile * BAT_POP_LANES * BAT_CKPT_RECORD(dim), &pop,
+                                          tile * BAT_POP_LANES, end);
+                    }
+                }
+
+                #pragma omp single
+                {
+                    if (ckpt->restart) {
+                        bat_ckpt_header_restore(&ckpt_h, &stats, &stop_state);
+                    } else {
+                        bat_stats_reset(&stats);
+                        bat_pop_stats(&pop, 0, pop.n_tiles, &stats);
+                        bat_stats_finalize(&stats);
+                        bat_pop_get_x(&pop, (int)stats.best_index, best_x);
+                        bat_stop_init(&stop_state, stats.best_value);
+                    }
+                    t0 = omp_get_wtime();
+                }
+            }
+            bat_prof_lap(&prof, BAT_PROF_INIT);
+
+            /* Inputs of the next iteration: private copies, the same on every thread */
+            BatStats cur = stats;
+            const double *cur_x = best_x;
+
+            for (int t = t_next; t < max_iters && !alloc_failed && stop_reason == BAT_STOP_NONE && !next_team; t++) {
+
+                /* Phase 1: update the tiles (cur_x / cur are read-only) */
+                const int verify_due = bat_verify_due(verify, t);
+                const int single_due = needs_single(traj, verify, stop, ckpt, quiet, sched, &tuner, &planner, t);
+                const UpdatePhase u = { &pop, NULL, NULL, cur_x, &cur, obj, n_bats, pop.n_tiles, t, verify_due };
+                update_phase(&u, sched->kind, tuner.chunk, slots);
+                bat_prof_lap(&prof, BAT_PROF_UPDATE);
+                #pragma omp barrier
+                bat_prof_lap(&prof, BAT_PROF_WAIT);
+                end_update_phase(&slots[tid]);
+
+                /* Phase 2: every thread merges the generation of iteration t */
+                const GenPart *best = merge_gen(slots, omp_get_num_threads(), t, &cur);
+                cur_x = best->best_x;
+                bat_prof_lap(&prof, BAT_PROF_REDUCE);
+                if (!single_due) {
+                    continue;
+                }
+
+                /* Bookkeeping of iteration t: one thread, the others wait at its barrier */
+                #pragma omp single
+                {
+                    bat_sched_tuner_record(&tuner, slots[tid].phase_time);
+                    const int new_team = replan(sched, &planner, &tuner, slots, omp_get_num_threads(), pop.n_tiles, t);
+                    bat_prof_lap(&prof, BAT_PROF_REDUCE);
+
+                    if (bat_traj_due(traj, t)) {
+                        bat_traj_store_pop(bat_traj_begin(&tw), &tw.header, &pop, 0, n_bats);
+                        bat_traj_commit(&tw, t);
+                    }
+
+                    if (verify_due) {
+                        bat_verify_write(&vw, t, &cur, cur_x, merge_verify_sums(slots, omp_get_num_threads(), t));
+                    }
+
+                    if (!quiet && t % 100 == 0) {
+                        printf("[Iter %d] Best f_value = %f\n", t, cur.best_value);
+                    }
+                    bat_prof_lap(&prof, BAT_PROF_IO);
+
+                    if (bat_stop_due(stop, t)) {
+                        stop_reason = bat_stop_check(stop, &stop_state, t, cur.best_value,
+                                                     bat_stop_time_up(stop, omp_get_wtime() - t0));
+                        if (stop_reason != BAT_STOP_NONE) {
+                            iters_done = t + 1;
+                        }
+                    }
+                    bat_prof_lap(&prof, BAT_PROF_REDUCE);
+
+                    if (stop_reason == BAT_STOP_NONE && bat_ckpt_due(ckpt, t)) {
+                        if (bat_ckpt_save_pop(ckpt, ckpt_records, &pop, cur_x, t + 1, seed, &cur, &stop_state) == 0) {
+                            ckpt_written++;
+                        } else {
+                            rc = 1;
+                        }
+                        ckpt_last = t + 1;
+                    }
+
+                    /* New team: this epoch ends after iteration t */
+                    if (new_team && stop_reason == BAT_STOP_NONE && t + 1 < max_iters) {
+                        next_team = new_team;
+                        t_next = t + 1;
+                    }
+                    bat_prof_lap(&prof, BAT_PROF_IO);
+                }
+                /* implicit barrier: everyone sees the stop decision before iteration t + 1 */
+                bat_prof_lap(&prof, BAT_PROF_WAIT);
+            }
+
+            /* State of the next epoch and of the report (the team has left the update phase) */
+            #pragma omp master
+            {
+                stats = cur;
+                if (cur_x != best_x) {
+                    memcpy(best_x, cur_x, (size_t)dim * sizeof(double));
+                }
+            }
+
+            keep_prof(&slots[tid], &prof);
+            free(scratch);
+        }
+
+        epoch++;
+        if (next_team) {
+            team = next_team;
+        }
+    } while (next_team && !alloc_failed);
+    summarize_prof(slots, threads, &prof_sum);
+
+    double elapsed = omp_get_wtime() - t0;
+
+    if (traj->path && bat_traj_close(&tw) != 0) {
+        fprintf(stderr, "Writing the trajectory %s failed\n", traj->path);
+        rc = 1;
+    }
+
+    if (verify->path && bat_verify_close(&vw) != 0) {
+        fprintf(stderr, "Writing the digests %s failed\n", verify->path);
+        rc = 1;
+    }
+
+    if (alloc_failed) {
+        fprintf(stderr, "malloc scratch failed\n");
+        free(best_x);
+        free(slots);
+        free(ckpt_records);
+        bat_pop_free(&pop);
+        return 1;
+    }
+
+    if (ckpt->path && ckpt_last != iters_done) {
+        if (bat_ckpt_save_pop(ckpt, ckpt_records, &pop, best_x, iters_done, seed, &stats, &stop_state) == 0) {
+            ckpt_written++;
+        } else {
+            rc = 1;
+        }
+    }
+
+    if (!quiet) {
+        if (stop_reason != BAT_STOP_NONE) {
+            printf("\nStopped after %d iterations (%s)", iters_done, bat_stop_reason_name(stop_reason));
+        }
+        printf("\nFinal best f_value = %f\n", stats.best_value);
+        printf("Final position = (");
+        for (int d = 0; d < dim; d++) {
+            printf("%s%f", (d == 0 ? "" : ", "), best_x[d]);
+        }
+        printf(")\n");
+    }
+
+    printf("BENCH version=openmp n_bats=%d iters=%d procs=1 threads=%d time_s=%.6f layout=soa dim=%d kernel=%s objective=%s" BAT_BUILD_BENCH,
+           n_bats, max_iters, team, elapsed, dim, pop.kernel_name, obj->name);
+    bat_precision_print_bench(precision, bat_pop_bytes_per_bat(dim, precision));
+    bat_stop_print_bench(stop, iters_done, stop_reason);
+    bat_traj_print_bench(traj, traj->path ? tw.frames : 0);
+    bat_ckpt_print_bench(ckpt, t_start, ckpt_written);
+    bat_verify_print_bench(verify, verify->path ? vw.digests : 0);
+    bat_prof_print_bench(&prof_sum);
+    print_sched_bench(sched, &tuner, slots, threads);
+    bat_sched_planner_print_bench(sched, &planner, sched->kind);
+    bat_placement_print_bench(&placement);
+    printf("\n");
+
+    free(best_x);
+    free(slots);
+    free(ckpt_records);
+    bat_pop_free(&pop);
+    return rc;
+}
+
+/* Shared options (bat_options.h) and the update schedule (bat_sched.h). Returns 0, or -1 if a value is invalid. */
+static int parse_args(int argc, char **argv, BatOptions *opt, BatSchedOptions *sched) {
+    bat_options_defaults(opt);
+    bat_sched_defaults(sched);
     for (int i = 1; i < argc; i++) {
-        if (strcmp(argv[i], "--n-bats") == 0 && i + 1 < argc) {
-            *n_bats = atoi(argv[++i]);
-        } else if (strcmp(argv[i], "--iters") == 0 && i + 1 < argc) {
-            *max_iters = atoi(argv[++i]);
-        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
-            *seed = (unsigned int)strtoul(argv[++i], NULL, 10);
-        } else if (strcmp(argv[i], "--quiet") == 0) {
-            *quiet = 1;
+        int consumed = bat_options_parse_option(opt, argc, argv, &i);
+        if (consumed == 0) {
+            consumed = bat_sched_parse_option(sched, argc, argv, &i);
+        }
+        if (consumed < 0) {
+            return -1;
         }
     }
+    bat_options_finish(opt);
+    return 0;
 }
 
 int main(int argc, char **argv) {
 
-    int n_bats, max_iters;
-    int quiet;
-    unsigned int seed;
-    parse_args(argc, argv, &n_bats, &max_iters, &seed, &quiet);
-
-    if (n_bats <= 0 || max_iters <= 0) {
-        fprintf(stderr, "Invalid parameters: n_bats=%d iters=%d\n", n_bats, max_iters);
+    BatOptions opt;
+    BatSchedOptions sched_opt;
+    const BatObjective *obj;
+    if (parse_args(argc, argv, &opt, &sched_opt) != 0 || bat_options_validate(&opt, 1, &obj) != 0) {
         return 1;
     }
 
+    const int n_bats = opt.n_bats;
+    const int max_iters = opt.max_iters;
+    const unsigned int seed = opt.seed;
+    const int quiet = opt.quiet;
+    const BatStopCriteria *stop = &opt.stop;
+    const BatTrajOptions *traj = &opt.traj;
+    const BatCkptOptions *ckpt = &opt.ckpt;
+    const BatVerifyOptions *verify = &opt.verify;
+    const BatSchedOptions *sched = &sched_opt;
+
+    if (opt.layout == BAT_LAYOUT_SOA) {
+        return run_soa(n_bats, max_iters, seed, quiet, opt.dim, opt.precision, obj, stop, traj, ckpt, verify, sched);
+    }
+
     /*
      * Deterministic seed.
      * The core now uses a per-bat RNG state (stored inside each Bat), so this
@@ -55,60 +777,231 @@ int main(int argc, char **argv) {
      */
 
     Bat *bats = malloc((size_t)n_bats * sizeof(Bat));
-    if (!bats) {
+    BatSchedPlanner planner;
+    const int threads = plan_first_team(sched, &planner);
+    ThreadSlot *slots = alloc_slots(threads, 0);
+    double *ckpt_records = NULL;
+    if (ckpt->path || ckpt->restart) {
+        ckpt_records = malloc((size_t)n_bats * BAT_CKPT_RECORD(dimension) * sizeof(double));
+    }
+    if (!bats || !slots || ((ckpt->path || ckpt->restart) && !ckpt_records)) {
         perror("malloc bats");
+        free(bats);
+        free(slots);
+        free(ckpt_records);
         return 1;
     }
-    Bat best_bat;
 
-    /* Create initial bats and compute the first best bat */
-    initialize_bats_seeded(bats, n_bats, &best_bat, (uint32_t)seed);
+    /* Restart: read the whole file now, load it inside the parallel region */
+    Bat best_bat;
+    BatCkptHeader ckpt_h;
+    int t_start = 0;
+    if (ckpt->restart) {
+        if (bat_ckpt_restore(ckpt->restart, n_bats, dimension, obj->name, max_iters, &ckpt_h, best_bat.x_i, ckpt_records) != 0) {
+            free(bats);
+            free(slots);
+            free(ckpt_records);
+            return 1;
+        }
+        t_start = (int)ckpt_h.iteration;
+    }
 
-    /* Wall-clock timing around the full iteration loop. */
-    double t0 = omp_get_wtime();
+    BatVerifyWriter vw;
+    if (verify->path && bat_verify_open(&vw, verify->path, "openmp", n_bats, dimension, seed, obj->name, "double") != 0) {
+        perror(verify->path);
+        free(bats);
+        free(slots);
+        free(ckpt_records);
+        return 1;
+    }
 
-    for (int t = 0; t < max_iters; t++) {
+    BatTrajWriter tw;
+    if (traj->path && bat_traj_open(&tw, traj, n_bats, dimension) != 0) {
+        perror(traj->path);
+        if (verify->path) {
+            bat_verify_close(&vw);
+        }
+        free(bats);
+        free(slots);
+        free(ckpt_records);
+        return 1;
+    }
+    BatStats stats;
+    double t0 = 0.0;
+    BatStopState stop_state;
+    BatStopReason stop_reason = BAT_STOP_NONE;
+    int iters_done = max_iters;
+    int ckpt_written = 0;
+    int ckpt_last = -1;
+    int rc = 0;
+    BatProfSummary prof_sum;
+    bat_prof_summary_init(&prof_sum);
+    BatSchedTuner tuner;
+    BatPlacement placement;
+    bat_placement_init(&placement);
 
-        /* iter_best is the best solution from the previous iteration (read-only guide) */
-        Bat iter_best = best_bat;
-        Bat next_best = iter_best;
+    /*
+     * One parallel region for the whole run: threads are created once
+     * (once per team size with --threads auto)
+     */
+    int team = threads;
+    int t_next = t_start;
+    int epoch = 0;
+    int next_team;
+    do {
+        next_team = 0;
+        start_tuner(&tuner, sched, &planner, n_bats, team);
 
-        /* Parallel region: multiple threads work together */
-        #pragma omp parallel
+        #pragma omp parallel num_threads(team)
         {
-            /* Each thread keeps its own best bat (private variable) */
-            Bat thread_best = iter_best;
-
-            /* Split the bats between threads */
-            #pragma omp for
-            for (int i = 0; i < n_bats; i++) {
-                /* Update one bat using the best solution known at this moment */
-                update_bat(bats, n_bats, &iter_best, i, t);
-
-                /* Track the best bat seen by this thread */
-                if (bats[i].f_value > thread_best.f_value) {
-                    thread_best = bats[i];
+            const int tid = omp_get_thread_num();
+            BatProf prof;
+            bat_prof_begin(&prof);
+            #pragma omp critical(placement)
+            bat_placement_add_self(&placement);
+
+            if (epoch == 0) {
+                /*
+                 * Create the initial bats in parallel. The loop has the same bounds
+                 * and static schedule as the update loop, so every thread first
+                 * touches (and places on its NUMA node) exactly the bats it updates.
+                 * Each bat only depends on (seed, i): same values as the serial
+                 * initializer.
+                 */
+                #pragma omp for schedule(static)
+                for (int i = 0; i < n_bats; i++) {
+                    if (ckpt->restart) {
+                        bat_ckpt_load_bats(ckpt_records + (size_t)i * BAT_CKPT_RECORD(dimension), bats, i, i + 1);
+                    } else {
+                        initialize_bats_range(bats, i, i + 1, 0, (uint32_t)seed, obj);
+                    }
+                }
+
+                /* Statistics and best of the initial (or restored) population: input of iteration t_start */
+                #pragma omp single
+                {
+                    if (ckpt->restart) {
+                        bat_ckpt_header_restore(&ckpt_h, &stats, &stop_state);
+                        best_bat = bats[stats.best_index];
+                    } else {
+                        bat_stats_compute(&stats, bats, n_bats, 0);
+                        best_bat = bats[stats.best_index];
+                        bat_stop_init(&stop_state, best_bat.f_value);
+                    }
+
+                    /* Wall-clock timing around the full iteration loop. */
+                    t0 = omp_get_wtime();
                 }
             }
+            bat_prof_lap(&prof, BAT_PROF_INIT);
 
-            /* Merge the thread bests into a single iter_best (one thread at a time) */
-            #pragma omp critical
-            {
-                if (thread_best.f_value > next_best.f_value) {
-                    next_best = thread_best;
+            /* Inputs of the next iteration: private copies, the same on every thread */
+            BatStats cur = stats;
+            const Bat *cur_best = &best_bat;
+
+            for (int t = t_next; t < max_iters && stop_reason == BAT_STOP_NONE && !next_team; t++) {
+
+                /*
+                 * Phase 1: update.
+                 * cur_best (best of the previous iteration) and cur are
+                 * read-only here; each chunk of bats is written by one thread,
+                 * which adds it to its generation of its own slot.
+                 */
+                const int verify_due = bat_verify_due(verify, t);
+                const int single_due = needs_single(traj, verify, stop, ckpt, quiet, sched, &tuner, &planner, t);
+                const UpdatePhase u = { NULL, bats, cur_best, NULL, &cur, obj, n_bats, n_bats, t, verify_due };
+                update_phase(&u, sched->kind, tuner.chunk, slots);
+                bat_prof_lap(&prof, BAT_PROF_UPDATE);
+                #pragma omp barrier
+                bat_prof_lap(&prof, BAT_PROF_WAIT);
+                end_update_phase(&slots[tid]);
+
+                /*
+                 * Phase 2: reduce.
+                 * Every thread merges the (value, index) bests and the sums of
+                 * the generations of iteration t; the winning bat was copied
+                 * into its generation by the thread that updated it.
+                 */
+                cur_best = &merge_gen(slots, omp_get_num_threads(), t, &cur)->best;
+                bat_prof_lap(&prof, BAT_PROF_REDUCE);
+                if (!single_due) {
+                    continue;
+                }
+
+                /* Bookkeeping of iteration t: one thread, the others wait at its barrier */
+                #pragma omp single
+                {
+                    bat_sched_tuner_record(&tuner, slots[tid].phase_time);
+                    const int new_team = replan(sched, &planner, &tuner, slots, omp_get_num_threads(), n_bats, t);
+                    bat_prof_lap(&prof, BAT_PROF_REDUCE);
+
+                    /* Trajectory frame: the bats are frozen until the barrier */
+                    if (bat_traj_due(traj, t)) {
+                        bat_traj_store_bats(bat_traj_begin(&tw), &tw.header, bats, 0, n_bats);
+                        bat_traj_commit(&tw, t);
+                    }
+
+                    if (verify_due) {
+                        bat_verify_write(&vw, t, &cur, cur_best->x_i, merge_verify_sums(slots, omp_get_num_threads(), t));
+                    }
+
+                    if (!quiet && t % 100 == 0) {
+                        printf("[Iter %d] Best f_value = %f\n", t, cur_best->f_value);
+                    }
+                    bat_prof_lap(&prof, BAT_PROF_IO);
+
+                    /* Stopping criteria: read by every thread after the barrier */
+                    if (bat_stop_due(stop, t)) {
+                        stop_reason = bat_stop_check(stop, &stop_state, t, cur_best->f_value,
+                                                     bat_stop_time_up(stop, omp_get_wtime() - t0));
+                        if (stop_reason != BAT_STOP_NONE) {
+                            iters_done = t + 1;
+                        }
+                    }
+                    bat_prof_lap(&prof, BAT_PROF_REDUCE);
+
+                    /* Periodic checkpoint (a stopping run writes its final one below) */
+                    if (stop_reason == BAT_STOP_NONE && bat_ckpt_due(ckpt, t)) {
+                        if (bat_ckpt_save_bats(ckpt, ckpt_records, bats, n_bats, t + 1, seed, &cur, &stop_state, obj->name) == 0) {
+                            ckpt_written++;
+                        } else {
+                            rc = 1;
+                        }
+                        ckpt_last = t + 1;
+                    }
+
+                    /* New team: this epoch ends after iteration t */
+                    if (new_team && stop_reason == BAT_STOP_NONE && t + 1 < max_iters) {
+                        next_team = new_team;
+                        t_next = t + 1;
+                    }
+                    bat_prof_lap(&prof, BAT_PROF_IO);
                 }
+                /* implicit barrier of single: the stop decision is visible to all */
+                bat_prof_lap(&prof, BAT_PROF_WAIT);
+            }
+
+            /* State of the next epoch and of the report (the team has left the update phase) */
+            #pragma omp master
+            {
+                stats = cur;
+                best_bat = *cur_best;
             }
-        }
 
-        /* Save the best solution for the next iteration */
-        best_bat = next_best;
+            keep_prof(&slots[tid], &prof);
+        }
 
-        if (!quiet && t % 100 == 0) {
-            printf("[Iter %d] Best f_value = %f\n", t, best_bat.f_value);
+        epoch++;
+        if (next_team) {
+            team = next_team;
         }
-    }
+    } while (next_team);
+    summarize_prof(slots, threads, &prof_sum);
 
     if (!quiet) {
+        if (stop_reason != BAT_STOP_NONE) {
+            printf("\nStopped after %d iterations (%s)", iters_done, bat_stop_reason_name(stop_reason));
+        }
         printf("\nFinal best f_value = %f\n", best_bat.f_value);
         printf("Final position = (");
         for (int d = 0; d < dimension; d++) {
@@ -118,12 +1011,43 @@ int main(int argc, char **argv) {
     }
 
     double elapsed = omp_get_wtime() - t0;
-    /* Report the maximum number of OpenMP threads for this run. */
-    int threads = omp_get_max_threads();
-    printf("BENCH version=openmp n_bats=%d iters=%d procs=1 threads=%d time_s=%.6f\n",
-           n_bats, max_iters, threads, elapsed);
+
+    if (traj->path && bat_traj_close(&tw) != 0) {
+        fprintf(stderr, "Writing the trajectory %s failed\n", traj->path);
+        rc = 1;
+    }
+
+    if (verify->path && bat_verify_close(&vw) != 0) {
+        fprintf(stderr, "Writing the digests %s failed\n", verify->path);
+        rc = 1;
+    }
+
+    /* Final state, so that the run can be extended with a larger --iters */
+    if (ckpt->path && ckpt_last != iters_done) {
+        if (bat_ckpt_save_bats(ckpt, ckpt_records, bats, n_bats, iters_done, seed, &stats, &stop_state, obj->name) == 0) {
+            ckpt_written++;
+        } else {
+            rc = 1;
+        }
+    }
+
+    /* Report the team of the last epoch (OMP_NUM_THREADS without --threads auto). */
+    printf("BENCH version=openmp n_bats=%d iters=%d procs=1 threads=%d time_s=%.6f layout=aos dim=%d objective=%s" BAT_BUILD_BENCH,
+           n_bats, max_iters, team, elapsed, dimension, obj->name);
+    bat_precision_print_bench(BAT_PRECISION_DOUBLE, sizeof(Bat));
+    bat_stop_print_bench(stop, iters_done, stop_reason);
+    bat_traj_print_bench(traj, traj->path ? tw.frames : 0);
+    bat_ckpt_print_bench(ckpt, t_start, ckpt_written);
+    bat_verify_print_bench(verify, verify->path ? vw.digests : 0);
+    bat_prof_print_bench(&prof_sum);
+    print_sched_bench(sched, &tuner, slots, threads);
+    bat_sched_planner_print_bench(sched, &planner, sched->kind);
+    bat_placement_print_bench(&placement);
+    printf("\n");
 
     free(bats);
+    free(slots);
+    free(ckpt_records);
 
-    return 0;
+    return rc;
 }
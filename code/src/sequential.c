@@ -6,6 +6,17 @@
 
 #include "bat.h"
 #include "bat_utils.h"
+#include "bat_stats.h"
+#include "bat_pop.h"
+#include "bat_stop.h"
+#include "bat_traj.h"
+#include "bat_ckpt.h"
+#include "bat_options.h"
+#include "bat_solver.h"
+#include "bat_prof.h"
+#include "bat_host.h"
+#include "bat_verify.h"
+#include "bat_store.h"
 
 /*
  * Sequential version of the Bat Algorithm.
@@ -17,7 +28,39 @@
  *   1. Each bat's position and velocity are updated based on the global best.
  *   2. A local search is performed probabilistically.
  *   3. The global best solution is re-evaluated after all bats have moved.
+ *      The same pass accumulates the population statistics (mean loudness)
+ *      used by the local search of the next iteration.
  * - This version serves as the baseline for performance comparisons (speedup/efficiency).
+ *
+ * With --layout soa the population is stored as a BatPopulation
+ * (structure of arrays) and updated tile by tile with bat_pop_update(),
+ * through the solver handle of libbat (bat_solver.h) that other programs
+ * can embed. Same seed => same trajectory as the default AoS layout.
+ *
+ * The options common to all front-ends are parsed by bat_options.h.
+ *
+ * --target / --window / --tol / --time-limit [--check-every K] stop the
+ * run before --iters once the swarm has converged (bat_stop.h).
+ *
+ * --traj FILE [--traj-every N] [--traj-float] records the positions every
+ * N iterations in a binary file (bat_traj.h), written by a background
+ * thread. The CSV snapshots below are the historical fixed-iteration
+ * output for the report.
+ *
+ * --checkpoint FILE [--checkpoint-every K] saves the whole state every K
+ * iterations and at the end; --restart FILE continues such a run with the
+ * same trajectory as if it had never stopped (bat_ckpt.h).
+ *
+ * Built with `make PROFILE=1`, the BENCH line also gives the time of each
+ * phase of the loop (bat_prof.h).
+ *
+ * --verify FILE [--verify-every K] writes a digest of the best and of the
+ * whole population after every K-th iteration (bat_verify.h), to check
+ * that other front-ends and layouts compute exactly the same run.
+ *
+ * --store mmap:FILE [--store-block N] keeps the population out of core in
+ * a memory-mapped checkpoint file and streams it through the SoA kernel
+ * in blocks of N bats (bat_store.h); same trajectory as --layout soa.
  */
 
 
@@ -49,6 +92,38 @@ static void save_snapshot(const char *filename, Bat bats[], int n_bats) {
     fclose(fp);
 }
 
+/* Appends one snapshot line per bat of a SoA population store. */
+static void write_snapshot_pop(FILE *fp, const BatPopulation *pop) {
+    for (int i = 0; i < pop->n; i++) {
+        for (int d = 0; d < pop->dim; d++) {
+            fprintf(fp, (d == 0) ? "%f" : ",%f", bat_pop_x(pop, bat_pop_offset(pop->dim, i, d)));
+        }
+        fprintf(fp, "\n");
+    }
+}
+
+/* Same as save_snapshot(), for the SoA population store. */
+static void save_snapshot_pop(const char *filename, const BatPopulation *pop) {
+    FILE *fp = fopen(filename, "w");
+    if (!fp) {
+        perror("fopen snapshot");
+        return;
+    }
+    write_snapshot_pop(fp, pop);
+    fclose(fp);
+}
+
+/* Snapshot file name for iteration t (NULL if no snapshot is taken at t). */
+static const char *snapshot_name(int t) {
+    switch (t) {
+    case 0:    return "snapshot_t000.csv";
+    case 2500: return "snapshot_t250.csv";
+    case 5000: return "snapshot_t500.csv";
+    case 7500: return "snapshot_t750.csv";
+    default:   return NULL;
+    }
+}
+
 /*
  * Computes the elapsed time in seconds between two timestamps.
  *
@@ -62,112 +137,732 @@ static double seconds_since(const struct timespec *start, const struct timespec
 
 
 /*
- * Parses command-line arguments and sets execution parameters.
- *
- * Parameters:
- *   - argc        : number of command-line arguments
- *   - argv        : array of command-line arguments
- *   - n_bats      : number of bats in the population
- *   - max_iters   : maximum number of iterations
- *   - seed        : random seed
- *   - do_snapshot : enable or disable snapshots
- *   - quiet       : enable or disable console output
+ * Main loop on the SoA population store, driven through the libbat solver
+ * (bat_solver.h): the solver owns the population and performs the
+ * iterations, this loop adds the snapshots, trajectory, output and
+ * checkpoints. Mirrors the AoS loop in main(): same initialization, same
+ * best selection, same snapshots and output, only the storage and the
+ * kernel differ.
  */
-static void parse_args(int argc, char **argv, int *n_bats, int *max_iters, unsigned int *seed, int *do_snapshot, int *quiet) {
-    *n_bats = N_BATS;
-    *max_iters = MAX_ITERS;
-    *seed = (unsigned int)time(NULL);
-    *do_snapshot = 1;
-    *quiet = 0;
+static int run_soa(const BatOptions *o, const BatObjective *obj) {
+    const int n_bats = o->n_bats;
+    const int max_iters = o->max_iters;
+    const int dim = o->dim;
+    const BatStopCriteria *stop = &o->stop;
+    const BatTrajOptions *traj = &o->traj;
+    const BatCkptOptions *ckpt = &o->ckpt;
+    const BatVerifyOptions *verify = &o->verify;
+
+    BatSolverParams params = { n_bats, dim, max_iters, o->precision, *stop };
+    BatSolver solver;
+    if (bat_solver_alloc(&solver, &params) != 0) {
+        perror("alloc population");
+        return 1;
+    }
+    const BatPopulation *pop = &solver.pop;
+
+    double *ckpt_records = NULL;
+    if (ckpt->path || ckpt->restart) {
+        ckpt_records = malloc((size_t)n_bats * BAT_CKPT_RECORD(dim) * sizeof(double));
+        if (!ckpt_records) {
+            perror("malloc checkpoint records");
+            bat_solver_free(&solver);
+            return 1;
+        }
+    }
+
+    BatProf prof;
+    bat_prof_begin(&prof);
+
+    /* Initialize the population and find the initial best solution */
+    bat_solver_start(&solver, obj, (uint32_t)o->seed);
+    BatStopReason stop_reason = BAT_STOP_NONE;
+    int iters_done = max_iters;
+
+    /* Restart: the saved state replaces the initial population */
+    int t_start = 0;
+    if (ckpt->restart) {
+        BatCkptHeader h;
+        if (bat_ckpt_restore(ckpt->restart, n_bats, dim, obj->name, max_iters, &h, solver.best_x, ckpt_records) != 0) {
+            free(ckpt_records);
+            bat_solver_free(&solver);
+            return 1;
+        }
+        bat_ckpt_load_pop(ckpt_records, &solver.pop, 0, n_bats);
+        bat_ckpt_header_restore(&h, &solver.stats, &solver.stop_state);
+        t_start = (int)h.iteration;
+        solver.t = t_start;
+    }
+    int ckpt_written = 0;
+    int ckpt_last = -1;
+    int rc = 0;
+
+    BatVerifyWriter vw;
+    if (verify->path && bat_verify_open(&vw, verify->path, "sequential", n_bats, dim, o->seed, obj->name,
+                                       bat_precision_name(pop->precision)) != 0) {
+        perror(verify->path);
+        free(ckpt_records);
+        bat_solver_free(&solver);
+        return 1;
+    }
+
+    BatTrajWriter tw;
+    if (traj->path && bat_traj_open(&tw, traj, n_bats, dim) != 0) {
+        perror(traj->path);
+        if (verify->path) {
+            bat_verify_close(&vw);
+        }
+        free(ckpt_records);
+        bat_solver_free(&solver);
+        return 1;
+    }
+
+    bat_prof_lap(&prof, BAT_PROF_INIT);
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    for (int t = t_start; t < max_iters; t++) {
+
+        /* Iteration t: update, statistics and new best */
+        bat_solver_step(&solver);
+        double best_value = solver.stats.best_value;
+        bat_prof_lap(&prof, BAT_PROF_UPDATE);
+
+        if (o->do_snapshot && snapshot_name(t)) {
+            save_snapshot_pop(snapshot_name(t), pop);
+        }
+
+        if (bat_traj_due(traj, t)) {
+            bat_traj_store_pop(bat_traj_begin(&tw), &tw.header, pop, 0, n_bats);
+            bat_traj_commit(&tw, t);
+        }
+
+        if (bat_verify_due(verify, t)) {
+            bat_verify_write(&vw, t, &solver.stats, solver.best_x, bat_verify_hash_pop(pop, 0, n_bats));
+        }
 
+        if (!o->quiet && t % 100 == 0) {
+            printf("[Iteration %d] Best f_value = %f  Position = (", t, best_value);
+            for (int d = 0; d < dim; d++) {
+                printf("%s%f", (d == 0 ? "" : ", "), solver.best_x[d]);
+            }
+            printf(")\n");
+        }
+        bat_prof_lap(&prof, BAT_PROF_IO);
+
+        if (bat_stop_due(stop, t)) {
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            stop_reason = bat_stop_check(stop, &solver.stop_state, t, best_value,
+                                         bat_stop_time_up(stop, seconds_since(&t0, &t1)));
+            if (stop_reason != BAT_STOP_NONE) {
+                iters_done = t + 1;
+                break;
+            }
+        }
+        bat_prof_lap(&prof, BAT_PROF_REDUCE);
+
+        if (bat_ckpt_due(ckpt, t)) {
+            if (bat_ckpt_save_pop(ckpt, ckpt_records, pop, solver.best_x, t + 1, o->seed, &solver.stats, &solver.stop_state) == 0) {
+                ckpt_written++;
+            } else {
+                rc = 1;
+            }
+            ckpt_last = t + 1;
+        }
+        bat_prof_lap(&prof, BAT_PROF_IO);
+    }
+
+    /* Charges the stop check of the last iteration (if the loop broke) */
+    bat_prof_lap(&prof, BAT_PROF_REDUCE);
+    bat_prof_end(&prof);
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double elapsed = seconds_since(&t0, &t1);
+
+    if (ckpt->path && ckpt_last != iters_done) {
+        if (bat_ckpt_save_pop(ckpt, ckpt_records, pop, solver.best_x, iters_done, o->seed, &solver.stats, &solver.stop_state) == 0) {
+            ckpt_written++;
+        } else {
+            rc = 1;
+        }
+    }
+
+    if (traj->path && bat_traj_close(&tw) != 0) {
+        fprintf(stderr, "Writing the trajectory %s failed\n", traj->path);
+        rc = 1;
+    }
+
+    if (verify->path && bat_verify_close(&vw) != 0) {
+        fprintf(stderr, "Writing the digests %s failed\n", verify->path);
+        rc = 1;
+    }
+
+    if (!o->quiet) {
+        if (stop_reason != BAT_STOP_NONE) {
+            printf("Stopped after %d iterations (%s)\n", iters_done, bat_stop_reason_name(stop_reason));
+        }
+        printf("Final best f_value = %f\n", solver.stats.best_value);
+        printf("Final position = (");
+        for (int d = 0; d < dim; d++) {
+            printf("%s%f", (d == 0 ? "" : ", "), solver.best_x[d]);
+        }
+        printf(")\n");
+    }
+
+    BatProfSummary prof_sum;
+    bat_prof_summary_init(&prof_sum);
+    bat_prof_summary_add(&prof_sum, &prof);
+
+    printf("BENCH version=sequential n_bats=%d iters=%d procs=1 threads=1 time_s=%.6f layout=soa dim=%d kernel=%s objective=%s" BAT_BUILD_BENCH,
+           n_bats, max_iters, elapsed, dim, pop->kernel_name, obj->name);
+    bat_precision_print_bench(pop->precision, bat_pop_bytes_per_bat(dim, pop->precision));
+    bat_stop_print_bench(stop, iters_done, stop_reason);
+    bat_traj_print_bench(traj, traj->path ? tw.frames : 0);
+    bat_ckpt_print_bench(ckpt, t_start, ckpt_written);
+    bat_verify_print_bench(verify, verify->path ? vw.digests : 0);
+    bat_prof_print_bench(&prof_sum);
+    BatPlacement placement;
+    bat_placement_init(&placement);
+    bat_placement_add_self(&placement);
+    bat_placement_print_bench(&placement);
+    printf("\n");
+
+    free(ckpt_records);
+    bat_solver_free(&solver);
+    return rc;
+}
+
+/* Releases the block populations of run_store() (tail: NULL if none). */
+static void free_blocks(BatPopulation *full, BatPopulation *tail, double *scratch, double *best_x) {
+    if (tail) {
+        bat_pop_free(tail);
+    }
+    bat_pop_free(full);
+    free(scratch);
+    free(best_x);
+}
+
+/*
+ * Main loop on the memory-mapped store (--store mmap:FILE): the records
+ * of the file are the population. Every iteration streams them block by
+ * block through a small SoA population (a full block and the shorter last
+ * one): load, bat_pop_update(), store back. The blocks are updated in
+ * index order against the best of the previous iteration, so the run is
+ * the one of run_soa(); snapshots, trajectory frames and digests are
+ * filled block by block on the way. Every --checkpoint-every K iterations,
+ * at the end and after SIGTERM / SIGINT the file is synced into a valid
+ * checkpoint (bat_store_sync).
+ */
+static int run_store(const BatOptions *o, const BatStoreOptions *so, const BatObjective *obj) {
+    const int n_bats = o->n_bats;
+    const int max_iters = o->max_iters;
+    const int dim = o->dim;
+    const BatStopCriteria *stop = &o->stop;
+    const BatTrajOptions *traj = &o->traj;
+    const BatCkptOptions *ckpt = &o->ckpt;
+    const BatVerifyOptions *verify = &o->verify;
+
+    /* The store is the checkpoint file: --checkpoint-every sets its sync points */
+    BatCkptOptions sync = *ckpt;
+    sync.path = so->path;
+
+    if (o->layout_set && o->layout == BAT_LAYOUT_AOS) {
+        fprintf(stderr, "--store streams SoA blocks: use --layout soa\n");
+        return 1;
+    }
+    if (ckpt->path) {
+        fprintf(stderr, "--store mmap:%s is the checkpoint: drop --checkpoint (--checkpoint-every sets its sync points)\n",
+                so->path);
+        return 1;
+    }
+    if (ckpt->restart && strcmp(ckpt->restart, so->path) != 0) {
+        fprintf(stderr, "--store resumes in place: use --restart %s\n", so->path);
+        return 1;
+    }
+
+    /* Block populations: bats [b, b + block) and the remainder */
+    const int block = so->block < n_bats ? so->block : n_bats;
+    const int tail_n = n_bats % block;
+    BatPopulation full, tail;
+    double *scratch = malloc(bat_pop_scratch_size(dim) * sizeof(double));
+    double *best_x = malloc((size_t)dim * sizeof(double));
+    if (!scratch || !best_x || bat_pop_alloc(&full, block, dim, o->precision) != 0) {
+        perror("alloc population");
+        free(scratch);
+        free(best_x);
+        return 1;
+    }
+    if (tail_n > 0 && bat_pop_alloc(&tail, tail_n, dim, o->precision) != 0) {
+        perror("alloc population");
+        bat_pop_free(&full);
+        free(scratch);
+        free(best_x);
+        return 1;
+    }
+    /* Valid padding lanes, whatever the blocks are loaded with */
+    bat_pop_init_padding(&full);
+    if (tail_n > 0) {
+        bat_pop_init_padding(&tail);
+    }
+
+    BatProf prof;
+    bat_prof_begin(&prof);
+
+    BatStore store;
+    BatStats stats;
+    BatStopState stop_state;
+    int t_start = 0;
+    int rc = 0;
+    if (ckpt->restart) {
+        /* Resume in place: the records stay where they are */
+        BatCkptHeader h;
+        if (bat_store_resume(&store, so, n_bats, dim, obj->name, max_iters, &h) != 0) {
+            rc = 1;
+        } else {
+            bat_ckpt_header_restore(&h, &stats, &stop_state);
+            memcpy(best_x, store.best_x, (size_t)dim * sizeof(double));
+            t_start = (int)h.iteration;
+        }
+    } else if (bat_store_create(&store, so, n_bats, dim) != 0) {
+        rc = 1;
+    } else {
+        /* Initial population, written block by block */
+        bat_stats_reset(&stats);
+        for (long b = 0; b < n_bats; b += block) {
+            const int m = n_bats - b < block ? (int)(n_bats - b) : block;
+            BatPopulation *pop = m == block ? &full : &tail;
+            bat_pop_init_begin(pop, b, obj);
+            bat_pop_init_tiles(pop, (uint32_t)o->seed, 0, pop->n_tiles, scratch);
+            bat_pop_stats(pop, 0, pop->n_tiles, &stats);
+            bat_ckpt_store_pop(bat_store_block(&store, b, m), pop, 0, m);
+            bat_store_release(&store, b, m);
+        }
+        bat_stats_finalize(&stats);
+        memcpy(best_x, store.records + (size_t)stats.best_index * BAT_CKPT_RECORD(dim), (size_t)dim * sizeof(double));
+        bat_stop_init(&stop_state, stats.best_value);
+    }
+    if (rc != 0) {
+        free_blocks(&full, tail_n > 0 ? &tail : NULL, scratch, best_x);
+        return rc;
+    }
+    BatStopReason stop_reason = BAT_STOP_NONE;
+    int iters_done = max_iters;
+
+    BatVerifyWriter vw;
+    if (verify->path && bat_verify_open(&vw, verify->path, "sequential", n_bats, dim, o->seed, obj->name,
+                                       bat_precision_name(full.precision)) != 0) {
+        perror(verify->path);
+        rc = 1;
+    }
+
+    BatTrajWriter tw;
+    if (rc == 0 && traj->path && bat_traj_open(&tw, traj, n_bats, dim) != 0) {
+        perror(traj->path);
+        if (verify->path) {
+            bat_verify_close(&vw);
+        }
+        rc = 1;
+    }
+    if (rc != 0) {
+        /* The mapped state is still consistent: leave it as a checkpoint */
+        BatCkptHeader h;
+        bat_ckpt_header_init(&h, n_bats, dim, t_start, o->seed, &stats, &stop_state, obj->name);
+        bat_store_close(&store, &h, best_x);
+        free_blocks(&full, tail_n > 0 ? &tail : NULL, scratch, best_x);
+        return rc;
+    }
+
+    int synced = 0;
+    int sync_last = -1;
+    int interrupted = 0;
+    bat_store_catch_signals();
+
+    bat_prof_lap(&prof, BAT_PROF_INIT);
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    for (int t = t_start; t < max_iters; t++) {
+        /* The records change from here on: the last sync point stops being a checkpoint */
+        if (bat_store_begin_update(&store) != 0) {
+            perror(so->path);
+            rc = 1;
+            iters_done = t;
+            break;
+        }
+
+        FILE *snap = NULL;
+        if (o->do_snapshot && snapshot_name(t)) {
+            snap = fopen(snapshot_name(t), "w");
+            if (!snap) {
+                perror("fopen snapshot");
+            }
+        }
+        char *frame = bat_traj_due(traj, t) ? bat_traj_begin(&tw) : NULL;
+        const int hashing = bat_verify_due(verify, t);
+        uint64_t hash = 0;
+
+        /* Iteration t, block by block: the kernel accumulates the next statistics */
+        BatStats next_stats;
+        bat_stats_reset(&next_stats);
+        for (long b = 0; b < n_bats; b += block) {
+            const int m = n_bats - b < block ? (int)(n_bats - b) : block;
+            BatPopulation *pop = m == block ? &full : &tail;
+            double *records = bat_store_block(&store, b, m);
+            bat_pop_init_begin(pop, b, obj);
+            bat_ckpt_load_pop(records, pop, 0, m);
+            bat_pop_update(pop, 0, pop->n_tiles, best_x, &stats, &next_stats, t, scratch);
+            bat_ckpt_store_pop(records, pop, 0, m);
+            bat_prof_lap(&prof, BAT_PROF_UPDATE);
+
+            if (snap) {
+                write_snapshot_pop(snap, pop);
+            }
+            if (frame) {
+                bat_traj_store_pop(frame + (size_t)b * bat_traj_row_size(&tw.header), &tw.header, pop, 0, m);
+            }
+            if (hashing) {
+                hash += bat_verify_hash_pop(pop, 0, m);
+            }
+            bat_store_release(&store, b, m);
+            bat_prof_lap(&prof, BAT_PROF_IO);
+        }
+        bat_stats_finalize(&next_stats);
+        stats = next_stats;
+
+        /* New best (best_x is only read inside the update): x leads its record */
+        memcpy(best_x, store.records + (size_t)stats.best_index * BAT_CKPT_RECORD(dim), (size_t)dim * sizeof(double));
+        double best_value = stats.best_value;
+        bat_prof_lap(&prof, BAT_PROF_UPDATE);
+
+        if (snap) {
+            fclose(snap);
+        }
+        if (frame) {
+            bat_traj_commit(&tw, t);
+        }
+        if (hashing) {
+            bat_verify_write(&vw, t, &stats, best_x, hash);
+        }
+
+        if (!o->quiet && t % 100 == 0) {
+            printf("[Iteration %d] Best f_value = %f  Position = (", t, best_value);
+            for (int d = 0; d < dim; d++) {
+                printf("%s%f", (d == 0 ? "" : ", "), best_x[d]);
+            }
+            printf(")\n");
+        }
+        bat_prof_lap(&prof, BAT_PROF_IO);
+
+        if (bat_stop_due(stop, t)) {
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            stop_reason = bat_stop_check(stop, &stop_state, t, best_value,
+                                         bat_stop_time_up(stop, seconds_since(&t0, &t1)));
+            if (stop_reason != BAT_STOP_NONE) {
+                iters_done = t + 1;
+                break;
+            }
+        }
+        bat_prof_lap(&prof, BAT_PROF_REDUCE);
+
+        /* Sync point after the stop check, so the saved stall window includes t */
+        if (bat_ckpt_due(&sync, t)) {
+            BatCkptHeader h;
+            bat_ckpt_header_init(&h, n_bats, dim, t + 1, o->seed, &stats, &stop_state, obj->name);
+            if (bat_store_sync(&store, &h, best_x) == 0) {
+                synced++;
+            } else {
+                perror(so->path);
+                rc = 1;
+            }
+            sync_last = t + 1;
+        }
+        bat_prof_lap(&prof, BAT_PROF_IO);
+
+        if (bat_store_interrupted()) {
+            interrupted = 1;
+            iters_done = t + 1;
+            break;
+        }
+    }
+
+    /* Charges the stop check of the last iteration (if the loop broke) */
+    bat_prof_lap(&prof, BAT_PROF_REDUCE);
+    bat_prof_end(&prof);
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double elapsed = seconds_since(&t0, &t1);
+
+    /* Last sync point: the store becomes a checkpoint of the final state */
+    BatCkptHeader h;
+    bat_ckpt_header_init(&h, n_bats, dim, iters_done, o->seed, &stats, &stop_state, obj->name);
+    if (bat_store_close(&store, &h, best_x) != 0) {
+        perror(so->path);
+        rc = 1;
+    } else if (sync_last != iters_done) {
+        synced++;
+    }
+    if (interrupted) {
+        fprintf(stderr, "Interrupted after %d iterations: %s is a checkpoint (--restart %s)\n", iters_done, so->path,
+                so->path);
+    }
+
+    if (traj->path && bat_traj_close(&tw) != 0) {
+        fprintf(stderr, "Writing the trajectory %s failed\n", traj->path);
+        rc = 1;
+    }
+
+    if (verify->path && bat_verify_close(&vw) != 0) {
+        fprintf(stderr, "Writing the digests %s failed\n", verify->path);
+        rc = 1;
+    }
+
+    if (!o->quiet) {
+        if (stop_reason != BAT_STOP_NONE) {
+            printf("Stopped after %d iterations (%s)\n", iters_done, bat_stop_reason_name(stop_reason));
+        }
+        printf("Final best f_value = %f\n", stats.best_value);
+        printf("Final position = (");
+        for (int d = 0; d < dim; d++) {
+            printf("%s%f", (d == 0 ? "" : ", "), best_x[d]);
+        }
+        printf(")\n");
+    }
+
+    BatProfSummary prof_sum;
+    bat_prof_summary_init(&prof_sum);
+    bat_prof_summary_add(&prof_sum, &prof);
+
+    printf("BENCH version=sequential n_bats=%d iters=%d procs=1 threads=1 time_s=%.6f layout=soa dim=%d kernel=%s objective=%s" BAT_BUILD_BENCH,
+           n_bats, max_iters, elapsed, dim, full.kernel_name, obj->name);
+    bat_precision_print_bench(full.precision, bat_pop_bytes_per_bat(dim, full.precision));
+    bat_stop_print_bench(stop, iters_done, stop_reason);
+    bat_traj_print_bench(traj, traj->path ? tw.frames : 0);
+    bat_ckpt_print_bench(&sync, t_start, synced);
+    bat_verify_print_bench(verify, verify->path ? vw.digests : 0);
+    bat_store_print_bench(so, &store);
+    bat_prof_print_bench(&prof_sum);
+    BatPlacement placement;
+    bat_placement_init(&placement);
+    bat_placement_add_self(&placement);
+    bat_placement_print_bench(&placement);
+    printf("\n");
+
+    free_blocks(&full, tail_n > 0 ? &tail : NULL, scratch, best_x);
+    return rc;
+}
+
+/* Shared options and the store options of the sequential version. */
+static int parse_args(int argc, char **argv, BatOptions *opt, BatStoreOptions *store) {
+    bat_options_defaults(opt);
+    bat_store_defaults(store);
     for (int i = 1; i < argc; i++) {
-        if (strcmp(argv[i], "--n-bats") == 0 && i + 1 < argc) {
-            *n_bats = atoi(argv[++i]);
-        } else if (strcmp(argv[i], "--iters") == 0 && i + 1 < argc) {
-            *max_iters = atoi(argv[++i]);
-        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
-            *seed = (unsigned int)strtoul(argv[++i], NULL, 10);
-        } else if (strcmp(argv[i], "--no-snapshot") == 0) {
-            *do_snapshot = 0;
-        } else if (strcmp(argv[i], "--quiet") == 0) {
-            *quiet = 1;
+        int consumed = bat_options_parse_option(opt, argc, argv, &i);
+        if (consumed == 0) {
+            consumed = bat_store_parse_option(store, argc, argv, &i);
+        }
+        if (consumed < 0) {
+            return -1;
         }
     }
+    bat_options_finish(opt);
+    return 0;
 }
 
 int main(int argc, char **argv) {
-    int n_bats, max_iters, do_snapshot;
-    int quiet;
-    unsigned int seed;
-    parse_args(argc, argv, &n_bats, &max_iters, &seed, &do_snapshot, &quiet);
-
-    if (n_bats <= 0 || max_iters <= 0) {
-        fprintf(stderr, "Invalid parameters: n_bats=%d iters=%d\n", n_bats, max_iters);
+    BatOptions opt;
+    BatStoreOptions store_opt;
+    const BatObjective *obj;
+    if (parse_args(argc, argv, &opt, &store_opt) != 0 || bat_options_validate(&opt, 1, &obj) != 0) {
         return 1;
     }
 
+    if (store_opt.path) {
+        return run_store(&opt, &store_opt, obj);
+    }
+    if (opt.layout == BAT_LAYOUT_SOA) {
+        return run_soa(&opt, obj);
+    }
+
+    const int n_bats = opt.n_bats;
+    const int max_iters = opt.max_iters;
+    const unsigned int seed = opt.seed;
+    const BatStopCriteria *stop = &opt.stop;
+    const BatTrajOptions *traj = &opt.traj;
+    const BatCkptOptions *ckpt = &opt.ckpt;
+    const BatVerifyOptions *verify = &opt.verify;
+
     /* Allocate memory for the entire population of bats */
     Bat *bats = malloc((size_t)n_bats * sizeof(Bat));
-    if (!bats) {
+    /* Records of the checkpoint file (read on restart, written by checkpoints) */
+    double *ckpt_records = NULL;
+    if (ckpt->path || ckpt->restart) {
+        ckpt_records = malloc((size_t)n_bats * BAT_CKPT_RECORD(dimension) * sizeof(double));
+    }
+    if (!bats || ((ckpt->path || ckpt->restart) && !ckpt_records)) {
         perror("malloc bats");
+        free(bats);
+        free(ckpt_records);
         return 1;
     }
 
+    /* Per-phase timers (make PROFILE=1), from the initialization on */
+    BatProf prof;
+    bat_prof_begin(&prof);
+
     Bat best_bat;
     /* Initialize the population with random positions and find the initial best solution */
-    initialize_bats_seeded(bats, n_bats, &best_bat, (uint32_t)seed);
+    initialize_bats_seeded(bats, n_bats, &best_bat, (uint32_t)seed, obj);
+
+    /* Population statistics of the initial population (input of iteration 0) */
+    BatStats stats;
+    bat_stats_compute(&stats, bats, n_bats, 0);
+
+    /* Early termination (no criterion: exactly max_iters iterations) */
+    BatStopState stop_state;
+    bat_stop_init(&stop_state, best_bat.f_value);
+    BatStopReason stop_reason = BAT_STOP_NONE;
+    int iters_done = max_iters;
+
+    /* Restart: bats, statistics, best and stall window from the checkpoint */
+    int t_start = 0;
+    if (ckpt->restart) {
+        BatCkptHeader h;
+        if (bat_ckpt_restore(ckpt->restart, n_bats, dimension, obj->name, max_iters, &h, best_bat.x_i, ckpt_records) != 0) {
+            free(bats);
+            free(ckpt_records);
+            return 1;
+        }
+        bat_ckpt_load_bats(ckpt_records, bats, 0, n_bats);
+        bat_ckpt_header_restore(&h, &stats, &stop_state);
+        best_bat = bats[stats.best_index];
+        t_start = (int)h.iteration;
+    }
+    int ckpt_written = 0;
+    int ckpt_last = -1;
+    int rc = 0;
+
+    /* Digests of the best and the population (--verify) */
+    BatVerifyWriter vw;
+    if (verify->path && bat_verify_open(&vw, verify->path, "sequential", n_bats, dimension, seed, obj->name, "double") != 0) {
+        perror(verify->path);
+        free(bats);
+        free(ckpt_records);
+        return 1;
+    }
+
+    /* Binary trajectory, written in the background */
+    BatTrajWriter tw;
+    if (traj->path && bat_traj_open(&tw, traj, n_bats, dimension) != 0) {
+        perror(traj->path);
+        if (verify->path) {
+            bat_verify_close(&vw);
+        }
+        free(bats);
+        free(ckpt_records);
+        return 1;
+    }
 
     /* Start timing the execution */
+    bat_prof_lap(&prof, BAT_PROF_INIT);
     struct timespec t0, t1;
     clock_gettime(CLOCK_MONOTONIC, &t0);
 
     /* Main optimization loop */
-    for (int t = 0; t < max_iters; t++) {
+    for (int t = t_start; t < max_iters; t++) {
 
         /* Use the best solution from the previous iteration as a read-only guide */
         Bat best_snapshot = best_bat;
         
         /* Update each bat in the population sequentially */
         for (int i = 0; i < n_bats; i++) {
-            update_bat(bats, n_bats, &best_snapshot, i, t);
+            update_bat(bats, &best_snapshot, &stats, obj, i, t);
         }
+        bat_prof_lap(&prof, BAT_PROF_UPDATE);
 
-        /* Recompute best after all bats have been updated */
-        best_bat = bats[0];
-        for (int i = 1; i < n_bats; i++) {
-            if (bats[i].f_value > best_bat.f_value) {
-                best_bat = bats[i];
-            }
-        }
+        /* Recompute best and statistics after all bats have been updated */
+        bat_stats_compute(&stats, bats, n_bats, 0);
+        best_bat = bats[stats.best_index];
+        bat_prof_lap(&prof, BAT_PROF_REDUCE);
 
         /* Optional snapshots at fixed iteration numbers (for the report). */
-        if (do_snapshot) {
-            if (t == 0) {
-                save_snapshot("snapshot_t000.csv", bats, n_bats);
-            } else if (t == 2500) {
-                save_snapshot("snapshot_t250.csv", bats, n_bats);
-            } else if (t == 5000) {
-                save_snapshot("snapshot_t500.csv", bats, n_bats);
-            } else if (t == 7500) {
-                save_snapshot("snapshot_t750.csv", bats, n_bats);
-            }
+        if (opt.do_snapshot && snapshot_name(t)) {
+            save_snapshot(snapshot_name(t), bats, n_bats);
+        }
+
+        /* Trajectory frame: only the copy happens on the loop */
+        if (bat_traj_due(traj, t)) {
+            bat_traj_store_bats(bat_traj_begin(&tw), &tw.header, bats, 0, n_bats);
+            bat_traj_commit(&tw, t);
+        }
+
+        if (bat_verify_due(verify, t)) {
+            bat_verify_write(&vw, t, &stats, best_bat.x_i, bat_verify_hash_bats(bats, 0, n_bats, 0));
         }
 
         /* Print progress every 100 iterations (disabled in --quiet mode). */
-        if (!quiet && t % 100 == 0) {
+        if (!opt.quiet && t % 100 == 0) {
             printf("[Iteration %d] Best f_value = %f  Position = (", t, best_bat.f_value);
             for (int d = 0; d < dimension; d++) {
                 printf("%s%f", (d == 0 ? "" : ", "), best_bat.x_i[d]);
             }
             printf(")\n");
         }
+        bat_prof_lap(&prof, BAT_PROF_IO);
+
+        /* Stopping criteria, every --check-every iterations */
+        if (bat_stop_due(stop, t)) {
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            stop_reason = bat_stop_check(stop, &stop_state, t, best_bat.f_value,
+                                         bat_stop_time_up(stop, seconds_since(&t0, &t1)));
+            if (stop_reason != BAT_STOP_NONE) {
+                iters_done = t + 1;
+                break;
+            }
+        }
+        bat_prof_lap(&prof, BAT_PROF_REDUCE);
+
+        /* Checkpoint after the stop check, so the saved stall window includes t */
+        if (bat_ckpt_due(ckpt, t)) {
+            if (bat_ckpt_save_bats(ckpt, ckpt_records, bats, n_bats, t + 1, seed, &stats, &stop_state, obj->name) == 0) {
+                ckpt_written++;
+            } else {
+                rc = 1;
+            }
+            ckpt_last = t + 1;
+        }
+        bat_prof_lap(&prof, BAT_PROF_IO);
     }
 
-    /* Stop timing */
+    /* Stop timing (the lap charges the stop check of a broken loop) */
+    bat_prof_lap(&prof, BAT_PROF_REDUCE);
+    bat_prof_end(&prof);
     clock_gettime(CLOCK_MONOTONIC, &t1);
     double elapsed = seconds_since(&t0, &t1);
 
-    if (!quiet) {
+    /* Final state, so that the run can be extended with a larger --iters */
+    if (ckpt->path && ckpt_last != iters_done) {
+        if (bat_ckpt_save_bats(ckpt, ckpt_records, bats, n_bats, iters_done, seed, &stats, &stop_state, obj->name) == 0) {
+            ckpt_written++;
+        } else {
+            rc = 1;
+        }
+    }
+
+    /* Flush the frames still queued (outside the timed loop) */
+    if (traj->path && bat_traj_close(&tw) != 0) {
+        fprintf(stderr, "Writing the trajectory %s failed\n", traj->path);
+        rc = 1;
+    }
+
+    if (verify->path && bat_verify_close(&vw) != 0) {
+        fprintf(stderr, "Writing the digests %s failed\n", verify->path);
+        rc = 1;
+    }
+
+    if (!opt.quiet) {
+        if (stop_reason != BAT_STOP_NONE) {
+            printf("Stopped after %d iterations (%s)\n", iters_done, bat_stop_reason_name(stop_reason));
+        }
         printf("Final best f_value = %f\n", best_bat.f_value);
         printf("Final position = (");
         for (int d = 0; d < dimension; d++) {
@@ -176,10 +871,26 @@ int main(int argc, char **argv) {
         printf(")\n");
     }
 
+    BatProfSummary prof_sum;
+    bat_prof_summary_init(&prof_sum);
+    bat_prof_summary_add(&prof_sum, &prof);
+
     /* Output benchmark result in a machine-readable format */
-    printf("BENCH version=sequential n_bats=%d iters=%d procs=1 threads=1 time_s=%.6f\n",
-           n_bats, max_iters, elapsed);
+    printf("BENCH version=sequential n_bats=%d iters=%d procs=1 threads=1 time_s=%.6f layout=aos dim=%d objective=%s" BAT_BUILD_BENCH,
+           n_bats, max_iters, elapsed, dimension, obj->name);
+    bat_precision_print_bench(BAT_PRECISION_DOUBLE, sizeof(Bat));
+    bat_stop_print_bench(stop, iters_done, stop_reason);
+    bat_traj_print_bench(traj, traj->path ? tw.frames : 0);
+    bat_ckpt_print_bench(ckpt, t_start, ckpt_written);
+    bat_verify_print_bench(verify, verify->path ? vw.digests : 0);
+    bat_prof_print_bench(&prof_sum);
+    BatPlacement placement;
+    bat_placement_init(&placement);
+    bat_placement_add_self(&placement);
+    bat_placement_print_bench(&placement);
+    printf("\n");
 
     free(bats);
-    return 0;
+    free(ckpt_records);
+    return rc;
 }
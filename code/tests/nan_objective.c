@@ -0,0 +1,29 @@
+#include <math.h>
+
+/*
+ * nan_objective.c
+ *
+ * Purpose:
+ * User objectives without any comparable value, loaded by `make check`
+ * with --objective so:PATH:SYMBOL. No bat ever beats the empty state of
+ * the statistics: the best must still be a bat of the population (the
+ * smallest index, bat_stats_better).
+ */
+
+/* NaN everywhere. */
+void bat_objective_nan(const double *X, int n, int d, double *out) {
+    (void)X;
+    (void)d;
+    for (int i = 0; i < n; i++) {
+        out[i] = NAN;
+    }
+}
+
+/* -inf everywhere. */
+void bat_objective_neg_inf(const double *X, int n, int d, double *out) {
+    (void)X;
+    (void)d;
+    for (int i = 0; i < n; i++) {
+        out[i] = -INFINITY;
+    }
+}
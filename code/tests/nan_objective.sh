@@ -0,0 +1,40 @@
+#!/bin/sh
+#
+# nan_objective.sh SO
+#
+# Runs the sequential and OpenMP versions on the objectives of
+# nan_objective.c (shared object SO) and checks that every digest
+# (--verify) reports bat 0 as the best. Exits with 1 on the first failure.
+
+so=$1
+dir=$(mktemp -d) || exit 1
+trap 'rm -rf "$dir"' EXIT
+fail=0
+
+check() {
+    name=$1
+    shift
+    rm -f "$dir/store.bat"
+    if ! "$@" --n-bats 37 --iters 20 --seed 1 --quiet --no-snapshot --verify "$dir/digests" >"$dir/out" 2>&1; then
+        echo "FAIL $name: exit status"
+        cat "$dir/out"
+        fail=1
+    elif grep -v '^#' "$dir/digests" | grep -qv ' index=0 '; then
+        echo "FAIL $name: best is not bat 0"
+        fail=1
+    else
+        echo "ok   $name"
+    fi
+}
+
+for sym in bat_objective_nan bat_objective_neg_inf; do
+    obj="so:$so:$sym"
+    check "sequential aos $sym" ./sequential --layout aos --objective "$obj"
+    check "sequential soa $sym" ./sequential --layout soa --objective "$obj"
+    check "sequential store $sym" ./sequential --store "mmap:$dir/store.bat" --objective "$obj"
+    for sched in static dynamic tasks; do
+        check "openmp aos $sched $sym" env OMP_NUM_THREADS=3 ./openmp_bat --layout aos --schedule $sched --objective "$obj"
+        check "openmp soa $sched $sym" env OMP_NUM_THREADS=3 ./openmp_bat --layout soa --schedule $sched --objective "$obj"
+    done
+done
+exit $fail
@@ -5,14 +5,20 @@ Usage:
   python3 tools/bench_analyze.py --input code/bench_results.txt --outdir bench_out
 
 The program expects lines like:
-  BENCH version=openmp n_bats=2000 iters=2000 procs=1 threads=4 time_s=3.890662
+  BENCH version=openmp n_bats=2000 iters=2000 procs=1 threads=4 time_s=3.890662 layout=aos
+
+Fields after time_s are optional key=value pairs. Non-default variant
+fields (layout=soa, dim=30, see VARIANT_DEFAULTS) are folded into the version
+name (e.g. `openmp-soa-dim30`), so variants are analyzed as separate series.
 
 Key ideas / conventions used by this script:
 
 - `p` (parallelism level):
     - OpenMP: `p = threads`
     - MPI: `p = procs`
-    - sequential: `p = 1`
+    - hybrid MPI+OpenMP: `p = procs * threads`
+    - batch of runs (batch_bat): `p = procs * threads`
+    - sequential, GPU (gpu_bat): `p = 1`
 
 - Strong scaling (fixed problem size):
     - Problem size is (n_bats, iters)
@@ -24,7 +30,9 @@ Key ideas / conventions used by this script:
     for each parallel version:
         T_self1 = Tp at p=1 for the same version (MPI with 1 rank, OpenMP with 1 thread)
     This avoids misleading results when sequential and parallel programs have
-    different overheads.
+    different overheads. For the batch version (runs=N independent runs in one
+    measurement) only the self baseline is meaningful: the sequential time is
+    that of a single run.
 
 - Weak scaling (problem size grows with p):
     - In our benchmarks we typically set n_bats = base_n_bats * p
@@ -34,6 +42,53 @@ Key ideas / conventions used by this script:
             E_w(p) = T_base / Tp
         (no division by p)
 
+- Phase breakdown (binaries built with `make PROFILE=1`):
+    - BENCH lines then carry prof_<phase>_{min,avg,max} (seconds, over all
+      threads x ranks) for the phases init, update, reduce, comm, wait, io,
+      and with PAPI=1 papi_cycles / papi_ins / papi_l2_tcm / ipc.
+    - They are written to bench_phases.csv (fastest repeat per configuration)
+      and plotted as one stacked bar per p (average worker) for each version
+      and size; max - min of a phase is the imbalance between workers.
+
+- Kernel microbenchmarks (`make bench`, code/microbench.txt):
+    - MICRO lines (kernel=, layout=, n_bats=, dim=, ws_bytes=, level=,
+      ns_per_update=, bytes_per_update=, gb_per_s=) are written to
+      microbench.csv and plotted as ns per bat update and GB/s against the
+      working set, one curve per kernel. An input may contain only MICRO lines.
+
+- GPU offload (gpu_bat, `make gpu`):
+    - Every gpu run is compared with the CPU runs of the same problem (same
+      variant fields apart from the layout, which does not change the
+      trajectory) and size (n_bats, iters): the sequential time (T_seq1,
+      speedup_seq) and the fastest CPU run of any version and p (cpu_version,
+      cpu_p, T_cpu, speedup_cpu). Written to bench_device.csv with the device
+      that ran the kernels (accel, or host for the fallback) and the bytes
+      copied each way.
+
+- Build variants (`make fast`, `make pgo`):
+    - Their BENCH lines carry build=fast / build=pgo, folded into the version
+      name (`openmp-fast`, `sequential-soa-pgo`, ...), so each variant is its
+      own series. The sequential baseline of the speedups stays the baseline
+      build (`sequential`), so speedup_seq includes the gain of the variant;
+      speedup_self is the scaling of the variant alone.
+
+- Repetitions (benchmark.pbs runs every point REPS times):
+    - The repeats of a point (version, n_bats, iters, procs, threads) are
+      reduced to their median before any metric is computed; every metric row
+      also carries the number of repeats, the quartiles, the relative IQR and a
+      distribution-free confidence interval of the median (order statistics,
+      --confidence, default 95%; with few repeats the interval is the full
+      range and ci_level gives its actual coverage).
+    - Speedup and efficiency intervals combine the intervals of the two
+      medians (T1_lo / Tp_hi .. T1_hi / Tp_lo).
+    - A point is flagged unstable (column unstable, reason in
+      unstable_reason) if it has fewer than --min-reps repeats, a relative
+      IQR above --max-spread, a relative CI width above --max-ci, or repeats
+      measured on different hosts / CPUs / bindings (host=, cpus=, bind=,
+      places=, worker_cpus= of the BENCH lines). bench_stability.csv lists
+      every point; the unstable ones are also printed, and drawn with a red
+      cross on the plots (error bars are the confidence intervals).
+
 Plotting notes:
 - We generate *combined* comparison plots (sequential vs OpenMP vs MPI) to keep
     the number of figures small.
@@ -49,7 +104,9 @@ import argparse
 import csv
 import os
 import re
-from dataclasses import dataclass
+import statistics
+from dataclasses import dataclass, field, replace
+from math import comb
 from typing import Iterable, List, Dict, Tuple, Optional
 
 BENCH_RE = re.compile(
@@ -59,9 +116,122 @@ BENCH_RE = re.compile(
     r"iters=(?P<iters>\d+)\s+"
     r"procs=(?P<procs>\d+)\s+"
     r"threads=(?P<threads>\d+)\s+"
-    r"time_s=(?P<time_s>[0-9.]+)\s*$"
+    r"time_s=(?P<time_s>[0-9.]+)"
+    r"(?P<extra>(?:\s+\S+=\S+)*)\s*$"
 )
 
+# Trailing key=value fields (e.g. layout=soa dim=30) after time_s.
+EXTRA_RE = re.compile(r"(\S+)=(\S+)")
+
+# Phases of the per-phase timers (bat_prof.h), in BENCH order.
+PROF_PHASES = ("init", "update", "reduce", "comm", "wait", "io")
+
+# Hardware counter fields (PAPI builds).
+PROF_COUNTERS = ("papi_cycles", "papi_ins", "papi_l2_tcm", "ipc")
+
+# Extra fields that select a different program variant, with their default.
+# A non-default value is appended to the version name so that variants form
+# separate series (e.g. `openmp-soa-dim30`).
+VARIANT_DEFAULTS = {
+    "layout": "aos",
+    "dim": "2",
+    "objective": "sphere",
+    "exchange": "fused",
+    "staleness": "",
+    "rebalance_every": "",
+    "topology": "",
+    "migrate_every": "",
+    "traj_every": "",
+    "checkpoint_every": "",
+    "restart_iter": "",
+    "verify_every": "",
+    "store": "",
+    "runs": "",
+    "build": "",
+    "schedule": "static",
+    "precision": "double",
+    "threads_mode": "",
+}
+
+# Fields of the GPU version copied to bench_device.csv.
+DEVICE_FIELDS = ("device", "h2d_bytes", "d2h_bytes")
+
+# Placement of a run (code/include/bat_host.h): repeats of a point must agree.
+PLACEMENT_FIELDS = ("host", "hosts", "cpus", "worker_cpus", "bind", "places")
+
+# Columns of the repeat statistics (see summarize()), added to every metric row.
+STAT_FIELDS = ("reps", "time_min", "time_q1", "time_q3", "time_max", "iqr_rel",
+               "time_ci_lo", "time_ci_hi", "ci_level", "unstable", "unstable_reason")
+
+# Interval columns of the speedups and efficiencies.
+RATIO_FIELDS = ("speedup_seq", "efficiency_seq", "speedup_self", "efficiency_self")
+
+
+MICRO_RE = re.compile(r"^MICRO\s+(?P<fields>(?:\S+=\S+\s*)+)$")
+
+# Fields of a MICRO line, in CSV column order (numeric ones are converted).
+MICRO_FIELDS = ("kernel", "layout", "n_bats", "dim", "ws_bytes", "level", "passes",
+                "ns_per_update", "bytes_per_update", "gb_per_s")
+MICRO_NUMERIC = {"n_bats": int, "dim": int, "ws_bytes": int, "passes": int,
+                 "ns_per_update": float, "bytes_per_update": int, "gb_per_s": float}
+
+
+def parse_micro_lines(lines: Iterable[str]) -> List[Dict[str, object]]:
+    """MICRO lines of the kernel microbenchmarks (code/src/microbench.c)."""
+    out: List[Dict[str, object]] = []
+    for line in lines:
+        m = MICRO_RE.match(line.strip())
+        if not m:
+            continue
+        fields = dict(EXTRA_RE.findall(" " + m.group("fields")))
+        if any(k not in fields for k in MICRO_FIELDS):
+            continue
+        out.append({k: MICRO_NUMERIC.get(k, str)(fields[k]) for k in MICRO_FIELDS})
+    return out
+
+
+def try_plot_micro(micro: List[Dict[str, object]], outdir: str) -> None:
+    """ns per update and GB/s against the working set, one curve per kernel."""
+    try:
+        import matplotlib.pyplot as plt  # type: ignore
+    except Exception:
+        return
+
+    series: Dict[Tuple[str, str, int], List[Dict[str, object]]] = {}
+    for m in micro:
+        series.setdefault((str(m["kernel"]), str(m["layout"]), int(m["dim"])), []).append(m)
+
+    for ykey, ylabel, filename in (
+        ("ns_per_update", "ns per bat update", "microbench_ns.png"),
+        ("gb_per_s", "GB/s (bytes_per_update / ns)", "microbench_gbps.png"),
+    ):
+        plt.figure(figsize=(8, 5))
+        for (kernel, layout, dim), ms in sorted(series.items()):
+            ms = sorted(ms, key=lambda x: int(x["ws_bytes"]))
+            label = kernel if layout == "-" else f"{kernel} ({layout})"
+            plt.plot([int(m["ws_bytes"]) for m in ms], [float(m[ykey]) for m in ms], marker="o", label=f"{label} d={dim}")
+        plt.xscale("log", base=2)
+        plt.yscale("log")
+        plt.xlabel("Working set (bytes)")
+        plt.ylabel(ylabel)
+        plt.title("Kernel microbenchmarks")
+        plt.grid(True, which="both", alpha=0.3)
+        plt.legend(fontsize="small")
+        plt.savefig(os.path.join(outdir, filename), dpi=150, bbox_inches="tight")
+        plt.close()
+
+
+def variant_version(version: str, extra: Dict[str, str], skip: Tuple[str, ...] = ()) -> str:
+    """Append the non-default variant fields (except `skip`) to a version name."""
+    parts = [version]
+    for key, default in VARIANT_DEFAULTS.items():
+        if key in skip:
+            continue
+        value = extra.get(key, default)
+        if value != default:
+            parts.append(value if key in ("layout", "objective", "exchange", "topology", "build", "schedule", "precision", "threads_mode") else f"{key}{value}")
+    return "-".join(parts)
+
 
 @dataclass(frozen=True)
 class BenchRow:
@@ -71,14 +241,26 @@ class BenchRow:
     procs: int
     threads: int
     time_s: float
+    # prof_<phase>_<stat> and PAPI fields (empty unless built with PROFILE=1)
+    prof: Dict[str, float] = field(default_factory=dict, compare=False, hash=False)
+    # Variant fields without the layout: runs with the same problem compute the same trajectory
+    problem: str = field(default="", compare=False, hash=False)
+    # DEVICE_FIELDS of a gpu run
+    device: Dict[str, str] = field(default_factory=dict, compare=False, hash=False)
+    # PLACEMENT_FIELDS, "key=value" joined with spaces
+    placement: str = field(default="", compare=False, hash=False)
+    # Repeat statistics (STAT_FIELDS) of a summarized row
+    stats: Dict[str, object] = field(default_factory=dict, compare=False, hash=False)
 
     @property
     def p(self) -> int:
         """Return the parallelism level p for this record."""
-        if self.version == "openmp":
+        if self.version.startswith("openmp"):
             return self.threads
-        if self.version == "mpi":
+        if self.version.startswith("mpi"):
             return self.procs
+        if self.version.startswith("hybrid") or self.version.startswith("batch"):
+            return self.procs * self.threads
         return 1
 
 
@@ -93,43 +275,144 @@ def parse_lines(lines: Iterable[str]) -> List[BenchRow]:
         m = BENCH_RE.match(line)
         if not m:
             continue
+        extra = dict(EXTRA_RE.findall(m.group("extra") or ""))
+        version = variant_version(m.group("version"), extra)
+        prof = {k: float(v) for k, v in extra.items() if k.startswith("prof_") or k in PROF_COUNTERS}
         rows.append(
             BenchRow(
-                version=m.group("version"),
+                version=version,
                 n_bats=int(m.group("n_bats")),
                 iters=int(m.group("iters")),
                 procs=int(m.group("procs")),
                 threads=int(m.group("threads")),
                 time_s=float(m.group("time_s")),
+                prof=prof,
+                problem=variant_version("", extra, skip=("layout",)),
+                device={k: extra[k] for k in DEVICE_FIELDS if k in extra},
+                placement=" ".join(f"{k}={extra[k]}" for k in PLACEMENT_FIELDS if k in extra),
             )
         )
     return rows
 
 
+def median_ci(times: List[float], confidence: float) -> Tuple[float, float, float]:
+    """Distribution-free confidence interval of the median of `times`.
+
+    With the order statistics x_(1) <= ... <= x_(n), [x_(k), x_(n+1-k)]
+    contains the median with probability 1 - 2 P(B <= k - 1), B ~ Bin(n, 1/2).
+    Returns (lo, hi, coverage) for the narrowest such interval whose coverage
+    is at least `confidence`; if even the full range falls short (n < 6 at
+    95%), the full range with its actual coverage.
+    """
+    xs = sorted(times)
+    n = len(xs)
+    if n == 1:
+        return xs[0], xs[0], 0.0
+
+    def cdf(m: int) -> float:
+        return sum(comb(n, i) for i in range(m + 1)) / 2.0 ** n
+
+    k = 1
+    while k + 1 <= (n + 1) // 2 and 1.0 - 2.0 * cdf(k) >= confidence:
+        k += 1
+    return xs[k - 1], xs[n - k], 1.0 - 2.0 * cdf(k - 1)
+
+
+def summarize(rows: List[BenchRow], confidence: float, max_spread: float, max_ci: float,
+              min_reps: int) -> List[BenchRow]:
+    """One row per point (version, n_bats, iters, procs, threads): median time + repeat statistics."""
+    groups: Dict[Tuple[str, int, int, int, int], List[BenchRow]] = {}
+    for r in rows:
+        groups.setdefault((r.version, r.n_bats, r.iters, r.procs, r.threads), []).append(r)
+
+    out: List[BenchRow] = []
+    for key in sorted(groups):
+        rs = groups[key]
+        times = sorted(r.time_s for r in rs)
+        med = statistics.median(times)
+        q1, q3 = (statistics.quantiles(times, n=4, method="inclusive")[::2] if len(times) > 1
+                  else (times[0], times[0]))
+        lo, hi, level = median_ci(times, confidence)
+        iqr_rel = (q3 - q1) / med if med > 0 else 0.0
+
+        reasons = []
+        if len(times) < min_reps:
+            reasons.append(f"reps<{min_reps}")
+        if iqr_rel > max_spread:
+            reasons.append(f"spread={iqr_rel:.1%}")
+        if med > 0 and (hi - lo) / med > max_ci:
+            reasons.append(f"ci={(hi - lo) / med:.1%}")
+        if len({r.placement for r in rs}) > 1:
+            reasons.append("placement")
+
+        stats: Dict[str, object] = {
+            "reps": len(times),
+            "time_min": times[0],
+            "time_q1": q1,
+            "time_q3": q3,
+            "time_max": times[-1],
+            "iqr_rel": iqr_rel,
+            "time_ci_lo": lo,
+            "time_ci_hi": hi,
+            "ci_level": level,
+            "unstable": 1 if reasons else 0,
+            "unstable_reason": ";".join(reasons),
+        }
+        # The representative is the repeat closest to the median (prof / device fields)
+        rep_row = min(rs, key=lambda r: abs(r.time_s - med))
+        out.append(replace(rep_row, time_s=med, stats=stats))
+    return out
+
+
+def _ratio_ci(base: BenchRow, r: BenchRow, p: int = 1) -> Tuple[float, float]:
+    """Interval of base.time_s / (r.time_s * p) from the intervals of the two medians."""
+    b_lo = float(base.stats.get("time_ci_lo", base.time_s))
+    b_hi = float(base.stats.get("time_ci_hi", base.time_s))
+    r_lo = float(r.stats.get("time_ci_lo", r.time_s))
+    r_hi = float(r.stats.get("time_ci_hi", r.time_s))
+    lo = b_lo / (r_hi * p) if r_hi > 0 and p > 0 else 0.0
+    hi = b_hi / (r_lo * p) if r_lo > 0 and p > 0 else 0.0
+    return lo, hi
+
+
+def _intervals(seq_base: BenchRow, self_base: BenchRow, r: BenchRow, p: int, per_p: bool) -> Dict[str, object]:
+    """Repeat statistics of r and the <ratio>_lo / <ratio>_hi columns of a metric row.
+
+    per_p: efficiencies are speedups / p (strong scaling); otherwise they equal
+    the speedups (weak scaling).
+    """
+    out: Dict[str, object] = {k: r.stats.get(k, "") for k in STAT_FIELDS}
+    for name, base in (("seq", seq_base), ("self", self_base)):
+        lo, hi = _ratio_ci(base, r)
+        e_lo, e_hi = _ratio_ci(base, r, p) if per_p else (lo, hi)
+        out[f"speedup_{name}_lo"], out[f"speedup_{name}_hi"] = lo, hi
+        out[f"efficiency_{name}_lo"], out[f"efficiency_{name}_hi"] = e_lo, e_hi
+    return out
+
+
 def group_key(row: BenchRow) -> Tuple[str, int, int]:
     """Group key for strong scaling: version + (n_bats, iters)."""
     return (row.version, row.n_bats, row.iters)
 
 
-def find_baseline(rows: List[BenchRow], n_bats: int, iters: int) -> float:
-    """Strong-scaling baseline: sequential time with the same (n_bats, iters).
+def find_baseline(rows: List[BenchRow], n_bats: int, iters: int) -> BenchRow:
+    """Strong-scaling baseline: sequential run with the same (n_bats, iters).
 
-    If multiple runs exist, we use the minimum time as a simple noise-reduction
-    strategy.
+    The rows are summarized (one median per point); if several remain, the
+    fastest is used.
     """
     candidates = [r for r in rows if r.version == "sequential" and r.n_bats == n_bats and r.iters == iters]
     if not candidates:
         raise SystemExit(f"Missing sequential baseline for n_bats={n_bats} iters={iters}")
-    # Choose min time if multiple repeats
-    return min(r.time_s for r in candidates)
+    return min(candidates, key=lambda r: r.time_s)
 
 
-def find_self_baseline(rows: List[BenchRow], version: str, n_bats: int, iters: int) -> Optional[float]:
-    """Self baseline for a version: Tp at p=1 for the same (n_bats, iters)."""
+def find_self_baseline(rows: List[BenchRow], version: str, n_bats: int, iters: int) -> Optional[BenchRow]:
+    """Self baseline for a version: the p=1 run for the same (n_bats, iters)."""
     candidates = [r for r in rows if r.version == version and r.n_bats == n_bats and r.iters == iters and r.p == 1]
     if not candidates:
         return None
-    return min(r.time_s for r in candidates)
+    return min(candidates, key=lambda r: r.time_s)
 
 
 def _strong_metrics(rows: List[BenchRow]) -> List[Dict[str, object]]:
@@ -154,7 +437,7 @@ def _strong_metrics(rows: List[BenchRow]) -> List[Dict[str, object]]:
 
     sizes = sorted({(r.n_bats, r.iters) for r in rows})
     # Only keep sizes that actually have a sequential baseline
-    baselines: Dict[Tuple[int, int], float] = {}
+    baselines: Dict[Tuple[int, int], BenchRow] = {}
     for (n, it) in sizes:
         try:
             baselines[(n, it)] = find_baseline(rows, n, it)
@@ -171,11 +454,13 @@ def _strong_metrics(rows: List[BenchRow]) -> List[Dict[str, object]]:
         if key not in baselines:
             continue
 
-        t_seq1 = baselines[key]
-        t_self1 = find_self_baseline(rows, r.version, r.n_bats, r.iters)
-        if t_self1 is None:
+        seq_base = baselines[key]
+        self_base = find_self_baseline(rows, r.version, r.n_bats, r.iters)
+        if self_base is None:
             # If a version doesn't have p=1 data, we cannot compute self-baseline metrics.
-            t_self1 = t_seq1
+            self_base = seq_base
+        t_seq1 = seq_base.time_s
+        t_self1 = self_base.time_s
 
         p = r.p
         speedup_seq = t_seq1 / r.time_s if r.time_s > 0 else 0.0
@@ -206,6 +491,7 @@ def _strong_metrics(rows: List[BenchRow]) -> List[Dict[str, object]]:
                 "efficiency_seq": eff_seq,
                 "speedup_self": speedup_self,
                 "efficiency_self": eff_self,
+                **_intervals(seq_base, self_base, r, p, per_p=True),
             }
         )
     return out
@@ -286,6 +572,7 @@ def _weak_metrics(rows: List[BenchRow]) -> List[Dict[str, object]]:
                         "efficiency_seq": weak_eff_seq,
                         "speedup_self": weak_eff_self,
                         "efficiency_self": weak_eff_self,
+                        **_intervals(baseline, baseline_self or baseline, r, p, per_p=False),
                     }
                 )
 
@@ -310,6 +597,7 @@ def _weak_metrics(rows: List[BenchRow]) -> List[Dict[str, object]]:
                     "efficiency_seq": 1.0,
                     "speedup_self": 1.0,
                     "efficiency_self": 1.0,
+                    **_intervals(baseline, baseline, baseline, 1, per_p=False),
                 }
             )
 
@@ -335,6 +623,100 @@ def compute_metrics(rows: List[BenchRow]) -> List[Dict[str, object]]:
     return strong + weak
 
 
+def phase_breakdown(rows: List[BenchRow]) -> List[Dict[str, object]]:
+    """Per-phase times of the profiled runs, fastest repeat per configuration."""
+    best: Dict[Tuple[str, int, int, int, int], BenchRow] = {}
+    for r in rows:
+        if "prof_update_avg" not in r.prof:
+            continue
+        k = (r.version, r.n_bats, r.iters, r.procs, r.threads)
+        if k not in best or r.time_s < best[k].time_s:
+            best[k] = r
+
+    out: List[Dict[str, object]] = []
+    for k in sorted(best):
+        r = best[k]
+        m: Dict[str, object] = {
+            "version": r.version,
+            "n_bats": r.n_bats,
+            "iters": r.iters,
+            "procs": r.procs,
+            "threads": r.threads,
+            "p": r.p,
+            "time_s": r.time_s,
+            "workers": int(r.prof.get("prof_workers", 0)),
+        }
+        for ph in PROF_PHASES:
+            for stat in ("min", "avg", "max"):
+                m[f"{ph}_{stat}"] = r.prof.get(f"prof_{ph}_{stat}", 0.0)
+        for c in PROF_COUNTERS:
+            m[c] = r.prof.get(c, "")
+        out.append(m)
+    return out
+
+
+def device_comparison(rows: List[BenchRow]) -> List[Dict[str, object]]:
+    """GPU runs against the sequential and the fastest CPU run of the same problem and size."""
+    out: List[Dict[str, object]] = []
+    for r in sorted((r for r in rows if r.version.startswith("gpu")), key=lambda r: (r.version, r.n_bats, r.iters)):
+        same = [c for c in rows if not c.version.startswith("gpu") and c.problem == r.problem
+                and c.n_bats == r.n_bats and c.iters == r.iters]
+        seq = [c.time_s for c in same if c.version.startswith("sequential")]
+        cpu = min(same, key=lambda c: c.time_s) if same else None
+        t_seq1 = min(seq) if seq else None
+        out.append(
+            {
+                "version": r.version,
+                "n_bats": r.n_bats,
+                "iters": r.iters,
+                "time_s": r.time_s,
+                **{k: r.device.get(k, "") for k in DEVICE_FIELDS},
+                "T_seq1_s": t_seq1 if t_seq1 is not None else "",
+                "speedup_seq": t_seq1 / r.time_s if t_seq1 is not None and r.time_s > 0 else "",
+                "cpu_version": cpu.version if cpu else "",
+                "cpu_p": cpu.p if cpu else "",
+                "T_cpu_s": cpu.time_s if cpu else "",
+                "speedup_cpu": cpu.time_s / r.time_s if cpu and r.time_s > 0 else "",
+            }
+        )
+    return out
+
+
+def try_plot_phases(phases: List[Dict[str, object]], outdir: str) -> None:
+    """One stacked bar chart (average worker per phase vs p) per version and size."""
+    try:
+        import matplotlib.pyplot as plt  # type: ignore
+    except Exception:
+        return
+
+    groups: Dict[Tuple[str, int, int], List[Dict[str, object]]] = {}
+    for m in phases:
+        groups.setdefault((str(m["version"]), int(m["n_bats"]), int(m["iters"])), []).append(m)
+
+    for (version, n_bats, iters), ms in sorted(groups.items()):
+        ms = sorted(ms, key=lambda x: (int(x["p"]), int(x["procs"])))
+        labels = [f"{m['procs']}x{m['threads']}" if m["procs"] != 1 and m["threads"] != 1 else str(m["p"]) for m in ms]
+        xs = list(range(len(ms)))
+        bottom = [0.0 for _ in ms]
+
+        plt.figure()
+        for ph in PROF_PHASES:
+            ys = [float(m[f"{ph}_avg"]) for m in ms]
+            if not any(ys):
+                continue
+            plt.bar(xs, ys, bottom=bottom, label=ph)
+            bottom = [b + y for b, y in zip(bottom, ys)]
+        plt.plot(xs, [float(m["time_s"]) for m in ms], "k_", markersize=20, label="time_s")
+        plt.xticks(xs, labels)
+        plt.xlabel("p (threads, MPI processes or procs x threads)")
+        plt.ylabel("Time per worker (s)")
+        plt.title(f"Phase breakdown: {version} nbats{n_bats} it{iters}")
+        plt.grid(True, axis="y", alpha=0.3)
+        plt.legend()
+        plt.savefig(os.path.join(outdir, f"phases_{version}_nbats{n_bats}_it{iters}.png"), dpi=150, bbox_inches="tight")
+        plt.close()
+
+
 def try_plot(metrics: List[Dict[str, object]], outdir: str) -> None:
     try:
         import matplotlib.pyplot as plt  # type: ignore
@@ -342,11 +724,22 @@ def try_plot(metrics: List[Dict[str, object]], outdir: str) -> None:
         print("matplotlib not available; skipping plots. Install with: pip install matplotlib")
         return
 
-    def _series(ms: List[Dict[str, object]], ykey: str) -> Tuple[List[int], List[float]]:
+    def _series(ms: List[Dict[str, object]], ykey: str, label: str) -> None:
+        """One curve against p, with the confidence intervals as error bars; unstable points get a red cross."""
         ms = sorted(ms, key=lambda x: int(x["p"]))
         xs = [int(x["p"]) for x in ms]
         ys = [float(x[ykey]) for x in ms]
-        return xs, ys
+        lo_key, hi_key = ("time_ci_lo", "time_ci_hi") if ykey == "time_s" else (f"{ykey}_lo", f"{ykey}_hi")
+        if all(m.get(lo_key, "") != "" and m.get(hi_key, "") != "" for m in ms):
+            yerr = [[max(0.0, y - float(m[lo_key])) for y, m in zip(ys, ms)],
+                    [max(0.0, float(m[hi_key]) - y) for y, m in zip(ys, ms)]]
+            plt.errorbar(xs, ys, yerr=yerr, marker="o", capsize=3, label=label)
+        else:
+            plt.plot(xs, ys, marker="o", label=label)
+        bad = [(x, y) for x, y, m in zip(xs, ys, ms) if m.get("unstable")]
+        if bad:
+            plt.scatter([x for x, _ in bad], [y for _, y in bad], marker="x", color="red", s=80, zorder=3,
+                        label=f"{label} (unstable)")
 
     def plot_compare_strong(n_bats: int, iters: int, ms: List[Dict[str, object]]) -> None:
         # Split by version
@@ -364,11 +757,9 @@ def try_plot(metrics: List[Dict[str, object]], outdir: str) -> None:
         # Time
         plt.figure()
         if omp:
-            x, y = _series(omp, "time_s")
-            plt.plot(x, y, marker="o", label="OpenMP")
+            _series(omp, "time_s", "OpenMP")
         if mpi:
-            x, y = _series(mpi, "time_s")
-            plt.plot(x, y, marker="o", label="MPI")
+            _series(mpi, "time_s", "MPI")
         if t_seq1 > 0:
             plt.axhline(t_seq1, linestyle="--", linewidth=1.0, label="Sequential (p=1)")
         plt.xlabel("p (threads or MPI processes)")
@@ -382,11 +773,9 @@ def try_plot(metrics: List[Dict[str, object]], outdir: str) -> None:
         def _plot_speed_eff(ykey: str, ylabel: str, filename: str, ideal: str) -> None:
             plt.figure()
             if omp:
-                x, y = _series(omp, ykey)
-                plt.plot(x, y, marker="o", label="OpenMP")
+                _series(omp, ykey, "OpenMP")
             if mpi:
-                x, y = _series(mpi, ykey)
-                plt.plot(x, y, marker="o", label="MPI")
+                _series(mpi, ykey, "MPI")
             # Ideal line (strong scaling)
             x_ideal = sorted({int(m["p"]) for m in omp + mpi})
             if x_ideal:
@@ -423,11 +812,9 @@ def try_plot(metrics: List[Dict[str, object]], outdir: str) -> None:
         # Time (ideal is constant time at baseline)
         plt.figure()
         if omp:
-            x, y = _series(omp, "time_s")
-            plt.plot(x, y, marker="o", label="OpenMP")
+            _series(omp, "time_s", "OpenMP")
         if mpi:
-            x, y = _series(mpi, "time_s")
-            plt.plot(x, y, marker="o", label="MPI")
+            _series(mpi, "time_s", "MPI")
         if t_base_seq > 0:
             plt.axhline(t_base_seq, linestyle="--", linewidth=1.0, label="ideal (constant time)")
         plt.xlabel("p (threads or MPI processes)")
@@ -441,11 +828,9 @@ def try_plot(metrics: List[Dict[str, object]], outdir: str) -> None:
         def _plot_eff(ykey: str, ylabel: str, filename: str) -> None:
             plt.figure()
             if omp:
-                x, y = _series(omp, ykey)
-                plt.plot(x, y, marker="o", label="OpenMP")
+                _series(omp, ykey, "OpenMP")
             if mpi:
-                x, y = _series(mpi, ykey)
-                plt.plot(x, y, marker="o", label="MPI")
+                _series(mpi, ykey, "MPI")
             x_ideal = sorted({int(m["p"]) for m in omp + mpi})
             if x_ideal:
                 plt.plot(x_ideal, [1.0 for _ in x_ideal], linestyle="--", label="ideal")
@@ -484,17 +869,38 @@ def main() -> None:
     ap = argparse.ArgumentParser()
     ap.add_argument("--input", required=True, help="Input text file containing program output with BENCH lines")
     ap.add_argument("--outdir", default="bench_out", help="Output directory (CSV + PNG plots)")
+    ap.add_argument("--confidence", type=float, default=0.95, help="Level of the median confidence intervals (default 0.95)")
+    ap.add_argument("--min-reps", type=int, default=3, help="Fewer repeats flag a point as unstable (default 3)")
+    ap.add_argument("--max-spread", type=float, default=0.05,
+                    help="Relative IQR (IQR / median) above which a point is unstable (default 0.05)")
+    ap.add_argument("--max-ci", type=float, default=0.10,
+                    help="Relative CI width (width / median) above which a point is unstable (default 0.10)")
     args = ap.parse_args()
 
     os.makedirs(args.outdir, exist_ok=True)
 
     with open(args.input, "r", encoding="utf-8") as f:
-        rows = parse_lines(f)
+        lines = f.readlines()
+    rows = parse_lines(lines)
+    micro = parse_micro_lines(lines)
+
+    if micro:
+        micro_path = os.path.join(args.outdir, "microbench.csv")
+        with open(micro_path, "w", newline="", encoding="utf-8") as f:
+            w = csv.DictWriter(f, fieldnames=list(MICRO_FIELDS))
+            w.writeheader()
+            for m in micro:
+                w.writerow(m)
+        print(f"Wrote {micro_path}")
+        try_plot_micro(micro, args.outdir)
+        if not rows:
+            return
 
     if not rows:
-        raise SystemExit("No BENCH lines found in input.")
+        raise SystemExit("No BENCH or MICRO lines found in input.")
 
-    metrics = compute_metrics(rows)
+    points = summarize(rows, args.confidence, args.max_spread, args.max_ci, args.min_reps)
+    metrics = compute_metrics(points)
 
     # Write CSV
     csv_path = os.path.join(args.outdir, "bench_metrics.csv")
@@ -520,6 +926,8 @@ def main() -> None:
                 "efficiency_seq",
                 "speedup_self",
                 "efficiency_self",
+                *STAT_FIELDS,
+                *(f"{k}_{end}" for k in RATIO_FIELDS for end in ("lo", "hi")),
             ],
         )
         w.writeheader()
@@ -528,8 +936,50 @@ def main() -> None:
 
     print(f"Wrote {csv_path}")
 
+    # Repeat statistics of every point
+    stability_path = os.path.join(args.outdir, "bench_stability.csv")
+    with open(stability_path, "w", newline="", encoding="utf-8") as f:
+        w = csv.DictWriter(f, fieldnames=["version", "n_bats", "iters", "procs", "threads", "p", "time_median",
+                                          *STAT_FIELDS, "placement"])
+        w.writeheader()
+        for r in points:
+            w.writerow({"version": r.version, "n_bats": r.n_bats, "iters": r.iters, "procs": r.procs,
+                        "threads": r.threads, "p": r.p, "time_median": r.time_s, **r.stats,
+                        "placement": r.placement})
+    print(f"Wrote {stability_path}")
+    unstable = [r for r in points if r.stats["unstable"]]
+    if unstable:
+        print(f"{len(unstable)} of {len(points)} points are unstable:")
+        for r in unstable:
+            print(f"  {r.version} n_bats={r.n_bats} iters={r.iters} procs={r.procs} threads={r.threads}: "
+                  f"median {r.time_s:.6f}s over {r.stats['reps']} repeats, {r.stats['unstable_reason']}")
+
+    # Phase breakdown of the profiled runs
+    phases = phase_breakdown(rows)
+    if phases:
+        phases_path = os.path.join(args.outdir, "bench_phases.csv")
+        with open(phases_path, "w", newline="", encoding="utf-8") as f:
+            w = csv.DictWriter(f, fieldnames=list(phases[0].keys()))
+            w.writeheader()
+            for m in phases:
+                w.writerow(m)
+        print(f"Wrote {phases_path}")
+
+    # GPU runs against the CPU versions
+    device = device_comparison(points)
+    if device:
+        device_path = os.path.join(args.outdir, "bench_device.csv")
+        with open(device_path, "w", newline="", encoding="utf-8") as f:
+            w = csv.DictWriter(f, fieldnames=list(device[0].keys()))
+            w.writeheader()
+            for m in device:
+                w.writerow(m)
+        print(f"Wrote {device_path}")
+
     # Plots
     try_plot(metrics, args.outdir)
+    if phases:
+        try_plot_phases(phases, args.outdir)
 
 
 if __name__ == "__main__":
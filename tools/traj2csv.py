@@ -0,0 +1,103 @@
+#!/usr/bin/env python3
+"""Convert a binary trajectory (--traj FILE) to CSV.
+
+Usage:
+  python3 tools/traj2csv.py code/traj.bin --output traj.csv
+  python3 tools/traj2csv.py code/traj.bin --frames snapshots/
+
+The first form writes one CSV with a header line and one row per bat and
+frame:
+
+  iter,bat,x0,x1,...
+
+The second form writes one file per frame, `snapshot_t<iter>.csv`, with one
+line of coordinates per bat: the same format as the CSV snapshots of the
+sequential version, so the existing plotting scripts can read them.
+
+The binary format is described in code/include/bat_traj.h:
+  header : magic "BATTRAJ1", uint32 version, uint32 value_size (4 or 8),
+           int64 n_bats, int32 dim, int32 every (32 bytes, native order)
+  frame  : int64 iteration, then n_bats * dim float/double values, bat-major
+"""
+
+from __future__ import annotations
+
+import argparse
+import os
+import struct
+import sys
+from array import array
+from typing import BinaryIO, Iterator, Tuple
+
+MAGIC = b"BATTRAJ1"
+HEADER = struct.Struct("=8sIIqii")
+FRAME_HEAD = struct.Struct("=q")
+
+
+def read_header(fp: BinaryIO) -> Tuple[int, int, int, int]:
+    """Return (value_size, n_bats, dim, every) from a trajectory header."""
+    raw = fp.read(HEADER.size)
+    if len(raw) != HEADER.size:
+        raise ValueError("file too short for a trajectory header")
+    magic, version, value_size, n_bats, dim, every = HEADER.unpack(raw)
+    if magic != MAGIC:
+        raise ValueError("not a bat trajectory (bad magic)")
+    if version != 1 or value_size not in (4, 8):
+        raise ValueError(f"unsupported trajectory version={version} value_size={value_size}")
+    return value_size, n_bats, dim, every
+
+
+def frames(fp: BinaryIO, value_size: int, n_bats: int, dim: int) -> Iterator[Tuple[int, array]]:
+    """Yield (iteration, values) for every complete frame."""
+    payload = n_bats * dim * value_size
+    while True:
+        head = fp.read(FRAME_HEAD.size)
+        if len(head) < FRAME_HEAD.size:
+            return
+        body = fp.read(payload)
+        if len(body) < payload:
+            print("warning: truncated last frame ignored", file=sys.stderr)
+            return
+        values = array("f" if value_size == 4 else "d")
+        values.frombytes(body)
+        yield FRAME_HEAD.unpack(head)[0], values
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("input", help="binary trajectory written with --traj")
+    parser.add_argument("--output", "-o", help="single CSV output (default: stdout)")
+    parser.add_argument("--frames", metavar="DIR", help="write one snapshot_t<iter>.csv per frame into DIR")
+    args = parser.parse_args()
+
+    with open(args.input, "rb") as fp:
+        value_size, n_bats, dim, every = read_header(fp)
+
+        if args.frames:
+            os.makedirs(args.frames, exist_ok=True)
+            count = 0
+            for it, values in frames(fp, value_size, n_bats, dim):
+                path = os.path.join(args.frames, f"snapshot_t{it:06d}.csv")
+                with open(path, "w") as out:
+                    for i in range(n_bats):
+                        row = values[i * dim:(i + 1) * dim]
+                        out.write(",".join(f"{v:f}" for v in row) + "\n")
+                count += 1
+            print(f"{count} frames ({n_bats} bats, dim {dim}, every {every}) -> {args.frames}", file=sys.stderr)
+            return 0
+
+        out = open(args.output, "w") if args.output else sys.stdout
+        try:
+            out.write("iter,bat," + ",".join(f"x{d}" for d in range(dim)) + "\n")
+            for it, values in frames(fp, value_size, n_bats, dim):
+                for i in range(n_bats):
+                    row = values[i * dim:(i + 1) * dim]
+                    out.write(f"{it},{i}," + ",".join(f"{v:.17g}" for v in row) + "\n")
+        finally:
+            if out is not sys.stdout:
+                out.close()
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -0,0 +1,188 @@
+#!/usr/bin/env python3
+"""Compare the digest files of two or more runs (--verify FILE).
+
+Usage:
+  python3 tools/verify_diff.py seq.verify omp.verify mpi.verify
+  python3 tools/verify_diff.py --rtol 1e-12 old.verify new.verify
+  python3 tools/verify_diff.py --ftol 1e-4 double.verify float.verify
+
+Every file after the first is compared with the first one (the reference).
+The runs must describe the same problem (n_bats, dim, seed and objective of
+the header line); the version may differ. For each iteration present in both
+files:
+
+- best, index, x and sum (population checksum) must be identical: they are
+  printed with %.17g / hex, so a textual match is a bit-for-bit match
+- A_sum (loudness sum) must match within --rtol (default 0: exact; the sum
+  is exact in every version, see code/include/bat_stats.h)
+
+A run with another precision than the reference (--precision mixed|float
+against double, see code/include/bat_pop.h) rounds every move, so its
+population legitimately differs. For such a pair only best and A_sum are
+compared, within --ftol (relative, against max(1, |value|); default 1e-4),
+and the largest deviation of best is reported.
+
+The first differing iteration and its fields are reported for every file,
+as well as iterations missing from either side (--verify-every differs, or
+one run stopped earlier). The exit status is 0 if all files match, 1 if any
+of them differs and 2 on unreadable input.
+
+The format is described in code/include/bat_verify.h:
+  # BATVERIFY 1 version=<name> n_bats=<N> dim=<D> seed=<S> objective=<name> precision=<name>
+  t=<t> best=<value> index=<i> A_sum=<sum> sum=<checksum> x=<x0,x1,...>
+"""
+
+from __future__ import annotations
+
+import argparse
+import sys
+from typing import Dict, List, Tuple
+
+MAGIC = "# BATVERIFY 1"
+PROBLEM_KEYS = ("n_bats", "dim", "seed", "objective")
+EXACT_FIELDS = ("best", "index", "sum", "x")
+APPROX_FIELDS = ("best", "A_sum")
+
+
+def parse_fields(text: str) -> Dict[str, str]:
+    """Split `key=value key=value ...` into a dict."""
+    fields = {}
+    for token in text.split():
+        key, sep, value = token.partition("=")
+        if not sep:
+            raise ValueError(f"malformed field {token!r}")
+        fields[key] = value
+    return fields
+
+
+def read_digests(path: str) -> Tuple[Dict[str, str], Dict[int, Dict[str, str]]]:
+    """Return (header fields, {t: digest fields}) of a digest file."""
+    with open(path) as fp:
+        first = fp.readline()
+        if not first.startswith(MAGIC):
+            raise ValueError(f"{path}: not a digest file (missing '{MAGIC}' header)")
+        header = parse_fields(first[len(MAGIC):])
+        digests = {}
+        for lineno, line in enumerate(fp, start=2):
+            if not line.strip():
+                continue
+            try:
+                fields = parse_fields(line)
+                t = int(fields["t"])
+                for key in EXACT_FIELDS + ("A_sum",):
+                    fields[key]
+            except (KeyError, ValueError) as exc:
+                raise ValueError(f"{path}:{lineno}: malformed digest ({exc})") from None
+            digests[t] = fields
+    return header, digests
+
+
+def diff_fields(ref: Dict[str, str], other: Dict[str, str], rtol: float) -> List[str]:
+    """Names (with values) of the fields of one digest that do not match."""
+    diffs = [f"{key}: {ref[key]} != {other[key]}" for key in EXACT_FIELDS if ref[key] != other[key]]
+    a_ref, a_other = float(ref["A_sum"]), float(other["A_sum"])
+    if abs(a_ref - a_other) > rtol * max(abs(a_ref), abs(a_other)):
+        diffs.append(f"A_sum: {ref['A_sum']} != {other['A_sum']} (rtol {rtol:g})")
+    return diffs
+
+
+def deviation(ref: str, other: str) -> float:
+    """Difference of two values relative to max(1, |value|)."""
+    a, b = float(ref), float(other)
+    return abs(a - b) / max(1.0, abs(a), abs(b))
+
+
+def diff_approx(ref: Dict[str, str], other: Dict[str, str], ftol: float) -> List[str]:
+    """Fields of one digest that differ by more than ftol (runs of different precisions)."""
+    return [f"{key}: {ref[key]} != {other[key]} (deviation {deviation(ref[key], other[key]):.3g} > ftol {ftol:g})"
+            for key in APPROX_FIELDS if deviation(ref[key], other[key]) > ftol]
+
+
+def precision(header: Dict[str, str]) -> str:
+    """Precision of a run (files written before --precision existed are double)."""
+    return header.get("precision", "double")
+
+
+def describe(path: str, header: Dict[str, str]) -> str:
+    if precision(header) != "double":
+        return f"{path} ({header.get('version', '?')}, {precision(header)})"
+    return f"{path} ({header.get('version', '?')})"
+
+
+def compare(ref_path: str, ref: Tuple[Dict[str, str], Dict[int, Dict[str, str]]],
+            path: str, run: Tuple[Dict[str, str], Dict[int, Dict[str, str]]], rtol: float, ftol: float) -> bool:
+    """Print the comparison of one run with the reference; True if they match."""
+    ref_header, ref_digests = ref
+    header, digests = run
+    name = describe(path, header)
+
+    problem = [k for k in PROBLEM_KEYS if ref_header.get(k) != header.get(k)]
+    if problem:
+        print(f"{name}: different problem: "
+              + ", ".join(f"{k}={header.get(k)} (reference {ref_header.get(k)})" for k in problem))
+        return False
+
+    common = sorted(set(ref_digests) & set(digests))
+    only_ref = len(set(ref_digests) - set(digests))
+    only_run = len(set(digests) - set(ref_digests))
+    if not common:
+        print(f"{name}: no iteration in common with {describe(ref_path, ref_header)}")
+        return False
+
+    approx = precision(header) != precision(ref_header)
+    mismatches = 0
+    worst, worst_t = 0.0, common[0]
+    for t in common:
+        if approx:
+            diffs = diff_approx(ref_digests[t], digests[t], ftol)
+            dev = deviation(ref_digests[t]["best"], digests[t]["best"])
+            if dev > worst:
+                worst, worst_t = dev, t
+        else:
+            diffs = diff_fields(ref_digests[t], digests[t], rtol)
+        if diffs:
+            if mismatches == 0:
+                print(f"{name}: first difference at t={t}")
+                for d in diffs:
+                    print(f"  {d}")
+            mismatches += 1
+
+    missing = ""
+    if only_ref or only_run:
+        missing = f" ({only_ref} iterations only in the reference, {only_run} only in this run)"
+    if approx:
+        missing += (f" [best and A_sum compared with the {precision(ref_header)} run, ftol {ftol:g};"
+                    f" largest deviation of best {worst:.3g} at t={worst_t}]")
+    if mismatches:
+        print(f"{name}: {mismatches} of {len(common)} iterations differ{missing}")
+        return False
+    print(f"{name}: {len(common)} iterations match (t={common[0]}..{common[-1]}){missing}")
+    return True
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("files", nargs="+", help="digest files written with --verify (the first is the reference)")
+    parser.add_argument("--rtol", type=float, default=0.0, help="relative tolerance on A_sum (default 0: exact)")
+    parser.add_argument("--ftol", type=float, default=1e-4,
+                        help="tolerance on best and A_sum between runs of different precisions (default 1e-4)")
+    args = parser.parse_args()
+    if len(args.files) < 2:
+        parser.error("need at least two digest files")
+
+    try:
+        runs = [read_digests(path) for path in args.files]
+    except (OSError, ValueError) as exc:
+        print(f"error: {exc}", file=sys.stderr)
+        return 2
+
+    ref_path, ref = args.files[0], runs[0]
+    print(f"reference: {describe(ref_path, ref[0])}, {len(ref[1])} digests")
+    ok = True
+    for path, run in zip(args.files[1:], runs[1:]):
+        ok = compare(ref_path, ref, path, run, args.rtol, args.ftol) and ok
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())